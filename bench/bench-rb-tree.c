@@ -0,0 +1,1011 @@
+/**
+ * @file bench-rb-tree.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief micro benchmark of the red black tree variants
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * Usage: bench.out [nr_keys] [nr_threads]. The rows of the first table
+ * measure the CPU time of one thread. The rows of the second table run
+ * nr_threads threads (rb_tree_apply_batch(1) runs one), so they measure the
+ * wall clock time.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "rb-tree.h"
+#include "rb-generate.h"
+#include "rb-frozen.h"
+#include "rb-index.h"
+#include "rb-bucket-tree.h"
+#include "rb-small-tree.h"
+#include "rb-pool-tree.h"
+#include "rb-td-tree.h"
+#include "rb-fc-tree.h"
+
+#define BENCH_DEFAULT_SIZE (1000000)
+#define BENCH_ROUNDS (4)
+#define BENCH_TINY_KEYS (8) /**< average keys of a tiny tree */
+#define BENCH_DEFAULT_THREADS (16)
+
+struct bench_item {
+        uint64_t key; /**< hot fields (key and links) first */
+        RB_GEN_ENTRY(bench_item) entry;
+        void *data;
+};
+
+RB_GEN_HEAD(bench_tree, bench_item);
+RB_GENERATE_STATIC(bench_tree, bench_item, entry, uint64_t, key, RB_GEN_CMP)
+
+static uint64_t bench_seed = 0x9E3779B97F4A7C15ULL;
+static int bench_nr_threads = BENCH_DEFAULT_THREADS;
+
+/**
+ * @brief xorshift64 pseudo random generator
+ *
+ * @return uint64_t random value
+ */
+static uint64_t bench_rand(void)
+{
+        bench_seed ^= bench_seed << 13;
+        bench_seed ^= bench_seed >> 7;
+        bench_seed ^= bench_seed << 17;
+        return bench_seed;
+}
+
+/**
+ * @brief Best (minimum) time of each operation over the rounds
+ *
+ */
+struct bench_result {
+        const char *name;
+        double insert, search, delete;
+        double scan; /**< in-order visit per key */
+        double bytes_per_key; /**< node (and bucket) bytes per key */
+        struct rb_relayout_stats relayout; /**< rb_tree_relayout only */
+};
+
+/**
+ * @brief Keep the best nanoseconds per operation
+ *
+ * @param best best time stored location (0 means not measured yet)
+ * @param start start clock
+ * @param nr_ops number of the operations
+ */
+static void bench_update(double *best, clock_t start, size_t nr_ops)
+{
+        double ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC /
+                    (double)nr_ops;
+
+        if (*best == 0 || ns < *best) {
+                *best = ns;
+        }
+}
+
+/**
+ * @brief Wall clock time of the multi-threaded rows
+ *
+ * @return double nanoseconds of CLOCK_MONOTONIC
+ */
+static double bench_wall_now(void)
+{
+        struct timespec now;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+static void bench_update_wall(double *best, double start, size_t nr_ops)
+{
+        double ns = (bench_wall_now() - start) / (double)nr_ops;
+
+        if (*best == 0 || ns < *best) {
+                *best = ns;
+        }
+}
+
+static void bench_print(double ns)
+{
+        if (ns == 0) { /**< not supported by the variant */
+                printf(" %10s", "-");
+                return;
+        }
+        printf(" %10.1f", ns);
+}
+
+static void bench_report(const struct bench_result *result)
+{
+        printf("%-28s", result->name);
+        bench_print(result->insert);
+        bench_print(result->search);
+        bench_print(result->delete);
+        bench_print(result->scan);
+        printf("\n");
+}
+
+/**
+ * @brief The tree of the same keys (insert includes the relayout if it is set)
+ */
+static void bench_rb_tree_layout(struct bench_result *result,
+                                 const key_t *keys, const key_t *lookups,
+                                 size_t n, int relayout)
+{
+        struct rb_tree *tree = rb_tree_alloc();
+        size_t found = 0, scanned = 0;
+        clock_t start;
+
+        start = clock();
+        for (size_t i = 0; i < n; i++) {
+                rb_tree_insert(tree, keys[i], NULL);
+        }
+        if (relayout) {
+                rb_tree_relayout(tree, &result->relayout);
+        }
+        bench_update(&result->insert, start, n);
+
+        start = clock();
+        for (size_t i = 0; i < n; i++) {
+                found += (rb_tree_search(tree, lookups[i]) != NULL);
+        }
+        bench_update(&result->search, start, n);
+
+        start = clock();
+        for (struct rb_node *node = rb_tree_minimum(tree, tree->root);
+             node != tree->nil; node = rb_tree_successor(tree, node)) {
+                scanned += (node->data == NULL);
+        }
+        bench_update(&result->scan, start, n);
+        if (!relayout) {
+                result->bytes_per_key = (double)sizeof(struct rb_node);
+        }
+
+        start = clock();
+        for (size_t i = 0; i < n; i++) {
+                rb_tree_delete(tree, keys[i]);
+        }
+        bench_update(&result->delete, start, n);
+
+        if (found != n || scanned != n) {
+                printf("%s: lookup mismatch (%zu/%zu)\n", result->name, found,
+                       n);
+        }
+        rb_tree_dealloc(tree);
+}
+
+static void bench_rb_tree(struct bench_result *result, const key_t *keys,
+                          const key_t *lookups, size_t n)
+{
+        bench_rb_tree_layout(result, keys, lookups, n, 0);
+}
+
+static void bench_rb_tree_veb(struct bench_result *result, const key_t *keys,
+                              const key_t *lookups, size_t n)
+{
+        bench_rb_tree_layout(result, keys, lookups, n, 1);
+}
+
+/**
+ * @brief Frozen index of the same keys (insert includes the freeze)
+ */
+static void bench_rb_frozen_layout(struct bench_result *result,
+                                   const key_t *keys, const key_t *lookups,
+                                   size_t n, enum rb_frozen_layout layout)
+{
+        struct rb_tree *tree = rb_tree_alloc();
+        struct rb_frozen *frozen = NULL;
+        size_t found = 0;
+        clock_t start;
+
+        start = clock();
+        for (size_t i = 0; i < n; i++) {
+                rb_tree_insert(tree, keys[i], NULL);
+        }
+        frozen = rb_tree_freeze_layout(tree, layout);
+        bench_update(&result->insert, start, n);
+        if (!frozen) {
+                rb_tree_dealloc(tree);
+                return;
+        }
+
+        start = clock();
+        for (size_t i = 0; i < n; i++) {
+                found += (rb_frozen_search(frozen, lookups[i], NULL) == 0);
+        }
+        bench_update(&result->search, start, n);
+
+        if (found != n) {
+                printf("%s: lookup mismatch (%zu/%zu)\n", result->name, found,
+                       n);
+        }
+        rb_frozen_dealloc(frozen);
+        rb_tree_dealloc(tree);
+}
+
+static void bench_rb_frozen(struct bench_result *result, const key_t *keys,
+                            const key_t *lookups, size_t n)
+{
+        bench_rb_frozen_layout(result, keys, lookups, n, RB_FROZEN_EYTZINGER);
+}
+
+static void bench_rb_frozen_kary(struct bench_result *result,
+                                 const key_t *keys, const key_t *lookups,
+                                 size_t n)
+{
+        bench_rb_frozen_layout(result, keys, lookups, n, RB_FROZEN_KARY);
+}
+
+static int bench_count(key_t key, void *data, void *arg)
+{
+        (void)key;
+        *(size_t *)arg += (data == NULL);
+        return 0;
+}
+
+/**
+ * @brief The index of the engine (the same call sites for every engine)
+ */
+static void bench_rb_index(struct bench_result *result, const key_t *keys,
+                           const key_t *lookups, size_t n,
+                           enum rb_index_engine engine)
+{
+        struct rb_index *index = rb_index_alloc(engine);
+        size_t found = 0, scanned = 0;
+        clock_t start;
+
+        start = clock();
+        for (size_t i = 0; i < n; i++) {
+                rb_index_insert(index, keys[i], NULL);
+        }
+        bench_update(&result->insert, start, n);
+
+        start = clock();
+        for (size_t i = 0; i < n; i++) {
+                found += (rb_index_search(index, lookups[i], NULL) == 0);
+        }
+        bench_update(&result->search, start, n);
+
+        start = clock();
+        rb_index_for_each(index, 0, RB_MAX_KEY, bench_count, &scanned);
+        bench_update(&result->scan, start, n);
+        if (engine == RB_INDEX_RB_TREE) {
+                result->bytes_per_key = (double)sizeof(struct rb_node);
+        } else if (engine == RB_INDEX_BUCKET) {
+                result->bytes_per_key = (double)rb_bucket_tree_bytes(
+                                                (struct rb_bucket_tree *)
+                                                        index->impl) /
+                                        (double)n;
+        } else if (engine == RB_INDEX_SMALL) {
+                result->bytes_per_key = (double)rb_small_tree_bytes(
+                                                (struct rb_small_tree *)
+                                                        index->impl) /
+                                        (double)n;
+        } else if (engine == RB_INDEX_POOL) {
+                result->bytes_per_key = (double)rb_pool_tree_bytes(
+                                                (struct rb_pool_tree *)
+                                                        index->impl) /
+                                        (double)n;
+        } else if (engine == RB_INDEX_TD) {
+                result->bytes_per_key = (double)rb_td_tree_bytes(
+                                                (struct rb_td_tree *)
+                                                        index->impl) /
+                                        (double)n;
+        }
+
+        start = clock();
+        for (size_t i = 0; i < n; i++) {
+                rb_index_delete(index, keys[i]);
+        }
+        bench_update(&result->delete, start, n);
+
+        if (found != n || scanned != n) {
+                printf("%s: lookup mismatch (%zu/%zu)\n", result->name, found,
+                       n);
+        }
+        rb_index_dealloc(index);
+}
+
+static void bench_rb_index_tree(struct bench_result *result,
+                                const key_t *keys, const key_t *lookups,
+                                size_t n)
+{
+        bench_rb_index(result, keys, lookups, n, RB_INDEX_RB_TREE);
+}
+
+static void bench_rb_index_bptree(struct bench_result *result,
+                                  const key_t *keys, const key_t *lookups,
+                                  size_t n)
+{
+        bench_rb_index(result, keys, lookups, n, RB_INDEX_BPTREE);
+}
+
+static void bench_rb_index_art(struct bench_result *result, const key_t *keys,
+                               const key_t *lookups, size_t n)
+{
+        bench_rb_index(result, keys, lookups, n, RB_INDEX_ART);
+}
+
+static void bench_rb_index_bucket(struct bench_result *result,
+                                  const key_t *keys, const key_t *lookups,
+                                  size_t n)
+{
+        bench_rb_index(result, keys, lookups, n, RB_INDEX_BUCKET);
+}
+
+static void bench_rb_index_small(struct bench_result *result,
+                                 const key_t *keys, const key_t *lookups,
+                                 size_t n)
+{
+        bench_rb_index(result, keys, lookups, n, RB_INDEX_SMALL);
+}
+
+static void bench_rb_index_pool(struct bench_result *result,
+                                const key_t *keys, const key_t *lookups,
+                                size_t n)
+{
+        bench_rb_index(result, keys, lookups, n, RB_INDEX_POOL);
+}
+
+static void bench_rb_index_td(struct bench_result *result, const key_t *keys,
+                              const key_t *lookups, size_t n)
+{
+        bench_rb_index(result, keys, lookups, n, RB_INDEX_TD);
+}
+
+/**
+ * @brief Bytes of the tree structure and its nodes (without rb_index)
+ */
+static size_t bench_tiny_bytes(struct rb_index *index)
+{
+        struct rb_tree *tree = NULL;
+        struct rb_node *node = NULL;
+        size_t bytes = sizeof(struct rb_tree);
+
+        if (index->engine == RB_INDEX_SMALL) {
+                return rb_small_tree_bytes((struct rb_small_tree *)index->impl);
+        }
+        tree = (struct rb_tree *)index->impl;
+        for (node = rb_tree_minimum(tree, tree->root); node != tree->nil;
+             node = rb_tree_successor(tree, node)) {
+                bytes += sizeof(struct rb_node);
+        }
+        return bytes;
+}
+
+/**
+ * @brief Many tiny indexes (BENCH_TINY_KEYS keys on average) of the keys
+ */
+static void bench_rb_index_tiny(struct bench_result *result,
+                                const key_t *keys, const key_t *lookups,
+                                size_t n, enum rb_index_engine engine)
+{
+        size_t nr_indexes = n / BENCH_TINY_KEYS + 1;
+        struct rb_index **indexes = (struct rb_index **)malloc(
+                sizeof(struct rb_index *) * nr_indexes);
+        size_t found = 0, scanned = 0, bytes = 0;
+        clock_t start;
+
+        if (!indexes) {
+                pr_info("Memory allocation failed\n");
+                return;
+        }
+        for (size_t i = 0; i < nr_indexes; i++) {
+                indexes[i] = rb_index_alloc(engine);
+        }
+
+        start = clock();
+        for (size_t i = 0; i < n; i++) {
+                rb_index_insert(indexes[keys[i] % nr_indexes], keys[i], NULL);
+        }
+        bench_update(&result->insert, start, n);
+
+        start = clock();
+        for (size_t i = 0; i < n; i++) {
+                found += (rb_index_search(indexes[lookups[i] % nr_indexes],
+                                          lookups[i], NULL) == 0);
+        }
+        bench_update(&result->search, start, n);
+
+        start = clock();
+        for (size_t i = 0; i < nr_indexes; i++) {
+                rb_index_for_each(indexes[i], 0, RB_MAX_KEY, bench_count,
+                                  &scanned);
+        }
+        bench_update(&result->scan, start, n);
+        for (size_t i = 0; i < nr_indexes; i++) {
+                bytes += bench_tiny_bytes(indexes[i]);
+        }
+        result->bytes_per_key = (double)bytes / (double)n;
+
+        start = clock();
+        for (size_t i = 0; i < n; i++) {
+                rb_index_delete(indexes[keys[i] % nr_indexes], keys[i]);
+        }
+        bench_update(&result->delete, start, n);
+
+        if (found != n || scanned != n) {
+                printf("%s: lookup mismatch (%zu/%zu)\n", result->name, found,
+                       n);
+        }
+        for (size_t i = 0; i < nr_indexes; i++) {
+                rb_index_dealloc(indexes[i]);
+        }
+        free(indexes);
+}
+
+static void bench_rb_index_tree_tiny(struct bench_result *result,
+                                     const key_t *keys, const key_t *lookups,
+                                     size_t n)
+{
+        bench_rb_index_tiny(result, keys, lookups, n, RB_INDEX_RB_TREE);
+}
+
+static void bench_rb_index_small_tiny(struct bench_result *result,
+                                      const key_t *keys, const key_t *lookups,
+                                      size_t n)
+{
+        bench_rb_index_tiny(result, keys, lookups, n, RB_INDEX_SMALL);
+}
+
+/**
+ * @brief The index of the dense keys (0 ... n - 1 in a random order)
+ */
+static void bench_rb_index_dense(struct bench_result *result, size_t n,
+                                 enum rb_index_engine engine)
+{
+        key_t *keys = (key_t *)malloc(sizeof(key_t) * n);
+        key_t *lookups = (key_t *)malloc(sizeof(key_t) * n);
+
+        if (!keys || !lookups) {
+                pr_info("Memory allocation failed\n");
+                free(keys);
+                free(lookups);
+                return;
+        }
+        for (size_t i = 0; i < n; i++) {
+                keys[i] = i;
+                lookups[i] = i;
+        }
+        for (size_t i = n - 1; i > 0; i--) { /**< shuffle both orders */
+                size_t j = bench_rand() % (i + 1);
+                size_t k = bench_rand() % (i + 1);
+                key_t temp = keys[i];
+                keys[i] = keys[j];
+                keys[j] = temp;
+                temp = lookups[i];
+                lookups[i] = lookups[k];
+                lookups[k] = temp;
+        }
+        bench_rb_index(result, keys, lookups, n, engine);
+        free(keys);
+        free(lookups);
+}
+
+static void bench_rb_index_tree_dense(struct bench_result *result,
+                                      const key_t *keys, const key_t *lookups,
+                                      size_t n)
+{
+        (void)keys;
+        (void)lookups;
+        bench_rb_index_dense(result, n, RB_INDEX_RB_TREE);
+}
+
+static void bench_rb_index_bptree_dense(struct bench_result *result,
+                                        const key_t *keys,
+                                        const key_t *lookups, size_t n)
+{
+        (void)keys;
+        (void)lookups;
+        bench_rb_index_dense(result, n, RB_INDEX_BPTREE);
+}
+
+static void bench_rb_index_art_dense(struct bench_result *result,
+                                     const key_t *keys, const key_t *lookups,
+                                     size_t n)
+{
+        (void)keys;
+        (void)lookups;
+        bench_rb_index_dense(result, n, RB_INDEX_ART);
+}
+
+static void bench_rb_generate(struct bench_result *result, const key_t *keys,
+                              const key_t *lookups, size_t n)
+{
+        struct bench_tree head;
+        struct bench_item *item = NULL;
+        size_t found = 0;
+        clock_t start;
+
+        bench_tree_init(&head);
+
+        start = clock();
+        for (size_t i = 0; i < n; i++) {
+                item = (struct bench_item *)malloc(sizeof(struct bench_item));
+                item->key = keys[i];
+                item->data = NULL;
+                if (bench_tree_insert(&head, item)) {
+                        free(item);
+                }
+        }
+        bench_update(&result->insert, start, n);
+
+        start = clock();
+        for (size_t i = 0; i < n; i++) {
+                found += (bench_tree_search(&head, lookups[i]) != NULL);
+        }
+        bench_update(&result->search, start, n);
+
+        start = clock();
+        for (size_t i = 0; i < n; i++) {
+                item = bench_tree_search(&head, keys[i]);
+                if (item) {
+                        free(bench_tree_remove(&head, item));
+                }
+        }
+        bench_update(&result->delete, start, n);
+
+        if (found != n) {
+                printf("%s: lookup mismatch (%zu/%zu)\n", result->name, found,
+                       n);
+        }
+}
+
+typedef int (*bench_op_fn)(void *tree, key_t key);
+
+/**
+ * @brief Slice of the keys which one thread applies
+ *
+ */
+struct bench_worker {
+        pthread_t thread;
+        void *tree;
+        bench_op_fn op;
+        const key_t *keys;
+        size_t nr_keys;
+        size_t nr_done; /**< operations which return 0 */
+};
+
+static void *bench_worker_run(void *arg)
+{
+        struct bench_worker *worker = (struct bench_worker *)arg;
+
+        for (size_t i = 0; i < worker->nr_keys; i++) {
+                worker->nr_done += (worker->op(worker->tree,
+                                               worker->keys[i]) == 0);
+        }
+        return NULL;
+}
+
+/**
+ * @brief Apply the operation to the keys by bench_nr_threads threads
+ *
+ * @param best best wall clock time stored location
+ * @return size_t operations which return 0
+ */
+static size_t bench_parallel(double *best, void *tree, bench_op_fn op,
+                             const key_t *keys, size_t n)
+{
+        struct bench_worker *workers = NULL;
+        size_t chunk = (n + bench_nr_threads - 1) / bench_nr_threads;
+        size_t nr_done = 0;
+        double start;
+
+        workers = (struct bench_worker *)calloc(bench_nr_threads,
+                                                sizeof(*workers));
+        if (!workers) {
+                pr_info("Memory allocation failed\n");
+                return 0;
+        }
+
+        start = bench_wall_now();
+        for (int t = 0; t < bench_nr_threads; t++) {
+                size_t first = chunk * t < n ? chunk * t : n;
+
+                workers[t].tree = tree;
+                workers[t].op = op;
+                workers[t].keys = &keys[first];
+                workers[t].nr_keys = n - first < chunk ? n - first : chunk;
+                pthread_create(&workers[t].thread, NULL, bench_worker_run,
+                               &workers[t]);
+        }
+        for (int t = 0; t < bench_nr_threads; t++) {
+                pthread_join(workers[t].thread, NULL);
+                nr_done += workers[t].nr_done;
+        }
+        bench_update_wall(best, start, n);
+
+        free(workers);
+        return nr_done;
+}
+
+static int bench_fc_insert(void *tree, key_t key)
+{
+        return rb_fc_tree_insert((struct rb_fc_tree *)tree, key, NULL);
+}
+
+static int bench_fc_search(void *tree, key_t key)
+{
+        return rb_fc_tree_search((struct rb_fc_tree *)tree, key, NULL, NULL);
+}
+
+static int bench_fc_delete(void *tree, key_t key)
+{
+        return rb_fc_tree_delete((struct rb_fc_tree *)tree, key);
+}
+
+/**
+ * @brief Flat-combining writes from every thread
+ */
+static void bench_fc_tree(struct bench_result *result, const key_t *keys,
+                          const key_t *lookups, size_t n)
+{
+        struct rb_fc_tree *fctree = rb_fc_tree_alloc(0);
+        size_t found = 0;
+
+        if (!fctree) {
+                return;
+        }
+        bench_parallel(&result->insert, fctree, bench_fc_insert, keys, n);
+        found = bench_parallel(&result->search, fctree, bench_fc_search,
+                               lookups, n);
+        bench_parallel(&result->delete, fctree, bench_fc_delete, keys, n);
+
+        if (found != n) {
+                printf("%s: lookup mismatch (%zu/%zu)\n", result->name, found,
+                       n);
+        }
+        rb_fc_tree_dealloc(fctree);
+}
+
+/**
+ * @brief Tree which every operation locks by itself
+ *
+ */
+struct bench_locked_tree {
+        pthread_mutex_t lock;
+        struct rb_tree *tree;
+};
+
+static int bench_locked_insert(void *tree, key_t key)
+{
+        struct bench_locked_tree *locked = (struct bench_locked_tree *)tree;
+        int ret;
+
+        pthread_mutex_lock(&locked->lock);
+        ret = rb_tree_insert(locked->tree, key, NULL);
+        pthread_mutex_unlock(&locked->lock);
+        return ret;
+}
+
+static int bench_locked_search(void *tree, key_t key)
+{
+        struct bench_locked_tree *locked = (struct bench_locked_tree *)tree;
+        struct rb_node *node = NULL;
+
+        pthread_mutex_lock(&locked->lock);
+        node = rb_tree_search(locked->tree, key);
+        pthread_mutex_unlock(&locked->lock);
+        return node ? 0 : -ENODATA;
+}
+
+static int bench_locked_delete(void *tree, key_t key)
+{
+        struct bench_locked_tree *locked = (struct bench_locked_tree *)tree;
+        int ret;
+
+        pthread_mutex_lock(&locked->lock);
+        ret = rb_tree_delete(locked->tree, key);
+        pthread_mutex_unlock(&locked->lock);
+        return ret;
+}
+
+/**
+ * @brief The same operations with the mutex per operation
+ */
+static void bench_locked(struct bench_result *result, const key_t *keys,
+                         const key_t *lookups, size_t n)
+{
+        struct bench_locked_tree locked;
+        size_t found = 0;
+
+        locked.tree = rb_tree_alloc();
+        if (!locked.tree || pthread_mutex_init(&locked.lock, NULL)) {
+                return;
+        }
+        bench_parallel(&result->insert, &locked, bench_locked_insert, keys, n);
+        found = bench_parallel(&result->search, &locked, bench_locked_search,
+                               lookups, n);
+        bench_parallel(&result->delete, &locked, bench_locked_delete, keys, n);
+
+        if (found != n) {
+                printf("%s: lookup mismatch (%zu/%zu)\n", result->name, found,
+                       n);
+        }
+        pthread_mutex_destroy(&locked.lock);
+        rb_tree_dealloc(locked.tree);
+}
+
+/**
+ * @brief Insert and delete of the keys one by one (wall clock)
+ */
+static void bench_batch_serial(struct bench_result *result, const key_t *keys,
+                               const key_t *lookups, size_t n)
+{
+        struct rb_tree *tree = rb_tree_alloc();
+        double start;
+
+        (void)lookups;
+        if (!tree) {
+                return;
+        }
+        start = bench_wall_now();
+        for (size_t i = 0; i < n; i++) {
+                rb_tree_insert(tree, keys[i], NULL);
+        }
+        bench_update_wall(&result->insert, start, n);
+
+        start = bench_wall_now();
+        for (size_t i = 0; i < n; i++) {
+                rb_tree_delete(tree, keys[i]);
+        }
+        bench_update_wall(&result->delete, start, n);
+        rb_tree_dealloc(tree);
+}
+
+/**
+ * @brief Insert and delete of the keys as two batches (wall clock)
+ */
+static void bench_batch_threads(struct bench_result *result,
+                                const key_t *keys, const key_t *lookups,
+                                size_t n, int nthreads)
+{
+        struct rb_tree *tree = rb_tree_alloc();
+        struct rb_batch_op *ops = NULL;
+        size_t found = 0;
+        double start;
+
+        ops = (struct rb_batch_op *)malloc(sizeof(*ops) * n);
+        if (!tree || !ops) {
+                pr_info("Memory allocation failed\n");
+                goto out;
+        }
+        for (size_t i = 0; i < n; i++) {
+                ops[i].type = RB_BATCH_INSERT;
+                ops[i].key = keys[i];
+                ops[i].data = NULL;
+        }
+        start = bench_wall_now();
+        rb_tree_apply_batch(tree, ops, n, nthreads);
+        bench_update_wall(&result->insert, start, n);
+
+        for (size_t i = 0; i < n; i++) {
+                found += (rb_tree_search(tree, lookups[i]) != NULL);
+                ops[i].type = RB_BATCH_DELETE;
+        }
+        start = bench_wall_now();
+        rb_tree_apply_batch(tree, ops, n, nthreads);
+        bench_update_wall(&result->delete, start, n);
+
+        if (found != n || tree->root != tree->nil) {
+                printf("%s: lookup mismatch (%zu/%zu)\n", result->name, found,
+                       n);
+        }
+out:
+        free(ops);
+        if (tree) {
+                rb_tree_dealloc(tree);
+        }
+}
+
+static void bench_batch_one(struct bench_result *result, const key_t *keys,
+                            const key_t *lookups, size_t n)
+{
+        bench_batch_threads(result, keys, lookups, n, 1);
+}
+
+static void bench_batch(struct bench_result *result, const key_t *keys,
+                        const key_t *lookups, size_t n)
+{
+        bench_batch_threads(result, keys, lookups, n, bench_nr_threads);
+}
+
+typedef void (*bench_fn)(struct bench_result *result, const key_t *keys,
+                         const key_t *lookups, size_t n);
+
+static const bench_fn benches[] = {
+        bench_rb_tree,
+        bench_rb_tree_veb,
+        bench_rb_generate,
+        bench_rb_frozen,
+        bench_rb_frozen_kary,
+        bench_rb_index_tree,
+        bench_rb_index_bptree,
+        bench_rb_index_art,
+        bench_rb_index_bucket,
+        bench_rb_index_tree_dense,
+        bench_rb_index_bptree_dense,
+        bench_rb_index_art_dense,
+        bench_rb_index_small,
+        bench_rb_index_tree_tiny,
+        bench_rb_index_small_tiny,
+        bench_rb_index_pool,
+        bench_rb_index_td,
+};
+
+static const char *bench_names[] = {
+        "rb_tree",
+        "rb_tree_relayout",
+        "RB_GENERATE(uint64_t)",
+        "rb_tree_freeze",
+        "rb_tree_freeze(k-ary)",
+        "rb_index(rb_tree)",
+        "rb_index(rb_bptree)",
+        "rb_index(rb_art)",
+        "rb_index(rb_bucket_tree)",
+        "rb_index(rb_tree) dense",
+        "rb_index(rb_bptree) dense",
+        "rb_index(rb_art) dense",
+        "rb_index(rb_small_tree)",
+        "rb_index(rb_tree) tiny",
+        "rb_index(rb_small_tree) tiny",
+        "rb_index(rb_pool_tree)",
+        "rb_index(rb_td_tree)",
+};
+
+#define NR_BENCH ((int)(sizeof(benches) / sizeof(benches[0])))
+
+static const bench_fn wall_benches[] = {
+        bench_locked,
+        bench_fc_tree,
+        bench_batch_serial,
+        bench_batch_one,
+        bench_batch,
+};
+
+static const char *wall_bench_names[] = {
+        "rb_tree + mutex per op",
+        "rb_fc_tree",
+        "rb_tree_insert (serial)",
+        "rb_tree_apply_batch(1)",
+        "rb_tree_apply_batch(threads)",
+};
+
+#define NR_WALL_BENCH ((int)(sizeof(wall_benches) / sizeof(wall_benches[0])))
+
+/**
+ * @brief Run the benchmark in the child process
+ * @details
+ * Node placement depends on the heap state which the previous benchmark
+ * leaves. So, every benchmark starts with the same (fresh) heap.
+ *
+ * @param bench benchmark to run
+ * @param result best result of the benchmark
+ */
+static void bench_isolated(bench_fn bench, struct bench_result *result,
+                           const key_t *keys, const key_t *lookups, size_t n)
+{
+        int fds[2];
+        pid_t pid;
+
+        if (pipe(fds)) {
+                pr_info("pipe creation failed\n");
+                bench(result, keys, lookups, n);
+                return;
+        }
+
+        pid = fork();
+        if (pid == 0) {
+                close(fds[0]);
+                bench(result, keys, lookups, n);
+                if (write(fds[1], result, sizeof(*result)) < 0) {
+                        _exit(1);
+                }
+                _exit(0);
+        }
+
+        close(fds[1]);
+        if (pid < 0 || read(fds[0], result, sizeof(*result)) !=
+                               (ssize_t)sizeof(*result)) {
+                pr_info("benchmark %s failed\n", result->name);
+        }
+        close(fds[0]);
+        if (pid > 0) {
+                waitpid(pid, NULL, 0);
+        }
+}
+
+int main(int argc, char *argv[])
+{
+        size_t n = BENCH_DEFAULT_SIZE;
+        key_t *keys = NULL;
+        key_t *lookups = NULL;
+        struct bench_result results[NR_BENCH];
+        struct bench_result wall_results[NR_WALL_BENCH];
+
+        for (int i = 0; i < NR_BENCH; i++) {
+                memset(&results[i], 0, sizeof(struct bench_result));
+                results[i].name = bench_names[i];
+        }
+        for (int i = 0; i < NR_WALL_BENCH; i++) {
+                memset(&wall_results[i], 0, sizeof(struct bench_result));
+                wall_results[i].name = wall_bench_names[i];
+        }
+
+        if (argc > 1) {
+                n = (size_t)strtoull(argv[1], NULL, 10);
+        }
+        if (argc > 2 && atoi(argv[2]) > 0) {
+                bench_nr_threads = atoi(argv[2]);
+        }
+
+        keys = (key_t *)malloc(sizeof(key_t) * n);
+        lookups = (key_t *)malloc(sizeof(key_t) * n);
+        if (!keys || !lookups) {
+                pr_info("Memory allocation failed\n");
+                return 1;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+                keys[i] = bench_rand(); /**< full 64-bit key space */
+                lookups[i] = keys[i];
+        }
+        for (size_t i = n - 1; i > 0; i--) { /**< shuffle lookup order */
+                size_t j = bench_rand() % (i + 1);
+                key_t temp = lookups[i];
+                lookups[i] = lookups[j];
+                lookups[j] = temp;
+        }
+
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+                for (int i = 0; i < NR_BENCH; i++) {
+                        bench_isolated(benches[i], &results[i], keys,
+                                       lookups, n);
+                }
+                for (int i = 0; i < NR_WALL_BENCH; i++) {
+                        bench_isolated(wall_benches[i], &wall_results[i],
+                                       keys, lookups, n);
+                }
+        }
+
+        printf("%zu random keys, best of %d rounds (ns/op)\n", n,
+               BENCH_ROUNDS);
+        printf("%-28s %10s %10s %10s %10s\n", "", "insert", "search", "delete",
+               "scan");
+        for (int i = 0; i < NR_BENCH; i++) {
+                bench_report(&results[i]);
+        }
+        for (int i = 0; i < NR_BENCH; i++) {
+                if (results[i].bytes_per_key > 0) {
+                        printf("%s: %.1f bytes per key\n", results[i].name,
+                               results[i].bytes_per_key);
+                }
+        }
+        for (int i = 0; i < NR_BENCH; i++) {
+                if (results[i].relayout.nr_nodes) {
+                        printf("%s: cache lines per search %.2f -> %.2f\n",
+                               results[i].name,
+                               results[i].relayout.lines_before,
+                               results[i].relayout.lines_after);
+                }
+        }
+
+        printf("\n%zu random keys, %d threads, best of %d rounds "
+               "(wall clock ns/op)\n",
+               n, bench_nr_threads, BENCH_ROUNDS);
+        printf("%-28s %10s %10s %10s %10s\n", "", "insert", "search", "delete",
+               "scan");
+        for (int i = 0; i < NR_WALL_BENCH; i++) {
+                bench_report(&wall_results[i]);
+        }
+
+        free(keys);
+        free(lookups);
+        return 0;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file rb-arena.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief contiguous red black tree node block implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#include "rb-arena.h"
+
+_Static_assert(sizeof(struct rb_arena) <= sizeof(struct rb_arena_slot),
+               "the arena must fit in the header slot");
+
+/**
+ * @brief Find the arena of the node without any lock
+ * @details
+ * A node does not point to its arena (it would grow every node). Instead,
+ * `pooled` keeps the slot number from the header, which is the first slot
+ * of the block.
+ *
+ * @param node node which `rb_arena_node` handed out
+ * @return struct rb_arena* arena of the node
+ */
+static inline struct rb_arena *rb_arena_of(struct rb_node *node)
+{
+        return (struct rb_arena *)((struct rb_arena_slot *)node -
+                                   node->pooled);
+}
+
+/**
+ * @brief Drop a reference of the arena
+ *
+ * @param arena target arena (freed by the last reference)
+ */
+static void rb_arena_unref(struct rb_arena *arena)
+{
+        if (atomic_fetch_sub(&arena->nr_refs, 1) != 1) {
+                return;
+        }
+        free(arena); /**< the header and the slots are one block */
+}
+
+/**
+ * @brief Allocation of the arena
+ *
+ * @param capacity number of the nodes
+ * @return struct rb_arena* allocated arena (the caller holds the filler's
+ * reference)
+ */
+struct rb_arena *rb_arena_alloc(size_t capacity)
+{
+        struct rb_arena *arena = NULL;
+        size_t size = sizeof(struct rb_arena_slot) * (capacity + 1);
+
+        if (capacity >= UINT_MAX) { /**< `pooled` keeps the slot number */
+                goto exception;
+        }
+        arena = (struct rb_arena *)aligned_alloc(RB_CACHE_LINE_SIZE, size);
+        if (!arena) {
+                goto exception;
+        }
+        arena->slots = (struct rb_arena_slot *)arena + 1;
+        arena->capacity = capacity;
+        arena->nr_used = 0;
+        atomic_init(&arena->nr_refs, 1);
+        return arena;
+exception:
+        pr_info("Memory shortage detected! Allocation failed...");
+        return NULL;
+}
+
+/**
+ * @brief Hand out the next node of the arena
+ *
+ * @param arena target arena (only the filler calls this)
+ * @return struct rb_node* new node (NULL means the arena is full)
+ */
+struct rb_node *rb_arena_node(struct rb_arena *arena)
+{
+        struct rb_node *node = NULL;
+
+        if (arena->nr_used == arena->capacity) {
+                return NULL;
+        }
+        node = rb_arena_at(arena, arena->nr_used++);
+        atomic_fetch_add(&arena->nr_refs, 1);
+        memset(node, 0, sizeof(struct rb_node));
+        node->pooled = (unsigned int)arena->nr_used; /**< header is slot 0 */
+        return node;
+}
+
+/**
+ * @brief Drop the filler's reference
+ * @details
+ * The arena is freed here if every handed out node is already freed.
+ *
+ * @param arena target arena
+ */
+void rb_arena_release(struct rb_arena *arena)
+{
+        rb_arena_unref(arena);
+}
+
+/**
+ * @brief Return the pooled node to its arena
+ *
+ * @param node node which `rb_arena_node` handed out
+ */
+void rb_arena_put(struct rb_node *node)
+{
+        rb_arena_unref(rb_arena_of(node));
+}
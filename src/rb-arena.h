@@ -0,0 +1,63 @@
+/**
+ * @file rb-arena.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief contiguous red black tree node block's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * An arena is one block of nodes which the relayout fills in the order of
+ * the search paths. Each node has its own cache line, so a node never
+ * straddles two lines (a malloc'ed node takes 64 bytes too). The nodes in
+ * the arena are marked by `pooled` and `rb_node_dealloc` returns them to
+ * the arena instead of `free`. The arena itself is the first slot of the
+ * block and `pooled` is the slot number, so a node finds its arena without
+ * any lock. The arena counts its live nodes (and the reference of the
+ * filler), so it is freed when the last node is freed.
+ * Nodes can move to the other trees by split or concat and still be freed
+ * normally.
+ */
+#ifndef RB_ARENA_H_
+#define RB_ARENA_H_
+
+#include "rb-tree.h"
+#include "rb-rwlock.h"
+
+/**
+ * @brief Cache line sized place of a node
+ *
+ */
+struct rb_arena_slot {
+        _Alignas(RB_CACHE_LINE_SIZE) struct rb_node node;
+};
+
+/**
+ * @brief Block of the nodes
+ *
+ */
+struct rb_arena {
+        struct rb_arena_slot *slots; /**< right after the arena in the block */
+        size_t capacity;
+        size_t nr_used; /**< slots[0 .. nr_used) are handed out */
+        atomic_size_t nr_refs; /**< live nodes + 1 (the filler) */
+};
+
+struct rb_arena *rb_arena_alloc(size_t capacity);
+struct rb_node *rb_arena_node(struct rb_arena *arena);
+void rb_arena_release(struct rb_arena *arena);
+
+/**
+ * @brief Get the i-th node of the arena
+ *
+ * @param arena target arena
+ * @param i index of the slot
+ * @return struct rb_node* node of the slot
+ */
+static inline struct rb_node *rb_arena_at(struct rb_arena *arena, size_t i)
+{
+        return &arena->slots[i].node;
+}
+
+#endif
@@ -0,0 +1,1018 @@
+/**
+ * @file rb-art.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief adaptive radix tree implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#include <stdlib.h>
+#include "rb-art.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define RB_ART_NODE4(node) ((struct rb_art_node4 *)(node))
+#define RB_ART_NODE16(node) ((struct rb_art_node16 *)(node))
+#define RB_ART_NODE48(node) ((struct rb_art_node48 *)(node))
+#define RB_ART_NODE256(node) ((struct rb_art_node256 *)(node))
+#define RB_ART_LEAF(node) ((struct rb_art_leaf *)(node))
+
+static const size_t rb_art_node_size[] = {
+        [RB_ART_LEAF] = sizeof(struct rb_art_leaf),
+        [RB_ART_NODE4] = sizeof(struct rb_art_node4),
+        [RB_ART_NODE16] = sizeof(struct rb_art_node16),
+        [RB_ART_NODE48] = sizeof(struct rb_art_node48),
+        [RB_ART_NODE256] = sizeof(struct rb_art_node256),
+};
+
+static const unsigned int rb_art_capacity[] = {
+        [RB_ART_LEAF] = 0,   [RB_ART_NODE4] = 4,     [RB_ART_NODE16] = 16,
+        [RB_ART_NODE48] = 48, [RB_ART_NODE256] = 256,
+};
+
+/**
+ * @brief The depth-th byte of the key (0 is the most significant byte)
+ */
+static inline unsigned int rb_art_byte(key_t key, unsigned int depth)
+{
+        return (unsigned int)(key >> (8 * (RB_ART_KEY_BYTES - 1 - depth))) &
+               0xff;
+}
+
+static struct rb_art_node *rb_art_node_alloc(enum rb_art_type type)
+{
+        struct rb_art_node *node =
+                (struct rb_art_node *)calloc(1, rb_art_node_size[type]);
+        if (!node) {
+                pr_info("Memory allocation failed\n");
+                return NULL;
+        }
+        node->type = (uint8_t)type;
+        return node;
+}
+
+/**
+ * @brief Allocation of adaptive radix tree
+ *
+ * @return struct rb_art* allocated tree
+ */
+struct rb_art *rb_art_alloc(void)
+{
+        struct rb_art *tree = (struct rb_art *)malloc(sizeof(struct rb_art));
+
+        if (!tree) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+        tree->root = NULL;
+        tree->nr_keys = 0;
+        return tree;
+}
+
+/**
+ * @brief Location of the child of the byte
+ *
+ * @return struct rb_art_node** location of the child (NULL means none)
+ */
+static struct rb_art_node **rb_art_child(struct rb_art_node *node,
+                                         unsigned int byte)
+{
+        switch (node->type) {
+        case RB_ART_NODE4: {
+                struct rb_art_node4 *n = RB_ART_NODE4(node);
+
+                for (unsigned int i = 0; i < node->nr_children; i++) {
+                        if (n->keys[i] == byte) {
+                                return &n->children[i];
+                        }
+                }
+                return NULL;
+        }
+        case RB_ART_NODE16: {
+                struct rb_art_node16 *n = RB_ART_NODE16(node);
+#ifdef __SSE2__
+                __m128i cmp = _mm_cmpeq_epi8(
+                        _mm_set1_epi8((char)byte),
+                        _mm_loadu_si128((const __m128i *)n->keys));
+                unsigned int mask = (unsigned int)_mm_movemask_epi8(cmp) &
+                                    ((1U << node->nr_children) - 1);
+
+                return mask ? &n->children[__builtin_ctz(mask)] : NULL;
+#else
+                for (unsigned int i = 0; i < node->nr_children; i++) {
+                        if (n->keys[i] == byte) {
+                                return &n->children[i];
+                        }
+                }
+                return NULL;
+#endif
+        }
+        case RB_ART_NODE48: {
+                struct rb_art_node48 *n = RB_ART_NODE48(node);
+
+                return n->index[byte] ? &n->children[n->index[byte] - 1] : NULL;
+        }
+        case RB_ART_NODE256: {
+                struct rb_art_node256 *n = RB_ART_NODE256(node);
+
+                return n->children[byte] ? &n->children[byte] : NULL;
+        }
+        default:
+                return NULL;
+        }
+}
+
+/**
+ * @brief First child which byte is not less than `from`
+ *
+ * @param node inner node
+ * @param from first byte to look (256 means none)
+ * @param byte byte of the found child stored location
+ * @return struct rb_art_node* found child (NULL means none)
+ */
+static struct rb_art_node *rb_art_next(struct rb_art_node *node,
+                                       unsigned int from, unsigned int *byte)
+{
+        unsigned int i;
+
+        switch (node->type) {
+        case RB_ART_NODE4:
+        case RB_ART_NODE16: {
+                uint8_t *keys = (node->type == RB_ART_NODE4) ?
+                                        RB_ART_NODE4(node)->keys :
+                                        RB_ART_NODE16(node)->keys;
+                struct rb_art_node **children =
+                        (node->type == RB_ART_NODE4) ?
+                                RB_ART_NODE4(node)->children :
+                                RB_ART_NODE16(node)->children;
+
+                for (i = 0; i < node->nr_children; i++) {
+                        if (keys[i] >= from) {
+                                *byte = keys[i];
+                                return children[i];
+                        }
+                }
+                return NULL;
+        }
+        case RB_ART_NODE48:
+                for (i = from; i < 256; i++) {
+                        if (RB_ART_NODE48(node)->index[i]) {
+                                *byte = i;
+                                return RB_ART_NODE48(node)->children
+                                        [RB_ART_NODE48(node)->index[i] - 1];
+                        }
+                }
+                return NULL;
+        case RB_ART_NODE256:
+                for (i = from; i < 256; i++) {
+                        if (RB_ART_NODE256(node)->children[i]) {
+                                *byte = i;
+                                return RB_ART_NODE256(node)->children[i];
+                        }
+                }
+                return NULL;
+        default:
+                return NULL;
+        }
+}
+
+/**
+ * @brief Last child of the inner node
+ */
+static struct rb_art_node *rb_art_last(struct rb_art_node *node)
+{
+        int i;
+
+        switch (node->type) {
+        case RB_ART_NODE4:
+                return RB_ART_NODE4(node)->children[node->nr_children - 1];
+        case RB_ART_NODE16:
+                return RB_ART_NODE16(node)->children[node->nr_children - 1];
+        case RB_ART_NODE48:
+                for (i = 255; !RB_ART_NODE48(node)->index[i]; i--) {
+                }
+                return RB_ART_NODE48(node)
+                        ->children[RB_ART_NODE48(node)->index[i] - 1];
+        case RB_ART_NODE256:
+                for (i = 255; !RB_ART_NODE256(node)->children[i]; i--) {
+                }
+                return RB_ART_NODE256(node)->children[i];
+        default:
+                return NULL;
+        }
+}
+
+/**
+ * @brief Add the child of the byte (the node has a room)
+ */
+static void rb_art_add(struct rb_art_node *node, unsigned int byte,
+                       struct rb_art_node *child)
+{
+        unsigned int i, nr = node->nr_children;
+
+        switch (node->type) {
+        case RB_ART_NODE4:
+        case RB_ART_NODE16: {
+                uint8_t *keys = (node->type == RB_ART_NODE4) ?
+                                        RB_ART_NODE4(node)->keys :
+                                        RB_ART_NODE16(node)->keys;
+                struct rb_art_node **children =
+                        (node->type == RB_ART_NODE4) ?
+                                RB_ART_NODE4(node)->children :
+                                RB_ART_NODE16(node)->children;
+
+                for (i = 0; i < nr && keys[i] < byte; i++) {
+                }
+                memmove(&keys[i + 1], &keys[i], nr - i);
+                memmove(&children[i + 1], &children[i],
+                        sizeof(children[0]) * (nr - i));
+                keys[i] = (uint8_t)byte;
+                children[i] = child;
+                break;
+        }
+        case RB_ART_NODE48:
+                for (i = 0; RB_ART_NODE48(node)->children[i]; i++) {
+                }
+                RB_ART_NODE48(node)->children[i] = child;
+                RB_ART_NODE48(node)->index[byte] = (uint8_t)(i + 1);
+                break;
+        case RB_ART_NODE256:
+                RB_ART_NODE256(node)->children[byte] = child;
+                break;
+        default:
+                return;
+        }
+        node->nr_children++;
+}
+
+/**
+ * @brief Remove the child of the byte (the child must exist)
+ */
+static void rb_art_remove(struct rb_art_node *node, unsigned int byte)
+{
+        unsigned int i, nr = node->nr_children;
+
+        switch (node->type) {
+        case RB_ART_NODE4:
+        case RB_ART_NODE16: {
+                uint8_t *keys = (node->type == RB_ART_NODE4) ?
+                                        RB_ART_NODE4(node)->keys :
+                                        RB_ART_NODE16(node)->keys;
+                struct rb_art_node **children =
+                        (node->type == RB_ART_NODE4) ?
+                                RB_ART_NODE4(node)->children :
+                                RB_ART_NODE16(node)->children;
+
+                for (i = 0; keys[i] != byte; i++) {
+                }
+                memmove(&keys[i], &keys[i + 1], nr - i - 1);
+                memmove(&children[i], &children[i + 1],
+                        sizeof(children[0]) * (nr - i - 1));
+                break;
+        }
+        case RB_ART_NODE48:
+                i = RB_ART_NODE48(node)->index[byte] - 1U;
+                RB_ART_NODE48(node)->children[i] = NULL;
+                RB_ART_NODE48(node)->index[byte] = 0;
+                break;
+        case RB_ART_NODE256:
+                RB_ART_NODE256(node)->children[byte] = NULL;
+                break;
+        default:
+                return;
+        }
+        node->nr_children--;
+}
+
+/**
+ * @brief Move the node to a node of the other type
+ *
+ * @param node inner node (freed if success)
+ * @param type new type which can have every child of the node
+ * @return struct rb_art_node* new node (NULL means that the node is kept)
+ */
+static struct rb_art_node *rb_art_convert(struct rb_art_node *node,
+                                          enum rb_art_type type)
+{
+        struct rb_art_node *new_node = rb_art_node_alloc(type);
+        struct rb_art_node *child = NULL;
+        unsigned int byte = 0;
+
+        if (!new_node) {
+                return NULL;
+        }
+        new_node->prefix_len = node->prefix_len;
+        memcpy(new_node->prefix, node->prefix, node->prefix_len);
+        for (child = rb_art_next(node, 0, &byte); child;
+             child = rb_art_next(node, byte + 1, &byte)) {
+                rb_art_add(new_node, byte, child);
+        }
+        free(node);
+        return new_node;
+}
+
+/**
+ * @brief Replace the node which has only one child with the child
+ * @details
+ * The prefix of the node and the byte of the child go before the prefix
+ * of the child. The leaf has the whole key, so it needs no prefix.
+ */
+static struct rb_art_node *rb_art_collapse(struct rb_art_node *node)
+{
+        uint8_t prefix[RB_ART_KEY_BYTES];
+        unsigned int byte = 0, len = node->prefix_len;
+        struct rb_art_node *child = rb_art_next(node, 0, &byte);
+
+        if (child->type != RB_ART_LEAF) {
+                memcpy(prefix, node->prefix, len);
+                prefix[len++] = (uint8_t)byte;
+                memcpy(&prefix[len], child->prefix, child->prefix_len);
+                len += child->prefix_len;
+                memcpy(child->prefix, prefix, len);
+                child->prefix_len = (uint8_t)len;
+        }
+        free(node);
+        return child;
+}
+
+/**
+ * @brief Fit the inner node to the number of its children
+ * @details
+ * A node shrinks only when it is well under the smaller capacity, so the
+ * insert and the delete at the boundary do not convert every time. If the
+ * allocation fails, the node is kept as is.
+ *
+ * @return struct rb_art_node* fitted node (NULL means no child)
+ */
+static struct rb_art_node *rb_art_fit(struct rb_art_node *node)
+{
+        enum rb_art_type type;
+        struct rb_art_node *new_node = NULL;
+
+        if (node->nr_children == 0) {
+                free(node);
+                return NULL;
+        }
+        if (node->nr_children == 1) {
+                return rb_art_collapse(node);
+        }
+        if (node->nr_children <= 3) {
+                type = RB_ART_NODE4;
+        } else if (node->nr_children <= 12) {
+                type = RB_ART_NODE16;
+        } else if (node->nr_children <= 37) {
+                type = RB_ART_NODE48;
+        } else {
+                type = RB_ART_NODE256;
+        }
+        if (type >= node->type) {
+                return node;
+        }
+        new_node = rb_art_convert(node, type);
+        return new_node ? new_node : node;
+}
+
+/**
+ * @brief Number of the prefix bytes which match the key from the depth
+ */
+static inline unsigned int rb_art_match(const struct rb_art_node *node,
+                                        key_t key, unsigned int depth)
+{
+        unsigned int i;
+
+        for (i = 0; i < node->prefix_len; i++) {
+                if (node->prefix[i] != rb_art_byte(key, depth + i)) {
+                        break;
+                }
+        }
+        return i;
+}
+
+static struct rb_art_leaf *rb_art_minimum_leaf(struct rb_art_node *node)
+{
+        unsigned int byte;
+
+        while (node && node->type != RB_ART_LEAF) {
+                node = rb_art_next(node, 0, &byte);
+        }
+        return RB_ART_LEAF(node);
+}
+
+static struct rb_art_leaf *rb_art_maximum_leaf(struct rb_art_node *node)
+{
+        while (node && node->type != RB_ART_LEAF) {
+                node = rb_art_last(node);
+        }
+        return RB_ART_LEAF(node);
+}
+
+static int rb_art_entry(struct rb_art_leaf *leaf, key_t *key, void **data)
+{
+        if (!leaf) {
+                return -ENODATA;
+        }
+        if (key) {
+                *key = leaf->key;
+        }
+        if (data) {
+                *data = leaf->data;
+        }
+        return 0;
+}
+
+/**
+ * @brief Search the key
+ *
+ * @param tree adaptive radix tree whole
+ * @param key the key which I want to search
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_art_search(struct rb_art *tree, key_t key, void **data)
+{
+        struct rb_art_node *node = tree->root;
+        struct rb_art_node **child = NULL;
+        unsigned int depth = 0;
+
+        while (node && node->type != RB_ART_LEAF) {
+                if (rb_art_match(node, key, depth) != node->prefix_len) {
+                        return -ENODATA;
+                }
+                depth += node->prefix_len;
+                child = rb_art_child(node, rb_art_byte(key, depth++));
+                node = child ? *child : NULL;
+        }
+        if (!node || RB_ART_LEAF(node)->key != key) {
+                return -ENODATA;
+        }
+        return rb_art_entry(RB_ART_LEAF(node), NULL, data);
+}
+
+/**
+ * @brief First leaf which key is not less than the key in the subtree
+ */
+static struct rb_art_leaf *rb_art_lower(struct rb_art_node *node, key_t key,
+                                        unsigned int depth)
+{
+        struct rb_art_node **child = NULL;
+        struct rb_art_leaf *leaf = NULL;
+        unsigned int matched, byte;
+
+        if (node->type == RB_ART_LEAF) {
+                return (RB_ART_LEAF(node)->key >= key) ? RB_ART_LEAF(node) :
+                                                         NULL;
+        }
+        matched = rb_art_match(node, key, depth);
+        if (matched < node->prefix_len) { /**< every key is less or greater */
+                return (node->prefix[matched] >
+                        rb_art_byte(key, depth + matched)) ?
+                               rb_art_minimum_leaf(node) :
+                               NULL;
+        }
+        depth += node->prefix_len;
+        byte = rb_art_byte(key, depth);
+        child = rb_art_child(node, byte);
+        if (child) {
+                leaf = rb_art_lower(*child, key, depth + 1);
+                if (leaf) {
+                        return leaf;
+                }
+        }
+        return rb_art_minimum_leaf(rb_art_next(node, byte + 1, &byte));
+}
+
+/**
+ * @brief Find the first key which is not less than the key
+ *
+ * @param tree adaptive radix tree whole
+ * @param key lower bound key
+ * @param found found key stored location (nullable)
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_art_lower_bound(struct rb_art *tree, key_t key, key_t *found,
+                       void **data)
+{
+        if (!tree->root) {
+                return -ENODATA;
+        }
+        return rb_art_entry(rb_art_lower(tree->root, key, 0), found, data);
+}
+
+/**
+ * @brief Find the first key which is greater than the key
+ *
+ * @param tree adaptive radix tree whole
+ * @param key base key (it does not need to be in the tree)
+ * @param next found key stored location (nullable)
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_art_successor(struct rb_art *tree, key_t key, key_t *next, void **data)
+{
+        if (key == RB_MAX_KEY) {
+                return -ENODATA;
+        }
+        return rb_art_lower_bound(tree, key + 1, next, data);
+}
+
+int rb_art_minimum(struct rb_art *tree, key_t *key, void **data)
+{
+        return rb_art_entry(rb_art_minimum_leaf(tree->root), key, data);
+}
+
+int rb_art_maximum(struct rb_art *tree, key_t *key, void **data)
+{
+        return rb_art_entry(rb_art_maximum_leaf(tree->root), key, data);
+}
+
+/**
+ * @brief Insert the leaf
+ *
+ * @param tree adaptive radix tree whole
+ * @param leaf new leaf
+ * @param old the leaf which has the same key stored location
+ * @return int 0 means success. -EEXIST means that the key exists (the leaf
+ * is not inserted). -ENOMEM means that the tree is not changed.
+ */
+static int rb_art_insert_leaf(struct rb_art *tree, struct rb_art_leaf *leaf,
+                              struct rb_art_leaf **old)
+{
+        struct rb_art_node **ref = &tree->root, **child = NULL;
+        struct rb_art_node *node = NULL, *new_node = NULL;
+        key_t key = leaf->key;
+        unsigned int depth = 0, matched;
+
+        while (*ref) {
+                node = *ref;
+                if (node->type == RB_ART_LEAF) {
+                        key_t other = RB_ART_LEAF(node)->key;
+
+                        if (other == key) {
+                                *old = RB_ART_LEAF(node);
+                                return -EEXIST;
+                        }
+                        new_node = rb_art_node_alloc(RB_ART_NODE4);
+                        if (!new_node) {
+                                return -ENOMEM;
+                        }
+                        for (matched = 0; rb_art_byte(other, depth + matched) ==
+                                          rb_art_byte(key, depth + matched);
+                             matched++) {
+                                new_node->prefix[matched] =
+                                        (uint8_t)rb_art_byte(key,
+                                                             depth + matched);
+                        }
+                        new_node->prefix_len = (uint8_t)matched;
+                        rb_art_add(new_node, rb_art_byte(other, depth + matched),
+                                   node);
+                        rb_art_add(new_node, rb_art_byte(key, depth + matched),
+                                   &leaf->hdr);
+                        *ref = new_node;
+                        goto inserted;
+                }
+
+                matched = rb_art_match(node, key, depth);
+                if (matched < node->prefix_len) { /**< split the prefix */
+                        new_node = rb_art_node_alloc(RB_ART_NODE4);
+                        if (!new_node) {
+                                return -ENOMEM;
+                        }
+                        memcpy(new_node->prefix, node->prefix, matched);
+                        new_node->prefix_len = (uint8_t)matched;
+                        rb_art_add(new_node, node->prefix[matched], node);
+                        rb_art_add(new_node, rb_art_byte(key, depth + matched),
+                                   &leaf->hdr);
+                        node->prefix_len -= (uint8_t)(matched + 1);
+                        memmove(node->prefix, &node->prefix[matched + 1],
+                                node->prefix_len);
+                        *ref = new_node;
+                        goto inserted;
+                }
+
+                depth += node->prefix_len;
+                child = rb_art_child(node, rb_art_byte(key, depth));
+                if (!child) {
+                        if (node->nr_children == rb_art_capacity[node->type]) {
+                                node = rb_art_convert(node, node->type + 1);
+                                if (!node) {
+                                        return -ENOMEM;
+                                }
+                                *ref = node;
+                        }
+                        rb_art_add(node, rb_art_byte(key, depth), &leaf->hdr);
+                        goto inserted;
+                }
+                ref = child;
+                depth++;
+        }
+        *ref = &leaf->hdr;
+inserted:
+        tree->nr_keys++;
+        return 0;
+}
+
+/**
+ * @brief Insert the key and the data
+ *
+ * @param tree adaptive radix tree whole
+ * @param key new key
+ * @param data new data (the data of the same key is freed and updated)
+ * @return int 0 means success. -ENOMEM means that nothing is inserted.
+ */
+int rb_art_insert(struct rb_art *tree, key_t key, void *data)
+{
+        struct rb_art_leaf *leaf = NULL, *old = NULL;
+        int ret;
+
+        leaf = RB_ART_LEAF(rb_art_node_alloc(RB_ART_LEAF));
+        if (!leaf) {
+                return -ENOMEM;
+        }
+        leaf->key = key;
+        leaf->data = data;
+        ret = rb_art_insert_leaf(tree, leaf, &old);
+        if (ret == -EEXIST) {
+                free(old->data);
+                old->data = data;
+                ret = 0;
+        }
+        if (ret || old) {
+                free(leaf);
+        }
+        return ret;
+}
+
+/**
+ * @brief Detach the leaf of the key
+ * @details
+ * The parent is fitted after the removal. The fit never fails (the bigger
+ * node is kept if it cannot allocate), so the delete needs no memory.
+ *
+ * @return struct rb_art_leaf* detached leaf (NULL means not found)
+ */
+static struct rb_art_leaf *rb_art_detach(struct rb_art *tree, key_t key)
+{
+        struct rb_art_node **ref = &tree->root, **parent = NULL;
+        struct rb_art_node *node = NULL;
+        unsigned int depth = 0, byte = 0;
+
+        while ((node = *ref) && node->type != RB_ART_LEAF) {
+                if (rb_art_match(node, key, depth) != node->prefix_len) {
+                        return NULL;
+                }
+                depth += node->prefix_len;
+                byte = rb_art_byte(key, depth++);
+                parent = ref;
+                ref = rb_art_child(node, byte);
+                if (!ref) {
+                        return NULL;
+                }
+        }
+        if (!node || RB_ART_LEAF(node)->key != key) {
+                return NULL;
+        }
+        if (!parent) {
+                tree->root = NULL;
+        } else {
+                rb_art_remove(*parent, byte);
+                *parent = rb_art_fit(*parent);
+        }
+        tree->nr_keys--;
+        return RB_ART_LEAF(node);
+}
+
+/**
+ * @brief Delete the key
+ *
+ * @param tree adaptive radix tree whole
+ * @param key delete target key
+ * @return int 0 means that delete success. -ENODATA means not found.
+ */
+int rb_art_delete(struct rb_art *tree, key_t key)
+{
+        struct rb_art_leaf *leaf = rb_art_detach(tree, key);
+
+        if (!leaf) {
+                return -ENODATA;
+        }
+        free(leaf->data);
+        free(leaf);
+        return 0;
+}
+
+/**
+ * @brief Visit the leaves of the subtree in [first, last]
+ *
+ * @param base key bits which are fixed above the node
+ * @param depth depth of the node
+ */
+static int rb_art_walk(struct rb_art_node *node, key_t base,
+                       unsigned int depth, key_t first, key_t last,
+                       rb_art_fn fn, void *arg)
+{
+        struct rb_art_node *child = NULL;
+        unsigned int byte, shift;
+        key_t mask;
+        int ret;
+
+        if (node->type == RB_ART_LEAF) {
+                struct rb_art_leaf *leaf = RB_ART_LEAF(node);
+
+                if (leaf->key < first || leaf->key > last) {
+                        return 0;
+                }
+                return fn(leaf->key, leaf->data, arg);
+        }
+        for (unsigned int i = 0; i < node->prefix_len; i++, depth++) {
+                base |= (key_t)node->prefix[i]
+                        << (8 * (RB_ART_KEY_BYTES - 1 - depth));
+        }
+        shift = 8 * (RB_ART_KEY_BYTES - 1 - depth); /**< of the child byte */
+        mask = (depth == 0) ? RB_MAX_KEY : ((key_t)1 << (shift + 8)) - 1;
+        if (base > last || (base | mask) < first) {
+                return 0;
+        }
+        byte = ((first & ~mask) == base) ? rb_art_byte(first, depth) : 0;
+        for (child = rb_art_next(node, byte, &byte); child;
+             child = rb_art_next(node, byte + 1, &byte)) {
+                if ((base | ((key_t)byte << shift)) > last) {
+                        break;
+                }
+                ret = rb_art_walk(child, base | ((key_t)byte << shift),
+                                  depth + 1, first, last, fn, arg);
+                if (ret) {
+                        return ret;
+                }
+        }
+        return 0;
+}
+
+/**
+ * @brief Visit the keys in [first, last] in the key order
+ *
+ * @param tree adaptive radix tree whole
+ * @param first first key of the range
+ * @param last last key of the range (inclusive)
+ * @param fn visitor
+ * @param arg user argument
+ * @return int 0 means that every key is visited. Else, the visitor's
+ * return value which stopped the scan.
+ */
+int rb_art_for_each(struct rb_art *tree, key_t first, key_t last, rb_art_fn fn,
+                    void *arg)
+{
+        if (!tree->root || first > last) {
+                return 0;
+        }
+        return rb_art_walk(tree->root, 0, 0, first, last, fn, arg);
+}
+
+/**
+ * @brief Split the subtree to the keys <= x and the keys > x
+ * @details
+ * Only the nodes on the path of x are divided. The right part of each of
+ * them goes to the node of the same type from the pool, so it always has
+ * a room. Both parts are fitted after the split.
+ *
+ * @param pool preallocated nodes of the path in order
+ */
+static void rb_art_split_node(struct rb_art_node *node, unsigned int depth,
+                              key_t x, struct rb_art_node ***pool,
+                              struct rb_art_node **lo, struct rb_art_node **hi)
+{
+        struct rb_art_node *right = NULL, *child = NULL;
+        struct rb_art_node *child_lo = NULL, *child_hi = NULL;
+        struct rb_art_node **ref = NULL;
+        unsigned int matched, byte, next;
+
+        *lo = *hi = NULL;
+        if (!node) {
+                return;
+        }
+        if (node->type == RB_ART_LEAF) {
+                *(RB_ART_LEAF(node)->key <= x ? lo : hi) = node;
+                return;
+        }
+        matched = rb_art_match(node, x, depth);
+        if (matched < node->prefix_len) {
+                *(node->prefix[matched] < rb_art_byte(x, depth + matched) ?
+                          lo :
+                          hi) = node;
+                return;
+        }
+
+        depth += node->prefix_len;
+        byte = rb_art_byte(x, depth);
+        right = *(*pool)++;
+        right->prefix_len = node->prefix_len;
+        memcpy(right->prefix, node->prefix, node->prefix_len);
+        while ((child = rb_art_next(node, byte + 1, &next))) {
+                rb_art_remove(node, next);
+                rb_art_add(right, next, child);
+        }
+        ref = rb_art_child(node, byte);
+        if (ref) {
+                child = *ref;
+                rb_art_remove(node, byte);
+                rb_art_split_node(child, depth + 1, x, pool, &child_lo,
+                                  &child_hi);
+                if (child_lo) {
+                        rb_art_add(node, byte, child_lo);
+                }
+                if (child_hi) {
+                        rb_art_add(right, byte, child_hi);
+                }
+        }
+        *lo = rb_art_fit(node);
+        *hi = rb_art_fit(right);
+}
+
+static void rb_art_free_inner(struct rb_art_node *node)
+{
+        struct rb_art_node *child = NULL;
+        unsigned int byte = 0;
+
+        if (!node || node->type == RB_ART_LEAF) {
+                return;
+        }
+        for (child = rb_art_next(node, 0, &byte); child;
+             child = rb_art_next(node, byte + 1, &byte)) {
+                rb_art_free_inner(child);
+        }
+        free(node);
+}
+
+static size_t rb_art_count(struct rb_art_node *node)
+{
+        struct rb_art_node *child = NULL;
+        unsigned int byte = 0;
+        size_t nr = 0;
+
+        if (!node || node->type == RB_ART_LEAF) {
+                return node ? 1 : 0;
+        }
+        for (child = rb_art_next(node, 0, &byte); child;
+             child = rb_art_next(node, byte + 1, &byte)) {
+                nr += rb_art_count(child);
+        }
+        return nr;
+}
+
+/**
+ * @brief Split tree to t1, t2 based on key value x
+ * @details
+ * Only the nodes on the path of x (at most 8) are divided and their nodes
+ * are allocated first, so a failed allocation leaves the tree untouched.
+ *
+ * @param tree split target tree (freed after the split)
+ * @param x split point (the keys less than or equal to x go to t1)
+ * @param t1 t1 stored location
+ * @param t2 t2 stored location
+ * @return int 0 means success. -ENOMEM means that the tree is not changed.
+ */
+int rb_art_split(struct rb_art *tree, key_t x, struct rb_art **t1,
+                 struct rb_art **t2)
+{
+        struct rb_art_node *pool[RB_ART_KEY_BYTES];
+        struct rb_art_node **next = pool;
+        struct rb_art_node *node = tree->root;
+        struct rb_art_node **child = NULL;
+        struct rb_art *lower = NULL, *upper = NULL;
+        unsigned int depth = 0, nr_pool = 0;
+
+        lower = rb_art_alloc();
+        upper = rb_art_alloc();
+        if (!lower || !upper) {
+                goto exception;
+        }
+        while (node && node->type != RB_ART_LEAF &&
+               rb_art_match(node, x, depth) == node->prefix_len) {
+                pool[nr_pool] = rb_art_node_alloc(node->type);
+                if (!pool[nr_pool]) {
+                        goto exception;
+                }
+                nr_pool++;
+                depth += node->prefix_len;
+                child = rb_art_child(node, rb_art_byte(x, depth++));
+                node = child ? *child : NULL;
+        }
+
+        rb_art_split_node(tree->root, 0, x, &next, &lower->root, &upper->root);
+        lower->nr_keys = rb_art_count(lower->root);
+        upper->nr_keys = tree->nr_keys - lower->nr_keys;
+        free(tree);
+
+        *t1 = lower;
+        *t2 = upper;
+        return 0;
+exception:
+        while (nr_pool > 0) {
+                free(pool[--nr_pool]);
+        }
+        free(lower);
+        free(upper);
+        return -ENOMEM;
+}
+
+static void rb_art_gather(struct rb_art_node *node, struct rb_art_leaf **leaves,
+                          size_t *nr)
+{
+        struct rb_art_node *child = NULL;
+        unsigned int byte = 0;
+
+        if (node->type == RB_ART_LEAF) {
+                leaves[(*nr)++] = RB_ART_LEAF(node);
+                return;
+        }
+        for (child = rb_art_next(node, 0, &byte); child;
+             child = rb_art_next(node, byte + 1, &byte)) {
+                rb_art_gather(child, leaves, nr);
+        }
+}
+
+/**
+ * @brief Concatenate two trees (every key of t1 is less than t2's)
+ * @details
+ * The leaves of the smaller tree are moved to the bigger one. The moved
+ * leaves are detached again if an insert fails.
+ *
+ * @param t1 tree which has the smaller keys (reused as the result)
+ * @param t2 tree which has the greater keys (freed)
+ * @return struct rb_art* concatenated tree. NULL means that t1 and t2 are
+ * not changed.
+ */
+struct rb_art *rb_art_concat(struct rb_art *t1, struct rb_art *t2)
+{
+        struct rb_art *src = (t1->nr_keys < t2->nr_keys) ? t1 : t2;
+        struct rb_art *dst = (src == t1) ? t2 : t1;
+        struct rb_art_leaf **leaves = NULL;
+        struct rb_art_leaf *old = NULL;
+        size_t nr = 0;
+
+        if (t1->root && t2->root &&
+            rb_art_maximum_leaf(t1->root)->key >=
+                    rb_art_minimum_leaf(t2->root)->key) {
+                pr_info("invalid state key state t1.max < t2.min\n");
+                return NULL;
+        }
+        if (src->root) {
+                leaves = (struct rb_art_leaf **)malloc(sizeof(*leaves) *
+                                                       src->nr_keys);
+                if (!leaves) {
+                        pr_info("Memory allocation failed\n");
+                        return NULL;
+                }
+                rb_art_gather(src->root, leaves, &nr);
+        }
+        for (size_t i = 0; i < nr; i++) {
+                if (rb_art_insert_leaf(dst, leaves[i], &old)) {
+                        while (i-- > 0) {
+                                rb_art_detach(dst, leaves[i]->key);
+                        }
+                        free(leaves);
+                        return NULL;
+                }
+        }
+        free(leaves);
+
+        rb_art_free_inner(src->root);
+        t1->root = dst->root;
+        t1->nr_keys = dst->nr_keys;
+        free(t2);
+        return t1;
+}
+
+static void rb_art_free_node(struct rb_art_node *node)
+{
+        struct rb_art_node *child = NULL;
+        unsigned int byte = 0;
+
+        if (node->type == RB_ART_LEAF) {
+                free(RB_ART_LEAF(node)->data);
+                free(node);
+                return;
+        }
+        for (child = rb_art_next(node, 0, &byte); child;
+             child = rb_art_next(node, byte + 1, &byte)) {
+                rb_art_free_node(child);
+        }
+        free(node);
+}
+
+/**
+ * @brief Does deallocation of the adaptive radix tree with its data
+ *
+ * @param tree adaptive radix tree whole
+ */
+void rb_art_dealloc(struct rb_art *tree)
+{
+        if (tree->root) {
+                rb_art_free_node(tree->root);
+        }
+        free(tree);
+}
@@ -0,0 +1,118 @@
+/**
+ * @file rb-art.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief adaptive radix tree's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * The key is split to 8 bytes from the most significant byte, so the byte
+ * order is the key order and the search needs no key comparison. An inner
+ * node grows from Node4 to Node16, Node48 and Node256 (and shrinks back)
+ * by the number of its children. The bytes which every key of a subtree
+ * shares are kept in the node (path compression), so a node has at least
+ * two children. The key is at most 8 bytes, so the whole prefix fits in
+ * the node.
+ *
+ * The keys are unique. Like `struct rb_tree`, the tree owns the data: it
+ * is freed by delete, by the update of the same key and by dealloc.
+ *
+ * @ref Leis, V., Kemper, A., & Neumann, T. (2013). The adaptive radix tree: ARTful indexing for main-memory databases. ICDE.
+ */
+#ifndef RB_ART_H_
+#define RB_ART_H_
+
+#include "rb-tree.h"
+
+#define RB_ART_KEY_BYTES ((unsigned int)sizeof(key_t))
+
+/**
+ * @brief Types of the node
+ *
+ */
+enum rb_art_type {
+        RB_ART_LEAF,
+        RB_ART_NODE4,
+        RB_ART_NODE16,
+        RB_ART_NODE48,
+        RB_ART_NODE256,
+};
+
+/**
+ * @brief Common header of the nodes
+ *
+ */
+struct rb_art_node {
+        uint8_t type; /**< enum rb_art_type */
+        uint8_t prefix_len;
+        uint16_t nr_children;
+        uint8_t prefix[RB_ART_KEY_BYTES]; /**< bytes before the child byte */
+};
+
+struct rb_art_leaf {
+        struct rb_art_node hdr;
+        key_t key;
+        void *data;
+};
+
+struct rb_art_node4 {
+        struct rb_art_node hdr;
+        uint8_t keys[4]; /**< sorted child bytes */
+        struct rb_art_node *children[4];
+};
+
+struct rb_art_node16 {
+        struct rb_art_node hdr;
+        uint8_t keys[16]; /**< sorted child bytes */
+        struct rb_art_node *children[16];
+};
+
+struct rb_art_node48 {
+        struct rb_art_node hdr;
+        uint8_t index[256]; /**< slot + 1 of the byte (0 means none) */
+        struct rb_art_node *children[48];
+};
+
+struct rb_art_node256 {
+        struct rb_art_node hdr;
+        struct rb_art_node *children[256];
+};
+
+/**
+ * @brief Adaptive radix tree structure
+ *
+ */
+struct rb_art {
+        struct rb_art_node *root; /**< NULL means empty */
+        size_t nr_keys;
+};
+
+/**
+ * @brief Visitor of the range scan
+ *
+ * @param key visited key
+ * @param data data of the key
+ * @param arg user argument
+ * @return int 0 means continue. Not 0 stops the scan.
+ */
+typedef int (*rb_art_fn)(key_t key, void *data, void *arg);
+
+struct rb_art *rb_art_alloc(void);
+int rb_art_search(struct rb_art *tree, key_t key, void **data);
+int rb_art_lower_bound(struct rb_art *tree, key_t key, key_t *found,
+                       void **data);
+int rb_art_successor(struct rb_art *tree, key_t key, key_t *next, void **data);
+int rb_art_minimum(struct rb_art *tree, key_t *key, void **data);
+int rb_art_maximum(struct rb_art *tree, key_t *key, void **data);
+int rb_art_insert(struct rb_art *tree, key_t key, void *data);
+int rb_art_delete(struct rb_art *tree, key_t key);
+int rb_art_for_each(struct rb_art *tree, key_t first, key_t last, rb_art_fn fn,
+                    void *arg);
+int rb_art_split(struct rb_art *tree, key_t x, struct rb_art **t1,
+                 struct rb_art **t2);
+struct rb_art *rb_art_concat(struct rb_art *t1, struct rb_art *t2);
+void rb_art_dealloc(struct rb_art *tree);
+
+#endif
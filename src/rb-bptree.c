@@ -0,0 +1,956 @@
+/**
+ * @file rb-bptree.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief cache-conscious B+-tree implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#include <stdlib.h>
+#include "rb-bptree.h"
+
+_Static_assert(sizeof(struct rb_bptree_inner) <= RB_BPTREE_NODE_SIZE,
+               "inner node must fit in RB_BPTREE_NODE_SIZE");
+_Static_assert(sizeof(struct rb_bptree_leaf) <= RB_BPTREE_NODE_SIZE,
+               "leaf node must fit in RB_BPTREE_NODE_SIZE");
+
+#define RB_BPTREE_INNER(node) ((struct rb_bptree_inner *)(node))
+#define RB_BPTREE_LEAF(node) ((struct rb_bptree_leaf *)(node))
+
+/**
+ * @brief Preallocated memory of the bottom-up build
+ * @details
+ * Split and concat rebuild the inner nodes over the leaf chain. Everything
+ * is allocated before the tree is changed, so they fail without a change.
+ *
+ */
+struct rb_bptree_build {
+        struct rb_bptree_node **nodes; /**< nodes of the current level */
+        key_t *mins; /**< smallest key of each node of the level */
+        struct rb_bptree_node **pool; /**< unused inner nodes */
+        size_t nr_pool;
+};
+
+static struct rb_bptree_node *rb_bptree_node_alloc(unsigned int is_leaf)
+{
+        struct rb_bptree_node *node = (struct rb_bptree_node *)aligned_alloc(
+                RB_CACHE_LINE_SIZE, RB_BPTREE_NODE_SIZE);
+
+        if (!node) {
+                pr_info("Memory allocation failed\n");
+                return NULL;
+        }
+        node->is_leaf = is_leaf;
+        node->nr_keys = 0;
+        if (is_leaf) {
+                RB_BPTREE_LEAF(node)->prev = NULL;
+                RB_BPTREE_LEAF(node)->next = NULL;
+        }
+        return node;
+}
+
+/**
+ * @brief Allocation of B+-tree
+ *
+ * @return struct rb_bptree* allocated B+-tree
+ */
+struct rb_bptree *rb_bptree_alloc(void)
+{
+        struct rb_bptree *tree =
+                (struct rb_bptree *)malloc(sizeof(struct rb_bptree));
+        if (!tree) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+        tree->root = NULL;
+        tree->head = tree->tail = NULL;
+        tree->nr_keys = 0;
+        tree->height = 0;
+        return tree;
+}
+
+/**
+ * @brief Child index which covers the key (the number of keys <= key)
+ */
+static inline unsigned int rb_bptree_route(const struct rb_bptree_inner *inner,
+                                           key_t key)
+{
+        unsigned int i = 0;
+
+        for (unsigned int j = 0; j < inner->hdr.nr_keys; j++) {
+                i += (inner->keys[j] <= key);
+        }
+        return i;
+}
+
+/**
+ * @brief Position of the first key which is not less than the key
+ */
+static inline unsigned int rb_bptree_leaf_pos(const struct rb_bptree_leaf *leaf,
+                                              key_t key)
+{
+        unsigned int i = 0;
+
+        for (unsigned int j = 0; j < leaf->hdr.nr_keys; j++) {
+                i += (leaf->keys[j] < key);
+        }
+        return i;
+}
+
+static struct rb_bptree_leaf *rb_bptree_find_leaf(struct rb_bptree *tree,
+                                                  key_t key)
+{
+        struct rb_bptree_node *node = tree->root;
+
+        while (!node->is_leaf) {
+                node = RB_BPTREE_INNER(node)
+                               ->children[rb_bptree_route(RB_BPTREE_INNER(node),
+                                                          key)];
+        }
+        return RB_BPTREE_LEAF(node);
+}
+
+/**
+ * @brief Search the key
+ *
+ * @param tree B+-tree whole
+ * @param key the key which I want to search
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_bptree_search(struct rb_bptree *tree, key_t key, void **data)
+{
+        struct rb_bptree_leaf *leaf = NULL;
+        unsigned int pos;
+
+        if (!tree->root) {
+                return -ENODATA;
+        }
+        leaf = rb_bptree_find_leaf(tree, key);
+        pos = rb_bptree_leaf_pos(leaf, key);
+        if (pos == leaf->hdr.nr_keys || leaf->keys[pos] != key) {
+                return -ENODATA;
+        }
+        if (data) {
+                *data = leaf->data[pos];
+        }
+        return 0;
+}
+
+/**
+ * @brief Report the entry of the leaf (the next leaf if pos is the end)
+ */
+static int rb_bptree_entry(struct rb_bptree_leaf *leaf, unsigned int pos,
+                           key_t *key, void **data)
+{
+        if (pos == leaf->hdr.nr_keys) {
+                leaf = leaf->next;
+                pos = 0;
+        }
+        if (!leaf) {
+                return -ENODATA;
+        }
+        if (key) {
+                *key = leaf->keys[pos];
+        }
+        if (data) {
+                *data = leaf->data[pos];
+        }
+        return 0;
+}
+
+/**
+ * @brief Find the first key which is not less than the key
+ *
+ * @param tree B+-tree whole
+ * @param key lower bound key
+ * @param found found key stored location (nullable)
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_bptree_lower_bound(struct rb_bptree *tree, key_t key, key_t *found,
+                          void **data)
+{
+        struct rb_bptree_leaf *leaf = NULL;
+
+        if (!tree->root) {
+                return -ENODATA;
+        }
+        leaf = rb_bptree_find_leaf(tree, key);
+        return rb_bptree_entry(leaf, rb_bptree_leaf_pos(leaf, key), found,
+                               data);
+}
+
+/**
+ * @brief Find the first key which is greater than the key
+ *
+ * @param tree B+-tree whole
+ * @param key base key (it does not need to be in the tree)
+ * @param next found key stored location (nullable)
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_bptree_successor(struct rb_bptree *tree, key_t key, key_t *next,
+                        void **data)
+{
+        struct rb_bptree_leaf *leaf = NULL;
+        unsigned int pos;
+
+        if (!tree->root) {
+                return -ENODATA;
+        }
+        leaf = rb_bptree_find_leaf(tree, key);
+        pos = rb_bptree_leaf_pos(leaf, key);
+        if (pos < leaf->hdr.nr_keys && leaf->keys[pos] == key) {
+                pos++;
+        }
+        return rb_bptree_entry(leaf, pos, next, data);
+}
+
+int rb_bptree_minimum(struct rb_bptree *tree, key_t *key, void **data)
+{
+        if (!tree->head) {
+                return -ENODATA;
+        }
+        return rb_bptree_entry(tree->head, 0, key, data);
+}
+
+int rb_bptree_maximum(struct rb_bptree *tree, key_t *key, void **data)
+{
+        if (!tree->tail) {
+                return -ENODATA;
+        }
+        return rb_bptree_entry(tree->tail, tree->tail->hdr.nr_keys - 1, key,
+                               data);
+}
+
+static inline int rb_bptree_is_full(const struct rb_bptree_node *node)
+{
+        return node->nr_keys == (node->is_leaf ? RB_BPTREE_LEAF_KEYS :
+                                                 RB_BPTREE_INNER_KEYS);
+}
+
+static inline unsigned int rb_bptree_min(const struct rb_bptree_node *node)
+{
+        return node->is_leaf ? RB_BPTREE_LEAF_MIN : RB_BPTREE_INNER_MIN;
+}
+
+/**
+ * @brief Split the full child to the sibling which is allocated already
+ *
+ * @param tree B+-tree whole
+ * @param parent parent which is not full
+ * @param i index of the child
+ * @param sibling empty node of the same kind as the child
+ */
+static void rb_bptree_split_child(struct rb_bptree *tree,
+                                  struct rb_bptree_inner *parent,
+                                  unsigned int i,
+                                  struct rb_bptree_node *sibling)
+{
+        struct rb_bptree_node *child = parent->children[i];
+        unsigned int keep = child->nr_keys / 2;
+        key_t separator;
+
+        if (child->is_leaf) {
+                struct rb_bptree_leaf *left = RB_BPTREE_LEAF(child);
+                struct rb_bptree_leaf *right = RB_BPTREE_LEAF(sibling);
+
+                right->hdr.nr_keys = left->hdr.nr_keys - keep;
+                memcpy(right->keys, &left->keys[keep],
+                       sizeof(key_t) * right->hdr.nr_keys);
+                memcpy(right->data, &left->data[keep],
+                       sizeof(void *) * right->hdr.nr_keys);
+                left->hdr.nr_keys = keep;
+
+                right->prev = left;
+                right->next = left->next;
+                if (left->next) {
+                        left->next->prev = right;
+                } else {
+                        tree->tail = right;
+                }
+                left->next = right;
+                separator = right->keys[0];
+        } else {
+                struct rb_bptree_inner *left = RB_BPTREE_INNER(child);
+                struct rb_bptree_inner *right = RB_BPTREE_INNER(sibling);
+
+                separator = left->keys[keep]; /**< moves up to the parent */
+                right->hdr.nr_keys = left->hdr.nr_keys - keep - 1;
+                memcpy(right->keys, &left->keys[keep + 1],
+                       sizeof(key_t) * right->hdr.nr_keys);
+                memcpy(right->children, &left->children[keep + 1],
+                       sizeof(left->children[0]) * (right->hdr.nr_keys + 1));
+                left->hdr.nr_keys = keep;
+        }
+
+        memmove(&parent->keys[i + 1], &parent->keys[i],
+                sizeof(key_t) * (parent->hdr.nr_keys - i));
+        memmove(&parent->children[i + 2], &parent->children[i + 1],
+                sizeof(parent->children[0]) * (parent->hdr.nr_keys - i));
+        parent->keys[i] = separator;
+        parent->children[i + 1] = sibling;
+        parent->hdr.nr_keys++;
+}
+
+/**
+ * @brief Insert the key and the data
+ * @details
+ * The full nodes on the path are split before the descent, so the leaf
+ * always has a room. If the key exists, its data is freed and updated.
+ *
+ * @param tree B+-tree whole
+ * @param key new key
+ * @param data new data
+ * @return int 0 means success. -ENOMEM means that nothing is inserted.
+ */
+int rb_bptree_insert(struct rb_bptree *tree, key_t key, void *data)
+{
+        struct rb_bptree_node *node = NULL, *sibling = NULL;
+        struct rb_bptree_inner *inner = NULL;
+        struct rb_bptree_leaf *leaf = NULL;
+        unsigned int i, pos;
+
+        if (!tree->root) {
+                node = rb_bptree_node_alloc(1);
+                if (!node) {
+                        return -ENOMEM;
+                }
+                tree->root = node;
+                tree->head = tree->tail = RB_BPTREE_LEAF(node);
+        }
+        if (rb_bptree_is_full(tree->root)) {
+                inner = RB_BPTREE_INNER(rb_bptree_node_alloc(0));
+                sibling = rb_bptree_node_alloc(tree->root->is_leaf);
+                if (!inner || !sibling) {
+                        free(inner);
+                        free(sibling);
+                        return -ENOMEM;
+                }
+                inner->children[0] = tree->root;
+                rb_bptree_split_child(tree, inner, 0, sibling);
+                tree->root = &inner->hdr;
+                tree->height++;
+        }
+
+        node = tree->root;
+        while (!node->is_leaf) {
+                inner = RB_BPTREE_INNER(node);
+                i = rb_bptree_route(inner, key);
+                if (rb_bptree_is_full(inner->children[i])) {
+                        sibling = rb_bptree_node_alloc(
+                                inner->children[i]->is_leaf);
+                        if (!sibling) {
+                                return -ENOMEM;
+                        }
+                        rb_bptree_split_child(tree, inner, i, sibling);
+                        i += (key >= inner->keys[i]);
+                }
+                node = inner->children[i];
+        }
+
+        leaf = RB_BPTREE_LEAF(node);
+        pos = rb_bptree_leaf_pos(leaf, key);
+        if (pos < leaf->hdr.nr_keys && leaf->keys[pos] == key) {
+                free(leaf->data[pos]);
+                leaf->data[pos] = data;
+                return 0;
+        }
+        memmove(&leaf->keys[pos + 1], &leaf->keys[pos],
+                sizeof(key_t) * (leaf->hdr.nr_keys - pos));
+        memmove(&leaf->data[pos + 1], &leaf->data[pos],
+                sizeof(void *) * (leaf->hdr.nr_keys - pos));
+        leaf->keys[pos] = key;
+        leaf->data[pos] = data;
+        leaf->hdr.nr_keys++;
+        tree->nr_keys++;
+        return 0;
+}
+
+/**
+ * @brief Move the last entry of the left sibling to the child
+ */
+static void rb_bptree_borrow_left(struct rb_bptree_inner *parent,
+                                  unsigned int i)
+{
+        struct rb_bptree_node *child = parent->children[i];
+        struct rb_bptree_node *sibling = parent->children[i - 1];
+        unsigned int nr = child->nr_keys;
+
+        if (child->is_leaf) {
+                struct rb_bptree_leaf *leaf = RB_BPTREE_LEAF(child);
+                struct rb_bptree_leaf *left = RB_BPTREE_LEAF(sibling);
+
+                memmove(&leaf->keys[1], &leaf->keys[0], sizeof(key_t) * nr);
+                memmove(&leaf->data[1], &leaf->data[0], sizeof(void *) * nr);
+                leaf->keys[0] = left->keys[left->hdr.nr_keys - 1];
+                leaf->data[0] = left->data[left->hdr.nr_keys - 1];
+                parent->keys[i - 1] = leaf->keys[0];
+        } else {
+                struct rb_bptree_inner *inner = RB_BPTREE_INNER(child);
+                struct rb_bptree_inner *left = RB_BPTREE_INNER(sibling);
+
+                memmove(&inner->keys[1], &inner->keys[0], sizeof(key_t) * nr);
+                memmove(&inner->children[1], &inner->children[0],
+                        sizeof(inner->children[0]) * (nr + 1));
+                inner->keys[0] = parent->keys[i - 1];
+                inner->children[0] = left->children[left->hdr.nr_keys];
+                parent->keys[i - 1] = left->keys[left->hdr.nr_keys - 1];
+        }
+        sibling->nr_keys--;
+        child->nr_keys++;
+}
+
+/**
+ * @brief Move the first entry of the right sibling to the child
+ */
+static void rb_bptree_borrow_right(struct rb_bptree_inner *parent,
+                                   unsigned int i)
+{
+        struct rb_bptree_node *child = parent->children[i];
+        struct rb_bptree_node *sibling = parent->children[i + 1];
+        unsigned int nr = child->nr_keys, rest = sibling->nr_keys - 1;
+
+        if (child->is_leaf) {
+                struct rb_bptree_leaf *leaf = RB_BPTREE_LEAF(child);
+                struct rb_bptree_leaf *right = RB_BPTREE_LEAF(sibling);
+
+                leaf->keys[nr] = right->keys[0];
+                leaf->data[nr] = right->data[0];
+                memmove(&right->keys[0], &right->keys[1], sizeof(key_t) * rest);
+                memmove(&right->data[0], &right->data[1], sizeof(void *) * rest);
+                parent->keys[i] = right->keys[0];
+        } else {
+                struct rb_bptree_inner *inner = RB_BPTREE_INNER(child);
+                struct rb_bptree_inner *right = RB_BPTREE_INNER(sibling);
+
+                inner->keys[nr] = parent->keys[i];
+                inner->children[nr + 1] = right->children[0];
+                parent->keys[i] = right->keys[0];
+                memmove(&right->keys[0], &right->keys[1], sizeof(key_t) * rest);
+                memmove(&right->children[0], &right->children[1],
+                        sizeof(right->children[0]) * (rest + 1));
+        }
+        sibling->nr_keys--;
+        child->nr_keys++;
+}
+
+/**
+ * @brief Merge children[i + 1] to children[i]
+ */
+static void rb_bptree_merge(struct rb_bptree *tree,
+                            struct rb_bptree_inner *parent, unsigned int i)
+{
+        struct rb_bptree_node *child = parent->children[i];
+        struct rb_bptree_node *sibling = parent->children[i + 1];
+        unsigned int nr = child->nr_keys;
+
+        if (child->is_leaf) {
+                struct rb_bptree_leaf *left = RB_BPTREE_LEAF(child);
+                struct rb_bptree_leaf *right = RB_BPTREE_LEAF(sibling);
+
+                memcpy(&left->keys[nr], right->keys,
+                       sizeof(key_t) * right->hdr.nr_keys);
+                memcpy(&left->data[nr], right->data,
+                       sizeof(void *) * right->hdr.nr_keys);
+                left->hdr.nr_keys += right->hdr.nr_keys;
+                left->next = right->next;
+                if (right->next) {
+                        right->next->prev = left;
+                } else {
+                        tree->tail = left;
+                }
+        } else {
+                struct rb_bptree_inner *left = RB_BPTREE_INNER(child);
+                struct rb_bptree_inner *right = RB_BPTREE_INNER(sibling);
+
+                left->keys[nr] = parent->keys[i];
+                memcpy(&left->keys[nr + 1], right->keys,
+                       sizeof(key_t) * right->hdr.nr_keys);
+                memcpy(&left->children[nr + 1], right->children,
+                       sizeof(right->children[0]) * (right->hdr.nr_keys + 1));
+                left->hdr.nr_keys += right->hdr.nr_keys + 1;
+        }
+        free(sibling);
+
+        memmove(&parent->keys[i], &parent->keys[i + 1],
+                sizeof(key_t) * (parent->hdr.nr_keys - i - 1));
+        memmove(&parent->children[i + 1], &parent->children[i + 2],
+                sizeof(parent->children[0]) * (parent->hdr.nr_keys - i - 1));
+        parent->hdr.nr_keys--;
+}
+
+/**
+ * @brief Make the child have more than the minimum keys
+ *
+ * @return unsigned int index of the child which covers the same keys
+ */
+static unsigned int rb_bptree_fill(struct rb_bptree *tree,
+                                   struct rb_bptree_inner *parent,
+                                   unsigned int i)
+{
+        unsigned int min = rb_bptree_min(parent->children[i]);
+
+        if (i > 0 && parent->children[i - 1]->nr_keys > min) {
+                rb_bptree_borrow_left(parent, i);
+        } else if (i < parent->hdr.nr_keys &&
+                   parent->children[i + 1]->nr_keys > min) {
+                rb_bptree_borrow_right(parent, i);
+        } else if (i < parent->hdr.nr_keys) {
+                rb_bptree_merge(tree, parent, i);
+        } else {
+                rb_bptree_merge(tree, parent, --i);
+        }
+        return i;
+}
+
+/**
+ * @brief Delete the key
+ * @details
+ * The children on the path are filled above the minimum before the
+ * descent, so the leaf deletion never underflows.
+ *
+ * @param tree B+-tree whole
+ * @param key delete target key
+ * @return int 0 means that delete success. -ENODATA means not found.
+ */
+int rb_bptree_delete(struct rb_bptree *tree, key_t key)
+{
+        struct rb_bptree_node *node = tree->root;
+        struct rb_bptree_inner *inner = NULL;
+        struct rb_bptree_leaf *leaf = NULL;
+        unsigned int i, pos;
+
+        if (!node) {
+                return -ENODATA;
+        }
+        while (!node->is_leaf) {
+                inner = RB_BPTREE_INNER(node);
+                i = rb_bptree_route(inner, key);
+                if (inner->children[i]->nr_keys <=
+                    rb_bptree_min(inner->children[i])) {
+                        i = rb_bptree_fill(tree, inner, i);
+                }
+                node = inner->children[i];
+                if (&inner->hdr == tree->root && inner->hdr.nr_keys == 0) {
+                        tree->root = node; /**< the root is merged */
+                        tree->height--;
+                        free(inner);
+                }
+        }
+
+        leaf = RB_BPTREE_LEAF(node);
+        pos = rb_bptree_leaf_pos(leaf, key);
+        if (pos == leaf->hdr.nr_keys || leaf->keys[pos] != key) {
+                return -ENODATA;
+        }
+        free(leaf->data[pos]);
+        memmove(&leaf->keys[pos], &leaf->keys[pos + 1],
+                sizeof(key_t) * (leaf->hdr.nr_keys - pos - 1));
+        memmove(&leaf->data[pos], &leaf->data[pos + 1],
+                sizeof(void *) * (leaf->hdr.nr_keys - pos - 1));
+        leaf->hdr.nr_keys--;
+        tree->nr_keys--;
+        if (leaf->hdr.nr_keys == 0) { /**< only the root leaf can be empty */
+                free(leaf);
+                tree->root = NULL;
+                tree->head = tree->tail = NULL;
+        }
+        return 0;
+}
+
+/**
+ * @brief Visit the keys in [first, last] by the leaf chain
+ *
+ * @param tree B+-tree whole
+ * @param first first key of the range
+ * @param last last key of the range (inclusive)
+ * @param fn visitor
+ * @param arg user argument
+ * @return int 0 means that every key is visited. Else, the visitor's
+ * return value which stopped the scan.
+ */
+int rb_bptree_for_each(struct rb_bptree *tree, key_t first, key_t last,
+                       rb_bptree_fn fn, void *arg)
+{
+        struct rb_bptree_leaf *leaf = NULL;
+        unsigned int pos;
+        int ret;
+
+        if (!tree->root) {
+                return 0;
+        }
+        leaf = rb_bptree_find_leaf(tree, first);
+        pos = rb_bptree_leaf_pos(leaf, first);
+        for (; leaf; leaf = leaf->next, pos = 0) {
+                for (; pos < leaf->hdr.nr_keys; pos++) {
+                        if (leaf->keys[pos] > last) {
+                                return 0;
+                        }
+                        ret = fn(leaf->keys[pos], leaf->data[pos], arg);
+                        if (ret) {
+                                return ret;
+                        }
+                }
+        }
+        return 0;
+}
+
+static void rb_bptree_free_inner(struct rb_bptree_node *node)
+{
+        struct rb_bptree_inner *inner = RB_BPTREE_INNER(node);
+
+        if (!node || node->is_leaf) {
+                return;
+        }
+        for (unsigned int i = 0; i <= node->nr_keys; i++) {
+                rb_bptree_free_inner(inner->children[i]);
+        }
+        free(node);
+}
+
+static size_t rb_bptree_nr_inner(size_t nr_leaves)
+{
+        size_t total = 0;
+
+        while (nr_leaves > 1) {
+                nr_leaves = (nr_leaves + RB_BPTREE_INNER_KEYS) /
+                            (RB_BPTREE_INNER_KEYS + 1);
+                total += nr_leaves;
+        }
+        return total;
+}
+
+static void rb_bptree_build_release(struct rb_bptree_build *build)
+{
+        while (build->pool && build->nr_pool > 0) {
+                free(build->pool[--build->nr_pool]);
+        }
+        free(build->pool);
+        free(build->nodes);
+        free(build->mins);
+        memset(build, 0, sizeof(*build));
+}
+
+/**
+ * @brief Allocate everything which the build of `nr_leaves` leaves needs
+ *
+ * @return int 0 means success. -ENOMEM means that nothing is allocated.
+ */
+static int rb_bptree_build_prepare(struct rb_bptree_build *build,
+                                   size_t nr_leaves)
+{
+        size_t nr_inner = rb_bptree_nr_inner(nr_leaves);
+
+        memset(build, 0, sizeof(*build));
+        build->nodes = (struct rb_bptree_node **)malloc(
+                sizeof(*build->nodes) * (nr_leaves + 1));
+        build->mins = (key_t *)malloc(sizeof(key_t) * (nr_leaves + 1));
+        build->pool = (struct rb_bptree_node **)malloc(
+                sizeof(*build->pool) * (nr_inner + 1));
+        if (!build->nodes || !build->mins || !build->pool) {
+                goto exception;
+        }
+        while (build->nr_pool < nr_inner) {
+                build->pool[build->nr_pool] = rb_bptree_node_alloc(0);
+                if (!build->pool[build->nr_pool]) {
+                        goto exception;
+                }
+                build->nr_pool++;
+        }
+        return 0;
+exception:
+        pr_info("Memory shortage detected! Allocation failed...");
+        rb_bptree_build_release(build);
+        return -ENOMEM;
+}
+
+/**
+ * @brief Build the inner nodes over the leaf chain from the bottom
+ * @details
+ * The nodes of each level are spread evenly over the parents, so every
+ * node but the root has at least the minimum.
+ *
+ * @param tree tree which has only the leaf chain (head and tail)
+ * @param build prepared memory
+ */
+static void rb_bptree_build(struct rb_bptree *tree,
+                            struct rb_bptree_build *build)
+{
+        struct rb_bptree_inner *inner = NULL;
+        struct rb_bptree_leaf *leaf = NULL;
+        size_t nr = 0, nr_groups, size, k;
+
+        tree->nr_keys = 0;
+        tree->height = 0;
+        for (leaf = tree->head; leaf; leaf = leaf->next) {
+                build->nodes[nr] = &leaf->hdr;
+                build->mins[nr++] = leaf->keys[0];
+                tree->nr_keys += leaf->hdr.nr_keys;
+        }
+        while (nr > 1) {
+                nr_groups = (nr + RB_BPTREE_INNER_KEYS) /
+                            (RB_BPTREE_INNER_KEYS + 1);
+                k = 0;
+                for (size_t j = 0; j < nr_groups; j++) {
+                        size = nr / nr_groups + (j < nr % nr_groups);
+                        inner = RB_BPTREE_INNER(build->pool[--build->nr_pool]);
+                        inner->hdr.nr_keys = (unsigned int)size - 1;
+                        for (size_t t = 0; t < size; t++) {
+                                inner->children[t] = build->nodes[k + t];
+                                if (t > 0) {
+                                        inner->keys[t - 1] = build->mins[k + t];
+                                }
+                        }
+                        build->nodes[j] = &inner->hdr;
+                        build->mins[j] = build->mins[k];
+                        k += size;
+                }
+                nr = nr_groups;
+                tree->height++;
+        }
+        tree->root = nr ? build->nodes[0] : NULL;
+}
+
+static size_t rb_bptree_nr_leaves(struct rb_bptree_leaf *leaf)
+{
+        size_t nr = 0;
+
+        for (; leaf; leaf = leaf->next) {
+                nr++;
+        }
+        return nr;
+}
+
+/**
+ * @brief Rebalance the leaf and its next leaf (before the build)
+ * @details
+ * They are merged if they fit in a leaf. Else, the keys are spread evenly
+ * if either of them is under the minimum.
+ */
+static void rb_bptree_leaf_fix(struct rb_bptree *tree,
+                               struct rb_bptree_leaf *left)
+{
+        struct rb_bptree_leaf *right = left->next;
+        unsigned int total, target, move;
+
+        if (!right) {
+                return;
+        }
+        total = left->hdr.nr_keys + right->hdr.nr_keys;
+        if (total <= RB_BPTREE_LEAF_KEYS) {
+                memcpy(&left->keys[left->hdr.nr_keys], right->keys,
+                       sizeof(key_t) * right->hdr.nr_keys);
+                memcpy(&left->data[left->hdr.nr_keys], right->data,
+                       sizeof(void *) * right->hdr.nr_keys);
+                left->hdr.nr_keys = total;
+                left->next = right->next;
+                if (right->next) {
+                        right->next->prev = left;
+                } else {
+                        tree->tail = left;
+                }
+                free(right);
+                return;
+        }
+        if (left->hdr.nr_keys >= RB_BPTREE_LEAF_MIN &&
+            right->hdr.nr_keys >= RB_BPTREE_LEAF_MIN) {
+                return;
+        }
+        target = total / 2;
+        if (left->hdr.nr_keys > target) { /**< left's tail to right's head */
+                move = left->hdr.nr_keys - target;
+                memmove(&right->keys[move], right->keys,
+                        sizeof(key_t) * right->hdr.nr_keys);
+                memmove(&right->data[move], right->data,
+                        sizeof(void *) * right->hdr.nr_keys);
+                memcpy(right->keys, &left->keys[target], sizeof(key_t) * move);
+                memcpy(right->data, &left->data[target], sizeof(void *) * move);
+                left->hdr.nr_keys -= move;
+                right->hdr.nr_keys += move;
+        } else { /**< right's head to left's tail */
+                move = target - left->hdr.nr_keys;
+                memcpy(&left->keys[left->hdr.nr_keys], right->keys,
+                       sizeof(key_t) * move);
+                memcpy(&left->data[left->hdr.nr_keys], right->data,
+                       sizeof(void *) * move);
+                memmove(right->keys, &right->keys[move],
+                        sizeof(key_t) * (right->hdr.nr_keys - move));
+                memmove(right->data, &right->data[move],
+                        sizeof(void *) * (right->hdr.nr_keys - move));
+                left->hdr.nr_keys += move;
+                right->hdr.nr_keys -= move;
+        }
+}
+
+/**
+ * @brief Split tree to t1, t2 based on key value x
+ * @details
+ * Only the leaf which has x is divided. The leaf chains are cut there and
+ * the inner nodes of both sides are rebuilt from the bottom, so this takes
+ * O(n / RB_BPTREE_LEAF_KEYS) without moving the other keys.
+ *
+ * @param tree split target tree (freed after the split)
+ * @param x split point (the keys less than or equal to x go to t1)
+ * @param t1 t1 stored location
+ * @param t2 t2 stored location
+ * @return int 0 means success. -ENOMEM means that the tree is not changed.
+ */
+int rb_bptree_split(struct rb_bptree *tree, key_t x, struct rb_bptree **t1,
+                    struct rb_bptree **t2)
+{
+        struct rb_bptree_build build1, build2;
+        struct rb_bptree *lower = NULL, *upper = NULL;
+        struct rb_bptree_leaf *leaf = NULL, *right = NULL;
+        size_t nr_before = 0, nr_after = 0;
+        unsigned int pos = 0;
+
+        lower = rb_bptree_alloc();
+        upper = rb_bptree_alloc();
+        if (!lower || !upper) {
+                goto exception;
+        }
+        if (tree->root) {
+                leaf = rb_bptree_find_leaf(tree, x);
+                pos = rb_bptree_leaf_pos(leaf, x);
+                pos += (pos < leaf->hdr.nr_keys && leaf->keys[pos] == x);
+                nr_before = rb_bptree_nr_leaves(tree->head) -
+                            rb_bptree_nr_leaves(leaf);
+                nr_after = rb_bptree_nr_leaves(leaf->next);
+                if (pos > 0 && pos < leaf->hdr.nr_keys) {
+                        right = RB_BPTREE_LEAF(rb_bptree_node_alloc(1));
+                        if (!right) {
+                                goto exception;
+                        }
+                }
+        }
+        if (rb_bptree_build_prepare(&build1, nr_before + 1)) {
+                goto exception;
+        }
+        if (rb_bptree_build_prepare(&build2, nr_after + 1)) {
+                rb_bptree_build_release(&build1);
+                goto exception;
+        }
+
+        rb_bptree_free_inner(tree->root);
+        if (leaf) {
+                lower->head = tree->head;
+                upper->tail = tree->tail;
+                if (right) { /**< leaf[pos ...] moves to the new leaf */
+                        right->hdr.nr_keys = leaf->hdr.nr_keys - pos;
+                        memcpy(right->keys, &leaf->keys[pos],
+                               sizeof(key_t) * right->hdr.nr_keys);
+                        memcpy(right->data, &leaf->data[pos],
+                               sizeof(void *) * right->hdr.nr_keys);
+                        leaf->hdr.nr_keys = pos;
+                        right->next = leaf->next;
+                        if (leaf->next) {
+                                leaf->next->prev = right;
+                        } else {
+                                upper->tail = right;
+                        }
+                        leaf->next = right;
+                }
+                lower->tail = (pos == 0) ? leaf->prev : leaf;
+                upper->head = lower->tail ? lower->tail->next : leaf;
+                if (!lower->tail) {
+                        lower->head = NULL;
+                } else {
+                        lower->tail->next = NULL;
+                }
+                if (!upper->head) {
+                        upper->tail = NULL;
+                } else {
+                        upper->head->prev = NULL;
+                }
+                if (lower->tail && lower->tail->prev) {
+                        rb_bptree_leaf_fix(lower, lower->tail->prev);
+                }
+                if (upper->head) {
+                        rb_bptree_leaf_fix(upper, upper->head);
+                }
+        }
+        rb_bptree_build(lower, &build1);
+        rb_bptree_build(upper, &build2);
+        rb_bptree_build_release(&build1);
+        rb_bptree_build_release(&build2);
+        free(tree);
+
+        *t1 = lower;
+        *t2 = upper;
+        return 0;
+exception:
+        free(right);
+        free(lower);
+        free(upper);
+        return -ENOMEM;
+}
+
+/**
+ * @brief Concatenate two trees (every key of t1 is less than t2's)
+ * @details
+ * The leaf chains are linked and the inner nodes are rebuilt from the
+ * bottom, so this takes O(n / RB_BPTREE_LEAF_KEYS).
+ *
+ * @param t1 tree which has the smaller keys (reused as the result)
+ * @param t2 tree which has the greater keys (freed)
+ * @return struct rb_bptree* concatenated tree. NULL means that t1 and t2
+ * are not changed.
+ */
+struct rb_bptree *rb_bptree_concat(struct rb_bptree *t1, struct rb_bptree *t2)
+{
+        struct rb_bptree_build build;
+        struct rb_bptree_leaf *joint = t1->tail;
+
+        if (t1->tail && t2->head &&
+            t1->tail->keys[t1->tail->hdr.nr_keys - 1] >= t2->head->keys[0]) {
+                pr_info("invalid state key state t1.max < t2.min\n");
+                return NULL;
+        }
+        if (rb_bptree_build_prepare(&build, rb_bptree_nr_leaves(t1->head) +
+                                                    rb_bptree_nr_leaves(t2->head))) {
+                return NULL;
+        }
+
+        rb_bptree_free_inner(t1->root);
+        rb_bptree_free_inner(t2->root);
+        if (!t1->head) {
+                t1->head = t2->head;
+        } else if (t2->head) {
+                t1->tail->next = t2->head;
+                t2->head->prev = t1->tail;
+        }
+        if (t2->tail) {
+                t1->tail = t2->tail;
+        }
+        if (joint) {
+                rb_bptree_leaf_fix(t1, joint);
+        }
+        rb_bptree_build(t1, &build);
+        rb_bptree_build_release(&build);
+        free(t2);
+        return t1;
+}
+
+/**
+ * @brief Does deallocation of the B+-tree with its data
+ *
+ * @param tree B+-tree whole
+ */
+void rb_bptree_dealloc(struct rb_bptree *tree)
+{
+        struct rb_bptree_leaf *leaf = NULL, *next = NULL;
+
+        rb_bptree_free_inner(tree->root);
+        for (leaf = tree->head; leaf; leaf = next) {
+                next = leaf->next;
+                for (unsigned int i = 0; i < leaf->hdr.nr_keys; i++) {
+                        free(leaf->data[i]);
+                }
+                free(leaf);
+        }
+        free(tree);
+}
@@ -0,0 +1,98 @@
+/**
+ * @file rb-bptree.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief cache-conscious B+-tree's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * Every node is RB_BPTREE_NODE_SIZE bytes (four cache lines) and is cache
+ * line aligned. The inner nodes hold only the separator keys and the
+ * children, so one node routes 16 ways. The data lives in the leaves and
+ * the leaves are chained in the key order for the scans. Insert splits and
+ * delete borrows or merges on the way down, so both are one pass from the
+ * root and a failed allocation leaves a valid tree.
+ *
+ * The keys are unique. Like `struct rb_tree`, the tree owns the data: it
+ * is freed by delete, by the update of the same key and by dealloc.
+ *
+ * @ref Bayer, R., & McCreight, E. (1972). Organization and maintenance of large ordered indexes. Acta Informatica, 1(3), 173-189.
+ * @ref Rao, J., & Ross, K. A. (2000). Making B+-trees cache conscious in main memory. SIGMOD.
+ */
+#ifndef RB_BPTREE_H_
+#define RB_BPTREE_H_
+
+#include "rb-tree.h"
+#include "rb-rwlock.h"
+
+#define RB_BPTREE_NODE_SIZE (4 * RB_CACHE_LINE_SIZE)
+/** header (8) + keys (8K) + children (8(K + 1)) */
+#define RB_BPTREE_INNER_KEYS ((RB_BPTREE_NODE_SIZE - 16) / 16)
+/** header (8) + prev and next (16) + keys and data (16K) */
+#define RB_BPTREE_LEAF_KEYS ((RB_BPTREE_NODE_SIZE - 24) / 16)
+#define RB_BPTREE_INNER_MIN (RB_BPTREE_INNER_KEYS / 2)
+#define RB_BPTREE_LEAF_MIN (RB_BPTREE_LEAF_KEYS / 2)
+
+/**
+ * @brief Common header of the nodes
+ *
+ */
+struct rb_bptree_node {
+        unsigned int is_leaf;
+        unsigned int nr_keys;
+};
+
+struct rb_bptree_inner {
+        struct rb_bptree_node hdr;
+        key_t keys[RB_BPTREE_INNER_KEYS]; /**< keys[i] <= keys of children[i + 1] */
+        struct rb_bptree_node *children[RB_BPTREE_INNER_KEYS + 1];
+};
+
+struct rb_bptree_leaf {
+        struct rb_bptree_node hdr;
+        struct rb_bptree_leaf *prev, *next; /**< neighbor leaves */
+        key_t keys[RB_BPTREE_LEAF_KEYS];
+        void *data[RB_BPTREE_LEAF_KEYS];
+};
+
+/**
+ * @brief B+-tree structure
+ *
+ */
+struct rb_bptree {
+        struct rb_bptree_node *root; /**< NULL means empty */
+        struct rb_bptree_leaf *head, *tail; /**< first and last leaves */
+        size_t nr_keys;
+        size_t height; /**< levels of the inner nodes */
+};
+
+/**
+ * @brief Visitor of the range scan
+ *
+ * @param key visited key
+ * @param data data of the key
+ * @param arg user argument
+ * @return int 0 means continue. Not 0 stops the scan.
+ */
+typedef int (*rb_bptree_fn)(key_t key, void *data, void *arg);
+
+struct rb_bptree *rb_bptree_alloc(void);
+int rb_bptree_search(struct rb_bptree *tree, key_t key, void **data);
+int rb_bptree_lower_bound(struct rb_bptree *tree, key_t key, key_t *found,
+                          void **data);
+int rb_bptree_successor(struct rb_bptree *tree, key_t key, key_t *next,
+                        void **data);
+int rb_bptree_minimum(struct rb_bptree *tree, key_t *key, void **data);
+int rb_bptree_maximum(struct rb_bptree *tree, key_t *key, void **data);
+int rb_bptree_insert(struct rb_bptree *tree, key_t key, void *data);
+int rb_bptree_delete(struct rb_bptree *tree, key_t key);
+int rb_bptree_for_each(struct rb_bptree *tree, key_t first, key_t last,
+                       rb_bptree_fn fn, void *arg);
+int rb_bptree_split(struct rb_bptree *tree, key_t x, struct rb_bptree **t1,
+                    struct rb_bptree **t2);
+struct rb_bptree *rb_bptree_concat(struct rb_bptree *t1, struct rb_bptree *t2);
+void rb_bptree_dealloc(struct rb_bptree *tree);
+
+#endif
@@ -0,0 +1,566 @@
+/**
+ * @file rb-bucket-tree.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief red black tree of sorted key buckets implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#include <stdlib.h>
+#include "rb-bucket-tree.h"
+
+#define RB_BUCKET_MERGE_KEYS (RB_BUCKET_KEYS / 4) /**< merge under this */
+#define RB_BUCKET_MERGED_MAX (3 * RB_BUCKET_KEYS / 4) /**< merged size limit */
+
+/**
+ * @brief Allocation of the bucket tree
+ *
+ * @return struct rb_bucket_tree* allocated tree
+ */
+struct rb_bucket_tree *rb_bucket_tree_alloc(void)
+{
+        struct rb_bucket_tree *btree = (struct rb_bucket_tree *)malloc(
+                sizeof(struct rb_bucket_tree));
+
+        if (!btree) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+        btree->tree = rb_tree_alloc();
+        if (!btree->tree) {
+                free(btree);
+                return NULL;
+        }
+        btree->nr_keys = 0;
+        return btree;
+}
+
+static struct rb_bucket *rb_bucket_alloc(void)
+{
+        struct rb_bucket *bucket =
+                (struct rb_bucket *)malloc(sizeof(struct rb_bucket));
+
+        if (!bucket) {
+                pr_info("Memory allocation failed\n");
+                return NULL;
+        }
+        bucket->nr_keys = 0;
+        return bucket;
+}
+
+static inline struct rb_bucket *rb_bucket_of(struct rb_node *node)
+{
+        return (struct rb_bucket *)node->data;
+}
+
+/**
+ * @brief Position of the first key which is not less than the key
+ * @details
+ * The halving has no branch on the keys (the compiler makes a conditional
+ * move), so a bucket is searched in log2(RB_BUCKET_KEYS) steps without a
+ * misprediction.
+ */
+static inline unsigned int rb_bucket_pos(const struct rb_bucket *bucket,
+                                         key_t key)
+{
+        const key_t *base = bucket->keys;
+        unsigned int n = bucket->nr_keys, half;
+
+        if (n == 0) {
+                return 0;
+        }
+        while (n > 1) {
+                half = n / 2;
+                base = (base[half] < key) ? base + half : base;
+                n -= half;
+        }
+        return (unsigned int)(base - bucket->keys) + (*base < key);
+}
+
+/**
+ * @brief Node of the bucket which can contain the key
+ *
+ * @return struct rb_node* node of the greatest key which is not greater
+ * than the key (the first node if there is no such node). If the tree is
+ * empty then return tree->nil.
+ */
+static struct rb_node *rb_bucket_tree_floor(struct rb_tree *tree, key_t key)
+{
+        struct rb_node *node = tree->root, *floor = tree->nil;
+
+        while (node != tree->nil) {
+                if (node->key <= key) {
+                        floor = node;
+                        node = node->right;
+                } else {
+                        node = node->left;
+                }
+        }
+        if (floor == tree->nil) {
+                floor = rb_tree_minimum(tree, tree->root);
+        }
+        return floor;
+}
+
+/**
+ * @brief Search the key
+ *
+ * @param btree bucket tree whole
+ * @param key the key which I want to search
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_bucket_tree_search(struct rb_bucket_tree *btree, key_t key,
+                          void **data)
+{
+        struct rb_node *node = rb_bucket_tree_floor(btree->tree, key);
+        struct rb_bucket *bucket = NULL;
+        unsigned int pos;
+
+        if (node == btree->tree->nil) {
+                return -ENODATA;
+        }
+        bucket = rb_bucket_of(node);
+        pos = rb_bucket_pos(bucket, key);
+        if (pos == bucket->nr_keys || bucket->keys[pos] != key) {
+                return -ENODATA;
+        }
+        if (data) {
+                *data = bucket->data[pos];
+        }
+        return 0;
+}
+
+/**
+ * @brief Report the entry (the first entry of the next bucket if pos is
+ * the end of the bucket)
+ */
+static int rb_bucket_tree_entry(struct rb_tree *tree, struct rb_node *node,
+                                unsigned int pos, key_t *key, void **data)
+{
+        if (node != tree->nil && pos == rb_bucket_of(node)->nr_keys) {
+                node = rb_tree_successor(tree, node);
+                pos = 0;
+        }
+        if (node == tree->nil) {
+                return -ENODATA;
+        }
+        if (key) {
+                *key = rb_bucket_of(node)->keys[pos];
+        }
+        if (data) {
+                *data = rb_bucket_of(node)->data[pos];
+        }
+        return 0;
+}
+
+/**
+ * @brief Find the first key which is not less than the key
+ *
+ * @param btree bucket tree whole
+ * @param key lower bound key
+ * @param found found key stored location (nullable)
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_bucket_tree_lower_bound(struct rb_bucket_tree *btree, key_t key,
+                               key_t *found, void **data)
+{
+        struct rb_node *node = rb_bucket_tree_floor(btree->tree, key);
+
+        if (node == btree->tree->nil) {
+                return -ENODATA;
+        }
+        return rb_bucket_tree_entry(btree->tree, node,
+                                    rb_bucket_pos(rb_bucket_of(node), key),
+                                    found, data);
+}
+
+/**
+ * @brief Find the first key which is greater than the key
+ *
+ * @param btree bucket tree whole
+ * @param key base key (it does not need to be in the tree)
+ * @param next found key stored location (nullable)
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_bucket_tree_successor(struct rb_bucket_tree *btree, key_t key,
+                             key_t *next, void **data)
+{
+        if (key == RB_MAX_KEY) {
+                return -ENODATA;
+        }
+        return rb_bucket_tree_lower_bound(btree, key + 1, next, data);
+}
+
+int rb_bucket_tree_minimum(struct rb_bucket_tree *btree, key_t *key,
+                           void **data)
+{
+        struct rb_tree *tree = btree->tree;
+
+        return rb_bucket_tree_entry(tree, rb_tree_minimum(tree, tree->root), 0,
+                                    key, data);
+}
+
+int rb_bucket_tree_maximum(struct rb_bucket_tree *btree, key_t *key,
+                           void **data)
+{
+        struct rb_tree *tree = btree->tree;
+        struct rb_node *node = rb_tree_maximum(tree, tree->root);
+
+        if (node == tree->nil) {
+                return -ENODATA;
+        }
+        return rb_bucket_tree_entry(tree, node,
+                                    rb_bucket_of(node)->nr_keys - 1, key, data);
+}
+
+/**
+ * @brief Split the bucket of the node in half
+ * @details
+ * The upper half is copied to a new bucket and the bucket is cut only
+ * after the new node is inserted, so a failure changes nothing.
+ *
+ * @return struct rb_bucket* new bucket which has the upper half
+ */
+static struct rb_bucket *rb_bucket_split(struct rb_tree *tree,
+                                         struct rb_bucket *bucket,
+                                         unsigned int keep)
+{
+        struct rb_bucket *upper = rb_bucket_alloc();
+
+        if (!upper) {
+                return NULL;
+        }
+        upper->nr_keys = bucket->nr_keys - keep;
+        memcpy(upper->keys, &bucket->keys[keep],
+               sizeof(key_t) * upper->nr_keys);
+        memcpy(upper->data, &bucket->data[keep],
+               sizeof(void *) * upper->nr_keys);
+        if (rb_tree_insert(tree, upper->keys[0], upper)) {
+                free(upper);
+                return NULL;
+        }
+        bucket->nr_keys = keep;
+        return upper;
+}
+
+/**
+ * @brief Insert the key and the data
+ *
+ * @param btree bucket tree whole
+ * @param key new key
+ * @param data new data (the data of the same key is freed and updated)
+ * @return int 0 means success. -ENOMEM means that nothing is inserted.
+ */
+int rb_bucket_tree_insert(struct rb_bucket_tree *btree, key_t key, void *data)
+{
+        struct rb_tree *tree = btree->tree;
+        struct rb_node *node = rb_bucket_tree_floor(tree, key);
+        struct rb_bucket *bucket = NULL, *upper = NULL;
+        unsigned int pos;
+        int ret;
+
+        if (node == tree->nil) {
+                bucket = rb_bucket_alloc();
+                if (!bucket) {
+                        return -ENOMEM;
+                }
+                bucket->keys[0] = key;
+                bucket->data[0] = data;
+                bucket->nr_keys = 1;
+                ret = rb_tree_insert(tree, key, bucket);
+                if (ret) {
+                        free(bucket);
+                        return ret;
+                }
+                btree->nr_keys++;
+                return 0;
+        }
+
+        bucket = rb_bucket_of(node);
+        pos = rb_bucket_pos(bucket, key);
+        if (pos < bucket->nr_keys && bucket->keys[pos] == key) {
+                free(bucket->data[pos]);
+                bucket->data[pos] = data;
+                return 0;
+        }
+        if (bucket->nr_keys == RB_BUCKET_KEYS) {
+                upper = rb_bucket_split(tree, bucket, RB_BUCKET_KEYS / 2);
+                if (!upper) {
+                        return -ENOMEM;
+                }
+                if (pos > RB_BUCKET_KEYS / 2) {
+                        bucket = upper;
+                        pos -= RB_BUCKET_KEYS / 2;
+                }
+        }
+        memmove(&bucket->keys[pos + 1], &bucket->keys[pos],
+                sizeof(key_t) * (bucket->nr_keys - pos));
+        memmove(&bucket->data[pos + 1], &bucket->data[pos],
+                sizeof(void *) * (bucket->nr_keys - pos));
+        bucket->keys[pos] = key;
+        bucket->data[pos] = data;
+        bucket->nr_keys++;
+        if (pos == 0) { /**< only the first bucket gets a smaller key */
+                node->key = key;
+        }
+        btree->nr_keys++;
+        return 0;
+}
+
+/**
+ * @brief Move every entry of the right bucket to the end of the left one
+ */
+static void rb_bucket_append(struct rb_bucket *left, struct rb_bucket *right)
+{
+        memcpy(&left->keys[left->nr_keys], right->keys,
+               sizeof(key_t) * right->nr_keys);
+        memcpy(&left->data[left->nr_keys], right->data,
+               sizeof(void *) * right->nr_keys);
+        left->nr_keys += right->nr_keys;
+        right->nr_keys = 0;
+}
+
+/**
+ * @brief Merge the sparse bucket of the node to its neighbor
+ */
+static void rb_bucket_tree_merge(struct rb_tree *tree, struct rb_node *node)
+{
+        struct rb_bucket *bucket = rb_bucket_of(node);
+        struct rb_node *next = rb_tree_successor(tree, node);
+        struct rb_node *prev = NULL;
+
+        if (next != tree->nil && bucket->nr_keys + rb_bucket_of(next)->nr_keys <=
+                                         RB_BUCKET_MERGED_MAX) {
+                rb_bucket_append(bucket, rb_bucket_of(next));
+                rb_tree_delete_node(tree, next);
+                return;
+        }
+        prev = rb_tree_predecessor(tree, node);
+        if (prev != tree->nil && bucket->nr_keys + rb_bucket_of(prev)->nr_keys <=
+                                         RB_BUCKET_MERGED_MAX) {
+                rb_bucket_append(rb_bucket_of(prev), bucket);
+                rb_tree_delete_node(tree, node);
+        }
+}
+
+/**
+ * @brief Delete the key
+ *
+ * @param btree bucket tree whole
+ * @param key delete target key
+ * @return int 0 means that delete success. -ENODATA means not found.
+ */
+int rb_bucket_tree_delete(struct rb_bucket_tree *btree, key_t key)
+{
+        struct rb_tree *tree = btree->tree;
+        struct rb_node *node = rb_bucket_tree_floor(tree, key);
+        struct rb_bucket *bucket = NULL;
+        unsigned int pos;
+
+        if (node == tree->nil) {
+                return -ENODATA;
+        }
+        bucket = rb_bucket_of(node);
+        pos = rb_bucket_pos(bucket, key);
+        if (pos == bucket->nr_keys || bucket->keys[pos] != key) {
+                return -ENODATA;
+        }
+        free(bucket->data[pos]);
+        memmove(&bucket->keys[pos], &bucket->keys[pos + 1],
+                sizeof(key_t) * (bucket->nr_keys - pos - 1));
+        memmove(&bucket->data[pos], &bucket->data[pos + 1],
+                sizeof(void *) * (bucket->nr_keys - pos - 1));
+        bucket->nr_keys--;
+        btree->nr_keys--;
+
+        if (bucket->nr_keys == 0) {
+                rb_tree_delete_node(tree, node);
+                return 0;
+        }
+        node->key = bucket->keys[0];
+        if (bucket->nr_keys < RB_BUCKET_MERGE_KEYS) {
+                rb_bucket_tree_merge(tree, node);
+        }
+        return 0;
+}
+
+/**
+ * @brief Visit the keys in [first, last] in the key order
+ *
+ * @param btree bucket tree whole
+ * @param first first key of the range
+ * @param last last key of the range (inclusive)
+ * @param fn visitor
+ * @param arg user argument
+ * @return int 0 means that every key is visited. Else, the visitor's
+ * return value which stopped the scan.
+ */
+int rb_bucket_tree_for_each(struct rb_bucket_tree *btree, key_t first,
+                            key_t last, rb_bucket_fn fn, void *arg)
+{
+        struct rb_tree *tree = btree->tree;
+        struct rb_node *node = rb_bucket_tree_floor(tree, first);
+        struct rb_bucket *bucket = NULL;
+        unsigned int pos;
+        int ret;
+
+        if (node == tree->nil) {
+                return 0;
+        }
+        pos = rb_bucket_pos(rb_bucket_of(node), first);
+        for (; node != tree->nil; node = rb_tree_successor(tree, node), pos = 0) {
+                bucket = rb_bucket_of(node);
+                for (; pos < bucket->nr_keys; pos++) {
+                        if (bucket->keys[pos] > last) {
+                                return 0;
+                        }
+                        ret = fn(bucket->keys[pos], bucket->data[pos], arg);
+                        if (ret) {
+                                return ret;
+                        }
+                }
+        }
+        return 0;
+}
+
+static size_t rb_bucket_tree_count(struct rb_tree *tree)
+{
+        struct rb_node *node = rb_tree_minimum(tree, tree->root);
+        size_t nr_keys = 0;
+
+        for (; node != tree->nil; node = rb_tree_successor(tree, node)) {
+                nr_keys += rb_bucket_of(node)->nr_keys;
+        }
+        return nr_keys;
+}
+
+/**
+ * @brief Split tree to t1, t2 based on key value x
+ * @details
+ * The bucket which has x is divided first. Then, no bucket crosses x and
+ * `rb_tree_split` divides the buckets.
+ *
+ * @param btree split target tree (freed after the split)
+ * @param x split point (the keys less than or equal to x go to t1)
+ * @param t1 t1 stored location
+ * @param t2 t2 stored location
+ * @return int 0 means success. Else, the keys are not moved.
+ */
+int rb_bucket_tree_split(struct rb_bucket_tree *btree, key_t x,
+                         struct rb_bucket_tree **t1,
+                         struct rb_bucket_tree **t2)
+{
+        struct rb_node *node = rb_bucket_tree_floor(btree->tree, x);
+        struct rb_bucket_tree *lower = NULL, *upper = NULL;
+        struct rb_bucket *bucket = NULL;
+        unsigned int pos;
+        int ret = -ENOMEM;
+
+        lower = (struct rb_bucket_tree *)malloc(sizeof(struct rb_bucket_tree));
+        upper = (struct rb_bucket_tree *)malloc(sizeof(struct rb_bucket_tree));
+        if (!lower || !upper) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                goto exception;
+        }
+        if (node != btree->tree->nil) {
+                bucket = rb_bucket_of(node);
+                pos = rb_bucket_pos(bucket, x);
+                pos += (pos < bucket->nr_keys && bucket->keys[pos] == x);
+                if (pos > 0 && pos < bucket->nr_keys &&
+                    !rb_bucket_split(btree->tree, bucket, pos)) {
+                        goto exception;
+                }
+        }
+        ret = rb_tree_split(btree->tree, x, &lower->tree, &upper->tree);
+        if (ret) {
+                goto exception;
+        }
+        lower->nr_keys = rb_bucket_tree_count(lower->tree);
+        upper->nr_keys = btree->nr_keys - lower->nr_keys;
+        free(btree);
+
+        *t1 = lower;
+        *t2 = upper;
+        return 0;
+exception:
+        free(lower);
+        free(upper);
+        return ret;
+}
+
+/**
+ * @brief Concatenate two trees (every key of t1 is less than t2's)
+ *
+ * @param t1 tree which has the smaller keys (reused as the result)
+ * @param t2 tree which has the greater keys (freed)
+ * @return struct rb_bucket_tree* concatenated tree. NULL means that t1 and
+ * t2 are not changed.
+ */
+struct rb_bucket_tree *rb_bucket_tree_concat(struct rb_bucket_tree *t1,
+                                             struct rb_bucket_tree *t2)
+{
+        struct rb_node *min = rb_tree_minimum(t2->tree, t2->tree->root);
+        struct rb_tree *tree = NULL;
+        key_t max;
+
+        if (min == t2->tree->nil) {
+                rb_bucket_tree_dealloc(t2);
+                return t1;
+        }
+        if (rb_bucket_tree_maximum(t1, &max, NULL) == 0 && max >= min->key) {
+                pr_info("invalid state key state t1.max < t2.min\n");
+                return NULL;
+        }
+        tree = rb_tree_concat(t1->tree, t2->tree, min);
+        if (!tree) {
+                return NULL;
+        }
+        t1->tree = tree;
+        t1->nr_keys += t2->nr_keys;
+        free(t2);
+        return t1;
+}
+
+/**
+ * @brief Bytes of the nodes and the buckets
+ *
+ * @param btree bucket tree whole
+ * @return size_t bytes which the tree allocates (without the data)
+ */
+size_t rb_bucket_tree_bytes(struct rb_bucket_tree *btree)
+{
+        struct rb_tree *tree = btree->tree;
+        struct rb_node *node = rb_tree_minimum(tree, tree->root);
+        size_t nr_nodes = 0;
+
+        for (; node != tree->nil; node = rb_tree_successor(tree, node)) {
+                nr_nodes++;
+        }
+        return nr_nodes * (sizeof(struct rb_node) + sizeof(struct rb_bucket));
+}
+
+/**
+ * @brief Does deallocation of the bucket tree with its data
+ *
+ * @param btree bucket tree whole
+ */
+void rb_bucket_tree_dealloc(struct rb_bucket_tree *btree)
+{
+        struct rb_tree *tree = btree->tree;
+        struct rb_node *node = rb_tree_minimum(tree, tree->root);
+        struct rb_bucket *bucket = NULL;
+
+        for (; node != tree->nil; node = rb_tree_successor(tree, node)) {
+                bucket = rb_bucket_of(node);
+                for (unsigned int i = 0; i < bucket->nr_keys; i++) {
+                        free(bucket->data[i]);
+                }
+        }
+        rb_tree_dealloc(tree); /**< frees the buckets */
+        free(btree);
+}
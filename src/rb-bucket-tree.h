@@ -0,0 +1,83 @@
+/**
+ * @file rb-bucket-tree.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief red black tree of sorted key buckets' declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * Each node of the `struct rb_tree` holds a bucket (its data) of up to
+ * RB_BUCKET_KEYS sorted keys and the node's key is the smallest key of the
+ * bucket. So, the red-black tree orders the buckets and a key lives in the
+ * bucket of the greatest node key which is not greater than it. A full
+ * bucket is split in half. A bucket under RB_BUCKET_KEYS / 4 keys is merged
+ * to its neighbor if they fit in 3 / 4 of a bucket.
+ *
+ * A node and its pointers are shared by the keys of the bucket, so a key
+ * takes about 16 bytes instead of a whole node.
+ *
+ * The keys are unique. Like `struct rb_tree`, the tree owns the data: it
+ * is freed by delete, by the update of the same key and by dealloc.
+ */
+#ifndef RB_BUCKET_TREE_H_
+#define RB_BUCKET_TREE_H_
+
+#include "rb-tree.h"
+
+#define RB_BUCKET_KEYS (32)
+
+/**
+ * @brief Sorted keys and data of a node
+ *
+ */
+struct rb_bucket {
+        unsigned int nr_keys;
+        key_t keys[RB_BUCKET_KEYS];
+        void *data[RB_BUCKET_KEYS];
+};
+
+/**
+ * @brief Red-black tree of buckets
+ *
+ */
+struct rb_bucket_tree {
+        struct rb_tree *tree; /**< node->data is struct rb_bucket */
+        size_t nr_keys;
+};
+
+/**
+ * @brief Visitor of the range scan
+ *
+ * @param key visited key
+ * @param data data of the key
+ * @param arg user argument
+ * @return int 0 means continue. Not 0 stops the scan.
+ */
+typedef int (*rb_bucket_fn)(key_t key, void *data, void *arg);
+
+struct rb_bucket_tree *rb_bucket_tree_alloc(void);
+int rb_bucket_tree_search(struct rb_bucket_tree *btree, key_t key,
+                          void **data);
+int rb_bucket_tree_lower_bound(struct rb_bucket_tree *btree, key_t key,
+                               key_t *found, void **data);
+int rb_bucket_tree_successor(struct rb_bucket_tree *btree, key_t key,
+                             key_t *next, void **data);
+int rb_bucket_tree_minimum(struct rb_bucket_tree *btree, key_t *key,
+                           void **data);
+int rb_bucket_tree_maximum(struct rb_bucket_tree *btree, key_t *key,
+                           void **data);
+int rb_bucket_tree_insert(struct rb_bucket_tree *btree, key_t key, void *data);
+int rb_bucket_tree_delete(struct rb_bucket_tree *btree, key_t key);
+int rb_bucket_tree_for_each(struct rb_bucket_tree *btree, key_t first,
+                            key_t last, rb_bucket_fn fn, void *arg);
+int rb_bucket_tree_split(struct rb_bucket_tree *btree, key_t x,
+                         struct rb_bucket_tree **t1,
+                         struct rb_bucket_tree **t2);
+struct rb_bucket_tree *rb_bucket_tree_concat(struct rb_bucket_tree *t1,
+                                             struct rb_bucket_tree *t2);
+size_t rb_bucket_tree_bytes(struct rb_bucket_tree *btree);
+void rb_bucket_tree_dealloc(struct rb_bucket_tree *btree);
+
+#endif
@@ -0,0 +1,337 @@
+/**
+ * @file rb-cmp-tree.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief comparator based red black tree implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#include <stdlib.h>
+#include "rb-cmp-tree.h"
+#include "rb-tree-internal.h"
+
+#define RB_PREFIX_SIGN_BIT ((uint64_t)1 << 63)
+
+/**
+ * @brief Allocation of comparator based red-black tree
+ *
+ * @param cmp key compare function (same as `strcmp` style)
+ * @param prefix order preserving key prefix function (nullable)
+ * @return struct rb_cmp_tree* allocated tree
+ */
+struct rb_cmp_tree *rb_cmp_tree_alloc(rb_cmp_fn cmp, rb_prefix_fn prefix)
+{
+        struct rb_cmp_tree *ctree = NULL;
+
+        if (!cmp) {
+                pr_info("compare function must be not null\n");
+                return NULL;
+        }
+
+        ctree = (struct rb_cmp_tree *)malloc(sizeof(struct rb_cmp_tree));
+        if (!ctree) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+
+        ctree->tree = rb_tree_alloc();
+        if (!ctree->tree) {
+                free(ctree);
+                return NULL;
+        }
+        ctree->cmp = cmp;
+        ctree->prefix = prefix;
+
+        return ctree;
+}
+
+/**
+ * @brief Get the prefix of the key
+ *
+ * @param ctree comparator based red-black tree
+ * @param key target key
+ * @return uint64_t prefix of the key
+ */
+static inline uint64_t rb_cmp_prefix(struct rb_cmp_tree *ctree,
+                                     const void *key)
+{
+        return ctree->prefix ? ctree->prefix(key) : 0;
+}
+
+/**
+ * @brief Compare the key with the node's key
+ * @details
+ * The out-of-line key is dereferenced only if the prefixes are the same.
+ *
+ * @param ctree comparator based red-black tree
+ * @param prefix prefix of the key
+ * @param key target key
+ * @param node compared node
+ * @return int negative, zero or positive (same as `strcmp`)
+ */
+static inline int rb_cmp_compare(struct rb_cmp_tree *ctree, uint64_t prefix,
+                                 const void *key, struct rb_node *node)
+{
+        if (prefix != node->key) {
+                return prefix < node->key ? -1 : 1;
+        }
+        return ctree->cmp(key, rb_cmp_node_entry(node)->key);
+}
+
+/**
+ * @brief Search the node which has the same key
+ *
+ * @param ctree comparator based red-black tree
+ * @param key the key which I want to search
+ * @return struct rb_cmp_node* if find success then return specific node pointer.
+ * but if find failed then return NULL pointer
+ */
+struct rb_cmp_node *rb_cmp_tree_search(struct rb_cmp_tree *ctree,
+                                       const void *key)
+{
+        struct rb_tree *tree = ctree->tree;
+        struct rb_node *node = tree->root;
+        uint64_t prefix = rb_cmp_prefix(ctree, key);
+        int ret;
+
+        while (node != tree->nil) {
+                ret = rb_cmp_compare(ctree, prefix, key, node);
+                if (ret == 0) {
+                        return rb_cmp_node_entry(node);
+                }
+                node = ret < 0 ? node->left : node->right;
+        }
+
+        return NULL;
+}
+
+/**
+ * @brief Find the first node which key is not less than the key
+ *
+ * @param ctree comparator based red-black tree
+ * @param key lower bound key
+ * @return struct rb_cmp_node* first node which key is not less than the key.
+ * If there is no such node then return NULL
+ */
+struct rb_cmp_node *rb_cmp_tree_lower_bound(struct rb_cmp_tree *ctree,
+                                            const void *key)
+{
+        struct rb_tree *tree = ctree->tree;
+        struct rb_node *node = tree->root;
+        struct rb_node *bound = NULL;
+        uint64_t prefix = rb_cmp_prefix(ctree, key);
+
+        while (node != tree->nil) {
+                if (rb_cmp_compare(ctree, prefix, key, node) > 0) {
+                        node = node->right;
+                } else {
+                        bound = node;
+                        node = node->left;
+                }
+        }
+
+        return bound ? rb_cmp_node_entry(bound) : NULL;
+}
+
+/**
+ * @brief Insert the key and data to the tree
+ * @details
+ * The tree takes the ownership of the key and the data. If the key already
+ * exists then the data is updated and the new key is deallocated.
+ *
+ * @param ctree comparator based red-black tree
+ * @param key new node's key (must be allocated in HEAP location)
+ * @param data new node's data (must be allocated in HEAP location)
+ * @return int successfully insert status (0: success, else: fail)
+ */
+int rb_cmp_tree_insert(struct rb_cmp_tree *ctree, void *key, void *data)
+{
+        struct rb_tree *tree = ctree->tree;
+        struct rb_cmp_node *cnode = NULL;
+        struct rb_node *z = NULL;
+        struct rb_node *y = tree->nil;
+        struct rb_node *x = tree->root;
+        uint64_t prefix = rb_cmp_prefix(ctree, key);
+        int ret = 0;
+
+        while (x != tree->nil) {
+                ret = rb_cmp_compare(ctree, prefix, key, x);
+                if (ret == 0) { /**< update key's data */
+                        cnode = rb_cmp_node_entry(x);
+                        if (cnode->node.data) {
+                                free(cnode->node.data);
+                        }
+                        cnode->node.data = data;
+                        free(key);
+                        return 0;
+                }
+                y = x;
+                x = ret < 0 ? x->left : x->right;
+        }
+
+        cnode = (struct rb_cmp_node *)malloc(sizeof(struct rb_cmp_node));
+        if (!cnode) {
+                pr_info("Memory allocation failed\n");
+                return -ENOMEM;
+        }
+        cnode->key = key;
+
+        z = &cnode->node;
+        z->key = prefix;
+        z->data = data;
+        z->parent = y;
+        z->left = z->right = tree->nil;
+        z->color = RB_NODE_COLOR_RED;
+
+        if (y == tree->nil) {
+                tree->root = z;
+        } else if (ret < 0) {
+                y->left = z;
+        } else {
+                y->right = z;
+        }
+
+        rb_tree_insert_fixup(tree, z);
+
+        return 0;
+}
+
+/**
+ * @brief Deallocation comparator node
+ *
+ * @param cnode deallocate target
+ */
+static void rb_cmp_node_dealloc(struct rb_cmp_node *cnode)
+{
+        if (cnode->node.data) {
+                free(cnode->node.data);
+        }
+        if (cnode->key) {
+                free(cnode->key);
+        }
+        free(cnode);
+}
+
+/**
+ * @brief Delete the node which has the same key
+ *
+ * @param ctree comparator based red-black tree
+ * @param key delete target node's key
+ * @return int 0 means that delete success. Not 0 means delete fail.
+ */
+int rb_cmp_tree_delete(struct rb_cmp_tree *ctree, const void *key)
+{
+        struct rb_cmp_node *cnode = rb_cmp_tree_search(ctree, key);
+        if (!cnode) {
+                return -ENODATA;
+        }
+        __rb_tree_delete(ctree->tree, &cnode->node);
+        rb_cmp_node_dealloc(cnode);
+        return 0;
+}
+
+/**
+ * @brief Does deallocation of the comparator based subtree
+ *
+ * @param tree red-black tree whole
+ * @param node the root of the subtree
+ */
+static void __rb_cmp_tree_dealloc(struct rb_tree *tree, struct rb_node *node)
+{
+        if (!node || rb_node_is_leaf(tree, node)) {
+                return;
+        }
+
+        __rb_cmp_tree_dealloc(tree, node->left);
+        __rb_cmp_tree_dealloc(tree, node->right);
+
+        rb_cmp_node_dealloc(rb_cmp_node_entry(node));
+}
+
+/**
+ * @brief Does deallocation of the comparator based tree
+ *
+ * @param ctree comparator based red-black tree
+ */
+void rb_cmp_tree_dealloc(struct rb_cmp_tree *ctree)
+{
+        struct rb_tree *tree = ctree->tree;
+
+        __rb_cmp_tree_dealloc(tree, tree->root);
+        tree->root = tree->nil;
+
+        rb_tree_dealloc(tree);
+        free(ctree);
+}
+
+/**
+ * @brief Compare function of NUL-terminated string keys
+ *
+ * @param a string key
+ * @param b string key
+ * @return int same as `strcmp`
+ */
+int rb_cmp_str(const void *a, const void *b)
+{
+        return strcmp((const char *)a, (const char *)b);
+}
+
+/**
+ * @brief Prefix function of NUL-terminated string keys
+ * @details
+ * First 8 bytes are packed as big-endian. So, the integer order is the same
+ * as the lexicographical order of the strings.
+ *
+ * @param key string key
+ * @return uint64_t prefix of the string
+ */
+uint64_t rb_prefix_str(const void *key)
+{
+        const unsigned char *str = (const unsigned char *)key;
+        uint64_t prefix = 0;
+        size_t i;
+
+        for (i = 0; i < sizeof(uint64_t) && str[i]; i++) {
+                prefix |= (uint64_t)str[i] << (8 * (sizeof(uint64_t) - 1 - i));
+        }
+
+        return prefix;
+}
+
+/**
+ * @brief Prefix function of `double` keys
+ * @details
+ * Positive values set the sign bit and negative values flip all bits.
+ * So, the whole value is encoded in the prefix with keeping the order.
+ *
+ * @param key pointer of the double value
+ * @return uint64_t order preserving encoded value
+ */
+uint64_t rb_prefix_double(const void *key)
+{
+        uint64_t bits;
+
+        memcpy(&bits, key, sizeof(bits));
+        if (bits & RB_PREFIX_SIGN_BIT) {
+                return ~bits;
+        }
+        return bits | RB_PREFIX_SIGN_BIT;
+}
+
+/**
+ * @brief Compare function of `double` keys
+ * @note -0.0 is ordered before 0.0 to be consistent with `rb_prefix_double`
+ *
+ * @param a pointer of the double value
+ * @param b pointer of the double value
+ * @return int negative, zero or positive (same as `strcmp`)
+ */
+int rb_cmp_double(const void *a, const void *b)
+{
+        uint64_t x = rb_prefix_double(a);
+        uint64_t y = rb_prefix_double(b);
+
+        return (x > y) - (x < y);
+}
@@ -0,0 +1,101 @@
+/**
+ * @file rb-cmp-tree.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief comparator based red black tree's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * The tree holds opaque keys which are ordered by the user compare function.
+ * Each node also stores a fixed-width prefix of its key in `node.key`.
+ * The prefix function must keep the order of the keys
+ * (prefix(a) < prefix(b) means cmp(a, b) < 0). So, the compare function is
+ * called only when the prefixes are the same.
+ */
+#ifndef RB_CMP_TREE_H_
+#define RB_CMP_TREE_H_
+
+#include <stddef.h>
+
+#include "rb-tree.h"
+
+typedef int (*rb_cmp_fn)(const void *a, const void *b);
+typedef uint64_t (*rb_prefix_fn)(const void *key);
+
+/**
+ * @brief Comparator based red black tree's node
+ *
+ */
+struct rb_cmp_node {
+        struct rb_node node; /**< node.key holds the prefix of the key */
+        void *key; /**< must be allocated in HEAP location */
+};
+
+/**
+ * @brief Comparator based red black tree structure
+ *
+ */
+struct rb_cmp_tree {
+        struct rb_tree *tree;
+        rb_cmp_fn cmp;
+        rb_prefix_fn prefix; /**< NULL means that every prefix is the same */
+};
+
+struct rb_cmp_tree *rb_cmp_tree_alloc(rb_cmp_fn cmp, rb_prefix_fn prefix);
+struct rb_cmp_node *rb_cmp_tree_search(struct rb_cmp_tree *ctree,
+                                       const void *key);
+struct rb_cmp_node *rb_cmp_tree_lower_bound(struct rb_cmp_tree *ctree,
+                                            const void *key);
+int rb_cmp_tree_insert(struct rb_cmp_tree *ctree, void *key, void *data);
+int rb_cmp_tree_delete(struct rb_cmp_tree *ctree, const void *key);
+void rb_cmp_tree_dealloc(struct rb_cmp_tree *ctree);
+
+int rb_cmp_str(const void *a, const void *b);
+uint64_t rb_prefix_str(const void *key);
+int rb_cmp_double(const void *a, const void *b);
+uint64_t rb_prefix_double(const void *key);
+
+/**
+ * @brief Get the comparator node which contains the red-black tree node
+ *
+ * @param node red-black tree node (it must not be tree->nil)
+ * @return struct rb_cmp_node* node's container
+ */
+static inline struct rb_cmp_node *rb_cmp_node_entry(struct rb_node *node)
+{
+        return (struct rb_cmp_node *)((char *)node -
+                                      offsetof(struct rb_cmp_node, node));
+}
+
+/**
+ * @brief Get the first node of the tree
+ *
+ * @param ctree comparator based red-black tree
+ * @return struct rb_cmp_node* first node. If tree is empty then NULL
+ */
+static inline struct rb_cmp_node *rb_cmp_tree_first(struct rb_cmp_tree *ctree)
+{
+        struct rb_tree *tree = ctree->tree;
+        struct rb_node *node = rb_tree_minimum(tree, tree->root);
+
+        return node == tree->nil ? NULL : rb_cmp_node_entry(node);
+}
+
+/**
+ * @brief Get the next node of the specific node
+ *
+ * @param ctree comparator based red-black tree
+ * @param cnode current node
+ * @return struct rb_cmp_node* next node. If there is no next then NULL
+ */
+static inline struct rb_cmp_node *rb_cmp_tree_next(struct rb_cmp_tree *ctree,
+                                                   struct rb_cmp_node *cnode)
+{
+        struct rb_tree *tree = ctree->tree;
+        struct rb_node *node = rb_tree_successor(tree, &cnode->node);
+
+        return node == tree->nil ? NULL : rb_cmp_node_entry(node);
+}
+#endif
@@ -0,0 +1,264 @@
+/**
+ * @file rb-ebr.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief epoch based memory reclamation implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <errno.h>
+#include <sched.h>
+#include "rb-tree.h"
+#include "rb-ebr.h"
+
+static atomic_ulong rb_ebr_next_id = 1;
+static _Thread_local char rb_ebr_token; /**< address identifies the thread */
+static _Thread_local unsigned long rb_ebr_cached_domain;
+static _Thread_local struct rb_ebr_thread *rb_ebr_cached_thread;
+
+/**
+ * @brief Allocation of the reclamation domain
+ *
+ * @return struct rb_ebr* allocated domain
+ */
+struct rb_ebr *rb_ebr_alloc(void)
+{
+        struct rb_ebr *ebr = (struct rb_ebr *)malloc(sizeof(struct rb_ebr));
+        if (!ebr) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+
+        ebr->id = atomic_fetch_add(&rb_ebr_next_id, 1);
+        atomic_init(&ebr->epoch, 0);
+        atomic_init(&ebr->threads, NULL);
+
+        return ebr;
+}
+
+/**
+ * @brief Get the record of the current thread (registered at first use)
+ *
+ * @param ebr reclamation domain
+ * @return struct rb_ebr_thread* record of the current thread
+ */
+static struct rb_ebr_thread *rb_ebr_self(struct rb_ebr *ebr)
+{
+        struct rb_ebr_thread *th = NULL;
+        struct rb_ebr_thread *head = NULL;
+
+        if (rb_ebr_cached_domain == ebr->id) {
+                return rb_ebr_cached_thread;
+        }
+
+        for (th = atomic_load(&ebr->threads); th; th = th->next) {
+                if (th->owner == &rb_ebr_token) {
+                        goto out;
+                }
+        }
+
+        th = (struct rb_ebr_thread *)calloc(1, sizeof(struct rb_ebr_thread));
+        if (!th) { /**< readers cannot run without the record */
+                pr_info("thread registration failed\n");
+                abort();
+        }
+        atomic_init(&th->epoch, 0);
+        atomic_init(&th->active, 0);
+        th->owner = &rb_ebr_token;
+
+        head = atomic_load(&ebr->threads);
+        do {
+                th->next = head;
+        } while (!atomic_compare_exchange_weak(&ebr->threads, &head, th));
+out:
+        rb_ebr_cached_domain = ebr->id;
+        rb_ebr_cached_thread = th;
+        return th;
+}
+
+/**
+ * @brief Enter the read-side critical section (nestable)
+ *
+ * @param ebr reclamation domain
+ */
+void rb_ebr_enter(struct rb_ebr *ebr)
+{
+        struct rb_ebr_thread *th = rb_ebr_self(ebr);
+
+        if (th->nesting++ == 0) {
+                atomic_store(&th->active, 1);
+                atomic_store(&th->epoch, atomic_load(&ebr->epoch));
+                atomic_thread_fence(memory_order_seq_cst);
+        }
+}
+
+/**
+ * @brief Exit the read-side critical section
+ *
+ * @param ebr reclamation domain
+ */
+void rb_ebr_exit(struct rb_ebr *ebr)
+{
+        struct rb_ebr_thread *th = rb_ebr_self(ebr);
+
+        if (--th->nesting == 0) {
+                atomic_store_explicit(&th->active, 0, memory_order_release);
+        }
+}
+
+/**
+ * @brief Advance the global epoch if every active thread observed it
+ *
+ * @param ebr reclamation domain
+ * @return true the global epoch is advanced
+ * @return false some thread is still in the previous epoch
+ */
+static int rb_ebr_try_advance(struct rb_ebr *ebr)
+{
+        unsigned long epoch = atomic_load(&ebr->epoch);
+        struct rb_ebr_thread *th = NULL;
+
+        for (th = atomic_load(&ebr->threads); th; th = th->next) {
+                if (atomic_load(&th->active) &&
+                    atomic_load(&th->epoch) != epoch) {
+                        return 0;
+                }
+        }
+
+        return atomic_compare_exchange_strong(&ebr->epoch, &epoch, epoch + 1);
+}
+
+/**
+ * @brief Free every object in the limbo list
+ *
+ * @param limbo limbo list
+ */
+static void rb_ebr_limbo_free(struct rb_ebr_limbo *limbo)
+{
+        for (size_t i = 0; i < limbo->nr_entries; i++) {
+                limbo->entries[i].free_fn(limbo->entries[i].ptr);
+        }
+        limbo->nr_entries = 0;
+}
+
+/**
+ * @brief Retire the unlinked object
+ * @details
+ * The object must be unreachable for the new readers. It is freed by
+ * `free_fn` after every reader which could see it exits.
+ *
+ * @param ebr reclamation domain
+ * @param ptr retired object
+ * @param free_fn free function of the object
+ * @return int 0 means success. -ENOMEM means that the object is not
+ * retired (the caller still owns it).
+ */
+int rb_ebr_retire(struct rb_ebr *ebr, void *ptr, rb_ebr_free_fn free_fn)
+{
+        struct rb_ebr_thread *th = rb_ebr_self(ebr);
+        struct rb_ebr_limbo *limbo = NULL;
+        unsigned long epoch;
+
+        atomic_thread_fence(memory_order_seq_cst); /**< unlink before epoch */
+        epoch = atomic_load(&ebr->epoch);
+        limbo = &th->limbo[epoch % RB_EBR_NR_EPOCHS];
+        if (limbo->epoch != epoch) { /**< entries of epoch - 3 (or older) */
+                rb_ebr_limbo_free(limbo);
+                limbo->epoch = epoch;
+        }
+
+        if (limbo->nr_entries == limbo->capacity) {
+                size_t capacity = limbo->capacity ? limbo->capacity * 2 :
+                                                    RB_EBR_BATCH_SIZE;
+                struct rb_ebr_entry *entries = (struct rb_ebr_entry *)realloc(
+                        limbo->entries, capacity * sizeof(struct rb_ebr_entry));
+                if (!entries) {
+                        pr_info("Memory allocation failed\n");
+                        return -ENOMEM;
+                }
+                limbo->entries = entries;
+                limbo->capacity = capacity;
+        }
+        limbo->entries[limbo->nr_entries].ptr = ptr;
+        limbo->entries[limbo->nr_entries].free_fn = free_fn;
+        limbo->nr_entries++;
+
+        if (++th->nr_retired >= RB_EBR_BATCH_SIZE) {
+                th->nr_retired = 0;
+                rb_ebr_collect(ebr);
+        }
+        return 0;
+}
+
+/**
+ * @brief Try to advance the epoch and free the current thread's batches
+ * which are two epochs old
+ *
+ * @param ebr reclamation domain
+ */
+void rb_ebr_collect(struct rb_ebr *ebr)
+{
+        struct rb_ebr_thread *th = rb_ebr_self(ebr);
+        unsigned long epoch;
+
+        rb_ebr_try_advance(ebr);
+        epoch = atomic_load(&ebr->epoch);
+        for (int i = 0; i < RB_EBR_NR_EPOCHS; i++) {
+                if (th->limbo[i].nr_entries && th->limbo[i].epoch + 2 <= epoch) {
+                        rb_ebr_limbo_free(&th->limbo[i]);
+                }
+        }
+}
+
+/**
+ * @brief Wait until the current thread's retired objects are freed
+ * @details
+ * The thread which retires objects calls this before it exits because
+ * the other threads do not free its limbo lists.
+ * @warning The current thread must not be in the critical section.
+ *
+ * @param ebr reclamation domain
+ */
+void rb_ebr_synchronize(struct rb_ebr *ebr)
+{
+        unsigned long target = atomic_load(&ebr->epoch) + 2;
+
+        while (atomic_load(&ebr->epoch) < target) {
+                if (!rb_ebr_try_advance(ebr)) {
+                        sched_yield();
+                }
+        }
+        rb_ebr_collect(ebr);
+}
+
+/**
+ * @brief Does deallocation of the domain and every retired object
+ * @warning No thread can be in the critical section at this point.
+ *
+ * @param ebr reclamation domain
+ */
+void rb_ebr_dealloc(struct rb_ebr *ebr)
+{
+        struct rb_ebr_thread *th = atomic_load(&ebr->threads);
+        struct rb_ebr_thread *next = NULL;
+
+        while (th) {
+                next = th->next;
+                for (int i = 0; i < RB_EBR_NR_EPOCHS; i++) {
+                        rb_ebr_limbo_free(&th->limbo[i]);
+                        free(th->limbo[i].entries);
+                }
+                free(th);
+                th = next;
+        }
+
+        if (rb_ebr_cached_domain == ebr->id) {
+                rb_ebr_cached_domain = 0;
+                rb_ebr_cached_thread = NULL;
+        }
+        free(ebr);
+}
@@ -0,0 +1,86 @@
+/**
+ * @file rb-ebr.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief epoch based memory reclamation's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * Readers wrap their accesses with `rb_ebr_enter` and `rb_ebr_exit`.
+ * Unlinked objects are retired to the per-thread limbo list of the current
+ * global epoch. The global epoch advances only if every active thread has
+ * observed it, so the objects retired in epoch e are freed in a batch when
+ * the global epoch reaches e + 2.
+ *
+ * Only the owner thread frees its limbo lists and no thread adopts them.
+ * So, a thread which retires objects calls `rb_ebr_synchronize` before it
+ * exits. Otherwise, its objects are freed by `rb_ebr_dealloc`.
+ *
+ * @ref Fraser, K. (2004). Practical lock-freedom (No. UCAM-CL-TR-579). University of Cambridge, Computer Laboratory.
+ */
+#ifndef RB_EBR_H_
+#define RB_EBR_H_
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define RB_EBR_NR_EPOCHS (3)
+#define RB_EBR_BATCH_SIZE (64) /**< retires between the advance attempts */
+
+typedef void (*rb_ebr_free_fn)(void *ptr);
+
+/**
+ * @brief Retired object
+ *
+ */
+struct rb_ebr_entry {
+        void *ptr;
+        rb_ebr_free_fn free_fn;
+};
+
+/**
+ * @brief Objects which are retired in the same epoch
+ *
+ */
+struct rb_ebr_limbo {
+        unsigned long epoch;
+        struct rb_ebr_entry *entries;
+        size_t nr_entries;
+        size_t capacity;
+};
+
+/**
+ * @brief Per-thread state of the domain
+ *
+ */
+struct rb_ebr_thread {
+        atomic_ulong epoch; /**< observed global epoch */
+        atomic_int active; /**< in the critical section */
+        int nesting;
+        const void *owner; /**< thread which uses this record */
+        size_t nr_retired; /**< retires since the last advance attempt */
+        struct rb_ebr_limbo limbo[RB_EBR_NR_EPOCHS];
+        struct rb_ebr_thread *next;
+};
+
+/**
+ * @brief Reclamation domain
+ *
+ */
+struct rb_ebr {
+        unsigned long id; /**< unique id (the address can be reused) */
+        atomic_ulong epoch; /**< global epoch */
+        struct rb_ebr_thread *_Atomic threads; /**< registered threads */
+};
+
+struct rb_ebr *rb_ebr_alloc(void);
+void rb_ebr_enter(struct rb_ebr *ebr);
+void rb_ebr_exit(struct rb_ebr *ebr);
+int rb_ebr_retire(struct rb_ebr *ebr, void *ptr, rb_ebr_free_fn free_fn);
+void rb_ebr_collect(struct rb_ebr *ebr);
+void rb_ebr_synchronize(struct rb_ebr *ebr);
+void rb_ebr_dealloc(struct rb_ebr *ebr);
+
+#endif
@@ -0,0 +1,289 @@
+/**
+ * @file rb-fc-tree.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief flat-combining red black tree wrapper implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <sched.h>
+#include <stdlib.h>
+#include "rb-fc-tree.h"
+#include "rb-tree-internal.h"
+
+static atomic_uint rb_fc_next_slot; /**< round-robin slot hint */
+static _Thread_local int rb_fc_slot_hint = -1;
+
+/**
+ * @brief Allocation of flat-combining red-black tree
+ * @details
+ * The combiner links and frees the nodes out of the bookkeeping of
+ * `rb_tree_insert` and `rb_tree_delete` (seqlock, snapshot, EBR and the
+ * retired list). So, only RB_FC_TREE_FLAGS are accepted, and the inner
+ * tree must not be snapshotted or attached to an EBR domain.
+ *
+ * @param flags combination of RB_FC_TREE_FLAGS values
+ * @return struct rb_fc_tree* allocated tree (NULL means that the flags
+ * are not supported or allocation failed)
+ */
+struct rb_fc_tree *rb_fc_tree_alloc(unsigned int flags)
+{
+        struct rb_fc_tree *fctree = NULL;
+
+        if (flags & ~RB_FC_TREE_FLAGS) {
+                pr_info("unsupported flags 0x%x\n", flags);
+                return NULL;
+        }
+
+        fctree = (struct rb_fc_tree *)aligned_alloc(RB_CACHE_LINE_SIZE,
+                                                    sizeof(struct rb_fc_tree));
+        if (!fctree) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+
+        fctree->tree = rb_tree_alloc_flags(flags);
+        if (!fctree->tree) {
+                goto exception;
+        }
+        if (pthread_mutex_init(&fctree->lock, NULL)) {
+                pr_info("lock initialization failed\n");
+                goto exception;
+        }
+        for (int i = 0; i < RB_FC_NR_SLOTS; i++) {
+                atomic_init(&fctree->slots[i].owner, 0);
+                atomic_init(&fctree->slots[i].op, RB_FC_OP_NONE);
+        }
+        atomic_init(&fctree->nr_combined, 0);
+        atomic_init(&fctree->nr_batches, 0);
+
+        return fctree;
+exception:
+        if (fctree->tree) {
+                rb_tree_dealloc(fctree->tree);
+        }
+        free(fctree);
+        return NULL;
+}
+
+/**
+ * @brief Claim a free publication slot
+ * @details
+ * Each thread starts from its own hint, so the threads rarely fight over
+ * the same slot. If every slot is busy, the thread waits for a free one.
+ *
+ * @param fctree flat-combining tree
+ * @return struct rb_fc_slot* claimed slot
+ */
+static struct rb_fc_slot *rb_fc_claim_slot(struct rb_fc_tree *fctree)
+{
+        int expected;
+
+        if (rb_fc_slot_hint < 0) {
+                rb_fc_slot_hint = (int)(atomic_fetch_add(&rb_fc_next_slot, 1) %
+                                        RB_FC_NR_SLOTS);
+        }
+
+        for (;;) {
+                for (int i = 0; i < RB_FC_NR_SLOTS; i++) {
+                        int id = (rb_fc_slot_hint + i) % RB_FC_NR_SLOTS;
+                        struct rb_fc_slot *slot = &fctree->slots[id];
+
+                        expected = 0;
+                        if (!atomic_load_explicit(&slot->owner,
+                                                  memory_order_relaxed) &&
+                            atomic_compare_exchange_strong(&slot->owner,
+                                                           &expected, 1)) {
+                                return slot;
+                        }
+                }
+                sched_yield();
+        }
+}
+
+/**
+ * @brief Link the new node
+ *
+ * @param tree combined tree (the combiner holds the lock)
+ * @param slot insert request (its node is left to the writer if the key
+ * exists, then the node has the old data)
+ * @return int 0 means success
+ */
+static int rb_fc_tree_link(struct rb_tree *tree, struct rb_fc_slot *slot)
+{
+        if (__rb_tree_insert(tree, slot->node) != RB_TREE_UPDATED) {
+                slot->node = NULL;
+        }
+        return 0;
+}
+
+/**
+ * @brief Unlink the node of the key (the writer frees it)
+ *
+ * @param tree combined tree (the combiner holds the lock)
+ * @param slot delete request
+ * @return int 0 means that delete success. -ENODATA means not found.
+ */
+static int rb_fc_tree_unlink(struct rb_tree *tree, struct rb_fc_slot *slot)
+{
+        struct rb_node *node = rb_tree_search(tree, slot->key);
+
+        slot->node = NULL;
+        if (!node) {
+                return -ENODATA;
+        }
+        __rb_tree_delete(tree, node);
+        slot->node = node;
+        return 0;
+}
+
+/**
+ * @brief Apply every published request (the combiner holds the lock)
+ *
+ * @param fctree flat-combining tree
+ */
+static void rb_fc_tree_combine(struct rb_fc_tree *fctree)
+{
+        struct rb_fc_slot *slot = NULL;
+        unsigned long nr_combined = 0;
+        int op;
+
+        for (int pass = 0; pass < RB_FC_NR_PASSES; pass++) {
+                unsigned long nr_found = 0;
+
+                for (int i = 0; i < RB_FC_NR_SLOTS; i++) {
+                        slot = &fctree->slots[i];
+                        op = atomic_load_explicit(&slot->op,
+                                                  memory_order_acquire);
+                        if (op == RB_FC_OP_INSERT) {
+                                slot->ret = rb_fc_tree_link(fctree->tree,
+                                                            slot);
+                        } else if (op == RB_FC_OP_DELETE) {
+                                slot->ret = rb_fc_tree_unlink(fctree->tree,
+                                                              slot);
+                        } else {
+                                continue;
+                        }
+                        atomic_store_explicit(&slot->op, RB_FC_OP_DONE,
+                                              memory_order_release);
+                        nr_found++;
+                }
+                nr_combined += nr_found;
+                if (!nr_found) { /**< nobody arrived during the last pass */
+                        break;
+                }
+        }
+
+        atomic_fetch_add_explicit(&fctree->nr_combined, nr_combined,
+                                  memory_order_relaxed);
+        atomic_fetch_add_explicit(&fctree->nr_batches, 1,
+                                  memory_order_relaxed);
+}
+
+/**
+ * @brief Publish the request and wait until some combiner applies it
+ *
+ * @param fctree flat-combining tree
+ * @param op RB_FC_OP_INSERT or RB_FC_OP_DELETE
+ * @param key target key
+ * @param node new node (insert only)
+ * @return int return value of the applied operation
+ */
+static int rb_fc_tree_execute(struct rb_fc_tree *fctree, int op, key_t key,
+                              struct rb_node *node)
+{
+        struct rb_fc_slot *slot = rb_fc_claim_slot(fctree);
+        int ret;
+
+        slot->key = key;
+        slot->node = node;
+        atomic_store_explicit(&slot->op, op, memory_order_release);
+
+        while (atomic_load_explicit(&slot->op, memory_order_acquire) !=
+               RB_FC_OP_DONE) {
+                if (pthread_mutex_trylock(&fctree->lock) == 0) {
+                        rb_fc_tree_combine(fctree); /**< mine is in it */
+                        pthread_mutex_unlock(&fctree->lock);
+                } else {
+                        sched_yield();
+                }
+        }
+
+        ret = slot->ret;
+        node = slot->node;
+        atomic_store_explicit(&slot->op, RB_FC_OP_NONE, memory_order_relaxed);
+        atomic_store_explicit(&slot->owner, 0, memory_order_release);
+
+        if (node) { /**< deleted or replaced, freed out of the lock */
+                rb_node_dealloc(node);
+        }
+        return ret;
+}
+
+/**
+ * @brief Insert the key and the data through the combiner
+ *
+ * @param fctree flat-combining tree
+ * @param key new node's key
+ * @param data new node's data (the data of the same key is freed and
+ * updated)
+ * @return int 0 means success. -ENOMEM means that nothing is inserted.
+ */
+int rb_fc_tree_insert(struct rb_fc_tree *fctree, key_t key, void *data)
+{
+        struct rb_node *node = rb_node_alloc(key);
+
+        if (!node) {
+                return -ENOMEM;
+        }
+        node->data = data;
+        return rb_fc_tree_execute(fctree, RB_FC_OP_INSERT, key, node);
+}
+
+int rb_fc_tree_delete(struct rb_fc_tree *fctree, key_t key)
+{
+        return rb_fc_tree_execute(fctree, RB_FC_OP_DELETE, key, NULL);
+}
+
+/**
+ * @brief Search the key and visit its node under the combiner lock
+ *
+ * @param fctree flat-combining tree
+ * @param key the key which I want to search
+ * @param fn visitor called under the lock (nullable)
+ * @param arg user argument
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_fc_tree_search(struct rb_fc_tree *fctree, key_t key, rb_visit_fn fn,
+                      void *arg)
+{
+        struct rb_node *node = NULL;
+        int ret = -ENODATA;
+
+        pthread_mutex_lock(&fctree->lock);
+        node = rb_tree_search(fctree->tree, key);
+        if (node && node != fctree->tree->nil) {
+                if (fn) {
+                        fn(node, arg);
+                }
+                ret = 0;
+        }
+        pthread_mutex_unlock(&fctree->lock);
+
+        return ret;
+}
+
+/**
+ * @brief Deallocate the tree (no thread may use it anymore)
+ *
+ * @param fctree flat-combining tree
+ */
+void rb_fc_tree_dealloc(struct rb_fc_tree *fctree)
+{
+        rb_tree_dealloc(fctree->tree);
+        pthread_mutex_destroy(&fctree->lock);
+        free(fctree);
+}
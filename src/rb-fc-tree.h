@@ -0,0 +1,70 @@
+/**
+ * @file rb-fc-tree.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief flat-combining red black tree wrapper's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * A writer publishes its request in a publication slot instead of waiting
+ * for the lock. Whoever gets the lock becomes the combiner and applies
+ * every pending request in one pass, and the other writers only wait for
+ * their slot to be done. So, the lock is handed off once per batch and the
+ * tree stays in the combiner's cache.
+ *
+ * The writer allocates the new node before it publishes the request and
+ * frees the deleted node after its request is done. So, the combiner only
+ * links and unlinks the nodes under the lock.
+ */
+#ifndef RB_FC_TREE_H_
+#define RB_FC_TREE_H_
+
+#include "rb-tree.h"
+#include "rb-rwlock.h"
+#include "rb-rw-tree.h"
+
+#define RB_FC_NR_SLOTS (64)
+#define RB_FC_NR_PASSES (3) /**< combining passes per lock acquisition */
+#define RB_FC_TREE_FLAGS (RB_TREE_FLAG_MULTI) /**< accepted flags */
+
+enum rb_fc_op {
+        RB_FC_OP_NONE = 0,
+        RB_FC_OP_INSERT,
+        RB_FC_OP_DELETE,
+        RB_FC_OP_DONE,
+};
+
+/**
+ * @brief Publication slot (one cache line per slot)
+ *
+ */
+struct rb_fc_slot {
+        _Alignas(RB_CACHE_LINE_SIZE) atomic_int owner; /**< claimed by */
+        atomic_int op; /**< `enum rb_fc_op` */
+        key_t key;
+        struct rb_node *node; /**< node to link or the unlinked node */
+        int ret;
+};
+
+/**
+ * @brief Flat-combining red-black tree
+ *
+ */
+struct rb_fc_tree {
+        struct rb_tree *tree;
+        pthread_mutex_t lock; /**< held by the combiner */
+        struct rb_fc_slot slots[RB_FC_NR_SLOTS];
+        atomic_ulong nr_combined; /**< requests applied by the combiners */
+        atomic_ulong nr_batches; /**< lock acquisitions of the combiners */
+};
+
+struct rb_fc_tree *rb_fc_tree_alloc(unsigned int flags);
+int rb_fc_tree_search(struct rb_fc_tree *fctree, key_t key, rb_visit_fn fn,
+                      void *arg);
+int rb_fc_tree_insert(struct rb_fc_tree *fctree, key_t key, void *data);
+int rb_fc_tree_delete(struct rb_fc_tree *fctree, key_t key);
+void rb_fc_tree_dealloc(struct rb_fc_tree *fctree);
+
+#endif
@@ -0,0 +1,443 @@
+/**
+ * @file rb-frozen.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief frozen (read-only) red black tree index implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#include <stdlib.h>
+#include "rb-frozen.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RB_FROZEN_X86
+#endif
+
+#define RB_FROZEN_KEY_SIGN ((key_t)1 << 63) /**< unsigned to signed order */
+
+/**
+ * @brief Child block of the (RB_FROZEN_BLOCK_KEYS + 1)-ary tree
+ *
+ * @param b parent block
+ * @param i child index (number of the keys which are less than the key)
+ */
+#define RB_FROZEN_CHILD(b, i) ((b) * (RB_FROZEN_BLOCK_KEYS + 1) + (i) + 1)
+
+/**
+ * @brief Place the next sorted node to the slot
+ *
+ * @param frozen target index
+ * @param nodes nodes of the tree in the key order
+ * @param next rank of the next sorted node
+ * @param slot target slot
+ */
+static void rb_frozen_place(struct rb_frozen *frozen, struct rb_node **nodes,
+                            size_t *next, size_t slot)
+{
+        if (*next < frozen->nr_keys) {
+                frozen->keys[slot] = nodes[*next]->key;
+                frozen->data[slot] = nodes[*next]->data;
+                frozen->ranks[slot] = *next;
+                frozen->slots[(*next)++] = slot;
+        } else {
+                frozen->keys[slot] = RB_MAX_KEY;
+                frozen->data[slot] = NULL;
+                frozen->ranks[slot] = frozen->nr_keys;
+        }
+}
+
+/**
+ * @brief Place the sorted keys to the Eytzinger positions
+ * @details
+ * The in-order traversal of the implicit tree visits the positions in the
+ * key order. So, the next sorted key goes to the visited position.
+ *
+ * @param frozen target index
+ * @param nodes nodes of the tree in the key order
+ * @param next rank of the next sorted node
+ * @param i current position
+ */
+static void rb_frozen_fill_eytzinger(struct rb_frozen *frozen,
+                                     struct rb_node **nodes, size_t *next,
+                                     size_t i)
+{
+        if (i >= frozen->nr_slots) {
+                return;
+        }
+        rb_frozen_fill_eytzinger(frozen, nodes, next, 2 * i);
+        rb_frozen_place(frozen, nodes, next, i);
+        rb_frozen_fill_eytzinger(frozen, nodes, next, 2 * i + 1);
+}
+
+/**
+ * @brief Place the sorted keys to the blocks of the k-ary tree
+ * @details
+ * The slots after the last key are padded by RB_MAX_KEY. They are the
+ * last in the in-order, so the search never prefers them to a real key.
+ *
+ * @param frozen target index
+ * @param nodes nodes of the tree in the key order
+ * @param next rank of the next sorted node
+ * @param b current block
+ */
+static void rb_frozen_fill_kary(struct rb_frozen *frozen,
+                                struct rb_node **nodes, size_t *next, size_t b)
+{
+        if (b * RB_FROZEN_BLOCK_KEYS >= frozen->nr_slots) {
+                return;
+        }
+        for (size_t i = 0; i < RB_FROZEN_BLOCK_KEYS; i++) {
+                rb_frozen_fill_kary(frozen, nodes, next, RB_FROZEN_CHILD(b, i));
+                rb_frozen_place(frozen, nodes, next,
+                                b * RB_FROZEN_BLOCK_KEYS + i);
+        }
+        rb_frozen_fill_kary(frozen, nodes, next,
+                            RB_FROZEN_CHILD(b, RB_FROZEN_BLOCK_KEYS));
+}
+
+/**
+ * @brief Eytzinger lower bound search
+ * @details
+ * The descendants four levels below are 16 consecutive keys (two cache
+ * lines). They are prefetched while the current level is compared.
+ */
+static size_t rb_frozen_eytzinger(const struct rb_frozen *frozen, key_t key)
+{
+        const key_t *keys = frozen->keys;
+        const size_t n = frozen->nr_keys;
+        size_t i = 1;
+
+        while (i <= n) {
+                __builtin_prefetch(keys + RB_FROZEN_PREFETCH_KEYS * i);
+                __builtin_prefetch(keys + RB_FROZEN_PREFETCH_KEYS * i + 8);
+                i = 2 * i + (keys[i] < key);
+        }
+        /** cancel the right turns after the last left turn */
+        i >>= __builtin_ffsll((long long)~i);
+        return i ? i : frozen->nr_slots;
+}
+
+/**
+ * @brief Expand the k-ary descent with the block rank function
+ * @details
+ * `rank` returns the number of the keys in the block which are less than
+ * the key. The last block slot which is not less than the key on the path
+ * is the lower bound. The padding is never reached if the key is not
+ * greater than the largest key.
+ */
+#define RB_FROZEN_KARY_SEARCH(frozen, key, rank)                               \
+        do {                                                                   \
+                const size_t nr_blocks =                                       \
+                        (frozen)->nr_slots / RB_FROZEN_BLOCK_KEYS;             \
+                size_t b = 0, i, found = (frozen)->nr_slots;                   \
+                while (b < nr_blocks) {                                        \
+                        i = rank((frozen)->keys + b * RB_FROZEN_BLOCK_KEYS,    \
+                                 (key));                                       \
+                        if (i < RB_FROZEN_BLOCK_KEYS) {                        \
+                                found = b * RB_FROZEN_BLOCK_KEYS + i;          \
+                        }                                                      \
+                        b = RB_FROZEN_CHILD(b, i);                             \
+                }                                                              \
+                return found;                                                  \
+        } while (0)
+
+static inline size_t rb_frozen_rank_scalar(const key_t *block, key_t key)
+{
+        size_t rank = 0;
+
+        for (size_t i = 0; i < RB_FROZEN_BLOCK_KEYS; i++) {
+                rank += (block[i] < key);
+        }
+        return rank;
+}
+
+static size_t rb_frozen_kary_scalar(const struct rb_frozen *frozen, key_t key)
+{
+        RB_FROZEN_KARY_SEARCH(frozen, key, rb_frozen_rank_scalar);
+}
+
+#ifdef RB_FROZEN_X86
+/**
+ * @brief Rank of the block by SSE4.2 (2 keys per compare)
+ * @details
+ * `pcmpgtq` compares the signed integers. So, both sides are flipped by
+ * the sign bit to keep the unsigned order.
+ */
+__attribute__((target("sse4.2"))) static inline size_t
+rb_frozen_rank_sse42(const key_t *block, key_t key)
+{
+        const __m128i sign = _mm_set1_epi64x((long long)RB_FROZEN_KEY_SIGN);
+        const __m128i k = _mm_xor_si128(_mm_set1_epi64x((long long)key), sign);
+        unsigned int mask = 0;
+
+        for (int i = 0; i < (int)RB_FROZEN_BLOCK_KEYS / 2; i++) {
+                __m128i v = _mm_load_si128((const __m128i *)block + i);
+                v = _mm_cmpgt_epi64(k, _mm_xor_si128(v, sign));
+                mask |= (unsigned int)_mm_movemask_pd(_mm_castsi128_pd(v))
+                        << (2 * i);
+        }
+        return (size_t)__builtin_ctz(~mask); /**< sorted: mask is 0...01...1 */
+}
+
+__attribute__((target("sse4.2"))) static size_t
+rb_frozen_kary_sse42(const struct rb_frozen *frozen, key_t key)
+{
+        RB_FROZEN_KARY_SEARCH(frozen, key, rb_frozen_rank_sse42);
+}
+
+/**
+ * @brief Rank of the block by AVX2 (4 keys per compare)
+ */
+__attribute__((target("avx2"))) static inline size_t
+rb_frozen_rank_avx2(const key_t *block, key_t key)
+{
+        const __m256i sign =
+                _mm256_set1_epi64x((long long)RB_FROZEN_KEY_SIGN);
+        const __m256i k =
+                _mm256_xor_si256(_mm256_set1_epi64x((long long)key), sign);
+        __m256i lo = _mm256_load_si256((const __m256i *)block);
+        __m256i hi = _mm256_load_si256((const __m256i *)block + 1);
+        unsigned int mask;
+
+        lo = _mm256_cmpgt_epi64(k, _mm256_xor_si256(lo, sign));
+        hi = _mm256_cmpgt_epi64(k, _mm256_xor_si256(hi, sign));
+        mask = (unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(lo)) |
+               (unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(hi)) << 4;
+        return (size_t)__builtin_ctz(~mask);
+}
+
+__attribute__((target("avx2"))) static size_t
+rb_frozen_kary_avx2(const struct rb_frozen *frozen, key_t key)
+{
+        RB_FROZEN_KARY_SEARCH(frozen, key, rb_frozen_rank_avx2);
+}
+#endif
+
+/**
+ * @brief Select the k-ary search of the running CPU
+ *
+ * @param frozen target index
+ */
+static void rb_frozen_select_kary(struct rb_frozen *frozen)
+{
+        frozen->lower_bound = rb_frozen_kary_scalar;
+        frozen->isa = "scalar";
+#ifdef RB_FROZEN_X86
+        __builtin_cpu_init();
+        if (RB_FROZEN_BLOCK_KEYS != 8) { /**< the SIMD ranks assume 8 keys */
+                return;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+                frozen->lower_bound = rb_frozen_kary_avx2;
+                frozen->isa = "avx2";
+        } else if (__builtin_cpu_supports("sse4.2")) {
+                frozen->lower_bound = rb_frozen_kary_sse42;
+                frozen->isa = "sse4.2";
+        }
+#endif
+}
+
+/**
+ * @brief Make the immutable index of the tree in Eytzinger layout
+ *
+ * @param tree source tree
+ * @return struct rb_frozen* frozen index
+ */
+struct rb_frozen *rb_tree_freeze(struct rb_tree *tree)
+{
+        return rb_tree_freeze_layout(tree, RB_FROZEN_EYTZINGER);
+}
+
+/**
+ * @brief Make the immutable index of the tree
+ * @details
+ * The tree is not changed and can be used (or deallocated after the data
+ * is not needed) as usual. The index does not follow the later changes.
+ *
+ * @param tree source tree
+ * @param layout array layout of the search keys
+ * @return struct rb_frozen* frozen index
+ */
+struct rb_frozen *rb_tree_freeze_layout(struct rb_tree *tree,
+                                        enum rb_frozen_layout layout)
+{
+        struct rb_frozen *frozen = NULL;
+        struct rb_node **nodes = NULL;
+        struct rb_node *node = NULL;
+        size_t nr_keys = 0, next = 0;
+        size_t size;
+
+        for (node = rb_tree_minimum(tree, tree->root); node != tree->nil;
+             node = rb_tree_successor(tree, node)) {
+                nr_keys++;
+        }
+
+        frozen = (struct rb_frozen *)calloc(1, sizeof(struct rb_frozen));
+        if (!frozen) {
+                goto exception;
+        }
+        frozen->layout = layout;
+        frozen->nr_keys = nr_keys;
+        switch (layout) {
+        case RB_FROZEN_KARY:
+                frozen->nr_slots = (nr_keys + RB_FROZEN_BLOCK_KEYS - 1) /
+                                   RB_FROZEN_BLOCK_KEYS * RB_FROZEN_BLOCK_KEYS;
+                rb_frozen_select_kary(frozen);
+                break;
+        case RB_FROZEN_EYTZINGER:
+        default:
+                frozen->layout = RB_FROZEN_EYTZINGER;
+                frozen->nr_slots = nr_keys + 1; /**< keys[0] is not used */
+                frozen->lower_bound = rb_frozen_eytzinger;
+                frozen->isa = "scalar";
+                break;
+        }
+
+        size = sizeof(key_t) * frozen->nr_slots;
+        size = (size + RB_CACHE_LINE_SIZE - 1) &
+               ~(size_t)(RB_CACHE_LINE_SIZE - 1);
+        frozen->keys = (key_t *)aligned_alloc(RB_CACHE_LINE_SIZE,
+                                              size ? size : RB_CACHE_LINE_SIZE);
+        frozen->data = (void **)malloc(sizeof(void *) * (frozen->nr_slots + 1));
+        frozen->ranks = (size_t *)malloc(sizeof(size_t) * (frozen->nr_slots + 1));
+        frozen->slots = (size_t *)malloc(sizeof(size_t) * (nr_keys + 1));
+        nodes = (struct rb_node **)malloc(sizeof(struct rb_node *) *
+                                          (nr_keys + 1));
+        if (!frozen->keys || !frozen->data || !frozen->ranks ||
+            !frozen->slots || !nodes) {
+                goto exception;
+        }
+
+        for (node = rb_tree_minimum(tree, tree->root); node != tree->nil;
+             node = rb_tree_successor(tree, node)) {
+                nodes[next++] = node;
+        }
+        frozen->max = nr_keys ? nodes[nr_keys - 1]->key : 0;
+        next = 0;
+        if (frozen->layout == RB_FROZEN_KARY) {
+                rb_frozen_fill_kary(frozen, nodes, &next, 0);
+        } else {
+                frozen->keys[0] = 0; /**< not used */
+                frozen->data[0] = NULL;
+                frozen->ranks[0] = nr_keys;
+                rb_frozen_fill_eytzinger(frozen, nodes, &next, 1);
+        }
+
+        free(nodes);
+        return frozen;
+exception:
+        pr_info("Memory shortage detected! Allocation failed...");
+        free(nodes);
+        if (frozen) {
+                rb_frozen_dealloc(frozen);
+        }
+        return NULL;
+}
+
+/**
+ * @brief Find the slot of the lower bound
+ *
+ * @param frozen frozen index
+ * @param key lower bound key
+ * @return size_t slot of the lower bound (nr_slots means none)
+ */
+static inline size_t rb_frozen_find(const struct rb_frozen *frozen, key_t key)
+{
+        if (!frozen->nr_keys || key > frozen->max) {
+                return frozen->nr_slots;
+        }
+        return frozen->lower_bound(frozen, key);
+}
+
+/**
+ * @brief Search the key in the frozen index
+ *
+ * @param frozen frozen index
+ * @param key the key which I want to search
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_frozen_search(const struct rb_frozen *frozen, key_t key, void **data)
+{
+        size_t slot = rb_frozen_find(frozen, key);
+
+        if (slot == frozen->nr_slots || frozen->keys[slot] != key) {
+                return -ENODATA;
+        }
+        if (data) {
+                *data = frozen->data[slot];
+        }
+        return 0;
+}
+
+/**
+ * @brief Find the first key which is not less than the key
+ *
+ * @param frozen frozen index
+ * @param key lower bound key
+ * @param found found key stored location (nullable)
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_frozen_lower_bound(const struct rb_frozen *frozen, key_t key,
+                          key_t *found, void **data)
+{
+        size_t slot = rb_frozen_find(frozen, key);
+
+        if (slot == frozen->nr_slots) {
+                return -ENODATA;
+        }
+        if (found) {
+                *found = frozen->keys[slot];
+        }
+        if (data) {
+                *data = frozen->data[slot];
+        }
+        return 0;
+}
+
+/**
+ * @brief Visit the keys in [first, last] by the key order
+ *
+ * @param frozen frozen index
+ * @param first first key of the range
+ * @param last last key of the range (inclusive)
+ * @param fn visitor
+ * @param arg user argument
+ * @return int 0 means that every key is visited. Else, the visitor's
+ * return value which stopped the scan.
+ */
+int rb_frozen_for_each(const struct rb_frozen *frozen, key_t first,
+                       key_t last, rb_frozen_fn fn, void *arg)
+{
+        size_t slot = rb_frozen_find(frozen, first);
+        size_t rank;
+        int ret;
+
+        if (slot == frozen->nr_slots) {
+                return 0;
+        }
+        for (rank = frozen->ranks[slot]; rank < frozen->nr_keys; rank++) {
+                slot = frozen->slots[rank];
+                if (frozen->keys[slot] > last) {
+                        break;
+                }
+                ret = fn(frozen->keys[slot], frozen->data[slot], arg);
+                if (ret) {
+                        return ret;
+                }
+        }
+        return 0;
+}
+
+void rb_frozen_dealloc(struct rb_frozen *frozen)
+{
+        free(frozen->keys);
+        free(frozen->data);
+        free(frozen->ranks);
+        free(frozen->slots);
+        free(frozen);
+}
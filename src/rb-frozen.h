@@ -0,0 +1,95 @@
+/**
+ * @file rb-frozen.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief frozen (read-only) red black tree index's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * `rb_tree_freeze` copies the keys of the tree to an array in Eytzinger
+ * (BFS) order: the children of `keys[i]` are `keys[2i]` and `keys[2i+1]`.
+ * The search walks down with no branch but the loop condition, and the
+ * descendants four levels below are prefetched while the current level is
+ * compared. So, the cache misses of the levels overlap instead of one per
+ * level. The index does not own the data. The data pointers are valid
+ * while the frozen tree's nodes are.
+ *
+ * `rb_tree_freeze_layout` with RB_FROZEN_KARY packs RB_FROZEN_BLOCK_KEYS
+ * keys to a cache line instead. Each block is a node of the implicit
+ * (RB_FROZEN_BLOCK_KEYS + 1)-ary tree and is resolved by one SIMD
+ * compare and movemask. The instruction set is detected at run time.
+ *
+ * @ref Khuong, P. V., & Morin, P. (2017). Array layouts for comparison-based searching. Journal of Experimental Algorithmics (JEA), 22, 1-39.
+ * @ref Kim, C., et al. (2010). FAST: fast architecture sensitive tree search on modern CPUs and GPUs. SIGMOD.
+ */
+#ifndef RB_FROZEN_H_
+#define RB_FROZEN_H_
+
+#include "rb-tree.h"
+#include "rb-rwlock.h"
+
+#define RB_FROZEN_PREFETCH_LEVELS (4)
+#define RB_FROZEN_PREFETCH_KEYS (1 << RB_FROZEN_PREFETCH_LEVELS)
+#define RB_FROZEN_BLOCK_KEYS (RB_CACHE_LINE_SIZE / sizeof(key_t))
+
+/**
+ * @brief Array layout of the frozen index
+ *
+ */
+enum rb_frozen_layout {
+        RB_FROZEN_EYTZINGER, /**< binary, BFS order */
+        RB_FROZEN_KARY, /**< cache line sized blocks, BFS order */
+};
+
+struct rb_frozen;
+
+/**
+ * @brief Lower bound search of the layout
+ *
+ * @param frozen frozen index
+ * @param key lower bound key
+ * @return size_t slot of the lower bound in keys (nr_slots means none)
+ */
+typedef size_t (*rb_frozen_search_fn)(const struct rb_frozen *frozen,
+                                      key_t key);
+
+/**
+ * @brief Immutable array-based index of the tree
+ *
+ */
+struct rb_frozen {
+        enum rb_frozen_layout layout;
+        size_t nr_keys;
+        key_t max; /**< largest key (the padding is never the lower bound) */
+        size_t nr_slots; /**< length of keys and ranks */
+        key_t *keys; /**< search array in the layout order */
+        void **data; /**< data of keys[i] */
+        size_t *ranks; /**< sorted rank of keys[i] (nr_keys means padding) */
+        size_t *slots; /**< slot of the sorted rank (for the scan) */
+        rb_frozen_search_fn lower_bound; /**< selected by the layout and CPU */
+        const char *isa; /**< name of the selected implementation */
+};
+
+/**
+ * @brief Visitor of the frozen range scan
+ *
+ * @param key visited key
+ * @param data data of the key
+ * @param arg user argument
+ * @return int 0 means continue. Not 0 stops the scan.
+ */
+typedef int (*rb_frozen_fn)(key_t key, void *data, void *arg);
+
+struct rb_frozen *rb_tree_freeze(struct rb_tree *tree);
+struct rb_frozen *rb_tree_freeze_layout(struct rb_tree *tree,
+                                        enum rb_frozen_layout layout);
+int rb_frozen_search(const struct rb_frozen *frozen, key_t key, void **data);
+int rb_frozen_lower_bound(const struct rb_frozen *frozen, key_t key,
+                          key_t *found, void **data);
+int rb_frozen_for_each(const struct rb_frozen *frozen, key_t first,
+                       key_t last, rb_frozen_fn fn, void *arg);
+void rb_frozen_dealloc(struct rb_frozen *frozen);
+
+#endif
@@ -0,0 +1,439 @@
+/**
+ * @file rb-generate.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief type specialized red black tree generator (like BSD sys/tree.h)
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * `RB_GENERATE` stamps out a full copy of the red-black tree algorithms for
+ * a node type, a key field and a compare expression. Because the compare is
+ * expanded in place, the compiler can inline it at every level. Nodes are
+ * intrusive (the user allocates them) and leaves are NULL, so any key value
+ * can be used.
+ *
+ * @code
+ * struct item {
+ *         uint64_t key;
+ *         RB_GEN_ENTRY(item) entry;
+ * };
+ * RB_GEN_HEAD(item_tree, item);
+ * RB_GENERATE_STATIC(item_tree, item, entry, uint64_t, key, RB_GEN_CMP)
+ * @endcode
+ *
+ * @ref Cormen, T. H., Leiserson, C. E., Rivest, R. L., & Stein, C. (2009). Introduction to algorithms. MIT press.
+ */
+#ifndef RB_GENERATE_H_
+#define RB_GENERATE_H_
+
+#include <stddef.h>
+
+#define RB_GEN_RED (0)
+#define RB_GEN_BLACK (1)
+
+/**
+ * @brief Default compare expression for the arithmetic keys
+ * @note Equality is tested first, so the compiler emits one compare and
+ * the conditional move per level instead of materializing -1/0/1.
+ */
+#define RB_GEN_CMP(a, b) ((a) == (b) ? 0 : ((a) < (b) ? -1 : 1))
+
+#define RB_GEN_ENTRY(type)                                                     \
+        struct {                                                               \
+                struct type *rbe_left, *rbe_right;                             \
+                struct type *rbe_parent;                                       \
+                int rbe_color;                                                 \
+        }
+
+#define RB_GEN_HEAD(name, type)                                                \
+        struct name {                                                          \
+                struct type *rbh_root;                                         \
+        }
+
+#define RB_GEN_LEFT(elm, field) (elm)->field.rbe_left
+#define RB_GEN_RIGHT(elm, field) (elm)->field.rbe_right
+#define RB_GEN_PARENT(elm, field) (elm)->field.rbe_parent
+#define RB_GEN_COLOR(elm, field) (elm)->field.rbe_color
+#define RB_GEN_IS_BLACK(elm, field)                                            \
+        ((elm) == NULL || RB_GEN_COLOR(elm, field) == RB_GEN_BLACK)
+
+#define RB_GENERATE(name, type, field, key_type, key_field, cmp)              \
+        RB_GENERATE_INTERNAL(name, type, field, key_type, key_field, cmp, )
+#define RB_GENERATE_STATIC(name, type, field, key_type, key_field, cmp)       \
+        RB_GENERATE_INTERNAL(name, type, field, key_type, key_field, cmp,     \
+                             static inline __attribute__((unused)))
+
+#define RB_GENERATE_PROTOTYPE(name, type, key_type)                            \
+        void name##_init(struct name *head);                                   \
+        struct type *name##_search(struct name *head, key_type key);           \
+        struct type *name##_lower_bound(struct name *head, key_type key);      \
+        struct type *name##_insert(struct name *head, struct type *elm);       \
+        struct type *name##_remove(struct name *head, struct type *elm);       \
+        struct type *name##_minimum(struct name *head);                        \
+        struct type *name##_maximum(struct name *head);                        \
+        struct type *name##_successor(struct type *elm);                       \
+        struct type *name##_predecessor(struct type *elm);
+
+#define RB_GENERATE_INTERNAL(name, type, field, key_type, key_field, cmp,     \
+                             attr)                                             \
+        attr void name##_init(struct name *head)                               \
+        {                                                                      \
+                head->rbh_root = NULL;                                         \
+        }                                                                      \
+                                                                               \
+        static inline void name##_left_rotate(struct name *head,              \
+                                              struct type *x)                  \
+        {                                                                      \
+                struct type *y = RB_GEN_RIGHT(x, field);                       \
+                                                                               \
+                RB_GEN_RIGHT(x, field) = RB_GEN_LEFT(y, field);                \
+                if (RB_GEN_LEFT(y, field)) {                                   \
+                        RB_GEN_PARENT(RB_GEN_LEFT(y, field), field) = x;       \
+                }                                                              \
+                RB_GEN_PARENT(y, field) = RB_GEN_PARENT(x, field);             \
+                if (RB_GEN_PARENT(x, field) == NULL) {                         \
+                        head->rbh_root = y;                                    \
+                } else if (x == RB_GEN_LEFT(RB_GEN_PARENT(x, field), field)) { \
+                        RB_GEN_LEFT(RB_GEN_PARENT(x, field), field) = y;       \
+                } else {                                                       \
+                        RB_GEN_RIGHT(RB_GEN_PARENT(x, field), field) = y;      \
+                }                                                              \
+                RB_GEN_LEFT(y, field) = x;                                     \
+                RB_GEN_PARENT(x, field) = y;                                   \
+        }                                                                      \
+                                                                               \
+        static inline void name##_right_rotate(struct name *head,             \
+                                               struct type *y)                 \
+        {                                                                      \
+                struct type *x = RB_GEN_LEFT(y, field);                        \
+                                                                               \
+                RB_GEN_LEFT(y, field) = RB_GEN_RIGHT(x, field);                \
+                if (RB_GEN_RIGHT(x, field)) {                                  \
+                        RB_GEN_PARENT(RB_GEN_RIGHT(x, field), field) = y;      \
+                }                                                              \
+                RB_GEN_PARENT(x, field) = RB_GEN_PARENT(y, field);             \
+                if (RB_GEN_PARENT(y, field) == NULL) {                         \
+                        head->rbh_root = x;                                    \
+                } else if (y == RB_GEN_RIGHT(RB_GEN_PARENT(y, field), field)) {\
+                        RB_GEN_RIGHT(RB_GEN_PARENT(y, field), field) = x;      \
+                } else {                                                       \
+                        RB_GEN_LEFT(RB_GEN_PARENT(y, field), field) = x;       \
+                }                                                              \
+                RB_GEN_RIGHT(x, field) = y;                                    \
+                RB_GEN_PARENT(y, field) = x;                                   \
+        }                                                                      \
+                                                                               \
+        attr struct type *name##_search(struct name *head, key_type key)       \
+        {                                                                      \
+                struct type *node = head->rbh_root;                            \
+                int ret;                                                       \
+                                                                               \
+                while (node) {                                                 \
+                        ret = cmp(key, node->key_field);                       \
+                        if (ret == 0) {                                        \
+                                break;                                         \
+                        }                                                      \
+                        if (ret < 0) {                                         \
+                                node = RB_GEN_LEFT(node, field);               \
+                        } else {                                               \
+                                node = RB_GEN_RIGHT(node, field);              \
+                        }                                                      \
+                }                                                              \
+                return node;                                                   \
+        }                                                                      \
+                                                                               \
+        attr struct type *name##_lower_bound(struct name *head, key_type key)  \
+        {                                                                      \
+                struct type *node = head->rbh_root;                            \
+                struct type *bound = NULL;                                     \
+                                                                               \
+                while (node) {                                                 \
+                        if (cmp(node->key_field, key) < 0) {                   \
+                                node = RB_GEN_RIGHT(node, field);              \
+                        } else {                                               \
+                                bound = node;                                  \
+                                node = RB_GEN_LEFT(node, field);               \
+                        }                                                      \
+                }                                                              \
+                return bound;                                                  \
+        }                                                                      \
+                                                                               \
+        static inline void name##_insert_fixup(struct name *head,             \
+                                               struct type *z)                 \
+        {                                                                      \
+                struct type *parent, *gparent, *y;                             \
+                                                                               \
+                while ((parent = RB_GEN_PARENT(z, field)) &&                   \
+                       RB_GEN_COLOR(parent, field) == RB_GEN_RED) {            \
+                        gparent = RB_GEN_PARENT(parent, field);                \
+                        if (parent == RB_GEN_LEFT(gparent, field)) {           \
+                                y = RB_GEN_RIGHT(gparent, field);              \
+                                if (!RB_GEN_IS_BLACK(y, field)) { /* case 1 */ \
+                                        RB_GEN_COLOR(y, field) = RB_GEN_BLACK; \
+                                        RB_GEN_COLOR(parent, field) =          \
+                                                RB_GEN_BLACK;                  \
+                                        RB_GEN_COLOR(gparent, field) =         \
+                                                RB_GEN_RED;                    \
+                                        z = gparent;                           \
+                                        continue;                              \
+                                }                                              \
+                                if (z == RB_GEN_RIGHT(parent, field)) {        \
+                                        name##_left_rotate(head, parent);      \
+                                        y = parent; /* case 2 */               \
+                                        parent = z;                            \
+                                        z = y;                                 \
+                                }                                              \
+                                RB_GEN_COLOR(parent, field) = RB_GEN_BLACK;    \
+                                RB_GEN_COLOR(gparent, field) = RB_GEN_RED;     \
+                                name##_right_rotate(head, gparent);            \
+                        } else {                                               \
+                                y = RB_GEN_LEFT(gparent, field);               \
+                                if (!RB_GEN_IS_BLACK(y, field)) {              \
+                                        RB_GEN_COLOR(y, field) = RB_GEN_BLACK; \
+                                        RB_GEN_COLOR(parent, field) =          \
+                                                RB_GEN_BLACK;                  \
+                                        RB_GEN_COLOR(gparent, field) =         \
+                                                RB_GEN_RED;                    \
+                                        z = gparent;                           \
+                                        continue;                              \
+                                }                                              \
+                                if (z == RB_GEN_LEFT(parent, field)) {         \
+                                        name##_right_rotate(head, parent);     \
+                                        y = parent;                            \
+                                        parent = z;                            \
+                                        z = y;                                 \
+                                }                                              \
+                                RB_GEN_COLOR(parent, field) = RB_GEN_BLACK;    \
+                                RB_GEN_COLOR(gparent, field) = RB_GEN_RED;     \
+                                name##_left_rotate(head, gparent);             \
+                        }                                                      \
+                }                                                              \
+                RB_GEN_COLOR(head->rbh_root, field) = RB_GEN_BLACK;            \
+        }                                                                      \
+                                                                               \
+        /* return the node which has the same key (elm is not inserted) */    \
+        attr struct type *name##_insert(struct name *head, struct type *elm)   \
+        {                                                                      \
+                struct type *parent = NULL;                                    \
+                struct type **link = &head->rbh_root;                          \
+                int ret;                                                       \
+                                                                               \
+                while (*link) {                                                \
+                        parent = *link;                                        \
+                        ret = cmp(elm->key_field, parent->key_field);          \
+                        if (ret == 0) {                                        \
+                                return parent;                                 \
+                        }                                                      \
+                        link = ret < 0 ? &RB_GEN_LEFT(parent, field) :         \
+                                         &RB_GEN_RIGHT(parent, field);         \
+                }                                                              \
+                RB_GEN_PARENT(elm, field) = parent;                            \
+                RB_GEN_LEFT(elm, field) = RB_GEN_RIGHT(elm, field) = NULL;     \
+                RB_GEN_COLOR(elm, field) = RB_GEN_RED;                         \
+                *link = elm;                                                   \
+                name##_insert_fixup(head, elm);                                \
+                return NULL;                                                   \
+        }                                                                      \
+                                                                               \
+        /* x can be NULL, so its parent is tracked explicitly */              \
+        static inline void name##_delete_fixup(                                \
+                struct name *head, struct type *parent, struct type *x)        \
+        {                                                                      \
+                struct type *w;                                                \
+                                                                               \
+                while (RB_GEN_IS_BLACK(x, field) && x != head->rbh_root) {     \
+                        if (RB_GEN_LEFT(parent, field) == x) {                 \
+                                w = RB_GEN_RIGHT(parent, field);               \
+                                if (!RB_GEN_IS_BLACK(w, field)) { /* case 1 */ \
+                                        RB_GEN_COLOR(w, field) = RB_GEN_BLACK; \
+                                        RB_GEN_COLOR(parent, field) =          \
+                                                RB_GEN_RED;                    \
+                                        name##_left_rotate(head, parent);      \
+                                        w = RB_GEN_RIGHT(parent, field);       \
+                                }                                              \
+                                if (RB_GEN_IS_BLACK(RB_GEN_LEFT(w, field),     \
+                                                    field) &&                  \
+                                    RB_GEN_IS_BLACK(RB_GEN_RIGHT(w, field),    \
+                                                    field)) { /* case 2 */     \
+                                        RB_GEN_COLOR(w, field) = RB_GEN_RED;   \
+                                        x = parent;                            \
+                                        parent = RB_GEN_PARENT(x, field);      \
+                                        continue;                              \
+                                }                                              \
+                                if (RB_GEN_IS_BLACK(RB_GEN_RIGHT(w, field),    \
+                                                    field)) { /* case 3 */     \
+                                        RB_GEN_COLOR(RB_GEN_LEFT(w, field),    \
+                                                     field) = RB_GEN_BLACK;    \
+                                        RB_GEN_COLOR(w, field) = RB_GEN_RED;   \
+                                        name##_right_rotate(head, w);          \
+                                        w = RB_GEN_RIGHT(parent, field);       \
+                                }                                              \
+                                RB_GEN_COLOR(w, field) =                       \
+                                        RB_GEN_COLOR(parent, field);           \
+                                RB_GEN_COLOR(parent, field) = RB_GEN_BLACK;    \
+                                RB_GEN_COLOR(RB_GEN_RIGHT(w, field), field) =  \
+                                        RB_GEN_BLACK;                          \
+                                name##_left_rotate(head, parent); /* case 4 */ \
+                                x = head->rbh_root;                            \
+                                break;                                         \
+                        } else {                                               \
+                                w = RB_GEN_LEFT(parent, field);                \
+                                if (!RB_GEN_IS_BLACK(w, field)) {              \
+                                        RB_GEN_COLOR(w, field) = RB_GEN_BLACK; \
+                                        RB_GEN_COLOR(parent, field) =          \
+                                                RB_GEN_RED;                    \
+                                        name##_right_rotate(head, parent);     \
+                                        w = RB_GEN_LEFT(parent, field);        \
+                                }                                              \
+                                if (RB_GEN_IS_BLACK(RB_GEN_RIGHT(w, field),    \
+                                                    field) &&                  \
+                                    RB_GEN_IS_BLACK(RB_GEN_LEFT(w, field),     \
+                                                    field)) {                  \
+                                        RB_GEN_COLOR(w, field) = RB_GEN_RED;   \
+                                        x = parent;                            \
+                                        parent = RB_GEN_PARENT(x, field);      \
+                                        continue;                              \
+                                }                                              \
+                                if (RB_GEN_IS_BLACK(RB_GEN_LEFT(w, field),     \
+                                                    field)) {                  \
+                                        RB_GEN_COLOR(RB_GEN_RIGHT(w, field),   \
+                                                     field) = RB_GEN_BLACK;    \
+                                        RB_GEN_COLOR(w, field) = RB_GEN_RED;   \
+                                        name##_left_rotate(head, w);           \
+                                        w = RB_GEN_LEFT(parent, field);        \
+                                }                                              \
+                                RB_GEN_COLOR(w, field) =                       \
+                                        RB_GEN_COLOR(parent, field);           \
+                                RB_GEN_COLOR(parent, field) = RB_GEN_BLACK;    \
+                                RB_GEN_COLOR(RB_GEN_LEFT(w, field), field) =   \
+                                        RB_GEN_BLACK;                          \
+                                name##_right_rotate(head, parent);             \
+                                x = head->rbh_root;                            \
+                                break;                                         \
+                        }                                                      \
+                }                                                              \
+                if (x) {                                                       \
+                        RB_GEN_COLOR(x, field) = RB_GEN_BLACK;                 \
+                }                                                              \
+        }                                                                      \
+                                                                               \
+        static inline void name##_transplant(struct name *head,               \
+                                             struct type *prev_root,           \
+                                             struct type *next_root)           \
+        {                                                                      \
+                struct type *parent = RB_GEN_PARENT(prev_root, field);         \
+                                                                               \
+                if (parent == NULL) {                                          \
+                        head->rbh_root = next_root;                            \
+                } else if (prev_root == RB_GEN_LEFT(parent, field)) {          \
+                        RB_GEN_LEFT(parent, field) = next_root;                \
+                } else {                                                       \
+                        RB_GEN_RIGHT(parent, field) = next_root;               \
+                }                                                              \
+                if (next_root) {                                               \
+                        RB_GEN_PARENT(next_root, field) = parent;              \
+                }                                                              \
+        }                                                                      \
+                                                                               \
+        /* return the removed node (it is not deallocated) */                 \
+        attr struct type *name##_remove(struct name *head, struct type *z)     \
+        {                                                                      \
+                struct type *x, *y, *x_parent;                                 \
+                int y_original_color = RB_GEN_COLOR(z, field);                 \
+                                                                               \
+                if (RB_GEN_LEFT(z, field) == NULL) {                           \
+                        x = RB_GEN_RIGHT(z, field);                            \
+                        x_parent = RB_GEN_PARENT(z, field);                    \
+                        name##_transplant(head, z, x);                         \
+                } else if (RB_GEN_RIGHT(z, field) == NULL) {                   \
+                        x = RB_GEN_LEFT(z, field);                             \
+                        x_parent = RB_GEN_PARENT(z, field);                    \
+                        name##_transplant(head, z, x);                         \
+                } else {                                                       \
+                        y = RB_GEN_RIGHT(z, field);                            \
+                        while (RB_GEN_LEFT(y, field)) {                        \
+                                y = RB_GEN_LEFT(y, field);                     \
+                        }                                                      \
+                        y_original_color = RB_GEN_COLOR(y, field);             \
+                        x = RB_GEN_RIGHT(y, field);                            \
+                        if (RB_GEN_PARENT(y, field) == z) {                    \
+                                x_parent = y;                                  \
+                        } else {                                               \
+                                x_parent = RB_GEN_PARENT(y, field);            \
+                                name##_transplant(head, y, x);                 \
+                                RB_GEN_RIGHT(y, field) = RB_GEN_RIGHT(z, field);\
+                                RB_GEN_PARENT(RB_GEN_RIGHT(y, field), field) = \
+                                        y;                                     \
+                        }                                                      \
+                        name##_transplant(head, z, y);                         \
+                        RB_GEN_LEFT(y, field) = RB_GEN_LEFT(z, field);         \
+                        RB_GEN_PARENT(RB_GEN_LEFT(y, field), field) = y;       \
+                        RB_GEN_COLOR(y, field) = RB_GEN_COLOR(z, field);       \
+                }                                                              \
+                if (y_original_color == RB_GEN_BLACK) {                        \
+                        name##_delete_fixup(head, x_parent, x);                \
+                }                                                              \
+                return z;                                                      \
+        }                                                                      \
+                                                                               \
+        attr struct type *name##_minimum(struct name *head)                    \
+        {                                                                      \
+                struct type *node = head->rbh_root;                            \
+                                                                               \
+                while (node && RB_GEN_LEFT(node, field)) {                     \
+                        node = RB_GEN_LEFT(node, field);                       \
+                }                                                              \
+                return node;                                                   \
+        }                                                                      \
+                                                                               \
+        attr struct type *name##_maximum(struct name *head)                    \
+        {                                                                      \
+                struct type *node = head->rbh_root;                            \
+                                                                               \
+                while (node && RB_GEN_RIGHT(node, field)) {                    \
+                        node = RB_GEN_RIGHT(node, field);                      \
+                }                                                              \
+                return node;                                                   \
+        }                                                                      \
+                                                                               \
+        attr struct type *name##_successor(struct type *x)                     \
+        {                                                                      \
+                struct type *y;                                                \
+                                                                               \
+                if (RB_GEN_RIGHT(x, field)) {                                  \
+                        x = RB_GEN_RIGHT(x, field);                            \
+                        while (RB_GEN_LEFT(x, field)) {                        \
+                                x = RB_GEN_LEFT(x, field);                     \
+                        }                                                      \
+                        return x;                                              \
+                }                                                              \
+                y = RB_GEN_PARENT(x, field);                                   \
+                while (y && x == RB_GEN_RIGHT(y, field)) {                     \
+                        x = y;                                                 \
+                        y = RB_GEN_PARENT(y, field);                           \
+                }                                                              \
+                return y;                                                      \
+        }                                                                      \
+                                                                               \
+        attr struct type *name##_predecessor(struct type *y)                   \
+        {                                                                      \
+                struct type *x;                                                \
+                                                                               \
+                if (RB_GEN_LEFT(y, field)) {                                   \
+                        y = RB_GEN_LEFT(y, field);                             \
+                        while (RB_GEN_RIGHT(y, field)) {                       \
+                                y = RB_GEN_RIGHT(y, field);                    \
+                        }                                                      \
+                        return y;                                              \
+                }                                                              \
+                x = RB_GEN_PARENT(y, field);                                   \
+                while (x && y == RB_GEN_LEFT(x, field)) {                      \
+                        y = x;                                                 \
+                        x = RB_GEN_PARENT(x, field);                           \
+                }                                                              \
+                return x;                                                      \
+        }
+
+#endif
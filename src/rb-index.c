@@ -0,0 +1,730 @@
+/**
+ * @file rb-index.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief engine selectable ordered index implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#include "rb-index.h"
+#include "rb-bptree.h"
+#include "rb-art.h"
+#include "rb-bucket-tree.h"
+#include "rb-small-tree.h"
+#include "rb-pool-tree.h"
+#include "rb-td-tree.h"
+
+static void *rb_index_tree_alloc(void)
+{
+        return rb_tree_alloc();
+}
+
+static int rb_index_tree_insert(void *impl, key_t key, void *data)
+{
+        return rb_tree_insert((struct rb_tree *)impl, key, data);
+}
+
+static int rb_index_tree_search(void *impl, key_t key, void **data)
+{
+        struct rb_node *node = rb_tree_search((struct rb_tree *)impl, key);
+
+        if (!node) {
+                return -ENODATA;
+        }
+        if (data) {
+                *data = node->data;
+        }
+        return 0;
+}
+
+static int rb_index_tree_delete(void *impl, key_t key)
+{
+        return rb_tree_delete((struct rb_tree *)impl, key);
+}
+
+/**
+ * @brief Report the node (tree->nil means no entry)
+ */
+static int rb_index_tree_entry(struct rb_tree *tree, struct rb_node *node,
+                               key_t *key, void **data)
+{
+        if (node == tree->nil) {
+                return -ENODATA;
+        }
+        if (key) {
+                *key = node->key;
+        }
+        if (data) {
+                *data = node->data;
+        }
+        return 0;
+}
+
+static int rb_index_tree_minimum(void *impl, key_t *key, void **data)
+{
+        struct rb_tree *tree = (struct rb_tree *)impl;
+
+        return rb_index_tree_entry(tree, rb_tree_minimum(tree, tree->root),
+                                   key, data);
+}
+
+static int rb_index_tree_maximum(void *impl, key_t *key, void **data)
+{
+        struct rb_tree *tree = (struct rb_tree *)impl;
+
+        return rb_index_tree_entry(tree, rb_tree_maximum(tree, tree->root),
+                                   key, data);
+}
+
+static int rb_index_tree_successor(void *impl, key_t key, key_t *next,
+                                   void **data)
+{
+        struct rb_tree *tree = (struct rb_tree *)impl;
+
+        return rb_index_tree_entry(tree, rb_tree_upper_bound(tree, key), next,
+                                   data);
+}
+
+static int rb_index_tree_for_each(void *impl, key_t first, key_t last,
+                                  rb_index_fn fn, void *arg)
+{
+        struct rb_tree *tree = (struct rb_tree *)impl;
+        struct rb_node *node = rb_tree_lower_bound(tree, first);
+        int ret;
+
+        for (; node != tree->nil && node->key <= last;
+             node = rb_tree_successor(tree, node)) {
+                ret = fn(node->key, node->data, arg);
+                if (ret) {
+                        return ret;
+                }
+        }
+        return 0;
+}
+
+static int rb_index_tree_split(void *impl, key_t x, void **lo, void **hi)
+{
+        return rb_tree_split((struct rb_tree *)impl, x, (struct rb_tree **)lo,
+                             (struct rb_tree **)hi);
+}
+
+/**
+ * @brief Concatenate by the minimum node of hi (it is detached from hi)
+ */
+static void *rb_index_tree_concat(void *lo, void *hi)
+{
+        struct rb_tree *t1 = (struct rb_tree *)lo, *t2 = (struct rb_tree *)hi;
+        struct rb_node *max = rb_tree_maximum(t1, t1->root);
+        struct rb_node *min = rb_tree_minimum(t2, t2->root);
+
+        if (min == t2->nil) {
+                rb_tree_dealloc(t2);
+                return t1;
+        }
+        if (max != t1->nil && max->key >= min->key) {
+                pr_info("invalid state key state t1.max < t2.min\n");
+                return NULL;
+        }
+        return rb_tree_concat(t1, t2, min);
+}
+
+static void rb_index_tree_dealloc(void *impl)
+{
+        rb_tree_dealloc((struct rb_tree *)impl);
+}
+
+static void *rb_index_bptree_alloc(void)
+{
+        return rb_bptree_alloc();
+}
+
+static int rb_index_bptree_insert(void *impl, key_t key, void *data)
+{
+        return rb_bptree_insert((struct rb_bptree *)impl, key, data);
+}
+
+static int rb_index_bptree_search(void *impl, key_t key, void **data)
+{
+        return rb_bptree_search((struct rb_bptree *)impl, key, data);
+}
+
+static int rb_index_bptree_delete(void *impl, key_t key)
+{
+        return rb_bptree_delete((struct rb_bptree *)impl, key);
+}
+
+static int rb_index_bptree_minimum(void *impl, key_t *key, void **data)
+{
+        return rb_bptree_minimum((struct rb_bptree *)impl, key, data);
+}
+
+static int rb_index_bptree_maximum(void *impl, key_t *key, void **data)
+{
+        return rb_bptree_maximum((struct rb_bptree *)impl, key, data);
+}
+
+static int rb_index_bptree_successor(void *impl, key_t key, key_t *next,
+                                     void **data)
+{
+        return rb_bptree_successor((struct rb_bptree *)impl, key, next, data);
+}
+
+static int rb_index_bptree_for_each(void *impl, key_t first, key_t last,
+                                    rb_index_fn fn, void *arg)
+{
+        return rb_bptree_for_each((struct rb_bptree *)impl, first, last, fn,
+                                  arg);
+}
+
+static int rb_index_bptree_split(void *impl, key_t x, void **lo, void **hi)
+{
+        return rb_bptree_split((struct rb_bptree *)impl, x,
+                               (struct rb_bptree **)lo,
+                               (struct rb_bptree **)hi);
+}
+
+static void *rb_index_bptree_concat(void *lo, void *hi)
+{
+        return rb_bptree_concat((struct rb_bptree *)lo,
+                                (struct rb_bptree *)hi);
+}
+
+static void rb_index_bptree_dealloc(void *impl)
+{
+        rb_bptree_dealloc((struct rb_bptree *)impl);
+}
+
+static void *rb_index_art_alloc(void)
+{
+        return rb_art_alloc();
+}
+
+static int rb_index_art_insert(void *impl, key_t key, void *data)
+{
+        return rb_art_insert((struct rb_art *)impl, key, data);
+}
+
+static int rb_index_art_search(void *impl, key_t key, void **data)
+{
+        return rb_art_search((struct rb_art *)impl, key, data);
+}
+
+static int rb_index_art_delete(void *impl, key_t key)
+{
+        return rb_art_delete((struct rb_art *)impl, key);
+}
+
+static int rb_index_art_minimum(void *impl, key_t *key, void **data)
+{
+        return rb_art_minimum((struct rb_art *)impl, key, data);
+}
+
+static int rb_index_art_maximum(void *impl, key_t *key, void **data)
+{
+        return rb_art_maximum((struct rb_art *)impl, key, data);
+}
+
+static int rb_index_art_successor(void *impl, key_t key, key_t *next,
+                                  void **data)
+{
+        return rb_art_successor((struct rb_art *)impl, key, next, data);
+}
+
+static int rb_index_art_for_each(void *impl, key_t first, key_t last,
+                                 rb_index_fn fn, void *arg)
+{
+        return rb_art_for_each((struct rb_art *)impl, first, last, fn, arg);
+}
+
+static int rb_index_art_split(void *impl, key_t x, void **lo, void **hi)
+{
+        return rb_art_split((struct rb_art *)impl, x, (struct rb_art **)lo,
+                            (struct rb_art **)hi);
+}
+
+static void *rb_index_art_concat(void *lo, void *hi)
+{
+        return rb_art_concat((struct rb_art *)lo, (struct rb_art *)hi);
+}
+
+static void rb_index_art_dealloc(void *impl)
+{
+        rb_art_dealloc((struct rb_art *)impl);
+}
+
+static void *rb_index_bucket_alloc(void)
+{
+        return rb_bucket_tree_alloc();
+}
+
+static int rb_index_bucket_insert(void *impl, key_t key, void *data)
+{
+        return rb_bucket_tree_insert((struct rb_bucket_tree *)impl, key, data);
+}
+
+static int rb_index_bucket_search(void *impl, key_t key, void **data)
+{
+        return rb_bucket_tree_search((struct rb_bucket_tree *)impl, key, data);
+}
+
+static int rb_index_bucket_delete(void *impl, key_t key)
+{
+        return rb_bucket_tree_delete((struct rb_bucket_tree *)impl, key);
+}
+
+static int rb_index_bucket_minimum(void *impl, key_t *key, void **data)
+{
+        return rb_bucket_tree_minimum((struct rb_bucket_tree *)impl, key, data);
+}
+
+static int rb_index_bucket_maximum(void *impl, key_t *key, void **data)
+{
+        return rb_bucket_tree_maximum((struct rb_bucket_tree *)impl, key, data);
+}
+
+static int rb_index_bucket_successor(void *impl, key_t key, key_t *next,
+                                     void **data)
+{
+        return rb_bucket_tree_successor((struct rb_bucket_tree *)impl, key,
+                                        next, data);
+}
+
+static int rb_index_bucket_for_each(void *impl, key_t first, key_t last,
+                                    rb_index_fn fn, void *arg)
+{
+        return rb_bucket_tree_for_each((struct rb_bucket_tree *)impl, first,
+                                       last, fn, arg);
+}
+
+static int rb_index_bucket_split(void *impl, key_t x, void **lo, void **hi)
+{
+        return rb_bucket_tree_split((struct rb_bucket_tree *)impl, x,
+                                    (struct rb_bucket_tree **)lo,
+                                    (struct rb_bucket_tree **)hi);
+}
+
+static void *rb_index_bucket_concat(void *lo, void *hi)
+{
+        return rb_bucket_tree_concat((struct rb_bucket_tree *)lo,
+                                     (struct rb_bucket_tree *)hi);
+}
+
+static void rb_index_bucket_dealloc(void *impl)
+{
+        rb_bucket_tree_dealloc((struct rb_bucket_tree *)impl);
+}
+
+static void *rb_index_small_alloc(void)
+{
+        return rb_small_tree_alloc();
+}
+
+static int rb_index_small_insert(void *impl, key_t key, void *data)
+{
+        return rb_small_tree_insert((struct rb_small_tree *)impl, key, data);
+}
+
+static int rb_index_small_search(void *impl, key_t key, void **data)
+{
+        return rb_small_tree_search((struct rb_small_tree *)impl, key, data);
+}
+
+static int rb_index_small_delete(void *impl, key_t key)
+{
+        return rb_small_tree_delete((struct rb_small_tree *)impl, key);
+}
+
+static int rb_index_small_minimum(void *impl, key_t *key, void **data)
+{
+        return rb_small_tree_minimum((struct rb_small_tree *)impl, key, data);
+}
+
+static int rb_index_small_maximum(void *impl, key_t *key, void **data)
+{
+        return rb_small_tree_maximum((struct rb_small_tree *)impl, key, data);
+}
+
+static int rb_index_small_successor(void *impl, key_t key, key_t *next,
+                                    void **data)
+{
+        return rb_small_tree_successor((struct rb_small_tree *)impl, key, next,
+                                       data);
+}
+
+static int rb_index_small_for_each(void *impl, key_t first, key_t last,
+                                   rb_index_fn fn, void *arg)
+{
+        return rb_small_tree_for_each((struct rb_small_tree *)impl, first,
+                                      last, fn, arg);
+}
+
+static int rb_index_small_split(void *impl, key_t x, void **lo, void **hi)
+{
+        return rb_small_tree_split((struct rb_small_tree *)impl, x,
+                                   (struct rb_small_tree **)lo,
+                                   (struct rb_small_tree **)hi);
+}
+
+static void *rb_index_small_concat(void *lo, void *hi)
+{
+        return rb_small_tree_concat((struct rb_small_tree *)lo,
+                                    (struct rb_small_tree *)hi);
+}
+
+static void rb_index_small_dealloc(void *impl)
+{
+        rb_small_tree_dealloc((struct rb_small_tree *)impl);
+}
+
+static void *rb_index_pool_alloc(void)
+{
+        return rb_pool_tree_alloc();
+}
+
+static int rb_index_pool_insert(void *impl, key_t key, void *data)
+{
+        return rb_pool_tree_insert((struct rb_pool_tree *)impl, key, data);
+}
+
+static int rb_index_pool_search(void *impl, key_t key, void **data)
+{
+        return rb_pool_tree_search((struct rb_pool_tree *)impl, key, data);
+}
+
+static int rb_index_pool_delete(void *impl, key_t key)
+{
+        return rb_pool_tree_delete((struct rb_pool_tree *)impl, key);
+}
+
+static int rb_index_pool_minimum(void *impl, key_t *key, void **data)
+{
+        return rb_pool_tree_minimum((struct rb_pool_tree *)impl, key, data);
+}
+
+static int rb_index_pool_maximum(void *impl, key_t *key, void **data)
+{
+        return rb_pool_tree_maximum((struct rb_pool_tree *)impl, key, data);
+}
+
+static int rb_index_pool_successor(void *impl, key_t key, key_t *next,
+                                   void **data)
+{
+        return rb_pool_tree_successor((struct rb_pool_tree *)impl, key, next,
+                                      data);
+}
+
+static int rb_index_pool_for_each(void *impl, key_t first, key_t last,
+                                  rb_index_fn fn, void *arg)
+{
+        return rb_pool_tree_for_each((struct rb_pool_tree *)impl, first, last,
+                                     fn, arg);
+}
+
+static int rb_index_pool_split(void *impl, key_t x, void **lo, void **hi)
+{
+        return rb_pool_tree_split((struct rb_pool_tree *)impl, x,
+                                  (struct rb_pool_tree **)lo,
+                                  (struct rb_pool_tree **)hi);
+}
+
+static void *rb_index_pool_concat(void *lo, void *hi)
+{
+        return rb_pool_tree_concat((struct rb_pool_tree *)lo,
+                                   (struct rb_pool_tree *)hi);
+}
+
+static void rb_index_pool_dealloc(void *impl)
+{
+        rb_pool_tree_dealloc((struct rb_pool_tree *)impl);
+}
+
+static void *rb_index_td_alloc(void)
+{
+        return rb_td_tree_alloc();
+}
+
+static int rb_index_td_insert(void *impl, key_t key, void *data)
+{
+        return rb_td_tree_insert((struct rb_td_tree *)impl, key, data);
+}
+
+static int rb_index_td_search(void *impl, key_t key, void **data)
+{
+        return rb_td_tree_search((struct rb_td_tree *)impl, key, data);
+}
+
+static int rb_index_td_delete(void *impl, key_t key)
+{
+        return rb_td_tree_delete((struct rb_td_tree *)impl, key);
+}
+
+static int rb_index_td_minimum(void *impl, key_t *key, void **data)
+{
+        return rb_td_tree_minimum((struct rb_td_tree *)impl, key, data);
+}
+
+static int rb_index_td_maximum(void *impl, key_t *key, void **data)
+{
+        return rb_td_tree_maximum((struct rb_td_tree *)impl, key, data);
+}
+
+static int rb_index_td_successor(void *impl, key_t key, key_t *next,
+                                 void **data)
+{
+        return rb_td_tree_successor((struct rb_td_tree *)impl, key, next, data);
+}
+
+static int rb_index_td_for_each(void *impl, key_t first, key_t last,
+                                rb_index_fn fn, void *arg)
+{
+        return rb_td_tree_for_each((struct rb_td_tree *)impl, first, last,
+                                   fn, arg);
+}
+
+static int rb_index_td_split(void *impl, key_t x, void **lo, void **hi)
+{
+        return rb_td_tree_split((struct rb_td_tree *)impl, x,
+                                (struct rb_td_tree **)lo,
+                                (struct rb_td_tree **)hi);
+}
+
+static void *rb_index_td_concat(void *lo, void *hi)
+{
+        return rb_td_tree_concat((struct rb_td_tree *)lo,
+                                 (struct rb_td_tree *)hi);
+}
+
+static void rb_index_td_dealloc(void *impl)
+{
+        rb_td_tree_dealloc((struct rb_td_tree *)impl);
+}
+
+static const struct rb_index_ops rb_index_engines[RB_INDEX_NR_ENGINES] = {
+        [RB_INDEX_RB_TREE] = {
+                .name = "rb_tree",
+                .alloc = rb_index_tree_alloc,
+                .insert = rb_index_tree_insert,
+                .search = rb_index_tree_search,
+                .delete = rb_index_tree_delete,
+                .minimum = rb_index_tree_minimum,
+                .maximum = rb_index_tree_maximum,
+                .successor = rb_index_tree_successor,
+                .for_each = rb_index_tree_for_each,
+                .split = rb_index_tree_split,
+                .concat = rb_index_tree_concat,
+                .dealloc = rb_index_tree_dealloc,
+        },
+        [RB_INDEX_BPTREE] = {
+                .name = "rb_bptree",
+                .alloc = rb_index_bptree_alloc,
+                .insert = rb_index_bptree_insert,
+                .search = rb_index_bptree_search,
+                .delete = rb_index_bptree_delete,
+                .minimum = rb_index_bptree_minimum,
+                .maximum = rb_index_bptree_maximum,
+                .successor = rb_index_bptree_successor,
+                .for_each = rb_index_bptree_for_each,
+                .split = rb_index_bptree_split,
+                .concat = rb_index_bptree_concat,
+                .dealloc = rb_index_bptree_dealloc,
+        },
+        [RB_INDEX_ART] = {
+                .name = "rb_art",
+                .alloc = rb_index_art_alloc,
+                .insert = rb_index_art_insert,
+                .search = rb_index_art_search,
+                .delete = rb_index_art_delete,
+                .minimum = rb_index_art_minimum,
+                .maximum = rb_index_art_maximum,
+                .successor = rb_index_art_successor,
+                .for_each = rb_index_art_for_each,
+                .split = rb_index_art_split,
+                .concat = rb_index_art_concat,
+                .dealloc = rb_index_art_dealloc,
+        },
+        [RB_INDEX_BUCKET] = {
+                .name = "rb_bucket_tree",
+                .alloc = rb_index_bucket_alloc,
+                .insert = rb_index_bucket_insert,
+                .search = rb_index_bucket_search,
+                .delete = rb_index_bucket_delete,
+                .minimum = rb_index_bucket_minimum,
+                .maximum = rb_index_bucket_maximum,
+                .successor = rb_index_bucket_successor,
+                .for_each = rb_index_bucket_for_each,
+                .split = rb_index_bucket_split,
+                .concat = rb_index_bucket_concat,
+                .dealloc = rb_index_bucket_dealloc,
+        },
+        [RB_INDEX_SMALL] = {
+                .name = "rb_small_tree",
+                .alloc = rb_index_small_alloc,
+                .insert = rb_index_small_insert,
+                .search = rb_index_small_search,
+                .delete = rb_index_small_delete,
+                .minimum = rb_index_small_minimum,
+                .maximum = rb_index_small_maximum,
+                .successor = rb_index_small_successor,
+                .for_each = rb_index_small_for_each,
+                .split = rb_index_small_split,
+                .concat = rb_index_small_concat,
+                .dealloc = rb_index_small_dealloc,
+        },
+        [RB_INDEX_POOL] = {
+                .name = "rb_pool_tree",
+                .alloc = rb_index_pool_alloc,
+                .insert = rb_index_pool_insert,
+                .search = rb_index_pool_search,
+                .delete = rb_index_pool_delete,
+                .minimum = rb_index_pool_minimum,
+                .maximum = rb_index_pool_maximum,
+                .successor = rb_index_pool_successor,
+                .for_each = rb_index_pool_for_each,
+                .split = rb_index_pool_split,
+                .concat = rb_index_pool_concat,
+                .dealloc = rb_index_pool_dealloc,
+        },
+        [RB_INDEX_TD] = {
+                .name = "rb_td_tree",
+                .alloc = rb_index_td_alloc,
+                .insert = rb_index_td_insert,
+                .search = rb_index_td_search,
+                .delete = rb_index_td_delete,
+                .minimum = rb_index_td_minimum,
+                .maximum = rb_index_td_maximum,
+                .successor = rb_index_td_successor,
+                .for_each = rb_index_td_for_each,
+                .split = rb_index_td_split,
+                .concat = rb_index_td_concat,
+                .dealloc = rb_index_td_dealloc,
+        },
+};
+
+/**
+ * @brief Name of the engine
+ *
+ * @param engine target engine
+ * @return const char* name of the engine (NULL means invalid engine)
+ */
+const char *rb_index_engine_name(enum rb_index_engine engine)
+{
+        if ((unsigned int)engine >= RB_INDEX_NR_ENGINES) {
+                return NULL;
+        }
+        return rb_index_engines[engine].name;
+}
+
+static struct rb_index *rb_index_wrap(enum rb_index_engine engine, void *impl)
+{
+        struct rb_index *index =
+                (struct rb_index *)malloc(sizeof(struct rb_index));
+        if (!index) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+        index->engine = engine;
+        index->ops = &rb_index_engines[engine];
+        index->impl = impl;
+        return index;
+}
+
+/**
+ * @brief Allocation of the index
+ *
+ * @param engine engine of the index
+ * @return struct rb_index* allocated index (NULL means fail)
+ */
+struct rb_index *rb_index_alloc(enum rb_index_engine engine)
+{
+        struct rb_index *index = NULL;
+        void *impl = NULL;
+
+        if ((unsigned int)engine >= RB_INDEX_NR_ENGINES) {
+                pr_info("invalid engine %d\n", (int)engine);
+                return NULL;
+        }
+        impl = rb_index_engines[engine].alloc();
+        if (!impl) {
+                return NULL;
+        }
+        index = rb_index_wrap(engine, impl);
+        if (!index) {
+                rb_index_engines[engine].dealloc(impl);
+        }
+        return index;
+}
+
+/**
+ * @brief Split index to lo, hi based on key value x
+ *
+ * @param index split target index (freed after the split)
+ * @param x split point (the keys less than or equal to x go to lo)
+ * @param lo lo stored location
+ * @param hi hi stored location
+ * @return int 0 means success. Else, the index is not changed.
+ */
+int rb_index_split(struct rb_index *index, key_t x, struct rb_index **lo,
+                   struct rb_index **hi)
+{
+        struct rb_index *result1 = NULL, *result2 = NULL;
+        int ret;
+
+        result1 = rb_index_wrap(index->engine, NULL);
+        result2 = rb_index_wrap(index->engine, NULL);
+        if (!result1 || !result2) {
+                ret = -ENOMEM;
+                goto exception;
+        }
+        ret = index->ops->split(index->impl, x, &result1->impl,
+                                &result2->impl);
+        if (ret) {
+                goto exception;
+        }
+        free(index);
+        *lo = result1;
+        *hi = result2;
+        return 0;
+exception:
+        free(result1);
+        free(result2);
+        return ret;
+}
+
+/**
+ * @brief Concatenate two indexes of the same engine
+ *
+ * @param lo index which has the smaller keys (reused as the result)
+ * @param hi index which has the greater keys (freed)
+ * @return struct rb_index* concatenated index. NULL means that lo and hi
+ * are not changed.
+ */
+struct rb_index *rb_index_concat(struct rb_index *lo, struct rb_index *hi)
+{
+        void *impl = NULL;
+
+        if (lo->engine != hi->engine) {
+                pr_info("engines are different (%s, %s)\n", lo->ops->name,
+                        hi->ops->name);
+                return NULL;
+        }
+        impl = lo->ops->concat(lo->impl, hi->impl);
+        if (!impl) {
+                return NULL;
+        }
+        lo->impl = impl;
+        free(hi);
+        return lo;
+}
+
+/**
+ * @brief Does deallocation of the index with its data
+ *
+ * @param index target index
+ */
+void rb_index_dealloc(struct rb_index *index)
+{
+        index->ops->dealloc(index->impl);
+        free(index);
+}
@@ -0,0 +1,150 @@
+/**
+ * @file rb-index.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief engine selectable ordered index's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * The index has the operations of `rb-tree.h` by the key and the engine is
+ * chosen by `rb_index_alloc`. So, the call sites do not change when the
+ * engine is changed. The keys are unique and the index owns the data like
+ * `struct rb_tree`.
+ */
+#ifndef RB_INDEX_H_
+#define RB_INDEX_H_
+
+#include "rb-tree.h"
+
+/**
+ * @brief Engines of the index
+ *
+ */
+enum rb_index_engine {
+        RB_INDEX_RB_TREE, /**< struct rb_tree */
+        RB_INDEX_BPTREE, /**< struct rb_bptree */
+        RB_INDEX_ART, /**< struct rb_art */
+        RB_INDEX_BUCKET, /**< struct rb_bucket_tree */
+        RB_INDEX_SMALL, /**< struct rb_small_tree */
+        RB_INDEX_POOL, /**< struct rb_pool_tree */
+        RB_INDEX_TD, /**< struct rb_td_tree */
+        RB_INDEX_NR_ENGINES,
+};
+
+/**
+ * @brief Visitor of the range scan
+ *
+ * @param key visited key
+ * @param data data of the key
+ * @param arg user argument
+ * @return int 0 means continue. Not 0 stops the scan.
+ */
+typedef int (*rb_index_fn)(key_t key, void *data, void *arg);
+
+/**
+ * @brief Operations of an engine (impl is the engine's tree)
+ *
+ */
+struct rb_index_ops {
+        const char *name;
+        void *(*alloc)(void);
+        int (*insert)(void *impl, key_t key, void *data);
+        int (*search)(void *impl, key_t key, void **data);
+        int (*delete)(void *impl, key_t key);
+        int (*minimum)(void *impl, key_t *key, void **data);
+        int (*maximum)(void *impl, key_t *key, void **data);
+        int (*successor)(void *impl, key_t key, key_t *next, void **data);
+        int (*for_each)(void *impl, key_t first, key_t last, rb_index_fn fn,
+                        void *arg);
+        int (*split)(void *impl, key_t x, void **lo, void **hi);
+        void *(*concat)(void *lo, void *hi); /**< NULL means not changed */
+        void (*dealloc)(void *impl);
+};
+
+/**
+ * @brief Index structure
+ *
+ */
+struct rb_index {
+        enum rb_index_engine engine;
+        const struct rb_index_ops *ops;
+        void *impl;
+};
+
+struct rb_index *rb_index_alloc(enum rb_index_engine engine);
+const char *rb_index_engine_name(enum rb_index_engine engine);
+int rb_index_split(struct rb_index *index, key_t x, struct rb_index **lo,
+                   struct rb_index **hi);
+struct rb_index *rb_index_concat(struct rb_index *lo, struct rb_index *hi);
+void rb_index_dealloc(struct rb_index *index);
+
+/**
+ * @brief Insert the key and the data (the data of the same key is updated)
+ *
+ * @return int 0 means success. Else, the negative errno.
+ */
+static inline int rb_index_insert(struct rb_index *index, key_t key,
+                                  void *data)
+{
+        return index->ops->insert(index->impl, key, data);
+}
+
+/**
+ * @brief Search the key
+ *
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+static inline int rb_index_search(struct rb_index *index, key_t key,
+                                  void **data)
+{
+        return index->ops->search(index->impl, key, data);
+}
+
+/**
+ * @brief Delete the key and free its data
+ *
+ * @return int 0 means that delete success. -ENODATA means not found.
+ */
+static inline int rb_index_delete(struct rb_index *index, key_t key)
+{
+        return index->ops->delete(index->impl, key);
+}
+
+static inline int rb_index_minimum(struct rb_index *index, key_t *key,
+                                   void **data)
+{
+        return index->ops->minimum(index->impl, key, data);
+}
+
+static inline int rb_index_maximum(struct rb_index *index, key_t *key,
+                                   void **data)
+{
+        return index->ops->maximum(index->impl, key, data);
+}
+
+/**
+ * @brief Find the first key which is greater than the key
+ *
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+static inline int rb_index_successor(struct rb_index *index, key_t key,
+                                     key_t *next, void **data)
+{
+        return index->ops->successor(index->impl, key, next, data);
+}
+
+/**
+ * @brief Visit the keys in [first, last] in the key order
+ *
+ * @return int 0 means that every key is visited. Else, the visitor's
+ * return value which stopped the scan.
+ */
+static inline int rb_index_for_each(struct rb_index *index, key_t first,
+                                    key_t last, rb_index_fn fn, void *arg)
+{
+        return index->ops->for_each(index->impl, first, last, fn, arg);
+}
+
+#endif
@@ -0,0 +1,300 @@
+/**
+ * @file rb-lr-tree.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief left-right red black tree wrapper implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @ref Ramalhete, P., & Correia, A. (2015). Left-Right: A Concurrency
+ * Control Technique with Wait-Free Population Oblivious Reads.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <sched.h>
+#include <stdlib.h>
+#include "rb-lr-tree.h"
+#include "rb-tree-internal.h"
+
+static atomic_uint rb_lr_next_slot; /**< round-robin slot assignment */
+static _Thread_local int rb_lr_slot_id = -1;
+
+typedef struct rb_node *(*rb_lookup_fn)(struct rb_tree *tree, key_t key);
+
+/**
+ * @brief Allocation of left-right red-black tree
+ * @details
+ * The replay links and frees the nodes out of the bookkeeping of
+ * `rb_tree_insert` and `rb_tree_delete` (seqlock, snapshot, EBR and the
+ * retired list). So, only RB_LR_TREE_FLAGS are accepted, and the inner
+ * tree must not be snapshotted or attached to an EBR domain.
+ *
+ * @param flags combination of RB_LR_TREE_FLAGS values
+ * @return struct rb_lr_tree* allocated tree (NULL means that the flags
+ * are not supported or allocation failed)
+ */
+struct rb_lr_tree *rb_lr_tree_alloc(unsigned int flags)
+{
+        struct rb_lr_tree *lrtree = NULL;
+
+        if (flags & ~RB_LR_TREE_FLAGS) {
+                pr_info("unsupported flags 0x%x\n", flags);
+                return NULL;
+        }
+
+        lrtree = (struct rb_lr_tree *)aligned_alloc(RB_CACHE_LINE_SIZE,
+                                                    sizeof(struct rb_lr_tree));
+        if (!lrtree) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+
+        lrtree->trees[0] = rb_tree_alloc_flags(flags);
+        lrtree->trees[1] = rb_tree_alloc_flags(flags);
+        if (!lrtree->trees[0] || !lrtree->trees[1]) {
+                goto exception;
+        }
+        if (pthread_mutex_init(&lrtree->writer_mutex, NULL)) {
+                pr_info("lock initialization failed\n");
+                goto exception;
+        }
+        atomic_init(&lrtree->active, 0);
+        atomic_init(&lrtree->version, 0);
+        for (int i = 0; i < RB_RWLOCK_NR_SLOTS; i++) {
+                atomic_init(&lrtree->indicators[0][i].nr_readers, 0);
+                atomic_init(&lrtree->indicators[1][i].nr_readers, 0);
+        }
+
+        return lrtree;
+exception:
+        for (int i = 0; i < 2; i++) {
+                if (lrtree->trees[i]) {
+                        rb_tree_dealloc(lrtree->trees[i]);
+                }
+        }
+        free(lrtree);
+        return NULL;
+}
+
+/**
+ * @brief Get the read indicator slot of the current thread
+ *
+ * @param lrtree left-right tree
+ * @param version version of the read indicator
+ * @return struct rb_rwlock_slot* slot of the current thread
+ */
+static inline struct rb_rwlock_slot *
+rb_lr_tree_get_slot(struct rb_lr_tree *lrtree, int version)
+{
+        if (rb_lr_slot_id < 0) {
+                rb_lr_slot_id = (int)(atomic_fetch_add(&rb_lr_next_slot, 1) %
+                                      RB_RWLOCK_NR_SLOTS);
+        }
+        return &lrtree->indicators[version][rb_lr_slot_id];
+}
+
+/**
+ * @brief Look up the active instance and visit the found node
+ * @details
+ * This is wait-free. The reader does a constant number of atomic steps
+ * besides the lookup itself and never waits for the writer.
+ *
+ * @param lrtree left-right tree
+ * @param lookup lookup function of the core API
+ * @param key lookup key
+ * @param fn visitor called before the reader departs (nullable)
+ * @param arg user argument
+ * @return int 0 means that the node is found. -ENODATA means not found.
+ */
+static int rb_lr_tree_lookup(struct rb_lr_tree *lrtree, rb_lookup_fn lookup,
+                             key_t key, rb_visit_fn fn, void *arg)
+{
+        struct rb_rwlock_slot *slot = NULL;
+        struct rb_tree *tree = NULL;
+        struct rb_node *node = NULL;
+        int ret = -ENODATA;
+
+        slot = rb_lr_tree_get_slot(lrtree, atomic_load(&lrtree->version));
+        atomic_fetch_add(&slot->nr_readers, 1); /**< arrive */
+
+        tree = lrtree->trees[atomic_load(&lrtree->active)];
+        node = lookup(tree, key);
+        if (node && node != tree->nil) {
+                if (fn) {
+                        fn(node, arg);
+                }
+                ret = 0;
+        }
+
+        atomic_fetch_sub(&slot->nr_readers, 1); /**< depart */
+        return ret;
+}
+
+/**
+ * @brief Search the key and visit its node without blocking
+ *
+ * @param lrtree left-right tree
+ * @param key the key which I want to search
+ * @param fn visitor (nullable)
+ * @param arg user argument
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_lr_tree_search(struct rb_lr_tree *lrtree, key_t key, rb_visit_fn fn,
+                      void *arg)
+{
+        return rb_lr_tree_lookup(lrtree, rb_tree_search, key, fn, arg);
+}
+
+int rb_lr_tree_lower_bound(struct rb_lr_tree *lrtree, key_t key,
+                           rb_visit_fn fn, void *arg)
+{
+        return rb_lr_tree_lookup(lrtree, rb_tree_lower_bound, key, fn, arg);
+}
+
+/**
+ * @brief Wait until every reader of the read indicator departs
+ *
+ * @param lrtree left-right tree
+ * @param version version of the read indicator
+ */
+static void rb_lr_tree_drain(struct rb_lr_tree *lrtree, int version)
+{
+        for (int i = 0; i < RB_RWLOCK_NR_SLOTS; i++) {
+                while (atomic_load(&lrtree->indicators[version][i].nr_readers)) {
+                        sched_yield();
+                }
+        }
+}
+
+/**
+ * @brief Make the updated instance active and wait for the old readers
+ * @details
+ * The readers which still use the old instance announced themselves in
+ * either of the read indicators. So, the writer toggles the version and
+ * drains both before it touches the old instance.
+ *
+ * @param lrtree left-right tree (writer mutex is held)
+ * @param next updated instance
+ */
+static void rb_lr_tree_publish(struct rb_lr_tree *lrtree, int next)
+{
+        int version = atomic_load(&lrtree->version);
+
+        atomic_store(&lrtree->active, next);
+        rb_lr_tree_drain(lrtree, !version);
+        atomic_store(&lrtree->version, !version);
+        rb_lr_tree_drain(lrtree, version);
+}
+
+/**
+ * @brief Drop the data ownership of the node which the first operation
+ * updates or deletes
+ * @details
+ * The readers of the active instance can still use the data. So, only the
+ * replay, which runs after the drain, frees the data.
+ *
+ * @param tree inactive instance (nobody reads it)
+ * @param key key of the operation
+ */
+static void rb_lr_tree_disown(struct rb_tree *tree, key_t key)
+{
+        struct rb_node *node = rb_tree_search(tree, key);
+
+        if (node && node != tree->nil) {
+                node->data = NULL; /**< the replay frees it */
+        }
+}
+
+/**
+ * @brief Insert the key and the data to both instances
+ * @details
+ * Both nodes are allocated before anything is published. So, the replay
+ * only links the node and never fails.
+ *
+ * @param lrtree left-right tree
+ * @param key new node's key
+ * @param data new node's data (the data of the same key is freed and
+ * updated)
+ * @return int 0 means success. -ENOMEM means that nothing is inserted.
+ */
+int rb_lr_tree_insert(struct rb_lr_tree *lrtree, key_t key, void *data)
+{
+        struct rb_node *node = rb_node_alloc(key);
+        struct rb_node *replay = rb_node_alloc(key);
+        int active, ret;
+
+        if (!node || !replay) {
+                if (node) {
+                        rb_node_dealloc(node);
+                }
+                if (replay) {
+                        rb_node_dealloc(replay);
+                }
+                return -ENOMEM;
+        }
+        node->data = replay->data = data;
+
+        pthread_mutex_lock(&lrtree->writer_mutex);
+        active = atomic_load(&lrtree->active);
+        if (!rb_tree_is_multi(lrtree->trees[!active])) {
+                rb_lr_tree_disown(lrtree->trees[!active], key);
+        }
+        ret = __rb_tree_insert(lrtree->trees[!active], node);
+        if (ret == RB_TREE_UPDATED) {
+                rb_node_dealloc(node); /**< its data is disowned */
+        }
+        rb_lr_tree_publish(lrtree, !active);
+
+        ret = __rb_tree_insert(lrtree->trees[active], replay);
+        if (ret == RB_TREE_UPDATED) {
+                rb_node_dealloc(replay); /**< frees the old data */
+        }
+        pthread_mutex_unlock(&lrtree->writer_mutex);
+        return 0;
+}
+
+/**
+ * @brief Delete the key from both instances
+ *
+ * @param lrtree left-right tree
+ * @param key delete target key (the oldest one in the multimap)
+ * @return int 0 means that delete success. -ENODATA means not found.
+ */
+int rb_lr_tree_delete(struct rb_lr_tree *lrtree, key_t key)
+{
+        int active, ret;
+
+        pthread_mutex_lock(&lrtree->writer_mutex);
+        active = atomic_load(&lrtree->active);
+        rb_lr_tree_disown(lrtree->trees[!active], key);
+        ret = rb_tree_delete(lrtree->trees[!active], key);
+        if (ret) {
+                goto out;
+        }
+        rb_lr_tree_publish(lrtree, !active);
+
+        rb_tree_delete(lrtree->trees[active], key); /**< frees the data */
+out:
+        pthread_mutex_unlock(&lrtree->writer_mutex);
+        return ret;
+}
+
+/**
+ * @brief Does deallocation of the tree
+ * @warning No other thread can use the tree at this point.
+ *
+ * @param lrtree left-right tree
+ */
+void rb_lr_tree_dealloc(struct rb_lr_tree *lrtree)
+{
+        struct rb_tree *tree = lrtree->trees[1];
+
+        for (struct rb_node *node = rb_tree_minimum(tree, tree->root);
+             node != tree->nil; node = rb_tree_successor(tree, node)) {
+                node->data = NULL; /**< owned by the other instance */
+        }
+        rb_tree_dealloc(lrtree->trees[0]);
+        rb_tree_dealloc(lrtree->trees[1]);
+        pthread_mutex_destroy(&lrtree->writer_mutex);
+        free(lrtree);
+}
@@ -0,0 +1,51 @@
+/**
+ * @file rb-lr-tree.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief left-right red black tree wrapper's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * The tree keeps two instances of the same contents. The readers look up
+ * the active instance after announcing themselves in a read indicator, so
+ * they never block and never retry. The writer updates the inactive
+ * instance, makes it active, waits until the readers of the old one
+ * drain, and then replays the same operation on the old one.
+ *
+ * Each node's data is shared by both instances but owned only once. So,
+ * the data is freed once by the delete, the update or the dealloc. The
+ * delete and the update free it in the replay, after the readers drain.
+ */
+#ifndef RB_LR_TREE_H_
+#define RB_LR_TREE_H_
+
+#include "rb-tree.h"
+#include "rb-rwlock.h"
+#include "rb-rw-tree.h"
+
+#define RB_LR_TREE_FLAGS (RB_TREE_FLAG_MULTI) /**< accepted flags */
+
+/**
+ * @brief Left-right red-black tree
+ *
+ */
+struct rb_lr_tree {
+        struct rb_tree *trees[2];
+        atomic_int active; /**< instance which the readers use */
+        atomic_int version; /**< read indicator which the readers use */
+        pthread_mutex_t writer_mutex; /**< serialize the writers */
+        struct rb_rwlock_slot indicators[2][RB_RWLOCK_NR_SLOTS];
+};
+
+struct rb_lr_tree *rb_lr_tree_alloc(unsigned int flags);
+int rb_lr_tree_search(struct rb_lr_tree *lrtree, key_t key, rb_visit_fn fn,
+                      void *arg);
+int rb_lr_tree_lower_bound(struct rb_lr_tree *lrtree, key_t key,
+                           rb_visit_fn fn, void *arg);
+int rb_lr_tree_insert(struct rb_lr_tree *lrtree, key_t key, void *data);
+int rb_lr_tree_delete(struct rb_lr_tree *lrtree, key_t key);
+void rb_lr_tree_dealloc(struct rb_lr_tree *lrtree);
+
+#endif
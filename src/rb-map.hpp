@@ -0,0 +1,1222 @@
+/**
+ * @file rb-map.hpp
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief header-only C++ red black tree map (std::map compatible interface)
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * `rb::map` keeps the value inside the node, so one allocation is done per
+ * entry and the value is destroyed by its destructor. The balancing is the
+ * same CLRS algorithm as `rb-tree.c`, but the leaves are `nullptr` and the
+ * root's parent is the header node, which also works as `end()`.
+ *
+ * @ref Cormen, T. H., Leiserson, C. E., Rivest, R. L., & Stein, C. (2009). Introduction to algorithms. MIT press.
+ */
+#ifndef RB_MAP_HPP_
+#define RB_MAP_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace rb
+{
+template <typename Key, typename T, typename Compare, typename Allocator>
+class map;
+
+namespace detail
+{
+enum node_color : int {
+        NODE_COLOR_RED,
+        NODE_COLOR_BLACK,
+        NODE_COLOR_HEADER, /**< header node (end of the tree) */
+};
+
+/**
+ * @brief Value independent part of the node
+ * @details
+ * For the header node, `left` is the root and `right` is the leftmost node.
+ */
+struct node_base {
+        node_base *left = nullptr, *right = nullptr;
+        node_base *parent = nullptr;
+        int color = NODE_COLOR_RED;
+};
+
+inline bool is_black(const node_base *node)
+{
+        return node == nullptr || node->color == NODE_COLOR_BLACK;
+}
+
+inline node_base *minimum(node_base *node)
+{
+        while (node->left) {
+                node = node->left;
+        }
+        return node;
+}
+
+inline node_base *maximum(node_base *node)
+{
+        while (node->right) {
+                node = node->right;
+        }
+        return node;
+}
+
+/**
+ * @brief In-order successor (header when the node is the last one)
+ */
+inline node_base *successor(node_base *x)
+{
+        node_base *y;
+
+        if (x->right) {
+                return minimum(x->right);
+        }
+        y = x->parent;
+        while (y->color != NODE_COLOR_HEADER && x == y->right) {
+                x = y;
+                y = y->parent;
+        }
+        return y;
+}
+
+/**
+ * @brief In-order predecessor (the last node when the node is header)
+ */
+inline node_base *predecessor(node_base *x)
+{
+        node_base *y;
+
+        if (x->color == NODE_COLOR_HEADER) {
+                return maximum(x->left);
+        }
+        if (x->left) {
+                return maximum(x->left);
+        }
+        y = x->parent;
+        while (y->color != NODE_COLOR_HEADER && x == y->left) {
+                x = y;
+                y = y->parent;
+        }
+        return y;
+}
+
+/**
+ * @brief Replace the parent's child link of `u` to `v`
+ */
+inline void replace_child(node_base *header, node_base *u, node_base *v)
+{
+        if (u->parent == header) {
+                header->left = v;
+        } else if (u == u->parent->left) {
+                u->parent->left = v;
+        } else {
+                u->parent->right = v;
+        }
+}
+
+inline void rotate_left(node_base *header, node_base *x)
+{
+        node_base *y = x->right;
+
+        x->right = y->left;
+        if (y->left) {
+                y->left->parent = x;
+        }
+        y->parent = x->parent;
+        replace_child(header, x, y);
+        y->left = x;
+        x->parent = y;
+}
+
+inline void rotate_right(node_base *header, node_base *x)
+{
+        node_base *y = x->left;
+
+        x->left = y->right;
+        if (y->right) {
+                y->right->parent = x;
+        }
+        y->parent = x->parent;
+        replace_child(header, x, y);
+        y->right = x;
+        x->parent = y;
+}
+
+/**
+ * @brief Link the new node under the parent and rebalance the tree
+ *
+ * @param header header of the tree
+ * @param parent parent of the new node (header means the tree is empty)
+ * @param z new node
+ * @param insert_left link `z` to the left side of the parent
+ */
+inline void insert_and_rebalance(node_base *header, node_base *parent,
+                                 node_base *z, bool insert_left)
+{
+        node_base *y;
+
+        z->left = z->right = nullptr;
+        z->parent = parent;
+        z->color = NODE_COLOR_RED;
+
+        if (parent == header) {
+                header->left = header->right = z;
+        } else if (insert_left) {
+                parent->left = z;
+                if (parent == header->right) {
+                        header->right = z;
+                }
+        } else {
+                parent->right = z;
+        }
+
+        /* the header is never red, so the root stops the loop */
+        while (z->parent->color == NODE_COLOR_RED) {
+                node_base *gp = z->parent->parent;
+                if (z->parent == gp->left) {
+                        y = gp->right;
+                        if (!is_black(y)) {
+                                z->parent->color = NODE_COLOR_BLACK;
+                                y->color = NODE_COLOR_BLACK;
+                                gp->color = NODE_COLOR_RED;
+                                z = gp;
+                                continue;
+                        }
+                        if (z == z->parent->right) {
+                                z = z->parent;
+                                rotate_left(header, z);
+                        }
+                        z->parent->color = NODE_COLOR_BLACK;
+                        gp->color = NODE_COLOR_RED;
+                        rotate_right(header, gp);
+                } else {
+                        y = gp->left;
+                        if (!is_black(y)) {
+                                z->parent->color = NODE_COLOR_BLACK;
+                                y->color = NODE_COLOR_BLACK;
+                                gp->color = NODE_COLOR_RED;
+                                z = gp;
+                                continue;
+                        }
+                        if (z == z->parent->left) {
+                                z = z->parent;
+                                rotate_right(header, z);
+                        }
+                        z->parent->color = NODE_COLOR_BLACK;
+                        gp->color = NODE_COLOR_RED;
+                        rotate_left(header, gp);
+                }
+        }
+        header->left->color = NODE_COLOR_BLACK;
+}
+
+/**
+ * @brief Restore the properties after the black node is removed
+ * @details
+ * The leaves are `nullptr`, so the parent of `x` is tracked explicitly.
+ */
+inline void erase_fixup(node_base *header, node_base *x, node_base *x_parent)
+{
+        node_base *w;
+
+        while (x != header->left && is_black(x)) {
+                if (x == x_parent->left) {
+                        w = x_parent->right;
+                        if (!is_black(w)) {
+                                w->color = NODE_COLOR_BLACK;
+                                x_parent->color = NODE_COLOR_RED;
+                                rotate_left(header, x_parent);
+                                w = x_parent->right;
+                        }
+                        if (is_black(w->left) && is_black(w->right)) {
+                                w->color = NODE_COLOR_RED;
+                                x = x_parent;
+                                x_parent = x_parent->parent;
+                                continue;
+                        }
+                        if (is_black(w->right)) {
+                                w->left->color = NODE_COLOR_BLACK;
+                                w->color = NODE_COLOR_RED;
+                                rotate_right(header, w);
+                                w = x_parent->right;
+                        }
+                        w->color = x_parent->color;
+                        x_parent->color = NODE_COLOR_BLACK;
+                        w->right->color = NODE_COLOR_BLACK;
+                        rotate_left(header, x_parent);
+                } else {
+                        w = x_parent->left;
+                        if (!is_black(w)) {
+                                w->color = NODE_COLOR_BLACK;
+                                x_parent->color = NODE_COLOR_RED;
+                                rotate_right(header, x_parent);
+                                w = x_parent->left;
+                        }
+                        if (is_black(w->left) && is_black(w->right)) {
+                                w->color = NODE_COLOR_RED;
+                                x = x_parent;
+                                x_parent = x_parent->parent;
+                                continue;
+                        }
+                        if (is_black(w->left)) {
+                                w->right->color = NODE_COLOR_BLACK;
+                                w->color = NODE_COLOR_RED;
+                                rotate_left(header, w);
+                                w = x_parent->left;
+                        }
+                        w->color = x_parent->color;
+                        x_parent->color = NODE_COLOR_BLACK;
+                        w->left->color = NODE_COLOR_BLACK;
+                        rotate_right(header, x_parent);
+                }
+                break;
+        }
+        if (x) {
+                x->color = NODE_COLOR_BLACK;
+        }
+}
+
+/**
+ * @brief Unlink the node from the tree and rebalance the tree
+ *
+ * @param header header of the tree
+ * @param z erase target (the memory is not released)
+ */
+inline void erase_and_rebalance(node_base *header, node_base *z)
+{
+        node_base *y = z, *x, *x_parent;
+        int y_original_color = y->color;
+
+        if (z == header->right) { /**< keep the leftmost node */
+                header->right = successor(z);
+        }
+
+        if (z->left == nullptr) {
+                x = z->right;
+                x_parent = z->parent;
+                if (x) {
+                        x->parent = z->parent;
+                }
+                replace_child(header, z, x);
+        } else if (z->right == nullptr) {
+                x = z->left;
+                x_parent = z->parent;
+                x->parent = z->parent;
+                replace_child(header, z, x);
+        } else {
+                y = minimum(z->right);
+                y_original_color = y->color;
+                x = y->right;
+                if (y->parent == z) {
+                        x_parent = y;
+                } else {
+                        x_parent = y->parent;
+                        if (x) {
+                                x->parent = y->parent;
+                        }
+                        y->parent->left = x;
+                        y->right = z->right;
+                        y->right->parent = y;
+                }
+                y->parent = z->parent;
+                replace_child(header, z, y);
+                y->left = z->left;
+                y->left->parent = y;
+                y->color = z->color;
+        }
+
+        if (y_original_color == NODE_COLOR_BLACK) {
+                erase_fixup(header, x, x_parent);
+        }
+}
+
+/**
+ * @brief Node which keeps the value in place
+ * @details
+ * The value is constructed by the allocator after the node allocation,
+ * so the storage is raw bytes.
+ */
+template <typename T> struct node : node_base {
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *valptr()
+        {
+                return std::launder(reinterpret_cast<T *>(storage));
+        }
+        const T *valptr() const
+        {
+                return std::launder(reinterpret_cast<const T *>(storage));
+        }
+};
+
+/**
+ * @brief Bidirectional iterator of the map
+ */
+template <typename T, bool Const> class map_iterator
+{
+        template <typename, typename, typename, typename> friend class ::rb::map;
+        friend class map_iterator<T, !Const>;
+
+        node_base *cur = nullptr;
+
+        explicit map_iterator(node_base *node) : cur(node)
+        {
+        }
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T *, T *>;
+        using reference = std::conditional_t<Const, const T &, T &>;
+
+        map_iterator() = default;
+
+        template <bool C = Const, typename = std::enable_if_t<C> >
+        map_iterator(const map_iterator<T, false> &it) : cur(it.cur)
+        {
+        }
+
+        reference operator*() const
+        {
+                return *static_cast<node<T> *>(cur)->valptr();
+        }
+        pointer operator->() const
+        {
+                return static_cast<node<T> *>(cur)->valptr();
+        }
+
+        map_iterator &operator++()
+        {
+                cur = successor(cur);
+                return *this;
+        }
+        map_iterator operator++(int)
+        {
+                map_iterator it = *this;
+                cur = successor(cur);
+                return it;
+        }
+        map_iterator &operator--()
+        {
+                cur = predecessor(cur);
+                return *this;
+        }
+        map_iterator operator--(int)
+        {
+                map_iterator it = *this;
+                cur = predecessor(cur);
+                return it;
+        }
+
+        friend bool operator==(const map_iterator &a, const map_iterator &b)
+        {
+                return a.cur == b.cur;
+        }
+        friend bool operator!=(const map_iterator &a, const map_iterator &b)
+        {
+                return a.cur != b.cur;
+        }
+};
+} // namespace detail
+
+/**
+ * @brief Ordered map based on the red black tree
+ *
+ * @tparam Key key type
+ * @tparam T mapped type (move-only types are allowed)
+ * @tparam Compare strict weak ordering of the keys
+ * @tparam Allocator allocator of `std::pair<const Key, T>`
+ */
+template <typename Key, typename T, typename Compare = std::less<Key>,
+          typename Allocator = std::allocator<std::pair<const Key, T> > >
+class map
+{
+    public:
+        using key_type = Key;
+        using mapped_type = T;
+        using value_type = std::pair<const Key, T>;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using key_compare = Compare;
+        using allocator_type = Allocator;
+        using reference = value_type &;
+        using const_reference = const value_type &;
+        using pointer = typename std::allocator_traits<Allocator>::pointer;
+        using const_pointer =
+                typename std::allocator_traits<Allocator>::const_pointer;
+        using iterator = detail::map_iterator<value_type, false>;
+        using const_iterator = detail::map_iterator<value_type, true>;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        /**
+         * @brief Compare the values by their keys
+         */
+        class value_compare
+        {
+                friend class map;
+
+            protected:
+                Compare comp;
+                explicit value_compare(Compare c) : comp(std::move(c))
+                {
+                }
+
+            public:
+                bool operator()(const value_type &a, const value_type &b) const
+                {
+                        return comp(a.first, b.first);
+                }
+        };
+
+    private:
+        using node_type = detail::node<value_type>;
+        using value_alloc_traits = std::allocator_traits<Allocator>;
+        using node_allocator =
+                typename value_alloc_traits::template rebind_alloc<node_type>;
+        using node_alloc_traits = std::allocator_traits<node_allocator>;
+
+        detail::node_base header;
+        size_type nr_nodes = 0;
+        Compare comp;
+        node_allocator alloc;
+
+    public:
+        map() : map(Compare())
+        {
+        }
+
+        explicit map(const Compare &c, const Allocator &a = Allocator())
+                : comp(c), alloc(a)
+        {
+                reset();
+        }
+
+        explicit map(const Allocator &a) : map(Compare(), a)
+        {
+        }
+
+        template <typename InputIt>
+        map(InputIt first, InputIt last, const Compare &c = Compare(),
+            const Allocator &a = Allocator())
+                : map(c, a)
+        {
+                insert(first, last);
+        }
+
+        map(std::initializer_list<value_type> init,
+            const Compare &c = Compare(), const Allocator &a = Allocator())
+                : map(c, a)
+        {
+                insert(init.begin(), init.end());
+        }
+
+        map(const map &other)
+                : map(other.comp,
+                      value_alloc_traits::select_on_container_copy_construction(
+                              other.get_allocator()))
+        {
+                copy_from(other);
+        }
+
+        map(const map &other, const Allocator &a) : map(other.comp, a)
+        {
+                copy_from(other);
+        }
+
+        map(map &&other) noexcept : comp(other.comp), alloc(std::move(other.alloc))
+        {
+                reset();
+                steal(other);
+        }
+
+        map(map &&other, const Allocator &a) : map(other.comp, a)
+        {
+                if (alloc == other.alloc) {
+                        steal(other);
+                } else {
+                        move_elements(other);
+                }
+        }
+
+        ~map()
+        {
+                clear();
+        }
+
+        map &operator=(const map &other)
+        {
+                if (this == &other) {
+                        return *this;
+                }
+                clear();
+                if constexpr (node_alloc_traits::
+                                      propagate_on_container_copy_assignment::
+                                              value) {
+                        alloc = other.alloc;
+                }
+                comp = other.comp;
+                copy_from(other);
+                return *this;
+        }
+
+        map &operator=(map &&other) noexcept(
+                node_alloc_traits::is_always_equal::value ||
+                node_alloc_traits::propagate_on_container_move_assignment::value)
+        {
+                if (this == &other) {
+                        return *this;
+                }
+                clear();
+                comp = std::move(other.comp);
+                if constexpr (node_alloc_traits::
+                                      propagate_on_container_move_assignment::
+                                              value) {
+                        alloc = std::move(other.alloc);
+                        steal(other);
+                } else {
+                        if (alloc == other.alloc) {
+                                steal(other);
+                        } else { /**< e.g. pmr of different resources */
+                                move_elements(other);
+                        }
+                }
+                return *this;
+        }
+
+        map &operator=(std::initializer_list<value_type> init)
+        {
+                clear();
+                insert(init.begin(), init.end());
+                return *this;
+        }
+
+        allocator_type get_allocator() const
+        {
+                return allocator_type(alloc);
+        }
+        key_compare key_comp() const
+        {
+                return comp;
+        }
+        value_compare value_comp() const
+        {
+                return value_compare(comp);
+        }
+
+        iterator begin() noexcept
+        {
+                return iterator(header.right);
+        }
+        const_iterator begin() const noexcept
+        {
+                return const_iterator(const_cast<detail::node_base *>(header.right));
+        }
+        iterator end() noexcept
+        {
+                return iterator(&header);
+        }
+        const_iterator end() const noexcept
+        {
+                return const_iterator(const_cast<detail::node_base *>(&header));
+        }
+        const_iterator cbegin() const noexcept
+        {
+                return begin();
+        }
+        const_iterator cend() const noexcept
+        {
+                return end();
+        }
+        reverse_iterator rbegin() noexcept
+        {
+                return reverse_iterator(end());
+        }
+        const_reverse_iterator rbegin() const noexcept
+        {
+                return const_reverse_iterator(end());
+        }
+        reverse_iterator rend() noexcept
+        {
+                return reverse_iterator(begin());
+        }
+        const_reverse_iterator rend() const noexcept
+        {
+                return const_reverse_iterator(begin());
+        }
+
+        bool empty() const noexcept
+        {
+                return nr_nodes == 0;
+        }
+        size_type size() const noexcept
+        {
+                return nr_nodes;
+        }
+        size_type max_size() const noexcept
+        {
+                return node_alloc_traits::max_size(alloc);
+        }
+
+        /**
+         * @brief Destroy all values and release the nodes
+         */
+        void clear() noexcept
+        {
+                destroy_subtree(header.left);
+                reset();
+        }
+
+        std::pair<iterator, bool> insert(const value_type &value)
+        {
+                return emplace(value);
+        }
+
+        std::pair<iterator, bool> insert(value_type &&value)
+        {
+                return emplace(std::move(value));
+        }
+
+        template <typename P,
+                  typename = std::enable_if_t<
+                          std::is_constructible<value_type, P &&>::value> >
+        std::pair<iterator, bool> insert(P &&value)
+        {
+                return emplace(std::forward<P>(value));
+        }
+
+        iterator insert(const_iterator hint, const value_type &value)
+        {
+                (void)hint;
+                return emplace(value).first;
+        }
+
+        iterator insert(const_iterator hint, value_type &&value)
+        {
+                (void)hint;
+                return emplace(std::move(value)).first;
+        }
+
+        template <typename InputIt> void insert(InputIt first, InputIt last)
+        {
+                for (; first != last; ++first) {
+                        emplace(*first);
+                }
+        }
+
+        void insert(std::initializer_list<value_type> init)
+        {
+                insert(init.begin(), init.end());
+        }
+
+        /**
+         * @brief Construct the value in the new node and insert it
+         * @details
+         * The key is known only after the construction. So, if the key
+         * already exists then the new node is destroyed.
+         *
+         * @return std::pair<iterator, bool> position of the key and
+         * whether the insertion took place
+         */
+        template <typename... Args>
+        std::pair<iterator, bool> emplace(Args &&... args)
+        {
+                node_type *z = create_node(std::forward<Args>(args)...);
+                std::pair<detail::node_base *, detail::node_base *> pos;
+
+                try {
+                        pos = find_insert_pos(z->valptr()->first);
+                } catch (...) {
+                        destroy_node(z);
+                        throw;
+                }
+
+                if (pos.second == nullptr) {
+                        destroy_node(z);
+                        return { iterator(pos.first), false };
+                }
+                link_node(pos, z);
+                return { iterator(z), true };
+        }
+
+        template <typename... Args>
+        iterator emplace_hint(const_iterator hint, Args &&... args)
+        {
+                (void)hint;
+                return emplace(std::forward<Args>(args)...).first;
+        }
+
+        /**
+         * @brief Construct the mapped value only if the key does not exist
+         */
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(const key_type &key,
+                                              Args &&... args)
+        {
+                return try_emplace_key(key, std::forward<Args>(args)...);
+        }
+
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(key_type &&key, Args &&... args)
+        {
+                return try_emplace_key(std::move(key),
+                                       std::forward<Args>(args)...);
+        }
+
+        template <typename M>
+        std::pair<iterator, bool> insert_or_assign(const key_type &key, M &&obj)
+        {
+                auto ret = try_emplace(key, std::forward<M>(obj));
+                if (!ret.second) {
+                        ret.first->second = std::forward<M>(obj);
+                }
+                return ret;
+        }
+
+        template <typename M>
+        std::pair<iterator, bool> insert_or_assign(key_type &&key, M &&obj)
+        {
+                auto ret = try_emplace(std::move(key), std::forward<M>(obj));
+                if (!ret.second) {
+                        ret.first->second = std::forward<M>(obj);
+                }
+                return ret;
+        }
+
+        T &operator[](const key_type &key)
+        {
+                return try_emplace(key).first->second;
+        }
+
+        T &operator[](key_type &&key)
+        {
+                return try_emplace(std::move(key)).first->second;
+        }
+
+        T &at(const key_type &key)
+        {
+                iterator it = find(key);
+                if (it == end()) {
+                        throw std::out_of_range("rb::map::at");
+                }
+                return it->second;
+        }
+
+        const T &at(const key_type &key) const
+        {
+                const_iterator it = find(key);
+                if (it == end()) {
+                        throw std::out_of_range("rb::map::at");
+                }
+                return it->second;
+        }
+
+        iterator erase(iterator pos)
+        {
+                return erase(const_iterator(pos));
+        }
+
+        iterator erase(const_iterator pos)
+        {
+                detail::node_base *z = pos.cur;
+                iterator next(detail::successor(z));
+
+                detail::erase_and_rebalance(&header, z);
+                destroy_node(static_cast<node_type *>(z));
+                nr_nodes--;
+                return next;
+        }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+                while (first != last) {
+                        first = erase(first);
+                }
+                return iterator(last.cur);
+        }
+
+        size_type erase(const key_type &key)
+        {
+                iterator it = find(key);
+                if (it == end()) {
+                        return 0;
+                }
+                erase(it);
+                return 1;
+        }
+
+        void swap(map &other) noexcept(node_alloc_traits::is_always_equal::value)
+        {
+                using std::swap;
+                detail::node_base *root = header.left;
+                detail::node_base *leftmost = header.right;
+                size_type size = nr_nodes;
+
+                if constexpr (node_alloc_traits::propagate_on_container_swap::
+                                      value) {
+                        swap(alloc, other.alloc);
+                }
+                swap(comp, other.comp);
+                reset();
+                steal(other);
+                if (root) {
+                        other.header.left = root;
+                        other.header.right = leftmost;
+                        other.nr_nodes = size;
+                        root->parent = &other.header;
+                }
+        }
+
+        iterator find(const key_type &key)
+        {
+                detail::node_base *bound = lower_bound_node(key);
+                if (bound == &header || comp(key, key_of(bound))) {
+                        return end();
+                }
+                return iterator(bound);
+        }
+
+        const_iterator find(const key_type &key) const
+        {
+                return const_cast<map *>(this)->find(key);
+        }
+
+        size_type count(const key_type &key) const
+        {
+                return find(key) != end();
+        }
+
+        bool contains(const key_type &key) const
+        {
+                return find(key) != end();
+        }
+
+        iterator lower_bound(const key_type &key)
+        {
+                return iterator(lower_bound_node(key));
+        }
+
+        const_iterator lower_bound(const key_type &key) const
+        {
+                return const_cast<map *>(this)->lower_bound(key);
+        }
+
+        iterator upper_bound(const key_type &key)
+        {
+                return iterator(upper_bound_node(key));
+        }
+
+        const_iterator upper_bound(const key_type &key) const
+        {
+                return const_cast<map *>(this)->upper_bound(key);
+        }
+
+        std::pair<iterator, iterator> equal_range(const key_type &key)
+        {
+                return { lower_bound(key), upper_bound(key) };
+        }
+
+        std::pair<const_iterator, const_iterator>
+        equal_range(const key_type &key) const
+        {
+                return { lower_bound(key), upper_bound(key) };
+        }
+
+#ifdef RB_TREE_DEBUG
+        /**
+         * @brief Check the red-black properties of the whole tree
+         *
+         * @return int black height of the tree. If the tree is broken then
+         * return -1
+         */
+        int verify() const
+        {
+                if (header.left && header.left->color != detail::NODE_COLOR_BLACK) {
+                        return -1;
+                }
+                return verify_subtree(header.left, &header);
+        }
+#endif
+
+    private:
+        static const key_type &key_of(const detail::node_base *node)
+        {
+                return static_cast<const node_type *>(node)->valptr()->first;
+        }
+
+        void reset() noexcept
+        {
+                header.left = nullptr;
+                header.right = &header;
+                header.parent = nullptr;
+                header.color = detail::NODE_COLOR_HEADER;
+                nr_nodes = 0;
+        }
+
+        /**
+         * @brief Take the nodes of the other map (allocators must be equal)
+         */
+        void steal(map &other) noexcept
+        {
+                if (other.header.left == nullptr) {
+                        return;
+                }
+                header.left = other.header.left;
+                header.right = other.header.right;
+                header.left->parent = &header;
+                nr_nodes = other.nr_nodes;
+                other.reset();
+        }
+
+        void move_elements(map &other)
+        {
+                for (auto &value : other) { /**< key is const, so copied */
+                        emplace(std::move(value));
+                }
+                other.clear();
+        }
+
+        template <typename... Args> node_type *create_node(Args &&... args)
+        {
+                node_type *z = node_alloc_traits::allocate(alloc, 1);
+                Allocator value_alloc(alloc);
+
+                ::new (static_cast<void *>(z)) node_type;
+                try {
+                        value_alloc_traits::construct(value_alloc, z->valptr(),
+                                                      std::forward<Args>(args)...);
+                } catch (...) {
+                        z->~node_type();
+                        node_alloc_traits::deallocate(alloc, z, 1);
+                        throw;
+                }
+                return z;
+        }
+
+        void destroy_node(node_type *z) noexcept
+        {
+                Allocator value_alloc(alloc);
+
+                value_alloc_traits::destroy(value_alloc, z->valptr());
+                z->~node_type();
+                node_alloc_traits::deallocate(alloc, z, 1);
+        }
+
+        void destroy_subtree(detail::node_base *node) noexcept
+        {
+                while (node) { /**< recursion only to the right side */
+                        detail::node_base *left = node->left;
+                        destroy_subtree(node->right);
+                        destroy_node(static_cast<node_type *>(node));
+                        node = left;
+                }
+        }
+
+        /**
+         * @brief Clone the subtree with the same shape and colors
+         */
+        detail::node_base *clone_subtree(const detail::node_base *src,
+                                         detail::node_base *parent)
+        {
+                node_type *z;
+
+                if (src == nullptr) {
+                        return nullptr;
+                }
+                z = create_node(*static_cast<const node_type *>(src)->valptr());
+                z->color = src->color;
+                z->parent = parent;
+                z->left = z->right = nullptr;
+                try {
+                        z->left = clone_subtree(src->left, z);
+                        z->right = clone_subtree(src->right, z);
+                } catch (...) {
+                        destroy_subtree(z);
+                        throw;
+                }
+                return z;
+        }
+
+        void copy_from(const map &other)
+        {
+                if (other.header.left == nullptr) {
+                        return;
+                }
+                header.left = clone_subtree(other.header.left, &header);
+                header.right = detail::minimum(header.left);
+                nr_nodes = other.nr_nodes;
+        }
+
+        /**
+         * @brief Find the location where the key is inserted
+         * @details
+         * Only one comparison is done per level. Equality is checked once
+         * with the predecessor of the found location.
+         *
+         * @return pair of (parent, nullptr) if the key exists, the first
+         * has the existing node. Else (parent, parent) or (parent, &header)
+         * which means left or right side of the parent.
+         */
+        std::pair<detail::node_base *, detail::node_base *>
+        find_insert_pos(const key_type &key)
+        {
+                detail::node_base *y = &header;
+                detail::node_base *x = header.left;
+                detail::node_base *j;
+                bool go_left = true;
+
+                while (x) {
+                        y = x;
+                        go_left = comp(key, key_of(x));
+                        x = go_left ? x->left : x->right;
+                }
+
+                j = y;
+                if (go_left) {
+                        if (j == header.right) {
+                                return { y, y };
+                        }
+                        j = detail::predecessor(j);
+                }
+                if (comp(key_of(j), key)) {
+                        return { y, go_left ? y : &header };
+                }
+                return { j, nullptr };
+        }
+
+        void link_node(std::pair<detail::node_base *, detail::node_base *> pos,
+                       node_type *z)
+        {
+                detail::insert_and_rebalance(&header, pos.first, z,
+                                             pos.first == &header ||
+                                                     pos.second == pos.first);
+                nr_nodes++;
+        }
+
+        template <typename K, typename... Args>
+        std::pair<iterator, bool> try_emplace_key(K &&key, Args &&... args)
+        {
+                auto pos = find_insert_pos(key);
+                node_type *z;
+
+                if (pos.second == nullptr) {
+                        return { iterator(pos.first), false };
+                }
+                z = create_node(std::piecewise_construct,
+                                std::forward_as_tuple(std::forward<K>(key)),
+                                std::forward_as_tuple(
+                                        std::forward<Args>(args)...));
+                link_node(pos, z);
+                return { iterator(z), true };
+        }
+
+        detail::node_base *lower_bound_node(const key_type &key)
+        {
+                detail::node_base *x = header.left;
+                detail::node_base *bound = &header;
+
+                while (x) {
+                        if (comp(key_of(x), key)) {
+                                x = x->right;
+                        } else {
+                                bound = x;
+                                x = x->left;
+                        }
+                }
+                return bound;
+        }
+
+        detail::node_base *upper_bound_node(const key_type &key)
+        {
+                detail::node_base *x = header.left;
+                detail::node_base *bound = &header;
+
+                while (x) {
+                        if (comp(key, key_of(x))) {
+                                bound = x;
+                                x = x->left;
+                        } else {
+                                x = x->right;
+                        }
+                }
+                return bound;
+        }
+
+#ifdef RB_TREE_DEBUG
+        int verify_subtree(const detail::node_base *node,
+                           const detail::node_base *parent) const
+        {
+                int left_bh, right_bh;
+
+                if (node == nullptr) {
+                        return 1;
+                }
+                if (node->parent != parent) {
+                        return -1;
+                }
+                if (node->color == detail::NODE_COLOR_RED &&
+                    (!detail::is_black(node->left) ||
+                     !detail::is_black(node->right))) {
+                        return -1;
+                }
+                if ((node->left && !comp(key_of(node->left), key_of(node))) ||
+                    (node->right && !comp(key_of(node), key_of(node->right)))) {
+                        return -1;
+                }
+                left_bh = verify_subtree(node->left, node);
+                right_bh = verify_subtree(node->right, node);
+                if (left_bh < 0 || left_bh != right_bh) {
+                        return -1;
+                }
+                return left_bh + (node->color == detail::NODE_COLOR_BLACK);
+        }
+#endif
+};
+
+template <typename K, typename T, typename C, typename A>
+bool operator==(const map<K, T, C, A> &a, const map<K, T, C, A> &b)
+{
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+template <typename K, typename T, typename C, typename A>
+bool operator!=(const map<K, T, C, A> &a, const map<K, T, C, A> &b)
+{
+        return !(a == b);
+}
+
+template <typename K, typename T, typename C, typename A>
+void swap(map<K, T, C, A> &a, map<K, T, C, A> &b) noexcept(noexcept(a.swap(b)))
+{
+        a.swap(b);
+}
+
+namespace pmr
+{
+/**
+ * @brief `rb::map` which allocates the nodes from the memory resource
+ */
+template <typename Key, typename T, typename Compare = std::less<Key> >
+using map = rb::map<Key, T, Compare,
+                    std::pmr::polymorphic_allocator<std::pair<const Key, T> > >;
+} // namespace pmr
+} // namespace rb
+
+#endif
@@ -0,0 +1,847 @@
+/**
+ * @file rb-pool-tree.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief index linked red black tree in a node pool implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#include <stdlib.h>
+#include "rb-pool-tree.h"
+
+static inline uint32_t rb_pool_parent(const struct rb_pool_node *nodes,
+                                      uint32_t x)
+{
+        return nodes[x].parent & ~RB_POOL_RED;
+}
+
+/**
+ * @brief Change the parent of the node (the color is kept)
+ */
+static inline void rb_pool_set_parent(struct rb_pool_node *nodes, uint32_t x,
+                                      uint32_t parent)
+{
+        nodes[x].parent = (nodes[x].parent & RB_POOL_RED) | parent;
+}
+
+static inline int rb_pool_is_red(const struct rb_pool_node *nodes, uint32_t x)
+{
+        return !!(nodes[x].parent & RB_POOL_RED);
+}
+
+static inline void rb_pool_set_red(struct rb_pool_node *nodes, uint32_t x)
+{
+        nodes[x].parent |= RB_POOL_RED;
+}
+
+static inline void rb_pool_set_black(struct rb_pool_node *nodes, uint32_t x)
+{
+        nodes[x].parent &= ~RB_POOL_RED;
+}
+
+static inline void rb_pool_copy_color(struct rb_pool_node *nodes, uint32_t x,
+                                      uint32_t source)
+{
+        nodes[x].parent = (nodes[x].parent & ~RB_POOL_RED) |
+                          (nodes[source].parent & RB_POOL_RED);
+}
+
+/**
+ * @brief Allocation of the tree which has the Nil only
+ *
+ * @param capacity number of the nodes of the pool (with the Nil)
+ * @return struct rb_pool_tree* allocated tree
+ */
+static struct rb_pool_tree *rb_pool_tree_create(uint32_t capacity)
+{
+        struct rb_pool_tree *pool = (struct rb_pool_tree *)malloc(
+                sizeof(struct rb_pool_tree));
+
+        if (!pool) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+        pool->nodes = (struct rb_pool_node *)malloc(
+                sizeof(struct rb_pool_node) * (size_t)capacity);
+        if (!pool->nodes) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                free(pool);
+                return NULL;
+        }
+        pool->nodes[RB_POOL_NIL].key = 0;
+        pool->nodes[RB_POOL_NIL].left = RB_POOL_NIL;
+        pool->nodes[RB_POOL_NIL].right = RB_POOL_NIL;
+        pool->nodes[RB_POOL_NIL].parent = RB_POOL_NIL; /**< black */
+        pool->data = NULL;
+        pool->root = RB_POOL_NIL;
+        pool->free_list = RB_POOL_NIL;
+        pool->nr_slots = 1;
+        pool->capacity = capacity;
+        pool->nr_keys = 0;
+        return pool;
+}
+
+/**
+ * @brief Allocation of the pool tree
+ *
+ * @return struct rb_pool_tree* allocated tree
+ */
+struct rb_pool_tree *rb_pool_tree_alloc(void)
+{
+        return rb_pool_tree_create(RB_POOL_INIT_NODES);
+}
+
+static int rb_pool_tree_data_alloc(struct rb_pool_tree *pool)
+{
+        pool->data = (void **)calloc(pool->capacity, sizeof(void *));
+        if (!pool->data) {
+                pr_info("Memory allocation failed\n");
+                return -ENOMEM;
+        }
+        return 0;
+}
+
+/**
+ * @brief Double the pool (the indices are kept, so nothing is fixed up)
+ *
+ * @return int 0 means success. Else, the pool is not changed.
+ */
+static int rb_pool_tree_grow(struct rb_pool_tree *pool)
+{
+        struct rb_pool_node *nodes = NULL;
+        uint32_t capacity = pool->capacity * 2;
+        void **data = NULL;
+
+        if (pool->capacity == RB_POOL_MAX_NODES) {
+                pr_info("pool is full (%" PRIu32 " nodes)\n", pool->capacity);
+                return -ENOSPC;
+        }
+        if (pool->capacity > RB_POOL_MAX_NODES / 2) {
+                capacity = RB_POOL_MAX_NODES;
+        }
+        nodes = (struct rb_pool_node *)realloc(
+                pool->nodes, sizeof(struct rb_pool_node) * (size_t)capacity);
+        if (!nodes) {
+                pr_info("Memory allocation failed\n");
+                return -ENOMEM;
+        }
+        pool->nodes = nodes;
+        if (pool->data) {
+                data = (void **)realloc(pool->data,
+                                        sizeof(void *) * (size_t)capacity);
+                if (!data) {
+                        pr_info("Memory allocation failed\n");
+                        return -ENOMEM;
+                }
+                memset(&data[pool->capacity], 0,
+                       sizeof(void *) * (size_t)(capacity - pool->capacity));
+                pool->data = data;
+        }
+        pool->capacity = capacity;
+        return 0;
+}
+
+/**
+ * @brief Take a red node from the free list or the end of the pool
+ * @warning The pool can be moved, so the node pointers are invalid after
+ * this.
+ *
+ * @return uint32_t new node (RB_POOL_NIL means fail)
+ */
+static uint32_t rb_pool_node_alloc(struct rb_pool_tree *pool, key_t key,
+                                   void *data)
+{
+        uint32_t x = pool->free_list;
+
+        if (data && !pool->data && rb_pool_tree_data_alloc(pool)) {
+                return RB_POOL_NIL;
+        }
+        if (x != RB_POOL_NIL) {
+                pool->free_list = pool->nodes[x].left;
+        } else {
+                if (pool->nr_slots == pool->capacity &&
+                    rb_pool_tree_grow(pool)) {
+                        return RB_POOL_NIL;
+                }
+                x = pool->nr_slots++;
+        }
+        pool->nodes[x].key = key;
+        pool->nodes[x].left = pool->nodes[x].right = RB_POOL_NIL;
+        pool->nodes[x].parent = RB_POOL_NIL | RB_POOL_RED;
+        if (pool->data) {
+                pool->data[x] = data;
+        }
+        return x;
+}
+
+/**
+ * @brief Free the data of the node and put the node to the free list
+ */
+static void rb_pool_node_free(struct rb_pool_tree *pool, uint32_t x)
+{
+        if (pool->data) {
+                free(pool->data[x]);
+                pool->data[x] = NULL;
+        }
+        pool->nodes[x].left = pool->free_list;
+        pool->free_list = x;
+}
+
+static void rb_pool_left_rotate(struct rb_pool_tree *pool, uint32_t x)
+{
+        struct rb_pool_node *nodes = pool->nodes;
+        uint32_t y = nodes[x].right, parent = rb_pool_parent(nodes, x);
+
+        nodes[x].right = nodes[y].left;
+        if (nodes[y].left != RB_POOL_NIL) {
+                rb_pool_set_parent(nodes, nodes[y].left, x);
+        }
+        rb_pool_set_parent(nodes, y, parent);
+        if (parent == RB_POOL_NIL) {
+                pool->root = y;
+        } else if (x == nodes[parent].left) {
+                nodes[parent].left = y;
+        } else {
+                nodes[parent].right = y;
+        }
+        nodes[y].left = x;
+        rb_pool_set_parent(nodes, x, y);
+}
+
+static void rb_pool_right_rotate(struct rb_pool_tree *pool, uint32_t x)
+{
+        struct rb_pool_node *nodes = pool->nodes;
+        uint32_t y = nodes[x].left, parent = rb_pool_parent(nodes, x);
+
+        nodes[x].left = nodes[y].right;
+        if (nodes[y].right != RB_POOL_NIL) {
+                rb_pool_set_parent(nodes, nodes[y].right, x);
+        }
+        rb_pool_set_parent(nodes, y, parent);
+        if (parent == RB_POOL_NIL) {
+                pool->root = y;
+        } else if (x == nodes[parent].right) {
+                nodes[parent].right = y;
+        } else {
+                nodes[parent].left = y;
+        }
+        nodes[y].right = x;
+        rb_pool_set_parent(nodes, x, y);
+}
+
+static uint32_t rb_pool_min(const struct rb_pool_tree *pool, uint32_t x)
+{
+        if (x == RB_POOL_NIL) {
+                return x;
+        }
+        while (pool->nodes[x].left != RB_POOL_NIL) {
+                x = pool->nodes[x].left;
+        }
+        return x;
+}
+
+static uint32_t rb_pool_max(const struct rb_pool_tree *pool, uint32_t x)
+{
+        if (x == RB_POOL_NIL) {
+                return x;
+        }
+        while (pool->nodes[x].right != RB_POOL_NIL) {
+                x = pool->nodes[x].right;
+        }
+        return x;
+}
+
+static uint32_t rb_pool_next(const struct rb_pool_tree *pool, uint32_t x)
+{
+        const struct rb_pool_node *nodes = pool->nodes;
+        uint32_t y;
+
+        if (nodes[x].right != RB_POOL_NIL) {
+                return rb_pool_min(pool, nodes[x].right);
+        }
+        y = rb_pool_parent(nodes, x);
+        while (y != RB_POOL_NIL && x == nodes[y].right) {
+                x = y;
+                y = rb_pool_parent(nodes, y);
+        }
+        return y;
+}
+
+static uint32_t rb_pool_find(const struct rb_pool_tree *pool, key_t key)
+{
+        const struct rb_pool_node *nodes = pool->nodes;
+        uint32_t x = pool->root;
+
+        while (x != RB_POOL_NIL && nodes[x].key != key) {
+                x = (key < nodes[x].key) ? nodes[x].left : nodes[x].right;
+        }
+        return x;
+}
+
+/**
+ * @brief Node of the first key which is not less than the key
+ */
+static uint32_t rb_pool_lower(const struct rb_pool_tree *pool, key_t key)
+{
+        const struct rb_pool_node *nodes = pool->nodes;
+        uint32_t x = pool->root, found = RB_POOL_NIL;
+
+        while (x != RB_POOL_NIL) {
+                if (nodes[x].key >= key) {
+                        found = x;
+                        x = nodes[x].left;
+                } else {
+                        x = nodes[x].right;
+                }
+        }
+        return found;
+}
+
+/**
+ * @brief Report the node (RB_POOL_NIL means no entry)
+ */
+static int rb_pool_entry(struct rb_pool_tree *pool, uint32_t x, key_t *key,
+                         void **data)
+{
+        if (x == RB_POOL_NIL) {
+                return -ENODATA;
+        }
+        if (key) {
+                *key = pool->nodes[x].key;
+        }
+        if (data) {
+                *data = pool->data ? pool->data[x] : NULL;
+        }
+        return 0;
+}
+
+/**
+ * @brief Search the key
+ *
+ * @param pool pool tree whole
+ * @param key the key which I want to search
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_pool_tree_search(struct rb_pool_tree *pool, key_t key, void **data)
+{
+        return rb_pool_entry(pool, rb_pool_find(pool, key), NULL, data);
+}
+
+/**
+ * @brief Find the first key which is not less than the key
+ *
+ * @param pool pool tree whole
+ * @param key lower bound key
+ * @param found found key stored location (nullable)
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_pool_tree_lower_bound(struct rb_pool_tree *pool, key_t key,
+                             key_t *found, void **data)
+{
+        return rb_pool_entry(pool, rb_pool_lower(pool, key), found, data);
+}
+
+/**
+ * @brief Find the first key which is greater than the key
+ *
+ * @param pool pool tree whole
+ * @param key base key (it does not need to be in the tree)
+ * @param next found key stored location (nullable)
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_pool_tree_successor(struct rb_pool_tree *pool, key_t key, key_t *next,
+                           void **data)
+{
+        if (key == RB_MAX_KEY) {
+                return -ENODATA;
+        }
+        return rb_pool_tree_lower_bound(pool, key + 1, next, data);
+}
+
+int rb_pool_tree_minimum(struct rb_pool_tree *pool, key_t *key, void **data)
+{
+        return rb_pool_entry(pool, rb_pool_min(pool, pool->root), key, data);
+}
+
+int rb_pool_tree_maximum(struct rb_pool_tree *pool, key_t *key, void **data)
+{
+        return rb_pool_entry(pool, rb_pool_max(pool, pool->root), key, data);
+}
+
+static void rb_pool_insert_fixup(struct rb_pool_tree *pool, uint32_t z)
+{
+        struct rb_pool_node *nodes = pool->nodes;
+        uint32_t parent, grand, uncle;
+
+        while (rb_pool_is_red(nodes, parent = rb_pool_parent(nodes, z))) {
+                grand = rb_pool_parent(nodes, parent);
+                if (parent == nodes[grand].left) {
+                        uncle = nodes[grand].right;
+                        if (rb_pool_is_red(nodes, uncle)) {
+                                rb_pool_set_black(nodes, parent);
+                                rb_pool_set_black(nodes, uncle);
+                                rb_pool_set_red(nodes, grand);
+                                z = grand;
+                                continue;
+                        }
+                        if (z == nodes[parent].right) {
+                                z = parent;
+                                rb_pool_left_rotate(pool, z);
+                                parent = rb_pool_parent(nodes, z);
+                        }
+                        rb_pool_set_black(nodes, parent);
+                        rb_pool_set_red(nodes, grand);
+                        rb_pool_right_rotate(pool, grand);
+                } else {
+                        uncle = nodes[grand].left;
+                        if (rb_pool_is_red(nodes, uncle)) {
+                                rb_pool_set_black(nodes, parent);
+                                rb_pool_set_black(nodes, uncle);
+                                rb_pool_set_red(nodes, grand);
+                                z = grand;
+                                continue;
+                        }
+                        if (z == nodes[parent].left) {
+                                z = parent;
+                                rb_pool_right_rotate(pool, z);
+                                parent = rb_pool_parent(nodes, z);
+                        }
+                        rb_pool_set_black(nodes, parent);
+                        rb_pool_set_red(nodes, grand);
+                        rb_pool_left_rotate(pool, grand);
+                }
+        }
+        rb_pool_set_black(nodes, pool->root);
+}
+
+/**
+ * @brief Insert the key and the data
+ *
+ * @param pool pool tree whole
+ * @param key new key
+ * @param data new data (the data of the same key is freed and updated)
+ * @return int 0 means success. Else, nothing is inserted.
+ */
+int rb_pool_tree_insert(struct rb_pool_tree *pool, key_t key, void *data)
+{
+        struct rb_pool_node *nodes = pool->nodes;
+        uint32_t x = pool->root, y = RB_POOL_NIL, z;
+
+        while (x != RB_POOL_NIL) {
+                if (nodes[x].key == key) { /**< update key's data */
+                        if (data && !pool->data &&
+                            rb_pool_tree_data_alloc(pool)) {
+                                return -ENOMEM;
+                        }
+                        if (pool->data) {
+                                free(pool->data[x]);
+                                pool->data[x] = data;
+                        }
+                        return 0;
+                }
+                y = x;
+                x = (key < nodes[x].key) ? nodes[x].left : nodes[x].right;
+        }
+
+        z = rb_pool_node_alloc(pool, key, data);
+        if (z == RB_POOL_NIL) {
+                return -ENOMEM;
+        }
+        nodes = pool->nodes; /**< the pool can be moved */
+        rb_pool_set_parent(nodes, z, y);
+        if (y == RB_POOL_NIL) {
+                pool->root = z;
+        } else if (key < nodes[y].key) {
+                nodes[y].left = z;
+        } else {
+                nodes[y].right = z;
+        }
+        rb_pool_insert_fixup(pool, z);
+        pool->nr_keys++;
+        return 0;
+}
+
+static void rb_pool_transplant(struct rb_pool_tree *pool, uint32_t u,
+                               uint32_t v)
+{
+        struct rb_pool_node *nodes = pool->nodes;
+        uint32_t parent = rb_pool_parent(nodes, u);
+
+        if (parent == RB_POOL_NIL) {
+                pool->root = v;
+        } else if (u == nodes[parent].left) {
+                nodes[parent].left = v;
+        } else {
+                nodes[parent].right = v;
+        }
+        rb_pool_set_parent(nodes, v, parent); /**< Nil's parent too */
+}
+
+static void rb_pool_delete_fixup(struct rb_pool_tree *pool, uint32_t x)
+{
+        struct rb_pool_node *nodes = pool->nodes;
+        uint32_t parent, w;
+
+        while (x != pool->root && !rb_pool_is_red(nodes, x)) {
+                parent = rb_pool_parent(nodes, x);
+                if (x == nodes[parent].left) {
+                        w = nodes[parent].right;
+                        if (rb_pool_is_red(nodes, w)) {
+                                rb_pool_set_black(nodes, w);
+                                rb_pool_set_red(nodes, parent);
+                                rb_pool_left_rotate(pool, parent);
+                                w = nodes[parent].right;
+                        }
+                        if (!rb_pool_is_red(nodes, nodes[w].left) &&
+                            !rb_pool_is_red(nodes, nodes[w].right)) {
+                                rb_pool_set_red(nodes, w);
+                                x = parent;
+                                continue;
+                        }
+                        if (!rb_pool_is_red(nodes, nodes[w].right)) {
+                                rb_pool_set_black(nodes, nodes[w].left);
+                                rb_pool_set_red(nodes, w);
+                                rb_pool_right_rotate(pool, w);
+                                w = nodes[parent].right;
+                        }
+                        rb_pool_copy_color(nodes, w, parent);
+                        rb_pool_set_black(nodes, parent);
+                        rb_pool_set_black(nodes, nodes[w].right);
+                        rb_pool_left_rotate(pool, parent);
+                        x = pool->root;
+                } else {
+                        w = nodes[parent].left;
+                        if (rb_pool_is_red(nodes, w)) {
+                                rb_pool_set_black(nodes, w);
+                                rb_pool_set_red(nodes, parent);
+                                rb_pool_right_rotate(pool, parent);
+                                w = nodes[parent].left;
+                        }
+                        if (!rb_pool_is_red(nodes, nodes[w].left) &&
+                            !rb_pool_is_red(nodes, nodes[w].right)) {
+                                rb_pool_set_red(nodes, w);
+                                x = parent;
+                                continue;
+                        }
+                        if (!rb_pool_is_red(nodes, nodes[w].left)) {
+                                rb_pool_set_black(nodes, nodes[w].right);
+                                rb_pool_set_red(nodes, w);
+                                rb_pool_left_rotate(pool, w);
+                                w = nodes[parent].left;
+                        }
+                        rb_pool_copy_color(nodes, w, parent);
+                        rb_pool_set_black(nodes, parent);
+                        rb_pool_set_black(nodes, nodes[w].left);
+                        rb_pool_right_rotate(pool, parent);
+                        x = pool->root;
+                }
+        }
+        rb_pool_set_black(nodes, x);
+}
+
+/**
+ * @brief Delete the key
+ *
+ * @param pool pool tree whole
+ * @param key delete target key
+ * @return int 0 means that delete success. -ENODATA means not found.
+ */
+int rb_pool_tree_delete(struct rb_pool_tree *pool, key_t key)
+{
+        struct rb_pool_node *nodes = pool->nodes;
+        uint32_t z = rb_pool_find(pool, key), y = z, x;
+        int y_red = rb_pool_is_red(nodes, y);
+
+        if (z == RB_POOL_NIL) {
+                return -ENODATA;
+        }
+        if (nodes[z].left == RB_POOL_NIL) {
+                x = nodes[z].right;
+                rb_pool_transplant(pool, z, x);
+        } else if (nodes[z].right == RB_POOL_NIL) {
+                x = nodes[z].left;
+                rb_pool_transplant(pool, z, x);
+        } else {
+                y = rb_pool_min(pool, nodes[z].right);
+                y_red = rb_pool_is_red(nodes, y);
+                x = nodes[y].right;
+                if (rb_pool_parent(nodes, y) == z) {
+                        rb_pool_set_parent(nodes, x, y);
+                } else {
+                        rb_pool_transplant(pool, y, x);
+                        nodes[y].right = nodes[z].right;
+                        rb_pool_set_parent(nodes, nodes[y].right, y);
+                }
+                rb_pool_transplant(pool, z, y);
+                nodes[y].left = nodes[z].left;
+                rb_pool_set_parent(nodes, nodes[y].left, y);
+                rb_pool_copy_color(nodes, y, z);
+        }
+        if (!y_red) {
+                rb_pool_delete_fixup(pool, x);
+        }
+        rb_pool_node_free(pool, z);
+        pool->nr_keys--;
+        return 0;
+}
+
+/**
+ * @brief Visit the keys in [first, last] in the key order
+ *
+ * @param pool pool tree whole
+ * @param first first key of the range
+ * @param last last key of the range (inclusive)
+ * @param fn visitor
+ * @param arg user argument
+ * @return int 0 means that every key is visited. Else, the visitor's
+ * return value which stopped the scan.
+ */
+int rb_pool_tree_for_each(struct rb_pool_tree *pool, key_t first, key_t last,
+                          rb_pool_fn fn, void *arg)
+{
+        uint32_t x = rb_pool_lower(pool, first);
+        int ret;
+
+        for (; x != RB_POOL_NIL && pool->nodes[x].key <= last;
+             x = rb_pool_next(pool, x)) {
+                ret = fn(pool->nodes[x].key, pool->data ? pool->data[x] : NULL,
+                         arg);
+                if (ret) {
+                        return ret;
+                }
+        }
+        return 0;
+}
+
+/**
+ * @brief Copy the keys and the data in the key order
+ */
+static void rb_pool_tree_gather(struct rb_pool_tree *pool, key_t *keys,
+                                void **data)
+{
+        uint32_t x = rb_pool_min(pool, pool->root);
+        size_t i = 0;
+
+        for (; x != RB_POOL_NIL; x = rb_pool_next(pool, x), i++) {
+                keys[i] = pool->nodes[x].key;
+                data[i] = pool->data ? pool->data[x] : NULL;
+        }
+}
+
+/**
+ * @brief Link nodes[lo + 1] ... nodes[hi] as a balanced subtree
+ * @details
+ * The halves differ by one node at most, so every Nil is at the same
+ * depth or one more. Then, the nodes at the deepest depth are red and the
+ * others are black.
+ *
+ * @return uint32_t root of the subtree
+ */
+static uint32_t rb_pool_tree_place(struct rb_pool_node *nodes, size_t lo,
+                                   size_t hi, unsigned int depth,
+                                   unsigned int red_depth)
+{
+        size_t mid = lo + (hi - lo) / 2;
+        uint32_t x = (uint32_t)mid + 1;
+
+        if (lo == hi) {
+                return RB_POOL_NIL;
+        }
+        nodes[x].left = rb_pool_tree_place(nodes, lo, mid, depth + 1,
+                                           red_depth);
+        nodes[x].right = rb_pool_tree_place(nodes, mid + 1, hi, depth + 1,
+                                            red_depth);
+        nodes[x].parent = (depth == red_depth) ? RB_POOL_RED : RB_POOL_NIL;
+        if (nodes[x].left != RB_POOL_NIL) {
+                rb_pool_set_parent(nodes, nodes[x].left, x);
+        }
+        if (nodes[x].right != RB_POOL_NIL) {
+                rb_pool_set_parent(nodes, nodes[x].right, x);
+        }
+        return x;
+}
+
+/**
+ * @brief Build the tree of the sorted keys in O(n)
+ * @details
+ * The node of the i-th key is nodes[i + 1]. So, the in-order walk of the
+ * new tree reads the pool sequentially.
+ *
+ * @return struct rb_pool_tree* new tree which owns the data (NULL means fail)
+ */
+static struct rb_pool_tree *rb_pool_tree_build(const key_t *keys,
+                                               void *const *data,
+                                               size_t nr_keys)
+{
+        struct rb_pool_tree *pool = NULL;
+        unsigned int red_depth = 0;
+        size_t i;
+
+        pool = rb_pool_tree_create(nr_keys + 1 > RB_POOL_INIT_NODES ?
+                                           (uint32_t)nr_keys + 1 :
+                                           RB_POOL_INIT_NODES);
+        if (!pool) {
+                return NULL;
+        }
+        for (i = 0; i < nr_keys; i++) {
+                pool->nodes[i + 1].key = keys[i];
+                if (data[i] && !pool->data && rb_pool_tree_data_alloc(pool)) {
+                        free(pool->nodes);
+                        free(pool);
+                        return NULL;
+                }
+                if (pool->data) {
+                        pool->data[i + 1] = data[i];
+                }
+        }
+        while (((size_t)2 << red_depth) - 1 < nr_keys) {
+                red_depth++; /**< depth of the deepest node */
+        }
+        pool->nr_slots = (uint32_t)nr_keys + 1;
+        pool->nr_keys = nr_keys;
+        pool->root = rb_pool_tree_place(pool->nodes, 0, nr_keys, 0, red_depth);
+        rb_pool_set_black(pool->nodes, pool->root);
+        return pool;
+}
+
+/**
+ * @brief Free the pool without its data (the data is moved)
+ */
+static void rb_pool_tree_release(struct rb_pool_tree *pool)
+{
+        if (!pool) {
+                return;
+        }
+        free(pool->nodes);
+        free(pool->data);
+        free(pool);
+}
+
+/**
+ * @brief Split tree to t1, t2 based on key value x
+ * @details
+ * Both halves are built again in the key order, so it takes O(n) and the
+ * nodes of the results are compacted.
+ *
+ * @param pool split target tree (freed after the split)
+ * @param x split point (the keys less than or equal to x go to t1)
+ * @param t1 t1 stored location
+ * @param t2 t2 stored location
+ * @return int 0 means success. Else, the keys are not moved.
+ */
+int rb_pool_tree_split(struct rb_pool_tree *pool, key_t x,
+                       struct rb_pool_tree **t1, struct rb_pool_tree **t2)
+{
+        size_t nr_keys = pool->nr_keys, pos = 0;
+        key_t *keys = (key_t *)malloc(sizeof(key_t) * (nr_keys + 1));
+        void **data = (void **)malloc(sizeof(void *) * (nr_keys + 1));
+        struct rb_pool_tree *lower = NULL, *upper = NULL;
+
+        if (!keys || !data) {
+                pr_info("Memory allocation failed\n");
+                goto exception;
+        }
+        rb_pool_tree_gather(pool, keys, data);
+        while (pos < nr_keys && keys[pos] <= x) {
+                pos++;
+        }
+        lower = rb_pool_tree_build(keys, data, pos);
+        upper = rb_pool_tree_build(&keys[pos], &data[pos], nr_keys - pos);
+        if (!lower || !upper) {
+                goto exception;
+        }
+        rb_pool_tree_release(pool);
+        free(keys);
+        free(data);
+
+        *t1 = lower;
+        *t2 = upper;
+        return 0;
+exception:
+        rb_pool_tree_release(lower);
+        rb_pool_tree_release(upper);
+        free(keys);
+        free(data);
+        return -ENOMEM;
+}
+
+/**
+ * @brief Concatenate two trees (every key of t1 is less than t2's)
+ *
+ * @param t1 tree which has the smaller keys (freed)
+ * @param t2 tree which has the greater keys (freed)
+ * @return struct rb_pool_tree* concatenated tree. NULL means that t1 and t2
+ * are not changed.
+ */
+struct rb_pool_tree *rb_pool_tree_concat(struct rb_pool_tree *t1,
+                                         struct rb_pool_tree *t2)
+{
+        size_t nr_keys = t1->nr_keys + t2->nr_keys;
+        struct rb_pool_tree *pool = NULL;
+        key_t *keys = NULL;
+        void **data = NULL;
+        key_t max, min;
+
+        if (rb_pool_tree_minimum(t2, &min, NULL)) {
+                rb_pool_tree_dealloc(t2);
+                return t1;
+        }
+        if (rb_pool_tree_maximum(t1, &max, NULL) == 0 && max >= min) {
+                pr_info("invalid state key state t1.max < t2.min\n");
+                return NULL;
+        }
+        keys = (key_t *)malloc(sizeof(key_t) * nr_keys);
+        data = (void **)malloc(sizeof(void *) * nr_keys);
+        if (!keys || !data) {
+                pr_info("Memory allocation failed\n");
+                goto out;
+        }
+        rb_pool_tree_gather(t1, keys, data);
+        rb_pool_tree_gather(t2, &keys[t1->nr_keys], &data[t1->nr_keys]);
+        pool = rb_pool_tree_build(keys, data, nr_keys);
+        if (pool) {
+                rb_pool_tree_release(t1);
+                rb_pool_tree_release(t2);
+        }
+out:
+        free(keys);
+        free(data);
+        return pool;
+}
+
+/**
+ * @brief Bytes of the pool
+ *
+ * @param pool pool tree whole
+ * @return size_t bytes which the tree allocates (without the data)
+ */
+size_t rb_pool_tree_bytes(struct rb_pool_tree *pool)
+{
+        size_t bytes = sizeof(struct rb_pool_tree) +
+                       (size_t)pool->capacity * sizeof(struct rb_pool_node);
+
+        if (pool->data) {
+                bytes += (size_t)pool->capacity * sizeof(void *);
+        }
+        return bytes;
+}
+
+/**
+ * @brief Does deallocation of the pool tree with its data
+ *
+ * @param pool pool tree whole
+ */
+void rb_pool_tree_dealloc(struct rb_pool_tree *pool)
+{
+        if (pool->data) {
+                for (uint32_t i = 1; i < pool->nr_slots; i++) {
+                        free(pool->data[i]); /**< NULL if it is freed */
+                }
+        }
+        rb_pool_tree_release(pool);
+}
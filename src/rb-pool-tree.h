@@ -0,0 +1,86 @@
+/**
+ * @file rb-pool-tree.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief index linked red black tree in a node pool's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @ref Cormen, T. H., Leiserson, C. E., Rivest, R. L., & Stein, C. (2009). Introduction to algorithms. MIT press.
+ *
+ * @details
+ * The nodes live in one growable array and link each other by 32-bit
+ * indices. Index 0 is the Nil of the tree and the top bit of `parent` is
+ * the color. So, a node is 24 bytes and the pool has no pointer in it: it
+ * can be moved by realloc (or memcpy) and written out as it is.
+ *
+ * The data is kept in a parallel array which is allocated by the first
+ * insert of non-NULL data. So, key-only trees pay nothing for it. The
+ * keys are unique and, like `struct rb_tree`, the tree owns the data: it
+ * is freed by delete, by the update of the same key and by dealloc.
+ */
+#ifndef RB_POOL_TREE_H_
+#define RB_POOL_TREE_H_
+
+#include "rb-tree.h"
+
+#define RB_POOL_NIL (0U) /**< same as Nil in CLRS books */
+#define RB_POOL_RED (UINT32_C(1) << 31) /**< color bit of parent */
+#define RB_POOL_MAX_NODES (RB_POOL_RED - 1) /**< with the Nil */
+#define RB_POOL_INIT_NODES (16)
+
+/**
+ * @brief Node of the pool
+ *
+ */
+struct rb_pool_node {
+        key_t key;
+        uint32_t left, right; /**< left is the next free node if freed */
+        uint32_t parent; /**< RB_POOL_RED bit is the color */
+};
+
+/**
+ * @brief Red-black tree in a node pool
+ *
+ */
+struct rb_pool_tree {
+        struct rb_pool_node *nodes;
+        void **data; /**< data of nodes[i] (NULL while every data is NULL) */
+        uint32_t root;
+        uint32_t free_list; /**< freed nodes (linked by left) */
+        uint32_t nr_slots; /**< used slots with the freed ones */
+        uint32_t capacity;
+        size_t nr_keys;
+};
+
+/**
+ * @brief Visitor of the range scan
+ *
+ * @param key visited key
+ * @param data data of the key
+ * @param arg user argument
+ * @return int 0 means continue. Not 0 stops the scan.
+ */
+typedef int (*rb_pool_fn)(key_t key, void *data, void *arg);
+
+struct rb_pool_tree *rb_pool_tree_alloc(void);
+int rb_pool_tree_search(struct rb_pool_tree *pool, key_t key, void **data);
+int rb_pool_tree_lower_bound(struct rb_pool_tree *pool, key_t key,
+                             key_t *found, void **data);
+int rb_pool_tree_successor(struct rb_pool_tree *pool, key_t key, key_t *next,
+                           void **data);
+int rb_pool_tree_minimum(struct rb_pool_tree *pool, key_t *key, void **data);
+int rb_pool_tree_maximum(struct rb_pool_tree *pool, key_t *key, void **data);
+int rb_pool_tree_insert(struct rb_pool_tree *pool, key_t key, void *data);
+int rb_pool_tree_delete(struct rb_pool_tree *pool, key_t key);
+int rb_pool_tree_for_each(struct rb_pool_tree *pool, key_t first, key_t last,
+                          rb_pool_fn fn, void *arg);
+int rb_pool_tree_split(struct rb_pool_tree *pool, key_t x,
+                       struct rb_pool_tree **t1, struct rb_pool_tree **t2);
+struct rb_pool_tree *rb_pool_tree_concat(struct rb_pool_tree *t1,
+                                         struct rb_pool_tree *t2);
+size_t rb_pool_tree_bytes(struct rb_pool_tree *pool);
+void rb_pool_tree_dealloc(struct rb_pool_tree *pool);
+
+#endif
@@ -0,0 +1,602 @@
+/**
+ * @file rb-ptree.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief persistent (path-copying) red black tree implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include "rb-ptree.h"
+
+#define RB_PTREE_MAX_SPARE (2 * RB_PTREE_MAX_HEIGHT)
+
+static inline int rb_pnode_is_red(const struct rb_pnode *node)
+{
+        return node && node->color == RB_NODE_COLOR_RED;
+}
+
+static inline void rb_pnode_get(struct rb_pnode *node)
+{
+        if (node) {
+                atomic_fetch_add_explicit(&node->refcount, 1,
+                                          memory_order_relaxed);
+        }
+}
+
+/**
+ * @brief Drop the reference and free the nodes which nobody points
+ *
+ * @param node released node (nullable)
+ */
+static void rb_pnode_put(struct rb_pnode *node)
+{
+        struct rb_pnode *right = NULL;
+
+        while (node) {
+                if (atomic_fetch_sub_explicit(&node->refcount, 1,
+                                              memory_order_acq_rel) != 1) {
+                        return;
+                }
+                right = node->right;
+                rb_pnode_put(node->left); /**< recursion depth <= height */
+                free(node);
+                node = right;
+        }
+}
+
+/**
+ * @brief Fill the spare nodes of the version
+ * @details
+ * Every allocation of insert and delete is reserved before the tree is
+ * changed. So, the allocation failure never leaves a half-fixed tree.
+ *
+ * @param ptree version of the tree
+ * @param nr_nodes number of the required spare nodes
+ * @return int 0 means success. -ENOMEM means allocation failed.
+ */
+static int rb_ptree_reserve(struct rb_ptree *ptree, size_t nr_nodes)
+{
+        struct rb_pnode *node = NULL;
+
+        while (ptree->nr_spare < nr_nodes) {
+                node = (struct rb_pnode *)malloc(sizeof(struct rb_pnode));
+                if (!node) {
+                        pr_info("Memory allocation failed\n");
+                        return -ENOMEM;
+                }
+                node->left = ptree->spare;
+                ptree->spare = node;
+                ptree->nr_spare++;
+        }
+        return 0;
+}
+
+/**
+ * @brief Upper bound of the number of the allocations in insert and delete
+ * @details
+ * The height is at most 2 * log2(n + 1). Each operation copies the path
+ * and the siblings which the fixup changes.
+ *
+ * @param ptree version of the tree
+ * @return size_t required spare nodes
+ */
+static size_t rb_ptree_nr_required(struct rb_ptree *ptree)
+{
+        size_t height = 0;
+
+        for (size_t n = ptree->nr_nodes + 1; n; n >>= 1) {
+                height += 2;
+        }
+        return 2 * height + 4;
+}
+
+static struct rb_pnode *rb_ptree_node_alloc(struct rb_ptree *ptree)
+{
+        struct rb_pnode *node = ptree->spare;
+
+        ptree->spare = node->left;
+        ptree->nr_spare--;
+        atomic_init(&node->refcount, 1);
+        return node;
+}
+
+static void rb_ptree_node_free(struct rb_ptree *ptree, struct rb_pnode *node)
+{
+        if (ptree->nr_spare >= RB_PTREE_MAX_SPARE) {
+                free(node);
+                return;
+        }
+        node->left = ptree->spare;
+        ptree->spare = node;
+        ptree->nr_spare++;
+}
+
+/**
+ * @brief Make the node of the slot owned only by this version
+ * @details
+ * The slot must be the root of the version or the child pointer of
+ * a node which is already unique. If other versions share the node, it is
+ * copied and the slot points the copy. Else, it is returned as it is.
+ *
+ * @param ptree version of the tree
+ * @param slot the pointer which points the node
+ * @return struct rb_pnode* node which can be modified in place
+ */
+static struct rb_pnode *rb_ptree_unique(struct rb_ptree *ptree,
+                                        struct rb_pnode **slot)
+{
+        struct rb_pnode *node = *slot;
+        struct rb_pnode *copy = NULL;
+
+        if (atomic_load_explicit(&node->refcount, memory_order_acquire) == 1) {
+                return node;
+        }
+
+        copy = rb_ptree_node_alloc(ptree);
+        copy->key = node->key;
+        copy->data = node->data;
+        copy->left = node->left;
+        copy->right = node->right;
+        copy->color = node->color;
+        rb_pnode_get(copy->left);
+        rb_pnode_get(copy->right);
+
+        *slot = copy;
+        rb_pnode_put(node); /**< other versions still hold the node */
+        return copy;
+}
+
+/**
+ * @brief Get the slot which points the i-th node of the path
+ *
+ * @param ptree version of the tree
+ * @param path nodes from the root
+ * @param i index of the node in the path
+ * @return struct rb_pnode** the root or the child pointer of the parent
+ */
+static struct rb_pnode **rb_ptree_slot(struct rb_ptree *ptree,
+                                       struct rb_pnode **path, int i)
+{
+        if (i == 0) {
+                return &ptree->root;
+        }
+        return path[i - 1]->left == path[i] ? &path[i - 1]->left :
+                                              &path[i - 1]->right;
+}
+
+/**
+ * @brief Left rotation of the unique nodes (see `rb_tree_left_rotate`)
+ *
+ * @param slot the pointer which points the subtree's root
+ */
+static void rb_pnode_left_rotate(struct rb_pnode **slot)
+{
+        struct rb_pnode *x = *slot;
+        struct rb_pnode *y = x->right;
+
+        x->right = y->left;
+        y->left = x;
+        *slot = y;
+}
+
+static void rb_pnode_right_rotate(struct rb_pnode **slot)
+{
+        struct rb_pnode *y = *slot;
+        struct rb_pnode *x = y->left;
+
+        y->left = x->right;
+        x->right = y;
+        *slot = x;
+}
+
+/**
+ * @brief Allocation of the empty version
+ *
+ * @return struct rb_ptree* allocated version
+ */
+struct rb_ptree *rb_ptree_alloc(void)
+{
+        struct rb_ptree *ptree = NULL;
+
+        ptree = (struct rb_ptree *)malloc(sizeof(struct rb_ptree));
+        if (!ptree) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+
+        ptree->root = NULL;
+        ptree->nr_nodes = 0;
+        ptree->spare = NULL;
+        ptree->nr_spare = 0;
+        if (pthread_mutex_init(&ptree->lock, NULL)) {
+                pr_info("lock initialization failed\n");
+                free(ptree);
+                return NULL;
+        }
+
+        return ptree;
+}
+
+/**
+ * @brief Take the point-in-time version of the tree in O(1)
+ * @details
+ * The snapshot shares every node with the original. Both can be changed
+ * independently after this (the shared path is copied at that time).
+ *
+ * @param ptree source version
+ * @return struct rb_ptree* new version (NULL means allocation failed)
+ */
+struct rb_ptree *rb_ptree_snapshot(struct rb_ptree *ptree)
+{
+        struct rb_ptree *snapshot = rb_ptree_alloc();
+        if (!snapshot) {
+                return NULL;
+        }
+
+        pthread_mutex_lock(&ptree->lock);
+        snapshot->root = ptree->root;
+        snapshot->nr_nodes = ptree->nr_nodes;
+        rb_pnode_get(snapshot->root);
+        pthread_mutex_unlock(&ptree->lock);
+
+        return snapshot;
+}
+
+/**
+ * @brief Search the node which has the key
+ *
+ * @param ptree version of the tree
+ * @param key the key which I want to search
+ * @return const struct rb_pnode* found node (NULL means not found)
+ */
+const struct rb_pnode *rb_ptree_search(struct rb_ptree *ptree, key_t key)
+{
+        const struct rb_pnode *node = ptree->root;
+
+        while (node && node->key != key) {
+                node = key < node->key ? node->left : node->right;
+        }
+        return node;
+}
+
+/**
+ * @brief Visit the nodes in [first, last] by the key order
+ *
+ * @param ptree version of the tree
+ * @param first first key of the range
+ * @param last last key of the range (inclusive)
+ * @param fn visitor
+ * @param arg user argument
+ * @return int 0 means that every node is visited. Else, the visitor's
+ * return value which stopped the iteration.
+ */
+int rb_ptree_for_each(struct rb_ptree *ptree, key_t first, key_t last,
+                      rb_pnode_visit_fn fn, void *arg)
+{
+        const struct rb_pnode *stack[RB_PTREE_MAX_HEIGHT];
+        const struct rb_pnode *node = ptree->root;
+        int top = 0;
+        int ret = 0;
+
+        while (node) { /**< ancestors which are greater than or equal to first */
+                if (node->key >= first) {
+                        stack[top++] = node;
+                        node = node->left;
+                } else {
+                        node = node->right;
+                }
+        }
+
+        while (top > 0) {
+                node = stack[--top];
+                if (node->key > last) {
+                        break;
+                }
+                ret = fn(node, arg);
+                if (ret) {
+                        break;
+                }
+                for (node = node->right; node; node = node->left) {
+                        stack[top++] = node;
+                }
+        }
+
+        return ret;
+}
+
+/**
+ * @brief Restore the red-black properties after insertion
+ * @details
+ * Same as `rb_tree_insert_fixup` but the parents come from the path.
+ * Every node in the path is unique. The uncle is made unique before
+ * recoloring.
+ *
+ * @param ptree version of the tree
+ * @param path ancestors of z from the root
+ * @param depth number of the ancestors
+ * @param z inserted node
+ */
+static void rb_ptree_insert_fixup(struct rb_ptree *ptree,
+                                  struct rb_pnode **path, int depth,
+                                  struct rb_pnode *z)
+{
+        struct rb_pnode *p = NULL;
+        struct rb_pnode *g = NULL;
+        struct rb_pnode *u = NULL;
+
+        while (depth > 0 && path[depth - 1]->color == RB_NODE_COLOR_RED) {
+                p = path[depth - 1];
+                g = path[depth - 2]; /**< red node is never the root */
+                if (p == g->left) {
+                        if (rb_pnode_is_red(g->right)) {
+                                u = rb_ptree_unique(ptree, &g->right);
+                                p->color = RB_NODE_COLOR_BLACK;
+                                u->color = RB_NODE_COLOR_BLACK;
+                                g->color = RB_NODE_COLOR_RED;
+                                z = g;
+                                depth -= 2;
+                                continue;
+                        }
+                        if (z == p->right) {
+                                rb_pnode_left_rotate(&g->left);
+                                p = z;
+                        }
+                        p->color = RB_NODE_COLOR_BLACK;
+                        g->color = RB_NODE_COLOR_RED;
+                        rb_pnode_right_rotate(
+                                rb_ptree_slot(ptree, path, depth - 2));
+                } else { /**< symmetric of previous sequence */
+                        if (rb_pnode_is_red(g->left)) {
+                                u = rb_ptree_unique(ptree, &g->left);
+                                p->color = RB_NODE_COLOR_BLACK;
+                                u->color = RB_NODE_COLOR_BLACK;
+                                g->color = RB_NODE_COLOR_RED;
+                                z = g;
+                                depth -= 2;
+                                continue;
+                        }
+                        if (z == p->left) {
+                                rb_pnode_right_rotate(&g->right);
+                                p = z;
+                        }
+                        p->color = RB_NODE_COLOR_BLACK;
+                        g->color = RB_NODE_COLOR_RED;
+                        rb_pnode_left_rotate(
+                                rb_ptree_slot(ptree, path, depth - 2));
+                }
+                break;
+        }
+        ptree->root->color = RB_NODE_COLOR_BLACK; /**< root is unique */
+}
+
+/**
+ * @brief Insert the key to the version (the data is updated if it exists)
+ *
+ * @param ptree version of the tree
+ * @param key inserted key
+ * @param data data of the key (not freed by the tree)
+ * @return int 0 means success. -ENOMEM means the version is not changed.
+ */
+int rb_ptree_insert(struct rb_ptree *ptree, key_t key, void *data)
+{
+        struct rb_pnode *path[RB_PTREE_MAX_HEIGHT];
+        struct rb_pnode **slot = &ptree->root;
+        struct rb_pnode *node = NULL;
+        int depth = 0;
+        int ret = 0;
+
+        pthread_mutex_lock(&ptree->lock);
+        ret = rb_ptree_reserve(ptree, rb_ptree_nr_required(ptree));
+        if (ret) {
+                goto out;
+        }
+
+        while (*slot) {
+                node = rb_ptree_unique(ptree, slot);
+                if (key == node->key) {
+                        node->data = data;
+                        goto out;
+                }
+                path[depth++] = node;
+                slot = key < node->key ? &node->left : &node->right;
+        }
+
+        node = rb_ptree_node_alloc(ptree);
+        node->key = key;
+        node->data = data;
+        node->left = node->right = NULL;
+        node->color = RB_NODE_COLOR_RED;
+        *slot = node;
+        ptree->nr_nodes++;
+
+        rb_ptree_insert_fixup(ptree, path, depth, node);
+out:
+        pthread_mutex_unlock(&ptree->lock);
+        return ret;
+}
+
+/**
+ * @brief Restore the red-black properties after the black leaf is removed
+ * @details
+ * Same as `rb_tree_delete_fixup` but the parents come from the path. The
+ * sibling and its children are made unique before they are changed.
+ *
+ * @param ptree version of the tree
+ * @param path ancestors of the removed leaf from the root
+ * @param depth number of the ancestors
+ * @param is_left the removed leaf was the left child of path[depth - 1]
+ */
+static void rb_ptree_delete_fixup(struct rb_ptree *ptree,
+                                  struct rb_pnode **path, int depth,
+                                  int is_left)
+{
+        struct rb_pnode *x = NULL; /**< NULL means the removed leaf */
+        struct rb_pnode *p = NULL;
+        struct rb_pnode *w = NULL;
+
+        while (depth > 0 && !rb_pnode_is_red(x)) {
+                p = path[depth - 1];
+                if (is_left) {
+                        w = rb_ptree_unique(ptree, &p->right);
+                        if (w->color == RB_NODE_COLOR_RED) {
+                                w->color = RB_NODE_COLOR_BLACK;
+                                p->color = RB_NODE_COLOR_RED;
+                                rb_pnode_left_rotate(
+                                        rb_ptree_slot(ptree, path, depth - 1));
+                                path[depth - 1] = w;
+                                path[depth++] = p;
+                                w = rb_ptree_unique(ptree, &p->right);
+                        }
+                        if (!rb_pnode_is_red(w->left) &&
+                            !rb_pnode_is_red(w->right)) {
+                                w->color = RB_NODE_COLOR_RED;
+                                x = p;
+                                depth--;
+                                is_left = depth > 0 && path[depth - 1]->left == x;
+                                continue;
+                        }
+                        if (!rb_pnode_is_red(w->right)) {
+                                rb_ptree_unique(ptree, &w->left)->color =
+                                        RB_NODE_COLOR_BLACK;
+                                w->color = RB_NODE_COLOR_RED;
+                                rb_pnode_right_rotate(&p->right);
+                                w = p->right;
+                        }
+                        w->color = p->color;
+                        p->color = RB_NODE_COLOR_BLACK;
+                        rb_ptree_unique(ptree, &w->right)->color =
+                                RB_NODE_COLOR_BLACK;
+                        rb_pnode_left_rotate(
+                                rb_ptree_slot(ptree, path, depth - 1));
+                } else { /**< symmetric of previous sequence */
+                        w = rb_ptree_unique(ptree, &p->left);
+                        if (w->color == RB_NODE_COLOR_RED) {
+                                w->color = RB_NODE_COLOR_BLACK;
+                                p->color = RB_NODE_COLOR_RED;
+                                rb_pnode_right_rotate(
+                                        rb_ptree_slot(ptree, path, depth - 1));
+                                path[depth - 1] = w;
+                                path[depth++] = p;
+                                w = rb_ptree_unique(ptree, &p->left);
+                        }
+                        if (!rb_pnode_is_red(w->left) &&
+                            !rb_pnode_is_red(w->right)) {
+                                w->color = RB_NODE_COLOR_RED;
+                                x = p;
+                                depth--;
+                                is_left = depth > 0 && path[depth - 1]->left == x;
+                                continue;
+                        }
+                        if (!rb_pnode_is_red(w->left)) {
+                                rb_ptree_unique(ptree, &w->right)->color =
+                                        RB_NODE_COLOR_BLACK;
+                                w->color = RB_NODE_COLOR_RED;
+                                rb_pnode_left_rotate(&p->left);
+                                w = p->left;
+                        }
+                        w->color = p->color;
+                        p->color = RB_NODE_COLOR_BLACK;
+                        rb_ptree_unique(ptree, &w->left)->color =
+                                RB_NODE_COLOR_BLACK;
+                        rb_pnode_right_rotate(
+                                rb_ptree_slot(ptree, path, depth - 1));
+                }
+                return;
+        }
+
+        if (x) { /**< x is in the path, so it is unique */
+                x->color = RB_NODE_COLOR_BLACK;
+        }
+}
+
+/**
+ * @brief Delete the key from the version
+ *
+ * @param ptree version of the tree
+ * @param key deleted key
+ * @return int 0 means success. -ENODATA means not found. -ENOMEM means
+ * the version is not changed.
+ */
+int rb_ptree_delete(struct rb_ptree *ptree, key_t key)
+{
+        struct rb_pnode *path[RB_PTREE_MAX_HEIGHT];
+        struct rb_pnode **slot = &ptree->root;
+        struct rb_pnode *node = NULL;
+        struct rb_pnode *z = NULL;
+        struct rb_pnode *x = NULL;
+        int depth = 0;
+        int is_left = 0;
+        int ret = 0;
+
+        pthread_mutex_lock(&ptree->lock);
+        if (!rb_ptree_search(ptree, key)) {
+                ret = -ENODATA;
+                goto out;
+        }
+        ret = rb_ptree_reserve(ptree, rb_ptree_nr_required(ptree));
+        if (ret) {
+                goto out;
+        }
+
+        for (z = rb_ptree_unique(ptree, slot); z->key != key;
+             z = rb_ptree_unique(ptree, slot)) {
+                path[depth++] = z;
+                slot = key < z->key ? &z->left : &z->right;
+        }
+
+        if (z->left && z->right) { /**< z gets the successor's contents */
+                path[depth++] = z;
+                slot = &z->right;
+                for (node = rb_ptree_unique(ptree, slot); node->left;
+                     node = rb_ptree_unique(ptree, slot)) {
+                        path[depth++] = node;
+                        slot = &node->left;
+                }
+                z->key = node->key;
+                z->data = node->data;
+                z = node;
+        }
+
+        x = z->left ? z->left : z->right; /**< parent's reference moves to x */
+        is_left = depth > 0 && slot == &path[depth - 1]->left;
+        *slot = x;
+        ptree->nr_nodes--;
+
+        if (z->color == RB_NODE_COLOR_BLACK) {
+                if (x) { /**< the only child of a black node is red */
+                        rb_ptree_unique(ptree, slot)->color =
+                                RB_NODE_COLOR_BLACK;
+                } else {
+                        rb_ptree_delete_fixup(ptree, path, depth, is_left);
+                }
+        }
+        rb_ptree_node_free(ptree, z);
+out:
+        pthread_mutex_unlock(&ptree->lock);
+        return ret;
+}
+
+/**
+ * @brief Does deallocation of the version
+ * @details
+ * The nodes which other versions share are not freed.
+ *
+ * @param ptree version of the tree
+ */
+void rb_ptree_dealloc(struct rb_ptree *ptree)
+{
+        struct rb_pnode *node = NULL;
+
+        rb_pnode_put(ptree->root);
+        while (ptree->spare) {
+                node = ptree->spare;
+                ptree->spare = node->left;
+                free(node);
+        }
+        pthread_mutex_destroy(&ptree->lock);
+        free(ptree);
+}
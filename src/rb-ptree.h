@@ -0,0 +1,76 @@
+/**
+ * @file rb-ptree.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief persistent (path-copying) red black tree's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * Nodes have no parent pointer and they are reference counted, so many
+ * versions can share them. Insert and delete copy only the shared nodes of
+ * the root-to-leaf path (and the siblings which the fixup recolors or
+ * rotates). The nodes which only this version references are modified in
+ * place. So, `rb_ptree_snapshot` is O(1): it just retains the root.
+ *
+ * A version is used by one thread at a time, like `struct rb_tree`. But
+ * `rb_ptree_snapshot` can be called while another thread writes the
+ * version, and the snapshot can be scanned while the writer goes on.
+ *
+ * @warning The tree does not free the data, because versions share it.
+ *
+ * @ref Driscoll, J. R., Sarnak, N., Sleator, D. D., & Tarjan, R. E. (1989). Making data structures persistent. Journal of computer and system sciences, 38(1), 86-124.
+ */
+#ifndef RB_PTREE_H_
+#define RB_PTREE_H_
+
+#include <pthread.h>
+#include "rb-tree.h"
+
+#define RB_PTREE_MAX_HEIGHT (130) /**< 2 * 64 + rotation in the fixup */
+
+/**
+ * @brief Reference counted node of the persistent tree
+ *
+ */
+struct rb_pnode {
+        key_t key;
+        void *data;
+        struct rb_pnode *left; /**< NULL means leaf */
+        struct rb_pnode *right;
+        atomic_uint refcount; /**< parents and versions which point this */
+        int color;
+};
+
+/**
+ * @brief Version of the persistent tree
+ *
+ */
+struct rb_ptree {
+        struct rb_pnode *root;
+        size_t nr_nodes;
+        struct rb_pnode *spare; /**< reserved nodes (linked by left) */
+        size_t nr_spare;
+        pthread_mutex_t lock; /**< orders the writer and the snapshots */
+};
+
+/**
+ * @brief Visitor of the persistent tree's node
+ *
+ * @param node visited node
+ * @param arg user argument
+ * @return int 0 means continue. Not 0 stops the iteration.
+ */
+typedef int (*rb_pnode_visit_fn)(const struct rb_pnode *node, void *arg);
+
+struct rb_ptree *rb_ptree_alloc(void);
+struct rb_ptree *rb_ptree_snapshot(struct rb_ptree *ptree);
+const struct rb_pnode *rb_ptree_search(struct rb_ptree *ptree, key_t key);
+int rb_ptree_for_each(struct rb_ptree *ptree, key_t first, key_t last,
+                      rb_pnode_visit_fn fn, void *arg);
+int rb_ptree_insert(struct rb_ptree *ptree, key_t key, void *data);
+int rb_ptree_delete(struct rb_ptree *ptree, key_t key);
+void rb_ptree_dealloc(struct rb_ptree *ptree);
+
+#endif
@@ -0,0 +1,317 @@
+/**
+ * @file rb-rw-tree.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief thread-safe red black tree wrapper implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#include <stdlib.h>
+#include "rb-rw-tree.h"
+
+/**
+ * @brief Allocation of reader-writer locked red-black tree
+ *
+ * @param flags combination of RB_TREE_FLAG_* values
+ * @return struct rb_rw_tree* allocated tree
+ */
+struct rb_rw_tree *rb_rw_tree_alloc(unsigned int flags)
+{
+        struct rb_rw_tree *rwtree = NULL;
+
+        rwtree = (struct rb_rw_tree *)aligned_alloc(
+                RB_CACHE_LINE_SIZE, sizeof(struct rb_rw_tree));
+        if (!rwtree) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+
+        rwtree->tree = rb_tree_alloc_flags(flags);
+        if (!rwtree->tree) {
+                goto exception;
+        }
+        if (rb_rwlock_init(&rwtree->lock)) {
+                pr_info("lock initialization failed\n");
+                goto exception;
+        }
+
+        return rwtree;
+exception:
+        if (rwtree->tree) {
+                rb_tree_dealloc(rwtree->tree);
+        }
+        free(rwtree);
+        return NULL;
+}
+
+/**
+ * @brief Visit the found node under the shared lock
+ *
+ * @param rwtree reader-writer locked tree
+ * @param node found node (tree->nil or NULL means not found)
+ * @param fn visitor (nullable)
+ * @param arg user argument
+ * @return int 0 means that the node is found. -ENODATA means not found.
+ */
+static int rb_rw_tree_visit(struct rb_rw_tree *rwtree, struct rb_node *node,
+                            rb_visit_fn fn, void *arg)
+{
+        if (!node || node == rwtree->tree->nil) {
+                return -ENODATA;
+        }
+        if (fn) {
+                fn(node, arg);
+        }
+        return 0;
+}
+
+/**
+ * @brief Search the key and visit its node
+ *
+ * @param rwtree reader-writer locked tree
+ * @param key the key which I want to search
+ * @param fn visitor called under the shared lock (nullable)
+ * @param arg user argument
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_rw_tree_search(struct rb_rw_tree *rwtree, key_t key, rb_visit_fn fn,
+                      void *arg)
+{
+        int ret;
+
+        rb_rwlock_read_lock(&rwtree->lock);
+        ret = rb_rw_tree_visit(rwtree, rb_tree_search(rwtree->tree, key), fn,
+                               arg);
+        rb_rwlock_read_unlock(&rwtree->lock);
+
+        return ret;
+}
+
+int rb_rw_tree_lower_bound(struct rb_rw_tree *rwtree, key_t key,
+                           rb_visit_fn fn, void *arg)
+{
+        int ret;
+
+        rb_rwlock_read_lock(&rwtree->lock);
+        ret = rb_rw_tree_visit(rwtree, rb_tree_lower_bound(rwtree->tree, key),
+                               fn, arg);
+        rb_rwlock_read_unlock(&rwtree->lock);
+
+        return ret;
+}
+
+int rb_rw_tree_upper_bound(struct rb_rw_tree *rwtree, key_t key,
+                           rb_visit_fn fn, void *arg)
+{
+        int ret;
+
+        rb_rwlock_read_lock(&rwtree->lock);
+        ret = rb_rw_tree_visit(rwtree, rb_tree_upper_bound(rwtree->tree, key),
+                               fn, arg);
+        rb_rwlock_read_unlock(&rwtree->lock);
+
+        return ret;
+}
+
+size_t rb_rw_tree_count_key(struct rb_rw_tree *rwtree, key_t key)
+{
+        size_t count;
+
+        rb_rwlock_read_lock(&rwtree->lock);
+        count = rb_tree_count_key(rwtree->tree, key);
+        rb_rwlock_read_unlock(&rwtree->lock);
+
+        return count;
+}
+
+size_t rb_rw_tree_get_bh(struct rb_rw_tree *rwtree, key_t key)
+{
+        size_t bh;
+
+        rb_rwlock_read_lock(&rwtree->lock);
+        bh = rb_tree_get_bh(rwtree->tree, key);
+        rb_rwlock_read_unlock(&rwtree->lock);
+
+        return bh;
+}
+
+/**
+ * @brief Visit the nodes in [first, last] by the key order
+ *
+ * @param rwtree reader-writer locked tree
+ * @param first first key of the range
+ * @param last last key of the range (inclusive)
+ * @param fn visitor called under the shared lock
+ * @param arg user argument
+ * @return int 0 means that every node is visited. Else, the visitor's
+ * return value which stopped the iteration.
+ */
+int rb_rw_tree_for_each(struct rb_rw_tree *rwtree, key_t first, key_t last,
+                        rb_visit_fn fn, void *arg)
+{
+        struct rb_tree *tree = NULL;
+        struct rb_node *node = NULL;
+        int ret = 0;
+
+        tree = rb_rw_tree_read_lock(rwtree);
+        node = rb_tree_lower_bound(tree, first);
+        while (node != tree->nil && node->key <= last) {
+                ret = fn(node, arg);
+                if (ret) {
+                        break;
+                }
+                node = rb_tree_successor(tree, node);
+        }
+        rb_rw_tree_read_unlock(rwtree);
+
+        return ret;
+}
+
+int rb_rw_tree_insert(struct rb_rw_tree *rwtree, key_t key, void *data)
+{
+        int ret;
+
+        rb_rwlock_write_lock(&rwtree->lock);
+        ret = rb_tree_insert(rwtree->tree, key, data);
+        rb_rwlock_write_unlock(&rwtree->lock);
+
+        return ret;
+}
+
+int rb_rw_tree_delete(struct rb_rw_tree *rwtree, key_t key)
+{
+        int ret;
+
+        rb_rwlock_write_lock(&rwtree->lock);
+        ret = rb_tree_delete(rwtree->tree, key);
+        rb_rwlock_write_unlock(&rwtree->lock);
+
+        return ret;
+}
+
+/**
+ * @brief Split the tree under the exclusive lock
+ * @details
+ * The keys which are less than or equal to the key stay in `rwtree`.
+ * So, other threads can keep using `rwtree` during and after the split.
+ *
+ * @param rwtree split target tree
+ * @param key split point
+ * @param upper new tree which has the keys greater than the key
+ * @return int 0 means success. Not 0 means fail.
+ */
+int rb_rw_tree_split(struct rb_rw_tree *rwtree, key_t key,
+                     struct rb_rw_tree **upper)
+{
+        struct rb_rw_tree *new_tree = NULL;
+        struct rb_tree *t1 = NULL;
+        struct rb_tree *t2 = NULL;
+        int ret = 0;
+
+        new_tree = rb_rw_tree_alloc(rwtree->tree->flags);
+        if (!new_tree) {
+                return -ENOMEM;
+        }
+
+        rb_rwlock_write_lock(&rwtree->lock);
+        ret = rb_tree_split(rwtree->tree, key, &t1, &t2);
+        if (ret == 0) {
+                rwtree->tree = t1;
+                rb_tree_dealloc(new_tree->tree);
+                new_tree->tree = t2;
+        }
+        rb_rwlock_write_unlock(&rwtree->lock);
+
+        if (ret) {
+                rb_rw_tree_dealloc(new_tree);
+                new_tree = NULL;
+        }
+        *upper = new_tree;
+        return ret;
+}
+
+/**
+ * @brief Check max(t1->key) <= x->key <= min(t2->key)
+ *
+ * @return true `rb_tree_concat` accepts the keys
+ * @return false the keys are not ordered
+ */
+static int rb_rw_tree_is_ordered(struct rb_tree *t1, struct rb_tree *t2,
+                                 struct rb_node *x)
+{
+        struct rb_node *max = rb_tree_maximum(t1, t1->root);
+        struct rb_node *min = rb_tree_minimum(t2, t2->root);
+
+        return (max == t1->nil || max->key <= x->key) &&
+               (min == t2->nil || x->key <= min->key);
+}
+
+/**
+ * @brief Concatenate t1, x and t2 into t1 under the exclusive locks
+ * @details
+ * Both locks are acquired by the address order to avoid the deadlock.
+ * After success, t2 becomes empty but it is still usable.
+ *
+ * @param t1 tree which have all value is smaller than x->key
+ * @param t2 tree which have all value is greater than x->key
+ * @param x joint node (same as `rb_tree_concat`)
+ * @return int 0 means success. -EINVAL means that the keys are not ordered.
+ * -EBUSY means that a snapshot of t1 or t2 is live. -ENOMEM means that
+ * the allocation failed. In the failure cases, t1 and t2 are not changed.
+ */
+int rb_rw_tree_concat(struct rb_rw_tree *t1, struct rb_rw_tree *t2,
+                      struct rb_node *x)
+{
+        struct rb_rw_tree *first = t1 < t2 ? t1 : t2;
+        struct rb_rw_tree *second = t1 < t2 ? t2 : t1;
+        struct rb_tree *empty = NULL;
+        struct rb_tree *new_tree = NULL;
+        int ret = 0;
+
+        if (t1 == t2) {
+                return -EINVAL;
+        }
+
+        empty = rb_tree_alloc_flags(t2->tree->flags);
+        if (!empty) {
+                return -ENOMEM;
+        }
+
+        rb_rwlock_write_lock(&first->lock);
+        rb_rwlock_write_lock(&second->lock);
+        if (rb_tree_has_snapshot(t1->tree) || rb_tree_has_snapshot(t2->tree)) {
+                ret = -EBUSY;
+        } else if (!rb_rw_tree_is_ordered(t1->tree, t2->tree, x)) {
+                ret = -EINVAL;
+        } else {
+                new_tree = rb_tree_concat(t1->tree, t2->tree, x);
+                if (new_tree) {
+                        t1->tree = new_tree;
+                        t2->tree = empty;
+                } else { /**< the other failures are checked above */
+                        ret = -ENOMEM;
+                }
+        }
+        rb_rwlock_write_unlock(&second->lock);
+        rb_rwlock_write_unlock(&first->lock);
+
+        if (ret) {
+                rb_tree_dealloc(empty);
+        }
+        return ret;
+}
+
+/**
+ * @brief Does deallocation of the tree
+ * @warning No other thread can use the tree at this point.
+ *
+ * @param rwtree reader-writer locked tree
+ */
+void rb_rw_tree_dealloc(struct rb_rw_tree *rwtree)
+{
+        rb_tree_dealloc(rwtree->tree);
+        rb_rwlock_destroy(&rwtree->lock);
+        free(rwtree);
+}
@@ -0,0 +1,77 @@
+/**
+ * @file rb-rw-tree.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief thread-safe red black tree wrapper's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * Lookups and iterations run under the shared lock, so they run in
+ * parallel. Insert, delete, split and concat run under the exclusive lock.
+ * Nodes are valid only while the lock is held. So, lookup functions pass
+ * the node to the visitor instead of returning it.
+ */
+#ifndef RB_RW_TREE_H_
+#define RB_RW_TREE_H_
+
+#include "rb-tree.h"
+#include "rb-rwlock.h"
+
+/**
+ * @brief Visitor of the node
+ *
+ * @param node visited node (valid only in the visitor)
+ * @param arg user argument
+ * @return int 0 means continue. Not 0 stops the iteration.
+ */
+typedef int (*rb_visit_fn)(struct rb_node *node, void *arg);
+
+/**
+ * @brief Reader-writer locked red-black tree
+ *
+ */
+struct rb_rw_tree {
+        struct rb_tree *tree;
+        struct rb_rwlock lock;
+};
+
+struct rb_rw_tree *rb_rw_tree_alloc(unsigned int flags);
+int rb_rw_tree_search(struct rb_rw_tree *rwtree, key_t key, rb_visit_fn fn,
+                      void *arg);
+int rb_rw_tree_lower_bound(struct rb_rw_tree *rwtree, key_t key,
+                           rb_visit_fn fn, void *arg);
+int rb_rw_tree_upper_bound(struct rb_rw_tree *rwtree, key_t key,
+                           rb_visit_fn fn, void *arg);
+size_t rb_rw_tree_count_key(struct rb_rw_tree *rwtree, key_t key);
+size_t rb_rw_tree_get_bh(struct rb_rw_tree *rwtree, key_t key);
+int rb_rw_tree_for_each(struct rb_rw_tree *rwtree, key_t first, key_t last,
+                        rb_visit_fn fn, void *arg);
+int rb_rw_tree_insert(struct rb_rw_tree *rwtree, key_t key, void *data);
+int rb_rw_tree_delete(struct rb_rw_tree *rwtree, key_t key);
+int rb_rw_tree_split(struct rb_rw_tree *rwtree, key_t key,
+                     struct rb_rw_tree **upper);
+int rb_rw_tree_concat(struct rb_rw_tree *t1, struct rb_rw_tree *t2,
+                      struct rb_node *x);
+void rb_rw_tree_dealloc(struct rb_rw_tree *rwtree);
+
+/**
+ * @brief Hold the shared lock to use the read-only core API directly
+ * (e.g. `rb_tree_successor` on `rwtree->tree`)
+ *
+ * @param rwtree reader-writer locked tree
+ * @return struct rb_tree* locked tree
+ */
+static inline struct rb_tree *rb_rw_tree_read_lock(struct rb_rw_tree *rwtree)
+{
+        rb_rwlock_read_lock(&rwtree->lock);
+        return rwtree->tree;
+}
+
+static inline void rb_rw_tree_read_unlock(struct rb_rw_tree *rwtree)
+{
+        rb_rwlock_read_unlock(&rwtree->lock);
+}
+
+#endif
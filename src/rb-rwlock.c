@@ -0,0 +1,106 @@
+/**
+ * @file rb-rwlock.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief writer-preferring reader-writer lock implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <sched.h>
+#include <errno.h>
+#include "rb-rwlock.h"
+
+static atomic_uint rb_rwlock_next_slot; /**< round-robin slot assignment */
+static _Thread_local int rb_rwlock_slot_id = -1;
+
+/**
+ * @brief Get the counter slot of the current thread
+ *
+ * @param lock reader-writer lock
+ * @return struct rb_rwlock_slot* slot of the current thread
+ */
+static inline struct rb_rwlock_slot *rb_rwlock_get_slot(struct rb_rwlock *lock)
+{
+        if (rb_rwlock_slot_id < 0) {
+                rb_rwlock_slot_id = (int)(atomic_fetch_add(&rb_rwlock_next_slot,
+                                                           1) %
+                                          RB_RWLOCK_NR_SLOTS);
+        }
+        return &lock->slots[rb_rwlock_slot_id];
+}
+
+/**
+ * @brief Initialize the reader-writer lock
+ *
+ * @param lock reader-writer lock
+ * @return int 0 means success. Not 0 means that the mutex init failed.
+ */
+int rb_rwlock_init(struct rb_rwlock *lock)
+{
+        atomic_init(&lock->writer, 0);
+        for (int i = 0; i < RB_RWLOCK_NR_SLOTS; i++) {
+                atomic_init(&lock->slots[i].nr_readers, 0);
+        }
+        return -pthread_mutex_init(&lock->writer_mutex, NULL);
+}
+
+void rb_rwlock_destroy(struct rb_rwlock *lock)
+{
+        pthread_mutex_destroy(&lock->writer_mutex);
+}
+
+/**
+ * @brief Acquire the shared lock
+ * @details
+ * The reader announces itself first and then checks the writer flag.
+ * Both are sequentially consistent, so either the reader sees the writer
+ * or the writer sees the reader's counter.
+ *
+ * @param lock reader-writer lock
+ */
+void rb_rwlock_read_lock(struct rb_rwlock *lock)
+{
+        struct rb_rwlock_slot *slot = rb_rwlock_get_slot(lock);
+
+        for (;;) {
+                while (atomic_load(&lock->writer)) {
+                        sched_yield();
+                }
+                atomic_fetch_add(&slot->nr_readers, 1);
+                if (!atomic_load(&lock->writer)) {
+                        return;
+                }
+                atomic_fetch_sub(&slot->nr_readers, 1); /**< writer first */
+        }
+}
+
+void rb_rwlock_read_unlock(struct rb_rwlock *lock)
+{
+        atomic_fetch_sub_explicit(&rb_rwlock_get_slot(lock)->nr_readers, 1,
+                                  memory_order_release);
+}
+
+/**
+ * @brief Acquire the exclusive lock
+ *
+ * @param lock reader-writer lock
+ */
+void rb_rwlock_write_lock(struct rb_rwlock *lock)
+{
+        pthread_mutex_lock(&lock->writer_mutex);
+        atomic_store(&lock->writer, 1);
+        for (int i = 0; i < RB_RWLOCK_NR_SLOTS; i++) {
+                while (atomic_load(&lock->slots[i].nr_readers)) {
+                        sched_yield();
+                }
+        }
+}
+
+void rb_rwlock_write_unlock(struct rb_rwlock *lock)
+{
+        atomic_store(&lock->writer, 0);
+        pthread_mutex_unlock(&lock->writer_mutex);
+}
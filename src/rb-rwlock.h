@@ -0,0 +1,50 @@
+/**
+ * @file rb-rwlock.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief writer-preferring reader-writer lock's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * Each reader only touches its own counter slot (one cache line per slot),
+ * so the parallel readers do not bounce the same cache line. A writer
+ * raises the `writer` flag first, so the new readers back off, and waits
+ * until every slot drains. The lock is not recursive.
+ */
+#ifndef RB_RWLOCK_H_
+#define RB_RWLOCK_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define RB_RWLOCK_NR_SLOTS (64)
+#define RB_CACHE_LINE_SIZE (64)
+
+/**
+ * @brief Reader counter of the threads which are mapped to the slot
+ *
+ */
+struct rb_rwlock_slot {
+        _Alignas(RB_CACHE_LINE_SIZE) atomic_long nr_readers;
+};
+
+/**
+ * @brief Writer-preferring reader-writer lock
+ *
+ */
+struct rb_rwlock {
+        atomic_int writer; /**< writer is waiting or running */
+        pthread_mutex_t writer_mutex; /**< serialize the writers */
+        struct rb_rwlock_slot slots[RB_RWLOCK_NR_SLOTS];
+};
+
+int rb_rwlock_init(struct rb_rwlock *lock);
+void rb_rwlock_destroy(struct rb_rwlock *lock);
+void rb_rwlock_read_lock(struct rb_rwlock *lock);
+void rb_rwlock_read_unlock(struct rb_rwlock *lock);
+void rb_rwlock_write_lock(struct rb_rwlock *lock);
+void rb_rwlock_write_unlock(struct rb_rwlock *lock);
+
+#endif
@@ -0,0 +1,498 @@
+/**
+ * @file rb-shard-tree.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief range-sharded red black tree implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#include <stdlib.h>
+#include "rb-shard-tree.h"
+
+/**
+ * @brief Allocation of the shard which has the empty tree
+ *
+ * @return struct rb_shard* allocated shard
+ */
+static struct rb_shard *rb_shard_alloc(void)
+{
+        struct rb_shard *shard = NULL;
+
+        shard = (struct rb_shard *)aligned_alloc(RB_CACHE_LINE_SIZE,
+                                                 sizeof(struct rb_shard));
+        if (!shard) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+
+        shard->tree = rb_tree_alloc();
+        if (!shard->tree) {
+                goto exception;
+        }
+        if (rb_rwlock_init(&shard->lock)) {
+                pr_info("lock initialization failed\n");
+                goto exception;
+        }
+        atomic_init(&shard->load, 0);
+
+        return shard;
+exception:
+        if (shard->tree) {
+                rb_tree_dealloc(shard->tree);
+        }
+        free(shard);
+        return NULL;
+}
+
+static void rb_shard_dealloc(struct rb_shard *shard)
+{
+        if (shard->tree) {
+                rb_tree_dealloc(shard->tree);
+        }
+        rb_rwlock_destroy(&shard->lock);
+        free(shard);
+}
+
+/**
+ * @brief Allocation of the range-sharded tree
+ * @details
+ * The key space is divided into the same size ranges at first.
+ *
+ * @param nr_shards number of the shards
+ * @return struct rb_shard_tree* allocated tree
+ */
+struct rb_shard_tree *rb_shard_tree_alloc(size_t nr_shards)
+{
+        struct rb_shard_tree *stree = NULL;
+        const key_t step = RB_MAX_KEY / (nr_shards ? nr_shards : 1);
+
+        if (nr_shards == 0) {
+                pr_info("at least one shard is required\n");
+                return NULL;
+        }
+
+        stree = (struct rb_shard_tree *)aligned_alloc(
+                RB_CACHE_LINE_SIZE, sizeof(struct rb_shard_tree));
+        if (!stree) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+        stree->nr_shards = 0;
+        atomic_init(&stree->balancing, 0);
+        /**< the balance merges before it splits, so no shard is added */
+        stree->bounds = (key_t *)malloc(sizeof(key_t) * nr_shards);
+        stree->shards = (struct rb_shard **)calloc(nr_shards,
+                                                   sizeof(struct rb_shard *));
+        if (!stree->bounds || !stree->shards) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                goto exception;
+        }
+        if (rb_rwlock_init(&stree->lock)) {
+                pr_info("lock initialization failed\n");
+                goto exception;
+        }
+
+        for (size_t i = 0; i < nr_shards; i++) {
+                stree->shards[i] = rb_shard_alloc();
+                if (!stree->shards[i]) {
+                        rb_shard_tree_dealloc(stree);
+                        return NULL;
+                }
+                stree->bounds[i] = (key_t)i * step;
+                stree->nr_shards++;
+        }
+
+        return stree;
+exception:
+        free(stree->bounds);
+        free(stree->shards);
+        free(stree);
+        return NULL;
+}
+
+/**
+ * @brief Find the shard which has the key in its range
+ * @warning The routing table's lock must be held.
+ *
+ * @param stree range-sharded tree
+ * @param key target key
+ * @return size_t index of the shard
+ */
+static size_t rb_shard_tree_route(struct rb_shard_tree *stree, key_t key)
+{
+        size_t low = 0;
+        size_t high = stree->nr_shards - 1;
+        size_t mid;
+
+        while (low < high) { /**< last shard which bounds[i] <= key */
+                mid = low + (high - low + 1) / 2;
+                if (stree->bounds[mid] <= key) {
+                        low = mid;
+                } else {
+                        high = mid - 1;
+                }
+        }
+        return low;
+}
+
+int rb_shard_tree_search(struct rb_shard_tree *stree, key_t key,
+                         rb_visit_fn fn, void *arg)
+{
+        struct rb_shard *shard = NULL;
+        struct rb_node *node = NULL;
+        int ret = 0;
+
+        rb_rwlock_read_lock(&stree->lock);
+        shard = stree->shards[rb_shard_tree_route(stree, key)];
+        rb_rwlock_read_lock(&shard->lock);
+        node = rb_tree_search(shard->tree, key);
+        if (!node || node == shard->tree->nil) {
+                ret = -ENODATA;
+        } else if (fn) {
+                fn(node, arg);
+        }
+        rb_rwlock_read_unlock(&shard->lock);
+        rb_rwlock_read_unlock(&stree->lock);
+
+        return ret;
+}
+
+/**
+ * @brief Count the write of the shard and check the balance periodically
+ *
+ * @param shard written shard
+ * @return int 1 means that the balance must be checked
+ */
+static inline int rb_shard_tree_account(struct rb_shard *shard)
+{
+        unsigned long load =
+                atomic_fetch_add_explicit(&shard->load, 1,
+                                          memory_order_relaxed) + 1;
+        return load % RB_SHARD_BALANCE_INTERVAL == 0;
+}
+
+int rb_shard_tree_insert(struct rb_shard_tree *stree, key_t key, void *data)
+{
+        struct rb_shard *shard = NULL;
+        int check;
+        int ret;
+
+        rb_rwlock_read_lock(&stree->lock);
+        shard = stree->shards[rb_shard_tree_route(stree, key)];
+        rb_rwlock_write_lock(&shard->lock);
+        ret = rb_tree_insert(shard->tree, key, data);
+        rb_rwlock_write_unlock(&shard->lock);
+        check = rb_shard_tree_account(shard);
+        rb_rwlock_read_unlock(&stree->lock);
+
+        if (check) {
+                rb_shard_tree_balance(stree);
+        }
+        return ret;
+}
+
+int rb_shard_tree_delete(struct rb_shard_tree *stree, key_t key)
+{
+        struct rb_shard *shard = NULL;
+        int check;
+        int ret;
+
+        rb_rwlock_read_lock(&stree->lock);
+        shard = stree->shards[rb_shard_tree_route(stree, key)];
+        rb_rwlock_write_lock(&shard->lock);
+        ret = rb_tree_delete(shard->tree, key);
+        rb_rwlock_write_unlock(&shard->lock);
+        check = rb_shard_tree_account(shard);
+        rb_rwlock_read_unlock(&stree->lock);
+
+        if (check) {
+                rb_shard_tree_balance(stree);
+        }
+        return ret;
+}
+
+/**
+ * @brief Merge the shard i + 1 into the shard i
+ * @warning The routing table's exclusive lock must be held.
+ *
+ * @param stree range-sharded tree
+ * @param i index of the left shard
+ * @return int 0 means success. Not 0 means fail.
+ */
+static int rb_shard_tree_merge(struct rb_shard_tree *stree, size_t i)
+{
+        struct rb_shard *left = stree->shards[i];
+        struct rb_shard *right = stree->shards[i + 1];
+        struct rb_tree *tree = NULL;
+        struct rb_node *x = NULL;
+
+        if (right->tree->root != right->tree->nil) { /**< joint node */
+                x = rb_tree_minimum(right->tree, right->tree->root);
+        } else if (left->tree->root != left->tree->nil) {
+                x = rb_tree_maximum(left->tree, left->tree->root);
+        }
+
+        if (x) {
+                tree = rb_tree_concat(left->tree, right->tree, x);
+                if (!tree) {
+                        return -ENOMEM;
+                }
+                left->tree = tree;
+                right->tree = NULL; /**< freed by `rb_tree_concat` */
+        }
+        atomic_fetch_add_explicit(&left->load,
+                                  atomic_load_explicit(&right->load,
+                                                       memory_order_relaxed),
+                                  memory_order_relaxed);
+        rb_shard_dealloc(right);
+
+        memmove(&stree->shards[i + 1], &stree->shards[i + 2],
+                sizeof(struct rb_shard *) * (stree->nr_shards - i - 2));
+        memmove(&stree->bounds[i + 1], &stree->bounds[i + 2],
+                sizeof(key_t) * (stree->nr_shards - i - 2));
+        stree->nr_shards--;
+        return 0;
+}
+
+/**
+ * @brief Get the key where the shard is split
+ * @details
+ * The root of the red-black tree divides the keys roughly in half, and the
+ * split at the root is the cheapest one.
+ *
+ * @param shard target shard
+ * @param key location where the last key of the lower part is stored
+ * @return int 0 means success. -ENODATA means that the shard cannot be
+ * split.
+ */
+static int rb_shard_split_key(struct rb_shard *shard, key_t *key)
+{
+        struct rb_tree *tree = shard->tree;
+
+        if (tree->root == tree->nil) {
+                return -ENODATA;
+        }
+        if (tree->root->right != tree->nil) {
+                *key = tree->root->key;
+        } else if (tree->root->left != tree->nil) {
+                *key = tree->root->left->key;
+        } else {
+                return -ENODATA; /**< only one key */
+        }
+        return 0;
+}
+
+/**
+ * @brief Split the shard i at its root
+ * @warning The routing table's exclusive lock must be held and there must
+ * be a free slot in the table.
+ *
+ * @param stree range-sharded tree
+ * @param i index of the split shard
+ * @return int 0 means success. -ENODATA means that the shard cannot be
+ * split. Else, fail.
+ */
+static int rb_shard_tree_split(struct rb_shard_tree *stree, size_t i)
+{
+        struct rb_shard *shard = stree->shards[i];
+        struct rb_shard *upper = NULL;
+        struct rb_tree *tree = shard->tree;
+        struct rb_tree *t1 = NULL;
+        struct rb_tree *t2 = NULL;
+        key_t key;
+        int ret;
+
+        ret = rb_shard_split_key(shard, &key);
+        if (ret) {
+                return ret;
+        }
+
+        upper = rb_shard_alloc();
+        if (!upper) {
+                return -ENOMEM;
+        }
+        ret = rb_tree_split(tree, key, &t1, &t2);
+        if (ret) {
+                rb_shard_dealloc(upper);
+                return ret;
+        }
+        shard->tree = t1;
+        rb_tree_dealloc(upper->tree);
+        upper->tree = t2;
+        atomic_store_explicit(&shard->load, 0, memory_order_relaxed);
+
+        memmove(&stree->shards[i + 2], &stree->shards[i + 1],
+                sizeof(struct rb_shard *) * (stree->nr_shards - i - 1));
+        memmove(&stree->bounds[i + 2], &stree->bounds[i + 1],
+                sizeof(key_t) * (stree->nr_shards - i - 1));
+        stree->shards[i + 1] = upper;
+        stree->bounds[i + 1] = key + 1; /**< key < RB_MAX_KEY (right exists) */
+        stree->nr_shards++;
+        return 0;
+}
+
+/**
+ * @brief Re-partition the hot shard
+ * @details
+ * If the hottest shard has more than RB_SHARD_HOT_RATIO times the average
+ * writes, the coldest adjacent pair which does not have the hot shard is
+ * merged and then the hot shard is split. So, the table never grows. If
+ * the split fails after the merge, the table has one less shard but every
+ * key is still routed. The write counters decay by half after each check.
+ *
+ * @param stree range-sharded tree
+ * @return int 1 means re-partitioned. 0 means balanced (or another thread
+ * is balancing). Negative value means fail.
+ */
+int rb_shard_tree_balance(struct rb_shard_tree *stree)
+{
+        unsigned long total = 0;
+        unsigned long load, pair, min_pair = 0;
+        size_t hot = 0;
+        size_t cold = 0;
+        key_t split_key;
+        int ret = 0;
+
+        if (atomic_exchange(&stree->balancing, 1)) {
+                return 0;
+        }
+        rb_rwlock_write_lock(&stree->lock);
+
+        for (size_t i = 0; i < stree->nr_shards; i++) {
+                load = atomic_load_explicit(&stree->shards[i]->load,
+                                            memory_order_relaxed);
+                total += load;
+                if (load > atomic_load_explicit(&stree->shards[hot]->load,
+                                                memory_order_relaxed)) {
+                        hot = i;
+                }
+        }
+        load = atomic_load_explicit(&stree->shards[hot]->load,
+                                    memory_order_relaxed);
+        if (stree->nr_shards < 3 ||
+            load * stree->nr_shards <= RB_SHARD_HOT_RATIO * total) {
+                goto out;
+        }
+
+        cold = stree->nr_shards;
+        for (size_t i = 0; i + 1 < stree->nr_shards; i++) {
+                if (i == hot || i + 1 == hot) {
+                        continue;
+                }
+                pair = atomic_load_explicit(&stree->shards[i]->load,
+                                            memory_order_relaxed) +
+                       atomic_load_explicit(&stree->shards[i + 1]->load,
+                                            memory_order_relaxed);
+                if (cold == stree->nr_shards || pair < min_pair) {
+                        cold = i;
+                        min_pair = pair;
+                }
+        }
+
+        if (cold == stree->nr_shards || /**< every pair has the hot shard */
+            rb_shard_split_key(stree->shards[hot], &split_key)) {
+                goto out;
+        }
+
+        ret = rb_shard_tree_merge(stree, cold);
+        if (ret) {
+                goto out;
+        }
+        if (cold < hot) { /**< the merge shifted the hot shard */
+                hot--;
+        }
+        ret = rb_shard_tree_split(stree, hot);
+        ret = ret ? ret : 1;
+out:
+        for (size_t i = 0; i < stree->nr_shards; i++) {
+                load = atomic_load_explicit(&stree->shards[i]->load,
+                                            memory_order_relaxed);
+                atomic_store_explicit(&stree->shards[i]->load, load / 2,
+                                      memory_order_relaxed);
+        }
+        rb_rwlock_write_unlock(&stree->lock);
+        atomic_store(&stree->balancing, 0);
+        return ret;
+}
+
+/**
+ * @brief Start the ordered iteration
+ * @details
+ * The shards are ordered by their ranges, so the merge of the shards is
+ * the concatenation of them. The iterator holds no lock between the calls,
+ * so it sees the concurrent changes of the keys which it has not passed.
+ *
+ * @param stree range-sharded tree
+ * @param iter iterator which will be initialized
+ * @param first first key of the iteration
+ */
+void rb_shard_iter_init(struct rb_shard_tree *stree,
+                        struct rb_shard_iter *iter, key_t first)
+{
+        iter->stree = stree;
+        iter->next = first;
+        iter->done = 0;
+}
+
+/**
+ * @brief Get the next key and data by the key order
+ *
+ * @param iter shard iterator
+ * @param key location where the key is stored
+ * @param data location where the data is stored (nullable)
+ * @return int 0 means success. -ENODATA means the end of the tree.
+ */
+int rb_shard_iter_next(struct rb_shard_iter *iter, key_t *key, void **data)
+{
+        struct rb_shard_tree *stree = iter->stree;
+        struct rb_shard *shard = NULL;
+        struct rb_node *node = NULL;
+        int ret = -ENODATA;
+
+        if (iter->done) {
+                return -ENODATA;
+        }
+
+        rb_rwlock_read_lock(&stree->lock);
+        for (size_t i = rb_shard_tree_route(stree, iter->next);
+             i < stree->nr_shards && ret; i++) {
+                shard = stree->shards[i];
+                rb_rwlock_read_lock(&shard->lock);
+                node = rb_tree_lower_bound(shard->tree, iter->next);
+                if (node != shard->tree->nil) {
+                        *key = node->key;
+                        if (data) {
+                                *data = node->data;
+                        }
+                        ret = 0;
+                }
+                rb_rwlock_read_unlock(&shard->lock);
+        }
+        rb_rwlock_read_unlock(&stree->lock);
+
+        if (ret || *key == RB_MAX_KEY) {
+                iter->done = 1;
+        } else {
+                iter->next = *key + 1;
+        }
+        return ret;
+}
+
+/**
+ * @brief Does deallocation of the tree
+ * @warning No other thread can use the tree at this point.
+ *
+ * @param stree range-sharded tree
+ */
+void rb_shard_tree_dealloc(struct rb_shard_tree *stree)
+{
+        for (size_t i = 0; i < stree->nr_shards; i++) {
+                rb_shard_dealloc(stree->shards[i]);
+        }
+        rb_rwlock_destroy(&stree->lock);
+        free(stree->bounds);
+        free(stree->shards);
+        free(stree);
+}
@@ -0,0 +1,73 @@
+/**
+ * @file rb-shard-tree.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief range-sharded red black tree's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * The key space is partitioned into the ranges and each range is an
+ * independent tree with its own lock. So, the writers of the different
+ * shards run in parallel. Every operation holds the routing table's shared
+ * lock, and the rebalancing holds its exclusive lock.
+ *
+ * The writes are counted per shard. If a shard gets more than
+ * RB_SHARD_HOT_RATIO times the average writes, it is split at its root
+ * (`rb_tree_split`) and the coldest adjacent pair is merged
+ * (`rb_tree_concat`). So, the number of the shards does not change.
+ */
+#ifndef RB_SHARD_TREE_H_
+#define RB_SHARD_TREE_H_
+
+#include "rb-tree.h"
+#include "rb-rw-tree.h"
+
+#define RB_SHARD_BALANCE_INTERVAL (1024) /**< writes of a shard per check */
+#define RB_SHARD_HOT_RATIO (2)
+
+/**
+ * @brief Range of the sharded tree
+ *
+ */
+struct rb_shard {
+        struct rb_rwlock lock;
+        struct rb_tree *tree;
+        _Alignas(RB_CACHE_LINE_SIZE) atomic_ulong load; /**< recent writes */
+};
+
+/**
+ * @brief Range-sharded red-black tree
+ *
+ */
+struct rb_shard_tree {
+        struct rb_rwlock lock; /**< protects the routing table */
+        size_t nr_shards;
+        key_t *bounds; /**< first key of each shard (bounds[0] is 0) */
+        struct rb_shard **shards;
+        atomic_int balancing;
+};
+
+/**
+ * @brief Ordered iterator over every shard
+ *
+ */
+struct rb_shard_iter {
+        struct rb_shard_tree *stree;
+        key_t next; /**< next key to look up */
+        int done;
+};
+
+struct rb_shard_tree *rb_shard_tree_alloc(size_t nr_shards);
+int rb_shard_tree_search(struct rb_shard_tree *stree, key_t key,
+                         rb_visit_fn fn, void *arg);
+int rb_shard_tree_insert(struct rb_shard_tree *stree, key_t key, void *data);
+int rb_shard_tree_delete(struct rb_shard_tree *stree, key_t key);
+int rb_shard_tree_balance(struct rb_shard_tree *stree);
+void rb_shard_iter_init(struct rb_shard_tree *stree,
+                        struct rb_shard_iter *iter, key_t first);
+int rb_shard_iter_next(struct rb_shard_iter *iter, key_t *key, void **data);
+void rb_shard_tree_dealloc(struct rb_shard_tree *stree);
+
+#endif
@@ -0,0 +1,739 @@
+/**
+ * @file rb-shm-tree.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief shared-memory red black tree implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @ref Cormen, T. H., Leiserson, C. E., Rivest, R. L., & Stein, C. (2009). Introduction to algorithms. MIT press.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "rb-shm-tree.h"
+
+#define RB_SHM_READ_ONCE(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+
+/**
+ * @brief Map the segment and fill the trusted copies of the layout
+ *
+ * @param fd file descriptor of the segment
+ * @param size size of the segment
+ * @return struct rb_shm_tree* mapping of the segment
+ */
+static struct rb_shm_tree *rb_shm_tree_map(int fd, size_t size)
+{
+        struct rb_shm_tree *stree = NULL;
+        void *addr = NULL;
+
+        stree = (struct rb_shm_tree *)malloc(sizeof(struct rb_shm_tree));
+        if (!stree) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+        addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+                pr_info("mmap failed (errno: %d)\n", errno);
+                free(stree);
+                return NULL;
+        }
+        stree->header = (struct rb_shm_header *)addr;
+        stree->size = size;
+        return stree;
+}
+
+/**
+ * @brief Create the shared-memory segment and the empty tree in it
+ *
+ * @param name POSIX shared-memory object name (e.g. "/rb-tree")
+ * @param capacity maximum number of the nodes
+ * @return struct rb_shm_tree* mapping of the created tree
+ * (NULL if the name already exists)
+ */
+struct rb_shm_tree *rb_shm_tree_create(const char *name, size_t capacity)
+{
+        struct rb_shm_tree *stree = NULL;
+        struct rb_shm_header *header = NULL;
+        pthread_mutexattr_t attr;
+        rb_shm_off_t nodes;
+        size_t size;
+        int fd;
+
+        nodes = (sizeof(struct rb_shm_header) + RB_CACHE_LINE_SIZE - 1) &
+                ~(rb_shm_off_t)(RB_CACHE_LINE_SIZE - 1);
+        size = nodes + capacity * sizeof(struct rb_shm_node);
+
+        fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+                pr_info("shm_open failed (errno: %d)\n", errno);
+                return NULL;
+        }
+        if (ftruncate(fd, (off_t)size)) {
+                pr_info("ftruncate failed (errno: %d)\n", errno);
+                goto exception;
+        }
+        stree = rb_shm_tree_map(fd, size);
+        if (!stree) {
+                goto exception;
+        }
+        close(fd);
+
+        header = stree->header; /**< ftruncate fills the segment by zero */
+        header->size = size;
+        header->capacity = capacity;
+        header->nodes = nodes;
+        header->root = 0;
+        header->free_list = 0;
+        header->brk = 0;
+        header->nr_nodes = 0;
+        atomic_init(&header->seq, 0);
+
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        if (pthread_mutex_init(&header->lock, &attr)) {
+                pr_info("lock initialization failed\n");
+                pthread_mutexattr_destroy(&attr);
+                rb_shm_tree_detach(stree);
+                shm_unlink(name);
+                return NULL;
+        }
+        pthread_mutexattr_destroy(&attr);
+
+        stree->nodes = nodes;
+        stree->end = size;
+        atomic_store_explicit(&header->magic, RB_SHM_MAGIC,
+                              memory_order_release);
+        return stree;
+exception:
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+}
+
+/**
+ * @brief Attach the tree which another process created
+ *
+ * @param name POSIX shared-memory object name
+ * @return struct rb_shm_tree* mapping of the tree (NULL if the segment
+ * does not exist or is not initialized yet)
+ */
+struct rb_shm_tree *rb_shm_tree_attach(const char *name)
+{
+        struct rb_shm_tree *stree = NULL;
+        struct stat st;
+        int fd;
+
+        fd = shm_open(name, O_RDWR, 0600);
+        if (fd < 0) {
+                pr_info("shm_open failed (errno: %d)\n", errno);
+                return NULL;
+        }
+        if (fstat(fd, &st) || (size_t)st.st_size < sizeof(struct rb_shm_header)) {
+                pr_info("invalid segment size\n");
+                close(fd);
+                return NULL;
+        }
+        stree = rb_shm_tree_map(fd, (size_t)st.st_size);
+        close(fd);
+        if (!stree) {
+                return NULL;
+        }
+
+        if (atomic_load_explicit(&stree->header->magic,
+                                 memory_order_acquire) != RB_SHM_MAGIC ||
+            stree->header->size != stree->size) {
+                pr_info("segment is not initialized\n");
+                rb_shm_tree_detach(stree);
+                return NULL;
+        }
+        stree->nodes = stree->header->nodes;
+        stree->end = stree->header->nodes +
+                     stree->header->capacity * sizeof(struct rb_shm_node);
+        if (stree->end > stree->size) {
+                pr_info("invalid segment layout\n");
+                rb_shm_tree_detach(stree);
+                return NULL;
+        }
+        return stree;
+}
+
+/**
+ * @brief Check that the reader can follow the offset
+ *
+ * @param stree mapped shared-memory tree
+ * @param off offset which may be torn by a writer
+ * @return int 1 means that it is nil or a node slot
+ */
+static inline int rb_shm_valid(struct rb_shm_tree *stree, rb_shm_off_t off)
+{
+        if (off == 0) {
+                return 1;
+        }
+        return off >= stree->nodes && off < stree->end &&
+               (off - stree->nodes) % sizeof(struct rb_shm_node) == 0;
+}
+
+static inline uint32_t rb_shm_color(struct rb_shm_tree *stree,
+                                    rb_shm_off_t off)
+{
+        return off ? rb_shm_node(stree, off)->color : RB_NODE_COLOR_BLACK;
+}
+
+static inline void rb_shm_write_begin(struct rb_shm_header *header)
+{
+        unsigned long seq = atomic_load_explicit(&header->seq,
+                                                 memory_order_relaxed);
+
+        atomic_store_explicit(&header->seq, seq + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+}
+
+static inline void rb_shm_write_end(struct rb_shm_header *header)
+{
+        unsigned long seq = atomic_load_explicit(&header->seq,
+                                                 memory_order_relaxed);
+
+        atomic_store_explicit(&header->seq, seq + 1, memory_order_release);
+}
+
+/**
+ * @brief Search the key without the lock
+ *
+ * @param stree mapped shared-memory tree
+ * @param key the key which I want to search
+ * @param value found value stored location
+ * @return int 0 means found. -ENODATA means not found. -EAGAIN means that
+ * the reader saw a broken link (a writer is running).
+ */
+static int __rb_shm_tree_search(struct rb_shm_tree *stree, key_t key,
+                                uint64_t *value)
+{
+        rb_shm_off_t off = RB_SHM_READ_ONCE(stree->header->root);
+        struct rb_shm_node *node = NULL;
+        key_t node_key;
+
+        for (int depth = 0; off; depth++) {
+                if (depth == RB_MAX_HEIGHT || !rb_shm_valid(stree, off)) {
+                        return -EAGAIN;
+                }
+                node = rb_shm_node(stree, off);
+                node_key = RB_SHM_READ_ONCE(node->key);
+                if (node_key == key) {
+                        *value = RB_SHM_READ_ONCE(node->value);
+                        return 0;
+                }
+                off = (key < node_key) ? RB_SHM_READ_ONCE(node->left) :
+                                         RB_SHM_READ_ONCE(node->right);
+        }
+        return -ENODATA;
+}
+
+/**
+ * @brief Search the key (lock-free unless a writer is stuck)
+ * @details
+ * If the seqlock keeps failing, the reader takes the lock. So, a reader
+ * does not spin forever on a writer which died with `seq` odd; the lock
+ * recovers the tree instead.
+ *
+ * @param stree mapped shared-memory tree
+ * @param key the key which I want to search
+ * @param value found value stored location (nullable)
+ * @return int 0 means found. -ENODATA means not found.
+ */
+int rb_shm_tree_search(struct rb_shm_tree *stree, key_t key, uint64_t *value)
+{
+        struct rb_shm_header *header = stree->header;
+        uint64_t found = 0;
+        unsigned long seq;
+        int ret;
+
+        for (int retry = 0; retry < RB_SHM_READ_RETRIES; retry++) {
+                seq = atomic_load_explicit(&header->seq, memory_order_acquire);
+                if (seq & 1) {
+                        sched_yield();
+                        continue;
+                }
+                ret = __rb_shm_tree_search(stree, key, &found);
+                atomic_thread_fence(memory_order_acquire);
+                if (ret != -EAGAIN &&
+                    atomic_load_explicit(&header->seq,
+                                         memory_order_relaxed) == seq) {
+                        goto out;
+                }
+        }
+
+        ret = rb_shm_tree_lock(stree);
+        if (ret) {
+                return ret;
+        }
+        ret = __rb_shm_tree_search(stree, key, &found);
+        rb_shm_tree_unlock(stree);
+out:
+        if (!ret && value) {
+                *value = found;
+        }
+        return ret;
+}
+
+static void rb_shm_left_rotate(struct rb_shm_tree *stree, rb_shm_off_t x)
+{
+        struct rb_shm_node *xn = rb_shm_node(stree, x);
+        rb_shm_off_t y = xn->right;
+        struct rb_shm_node *yn = rb_shm_node(stree, y);
+
+        xn->right = yn->left;
+        if (yn->left) {
+                rb_shm_node(stree, yn->left)->parent = x;
+        }
+        yn->parent = xn->parent;
+        if (!xn->parent) {
+                stree->header->root = y;
+        } else if (x == rb_shm_node(stree, xn->parent)->left) {
+                rb_shm_node(stree, xn->parent)->left = y;
+        } else {
+                rb_shm_node(stree, xn->parent)->right = y;
+        }
+        yn->left = x;
+        xn->parent = y;
+}
+
+static void rb_shm_right_rotate(struct rb_shm_tree *stree, rb_shm_off_t x)
+{
+        struct rb_shm_node *xn = rb_shm_node(stree, x);
+        rb_shm_off_t y = xn->left;
+        struct rb_shm_node *yn = rb_shm_node(stree, y);
+
+        xn->left = yn->right;
+        if (yn->right) {
+                rb_shm_node(stree, yn->right)->parent = x;
+        }
+        yn->parent = xn->parent;
+        if (!xn->parent) {
+                stree->header->root = y;
+        } else if (x == rb_shm_node(stree, xn->parent)->right) {
+                rb_shm_node(stree, xn->parent)->right = y;
+        } else {
+                rb_shm_node(stree, xn->parent)->left = y;
+        }
+        yn->right = x;
+        xn->parent = y;
+}
+
+static void rb_shm_insert_fixup(struct rb_shm_tree *stree, rb_shm_off_t z)
+{
+        rb_shm_off_t p, g, y;
+
+        while (rb_shm_color(stree, rb_shm_node(stree, z)->parent) ==
+               RB_NODE_COLOR_RED) {
+                p = rb_shm_node(stree, z)->parent;
+                g = rb_shm_node(stree, p)->parent;
+                if (p == rb_shm_node(stree, g)->left) {
+                        y = rb_shm_node(stree, g)->right;
+                        if (rb_shm_color(stree, y) == RB_NODE_COLOR_RED) {
+                                rb_shm_node(stree, p)->color = RB_NODE_COLOR_BLACK;
+                                rb_shm_node(stree, y)->color = RB_NODE_COLOR_BLACK;
+                                rb_shm_node(stree, g)->color = RB_NODE_COLOR_RED;
+                                z = g;
+                                continue;
+                        }
+                        if (z == rb_shm_node(stree, p)->right) {
+                                z = p;
+                                rb_shm_left_rotate(stree, z);
+                                p = rb_shm_node(stree, z)->parent;
+                        }
+                        rb_shm_node(stree, p)->color = RB_NODE_COLOR_BLACK;
+                        rb_shm_node(stree, g)->color = RB_NODE_COLOR_RED;
+                        rb_shm_right_rotate(stree, g);
+                } else { /**< only different part is left and right */
+                        y = rb_shm_node(stree, g)->left;
+                        if (rb_shm_color(stree, y) == RB_NODE_COLOR_RED) {
+                                rb_shm_node(stree, p)->color = RB_NODE_COLOR_BLACK;
+                                rb_shm_node(stree, y)->color = RB_NODE_COLOR_BLACK;
+                                rb_shm_node(stree, g)->color = RB_NODE_COLOR_RED;
+                                z = g;
+                                continue;
+                        }
+                        if (z == rb_shm_node(stree, p)->left) {
+                                z = p;
+                                rb_shm_right_rotate(stree, z);
+                                p = rb_shm_node(stree, z)->parent;
+                        }
+                        rb_shm_node(stree, p)->color = RB_NODE_COLOR_BLACK;
+                        rb_shm_node(stree, g)->color = RB_NODE_COLOR_RED;
+                        rb_shm_left_rotate(stree, g);
+                }
+        }
+        rb_shm_node(stree, stree->header->root)->color = RB_NODE_COLOR_BLACK;
+}
+
+/**
+ * @brief Link the node which has no duplicate key in the tree
+ *
+ * @param stree mapped shared-memory tree (writer lock is held)
+ * @param z new node's offset
+ */
+static void __rb_shm_tree_insert(struct rb_shm_tree *stree, rb_shm_off_t z)
+{
+        struct rb_shm_node *zn = rb_shm_node(stree, z);
+        rb_shm_off_t x = stree->header->root;
+        rb_shm_off_t y = 0;
+
+        while (x) {
+                y = x;
+                x = (zn->key < rb_shm_node(stree, x)->key) ?
+                            rb_shm_node(stree, x)->left :
+                            rb_shm_node(stree, x)->right;
+        }
+
+        zn->parent = y;
+        zn->left = 0;
+        zn->right = 0;
+        zn->color = RB_NODE_COLOR_RED;
+        zn->in_use = 1;
+        if (!y) {
+                stree->header->root = z;
+        } else if (zn->key < rb_shm_node(stree, y)->key) {
+                rb_shm_node(stree, y)->left = z;
+        } else {
+                rb_shm_node(stree, y)->right = z;
+        }
+        rb_shm_insert_fixup(stree, z);
+}
+
+/**
+ * @brief Rebuild the links after a writer died in the middle of an update
+ * @details
+ * A node is marked in use just before it is linked and unmarked just
+ * before it is unlinked. So, the nodes in use are exactly the contents
+ * before or after the interrupted operation, and relinking them gives a
+ * valid tree. The free list is rebuilt from the rest of the used slots.
+ *
+ * @param stree mapped shared-memory tree (writer lock is held)
+ */
+static void rb_shm_tree_recover(struct rb_shm_tree *stree)
+{
+        struct rb_shm_header *header = stree->header;
+        rb_shm_off_t off;
+
+        header->root = 0;
+        header->free_list = 0;
+        header->nr_nodes = 0;
+        if (header->brk > header->capacity) {
+                header->brk = header->capacity;
+        }
+        for (uint64_t i = header->brk; i-- > 0;) {
+                off = stree->nodes + i * sizeof(struct rb_shm_node);
+                if (rb_shm_node(stree, off)->in_use) {
+                        __rb_shm_tree_insert(stree, off);
+                        header->nr_nodes++;
+                } else {
+                        rb_shm_node(stree, off)->parent = header->free_list;
+                        header->free_list = off;
+                }
+        }
+}
+
+/**
+ * @brief Acquire the writer lock
+ * @details
+ * If the previous owner died during an update (`seq` is odd), the tree is
+ * recovered before the lock is returned.
+ *
+ * @param stree mapped shared-memory tree
+ * @return int 0 means success. Else, negative errno of the mutex.
+ */
+int rb_shm_tree_lock(struct rb_shm_tree *stree)
+{
+        struct rb_shm_header *header = stree->header;
+        int ret = pthread_mutex_lock(&header->lock);
+
+        if (ret == EOWNERDEAD) {
+                pr_info("the previous writer died, recover the tree\n");
+                if (atomic_load(&header->seq) & 1) {
+                        rb_shm_tree_recover(stree);
+                        rb_shm_write_end(header);
+                }
+                ret = pthread_mutex_consistent(&header->lock);
+        }
+        return -ret;
+}
+
+void rb_shm_tree_unlock(struct rb_shm_tree *stree)
+{
+        pthread_mutex_unlock(&stree->header->lock);
+}
+
+/**
+ * @brief Search the node under the writer lock
+ *
+ * @return rb_shm_off_t offset of the node (0 means not found)
+ */
+static rb_shm_off_t rb_shm_tree_find(struct rb_shm_tree *stree, key_t key)
+{
+        rb_shm_off_t x = stree->header->root;
+
+        while (x && rb_shm_node(stree, x)->key != key) {
+                x = (key < rb_shm_node(stree, x)->key) ?
+                            rb_shm_node(stree, x)->left :
+                            rb_shm_node(stree, x)->right;
+        }
+        return x;
+}
+
+/**
+ * @brief Insert the key or update its value
+ *
+ * @param stree mapped shared-memory tree
+ * @param key new node's key
+ * @param value new node's value
+ * @return int 0 means success. -ENOSPC means that every slot is used.
+ */
+int rb_shm_tree_insert(struct rb_shm_tree *stree, key_t key, uint64_t value)
+{
+        struct rb_shm_header *header = stree->header;
+        struct rb_shm_node *node = NULL;
+        rb_shm_off_t z;
+        int ret;
+
+        ret = rb_shm_tree_lock(stree);
+        if (ret) {
+                return ret;
+        }
+
+        z = rb_shm_tree_find(stree, key);
+        if (z) { /**< a word store does not change the structure */
+                __atomic_store_n(&rb_shm_node(stree, z)->value, value,
+                                 __ATOMIC_RELAXED);
+                goto out;
+        }
+        if (!header->free_list && header->brk == header->capacity) {
+                ret = -ENOSPC;
+                goto out;
+        }
+
+        rb_shm_write_begin(header);
+        if (header->free_list) {
+                z = header->free_list;
+                header->free_list = rb_shm_node(stree, z)->parent;
+        } else {
+                z = stree->nodes + header->brk * sizeof(struct rb_shm_node);
+                header->brk++;
+        }
+        node = rb_shm_node(stree, z);
+        node->key = key;
+        node->value = value;
+        __rb_shm_tree_insert(stree, z);
+        header->nr_nodes++;
+        rb_shm_write_end(header);
+out:
+        rb_shm_tree_unlock(stree);
+        return ret;
+}
+
+static void rb_shm_transplant(struct rb_shm_tree *stree, rb_shm_off_t u,
+                              rb_shm_off_t v)
+{
+        rb_shm_off_t parent = rb_shm_node(stree, u)->parent;
+
+        if (!parent) {
+                stree->header->root = v;
+        } else if (u == rb_shm_node(stree, parent)->left) {
+                rb_shm_node(stree, parent)->left = v;
+        } else {
+                rb_shm_node(stree, parent)->right = v;
+        }
+        if (v) {
+                rb_shm_node(stree, v)->parent = parent;
+        }
+}
+
+static void rb_shm_delete_fixup(struct rb_shm_tree *stree, rb_shm_off_t x,
+                                rb_shm_off_t x_parent)
+{
+        struct rb_shm_node *pn = NULL;
+        rb_shm_off_t w;
+
+        while (x != stree->header->root &&
+               rb_shm_color(stree, x) == RB_NODE_COLOR_BLACK) {
+                pn = rb_shm_node(stree, x_parent);
+                if (x == pn->left) {
+                        w = pn->right;
+                        if (rb_shm_color(stree, w) == RB_NODE_COLOR_RED) {
+                                rb_shm_node(stree, w)->color = RB_NODE_COLOR_BLACK;
+                                pn->color = RB_NODE_COLOR_RED;
+                                rb_shm_left_rotate(stree, x_parent);
+                                w = pn->right;
+                        }
+                        if (rb_shm_color(stree, rb_shm_node(stree, w)->left) ==
+                                    RB_NODE_COLOR_BLACK &&
+                            rb_shm_color(stree, rb_shm_node(stree, w)->right) ==
+                                    RB_NODE_COLOR_BLACK) {
+                                rb_shm_node(stree, w)->color = RB_NODE_COLOR_RED;
+                                x = x_parent;
+                                x_parent = pn->parent;
+                                continue;
+                        }
+                        if (rb_shm_color(stree, rb_shm_node(stree, w)->right) ==
+                            RB_NODE_COLOR_BLACK) {
+                                rb_shm_node(stree, rb_shm_node(stree, w)->left)
+                                        ->color = RB_NODE_COLOR_BLACK;
+                                rb_shm_node(stree, w)->color = RB_NODE_COLOR_RED;
+                                rb_shm_right_rotate(stree, w);
+                                w = pn->right;
+                        }
+                        rb_shm_node(stree, w)->color = pn->color;
+                        pn->color = RB_NODE_COLOR_BLACK;
+                        rb_shm_node(stree, rb_shm_node(stree, w)->right)->color =
+                                RB_NODE_COLOR_BLACK;
+                        rb_shm_left_rotate(stree, x_parent);
+                } else { /**< only different part is left and right */
+                        w = pn->left;
+                        if (rb_shm_color(stree, w) == RB_NODE_COLOR_RED) {
+                                rb_shm_node(stree, w)->color = RB_NODE_COLOR_BLACK;
+                                pn->color = RB_NODE_COLOR_RED;
+                                rb_shm_right_rotate(stree, x_parent);
+                                w = pn->left;
+                        }
+                        if (rb_shm_color(stree, rb_shm_node(stree, w)->right) ==
+                                    RB_NODE_COLOR_BLACK &&
+                            rb_shm_color(stree, rb_shm_node(stree, w)->left) ==
+                                    RB_NODE_COLOR_BLACK) {
+                                rb_shm_node(stree, w)->color = RB_NODE_COLOR_RED;
+                                x = x_parent;
+                                x_parent = pn->parent;
+                                continue;
+                        }
+                        if (rb_shm_color(stree, rb_shm_node(stree, w)->left) ==
+                            RB_NODE_COLOR_BLACK) {
+                                rb_shm_node(stree, rb_shm_node(stree, w)->right)
+                                        ->color = RB_NODE_COLOR_BLACK;
+                                rb_shm_node(stree, w)->color = RB_NODE_COLOR_RED;
+                                rb_shm_left_rotate(stree, w);
+                                w = pn->left;
+                        }
+                        rb_shm_node(stree, w)->color = pn->color;
+                        pn->color = RB_NODE_COLOR_BLACK;
+                        rb_shm_node(stree, rb_shm_node(stree, w)->left)->color =
+                                RB_NODE_COLOR_BLACK;
+                        rb_shm_right_rotate(stree, x_parent);
+                }
+                x = stree->header->root;
+        }
+        if (x) {
+                rb_shm_node(stree, x)->color = RB_NODE_COLOR_BLACK;
+        }
+}
+
+/**
+ * @brief Unlink the node (same as `__rb_tree_delete`)
+ *
+ * @param stree mapped shared-memory tree (writer lock is held)
+ * @param z offset of the deleted node
+ */
+static void __rb_shm_tree_delete(struct rb_shm_tree *stree, rb_shm_off_t z)
+{
+        struct rb_shm_node *zn = rb_shm_node(stree, z);
+        struct rb_shm_node *yn = NULL;
+        rb_shm_off_t y = z, x, x_parent;
+        uint32_t y_original_color = zn->color;
+
+        if (!zn->left) {
+                x = zn->right;
+                x_parent = zn->parent;
+                rb_shm_transplant(stree, z, zn->right);
+        } else if (!zn->right) {
+                x = zn->left;
+                x_parent = zn->parent;
+                rb_shm_transplant(stree, z, zn->left);
+        } else {
+                y = zn->right;
+                while (rb_shm_node(stree, y)->left) {
+                        y = rb_shm_node(stree, y)->left;
+                }
+                yn = rb_shm_node(stree, y);
+                y_original_color = yn->color;
+                x = yn->right;
+                if (yn->parent == z) {
+                        x_parent = y;
+                } else {
+                        x_parent = yn->parent;
+                        rb_shm_transplant(stree, y, yn->right);
+                        yn->right = zn->right;
+                        rb_shm_node(stree, yn->right)->parent = y;
+                }
+                rb_shm_transplant(stree, z, y);
+                yn->left = zn->left;
+                rb_shm_node(stree, yn->left)->parent = y;
+                yn->color = zn->color;
+        }
+
+        if (y_original_color == RB_NODE_COLOR_BLACK) {
+                rb_shm_delete_fixup(stree, x, x_parent);
+        }
+}
+
+/**
+ * @brief Delete the key and put its node slot to the free list
+ * @details
+ * Readers may still look at the slot. It is safe because the slot is
+ * never unmapped and the reader retries after the seqlock check.
+ *
+ * @param stree mapped shared-memory tree
+ * @param key delete target node's key
+ * @return int 0 means that delete success. -ENODATA means not found.
+ */
+int rb_shm_tree_delete(struct rb_shm_tree *stree, key_t key)
+{
+        struct rb_shm_header *header = stree->header;
+        rb_shm_off_t z;
+        int ret;
+
+        ret = rb_shm_tree_lock(stree);
+        if (ret) {
+                return ret;
+        }
+
+        z = rb_shm_tree_find(stree, key);
+        if (!z) {
+                ret = -ENODATA;
+                goto out;
+        }
+        rb_shm_write_begin(header);
+        rb_shm_node(stree, z)->in_use = 0;
+        __rb_shm_tree_delete(stree, z);
+        rb_shm_node(stree, z)->parent = header->free_list;
+        header->free_list = z;
+        header->nr_nodes--;
+        rb_shm_write_end(header);
+out:
+        rb_shm_tree_unlock(stree);
+        return ret;
+}
+
+/**
+ * @brief Unmap the segment from this process (the tree stays)
+ *
+ * @param stree mapped shared-memory tree
+ */
+void rb_shm_tree_detach(struct rb_shm_tree *stree)
+{
+        munmap(stree->header, stree->size);
+        free(stree);
+}
+
+/**
+ * @brief Remove the segment name (mapped processes can keep using it)
+ *
+ * @param name POSIX shared-memory object name
+ * @return int 0 means success. Else, negative errno.
+ */
+int rb_shm_tree_unlink(const char *name)
+{
+        return shm_unlink(name) ? -errno : 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file rb-shm-tree.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief shared-memory red black tree's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * The tree and its nodes live in a POSIX shared-memory segment, so the
+ * processes on the same host share one copy and a new process only
+ * attaches it. The segment is mapped at a different address in each
+ * process. So, the links are the byte offsets from the segment base
+ * (0 is nil) and the value is a plain 64-bit integer instead of a pointer.
+ *
+ * Writers are serialized by a robust process-shared mutex. Readers take no
+ * lock: they use the seqlock `seq` and retry if a writer changed the tree.
+ * The node slots are never unmapped and every offset is checked before it
+ * is followed, so a reader never faults even if it races with a writer.
+ * If a writer dies in the middle of an update, the next locker rebuilds
+ * the links from the slots which are marked in use.
+ */
+#ifndef RB_SHM_TREE_H_
+#define RB_SHM_TREE_H_
+
+#include <pthread.h>
+#include "rb-tree.h"
+#include "rb-rwlock.h"
+
+#define RB_SHM_MAGIC (0x52425348ULL) /**< "RBSH" */
+#define RB_SHM_READ_RETRIES (64) /**< optimistic tries before the lock */
+
+typedef uint64_t rb_shm_off_t; /**< byte offset from the segment base */
+
+/**
+ * @brief Node in the shared-memory segment
+ *
+ */
+struct rb_shm_node {
+        key_t key;
+        uint64_t value;
+        rb_shm_off_t left, right;
+        rb_shm_off_t parent; /**< next free node if it is not in use */
+        uint32_t color; /**< `enum rb_node_color` */
+        uint32_t in_use; /**< linked to the tree (used by the recovery) */
+};
+
+/**
+ * @brief Header at the beginning of the segment
+ *
+ */
+struct rb_shm_header {
+        atomic_ulong magic; /**< RB_SHM_MAGIC after the initialization */
+        uint64_t size; /**< segment size */
+        uint64_t capacity; /**< number of the node slots */
+        rb_shm_off_t nodes; /**< offset of the first node slot */
+        pthread_mutex_t lock; /**< robust and process-shared */
+        atomic_ulong seq; /**< odd while a writer changes the structure */
+        rb_shm_off_t root;
+        rb_shm_off_t free_list; /**< deleted nodes (linked by parent) */
+        uint64_t brk; /**< slots at and after this are never used */
+        uint64_t nr_nodes;
+};
+
+/**
+ * @brief Mapping of the segment in this process
+ *
+ */
+struct rb_shm_tree {
+        struct rb_shm_header *header;
+        size_t size; /**< mapped size (trusted copy of header->size) */
+        rb_shm_off_t nodes; /**< trusted copy of header->nodes */
+        rb_shm_off_t end; /**< end offset of the node slots */
+};
+
+struct rb_shm_tree *rb_shm_tree_create(const char *name, size_t capacity);
+struct rb_shm_tree *rb_shm_tree_attach(const char *name);
+int rb_shm_tree_search(struct rb_shm_tree *stree, key_t key, uint64_t *value);
+int rb_shm_tree_insert(struct rb_shm_tree *stree, key_t key, uint64_t value);
+int rb_shm_tree_delete(struct rb_shm_tree *stree, key_t key);
+int rb_shm_tree_lock(struct rb_shm_tree *stree);
+void rb_shm_tree_unlock(struct rb_shm_tree *stree);
+void rb_shm_tree_detach(struct rb_shm_tree *stree);
+int rb_shm_tree_unlink(const char *name);
+
+/**
+ * @brief Get the node of the offset
+ *
+ * @param stree mapped shared-memory tree
+ * @param off offset of the node (must not be 0)
+ * @return struct rb_shm_node* node in this process's mapping
+ */
+static inline struct rb_shm_node *rb_shm_node(struct rb_shm_tree *stree,
+                                              rb_shm_off_t off)
+{
+        return (struct rb_shm_node *)((char *)stree->header + off);
+}
+
+#endif
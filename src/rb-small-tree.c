@@ -0,0 +1,533 @@
+/**
+ * @file rb-small-tree.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief small tree optimized red black tree implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#include <stdlib.h>
+#include "rb-small-tree.h"
+
+/**
+ * @brief Allocation of the small tree (the keys start in the array)
+ *
+ * @return struct rb_small_tree* allocated tree
+ */
+struct rb_small_tree *rb_small_tree_alloc(void)
+{
+        struct rb_small_tree *stree = (struct rb_small_tree *)malloc(
+                sizeof(struct rb_small_tree));
+
+        if (!stree) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+        stree->tree = NULL;
+        stree->nr_keys = 0;
+        return stree;
+}
+
+/**
+ * @brief Position of the first key of the array which is not less than the
+ * key (branchless halving like `rb_bucket_pos`)
+ */
+static inline unsigned int rb_small_pos(const struct rb_small_tree *stree,
+                                        key_t key)
+{
+        const key_t *base = stree->keys;
+        unsigned int n = (unsigned int)stree->nr_keys, half;
+
+        if (n == 0) {
+                return 0;
+        }
+        while (n > 1) {
+                half = n / 2;
+                base = (base[half] < key) ? base + half : base;
+                n -= half;
+        }
+        return (unsigned int)(base - stree->keys) + (*base < key);
+}
+
+/**
+ * @brief Report the pos-th entry of the array (nr_keys means no entry)
+ */
+static int rb_small_entry(struct rb_small_tree *stree, unsigned int pos,
+                          key_t *key, void **data)
+{
+        if (pos >= stree->nr_keys) {
+                return -ENODATA;
+        }
+        if (key) {
+                *key = stree->keys[pos];
+        }
+        if (data) {
+                *data = stree->data[pos];
+        }
+        return 0;
+}
+
+/**
+ * @brief Report the node of the tree (tree->nil means no entry)
+ */
+static int rb_small_node_entry(struct rb_tree *tree, struct rb_node *node,
+                               key_t *key, void **data)
+{
+        if (node == tree->nil) {
+                return -ENODATA;
+        }
+        if (key) {
+                *key = node->key;
+        }
+        if (data) {
+                *data = node->data;
+        }
+        return 0;
+}
+
+/**
+ * @brief Move the keys of the array to a new red-black tree
+ *
+ * @return int 0 means success. Else, the keys stay in the array.
+ */
+static int rb_small_tree_grow(struct rb_small_tree *stree)
+{
+        struct rb_tree *tree = rb_tree_alloc();
+        struct rb_node *node = NULL;
+        unsigned int i;
+        int ret = -ENOMEM;
+
+        if (!tree) {
+                return ret;
+        }
+        for (i = 0; i < stree->nr_keys; i++) {
+                ret = rb_tree_insert(tree, stree->keys[i], stree->data[i]);
+                if (ret) {
+                        goto exception;
+                }
+        }
+        stree->tree = tree;
+        return 0;
+exception:
+        for (node = rb_tree_minimum(tree, tree->root); node != tree->nil;
+             node = rb_tree_successor(tree, node)) {
+                node->data = NULL; /**< the array keeps the data */
+        }
+        rb_tree_dealloc(tree);
+        return ret;
+}
+
+/**
+ * @brief Move the keys of the red-black tree back to the array
+ * @warning The tree must have no more than RB_SMALL_KEYS keys.
+ */
+static void rb_small_tree_shrink(struct rb_small_tree *stree)
+{
+        struct rb_tree *tree = stree->tree;
+        struct rb_node *node = rb_tree_minimum(tree, tree->root);
+        unsigned int i = 0;
+
+        for (; node != tree->nil; node = rb_tree_successor(tree, node), i++) {
+                stree->keys[i] = node->key;
+                stree->data[i] = node->data;
+                node->data = NULL; /**< moved to the array */
+        }
+        rb_tree_dealloc(tree);
+        stree->tree = NULL;
+}
+
+/**
+ * @brief Search the key
+ *
+ * @param stree small tree whole
+ * @param key the key which I want to search
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_small_tree_search(struct rb_small_tree *stree, key_t key, void **data)
+{
+        struct rb_node *node = NULL;
+        unsigned int pos;
+
+        if (stree->tree) {
+                node = rb_tree_search(stree->tree, key);
+                if (!node) {
+                        return -ENODATA;
+                }
+                if (data) {
+                        *data = node->data;
+                }
+                return 0;
+        }
+        pos = rb_small_pos(stree, key);
+        if (pos == stree->nr_keys || stree->keys[pos] != key) {
+                return -ENODATA;
+        }
+        return rb_small_entry(stree, pos, NULL, data);
+}
+
+/**
+ * @brief Find the first key which is not less than the key
+ *
+ * @param stree small tree whole
+ * @param key lower bound key
+ * @param found found key stored location (nullable)
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_small_tree_lower_bound(struct rb_small_tree *stree, key_t key,
+                              key_t *found, void **data)
+{
+        if (stree->tree) {
+                return rb_small_node_entry(stree->tree,
+                                           rb_tree_lower_bound(stree->tree,
+                                                               key),
+                                           found, data);
+        }
+        return rb_small_entry(stree, rb_small_pos(stree, key), found, data);
+}
+
+/**
+ * @brief Find the first key which is greater than the key
+ *
+ * @param stree small tree whole
+ * @param key base key (it does not need to be in the tree)
+ * @param next found key stored location (nullable)
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_small_tree_successor(struct rb_small_tree *stree, key_t key,
+                            key_t *next, void **data)
+{
+        if (key == RB_MAX_KEY) {
+                return -ENODATA;
+        }
+        return rb_small_tree_lower_bound(stree, key + 1, next, data);
+}
+
+int rb_small_tree_minimum(struct rb_small_tree *stree, key_t *key,
+                          void **data)
+{
+        struct rb_tree *tree = stree->tree;
+
+        if (tree) {
+                return rb_small_node_entry(tree,
+                                           rb_tree_minimum(tree, tree->root),
+                                           key, data);
+        }
+        return rb_small_entry(stree, 0, key, data);
+}
+
+int rb_small_tree_maximum(struct rb_small_tree *stree, key_t *key,
+                          void **data)
+{
+        struct rb_tree *tree = stree->tree;
+
+        if (tree) {
+                return rb_small_node_entry(tree,
+                                           rb_tree_maximum(tree, tree->root),
+                                           key, data);
+        }
+        if (stree->nr_keys == 0) {
+                return -ENODATA;
+        }
+        return rb_small_entry(stree, (unsigned int)stree->nr_keys - 1, key,
+                              data);
+}
+
+/**
+ * @brief Insert the key and the data
+ * @details
+ * The key which does not fit in the full array moves every key to the
+ * red-black tree.
+ *
+ * @param stree small tree whole
+ * @param key new key
+ * @param data new data (the data of the same key is freed and updated)
+ * @return int 0 means success. -ENOMEM means that nothing is inserted.
+ */
+int rb_small_tree_insert(struct rb_small_tree *stree, key_t key, void *data)
+{
+        struct rb_node *node = NULL;
+        unsigned int pos;
+        int ret;
+
+        if (!stree->tree) {
+                pos = rb_small_pos(stree, key);
+                if (pos < stree->nr_keys && stree->keys[pos] == key) {
+                        free(stree->data[pos]);
+                        stree->data[pos] = data;
+                        return 0;
+                }
+                if (stree->nr_keys < RB_SMALL_KEYS) {
+                        memmove(&stree->keys[pos + 1], &stree->keys[pos],
+                                sizeof(key_t) * (stree->nr_keys - pos));
+                        memmove(&stree->data[pos + 1], &stree->data[pos],
+                                sizeof(void *) * (stree->nr_keys - pos));
+                        stree->keys[pos] = key;
+                        stree->data[pos] = data;
+                        stree->nr_keys++;
+                        return 0;
+                }
+                ret = rb_small_tree_grow(stree);
+                if (ret) {
+                        return ret;
+                }
+        }
+
+        node = rb_tree_search(stree->tree, key); /**< keep nr_keys exact */
+        if (node) {
+                free(node->data);
+                node->data = data;
+                return 0;
+        }
+        ret = rb_tree_insert(stree->tree, key, data);
+        if (ret) {
+                return ret;
+        }
+        stree->nr_keys++;
+        return 0;
+}
+
+/**
+ * @brief Delete the key
+ * @details
+ * The tree which shrinks to RB_SMALL_SHRINK_KEYS keys moves its keys back
+ * to the array.
+ *
+ * @param stree small tree whole
+ * @param key delete target key
+ * @return int 0 means that delete success. -ENODATA means not found.
+ */
+int rb_small_tree_delete(struct rb_small_tree *stree, key_t key)
+{
+        unsigned int pos;
+        int ret;
+
+        if (stree->tree) {
+                ret = rb_tree_delete(stree->tree, key);
+                if (ret) {
+                        return ret;
+                }
+                if (--stree->nr_keys <= RB_SMALL_SHRINK_KEYS) {
+                        rb_small_tree_shrink(stree);
+                }
+                return 0;
+        }
+        pos = rb_small_pos(stree, key);
+        if (pos == stree->nr_keys || stree->keys[pos] != key) {
+                return -ENODATA;
+        }
+        free(stree->data[pos]);
+        memmove(&stree->keys[pos], &stree->keys[pos + 1],
+                sizeof(key_t) * (stree->nr_keys - pos - 1));
+        memmove(&stree->data[pos], &stree->data[pos + 1],
+                sizeof(void *) * (stree->nr_keys - pos - 1));
+        stree->nr_keys--;
+        return 0;
+}
+
+/**
+ * @brief Visit the keys in [first, last] in the key order
+ *
+ * @param stree small tree whole
+ * @param first first key of the range
+ * @param last last key of the range (inclusive)
+ * @param fn visitor
+ * @param arg user argument
+ * @return int 0 means that every key is visited. Else, the visitor's
+ * return value which stopped the scan.
+ */
+int rb_small_tree_for_each(struct rb_small_tree *stree, key_t first,
+                           key_t last, rb_small_fn fn, void *arg)
+{
+        struct rb_tree *tree = stree->tree;
+        struct rb_node *node = NULL;
+        unsigned int pos;
+        int ret;
+
+        if (tree) {
+                for (node = rb_tree_lower_bound(tree, first);
+                     node != tree->nil && node->key <= last;
+                     node = rb_tree_successor(tree, node)) {
+                        ret = fn(node->key, node->data, arg);
+                        if (ret) {
+                                return ret;
+                        }
+                }
+                return 0;
+        }
+        for (pos = rb_small_pos(stree, first);
+             pos < stree->nr_keys && stree->keys[pos] <= last; pos++) {
+                ret = fn(stree->keys[pos], stree->data[pos], arg);
+                if (ret) {
+                        return ret;
+                }
+        }
+        return 0;
+}
+
+static size_t rb_small_tree_count(struct rb_tree *tree)
+{
+        struct rb_node *node = rb_tree_minimum(tree, tree->root);
+        size_t nr_keys = 0;
+
+        for (; node != tree->nil; node = rb_tree_successor(tree, node)) {
+                nr_keys++;
+        }
+        return nr_keys;
+}
+
+/**
+ * @brief Split tree to t1, t2 based on key value x
+ * @details
+ * The array is copied to the two arrays. The red-black tree is divided by
+ * `rb_tree_split` and the small halves go back to the arrays.
+ *
+ * @param stree split target tree (freed after the split)
+ * @param x split point (the keys less than or equal to x go to t1)
+ * @param t1 t1 stored location
+ * @param t2 t2 stored location
+ * @return int 0 means success. Else, the keys are not moved.
+ */
+int rb_small_tree_split(struct rb_small_tree *stree, key_t x,
+                        struct rb_small_tree **t1, struct rb_small_tree **t2)
+{
+        struct rb_small_tree *lower = rb_small_tree_alloc();
+        struct rb_small_tree *upper = rb_small_tree_alloc();
+        unsigned int pos;
+        int ret = -ENOMEM;
+
+        if (!lower || !upper) {
+                goto exception;
+        }
+        if (stree->tree) {
+                ret = rb_tree_split(stree->tree, x, &lower->tree,
+                                    &upper->tree);
+                if (ret) {
+                        lower->tree = upper->tree = NULL;
+                        goto exception;
+                }
+                lower->nr_keys = rb_small_tree_count(lower->tree);
+                upper->nr_keys = stree->nr_keys - lower->nr_keys;
+                if (lower->nr_keys <= RB_SMALL_SHRINK_KEYS) {
+                        rb_small_tree_shrink(lower);
+                }
+                if (upper->nr_keys <= RB_SMALL_SHRINK_KEYS) {
+                        rb_small_tree_shrink(upper);
+                }
+        } else {
+                pos = rb_small_pos(stree, x);
+                pos += (pos < stree->nr_keys && stree->keys[pos] == x);
+                lower->nr_keys = pos;
+                upper->nr_keys = stree->nr_keys - pos;
+                memcpy(lower->keys, stree->keys, sizeof(key_t) * pos);
+                memcpy(lower->data, stree->data, sizeof(void *) * pos);
+                memcpy(upper->keys, &stree->keys[pos],
+                       sizeof(key_t) * upper->nr_keys);
+                memcpy(upper->data, &stree->data[pos],
+                       sizeof(void *) * upper->nr_keys);
+        }
+        free(stree);
+
+        *t1 = lower;
+        *t2 = upper;
+        return 0;
+exception:
+        free(lower);
+        free(upper);
+        return ret;
+}
+
+/**
+ * @brief Concatenate two trees (every key of t1 is less than t2's)
+ * @details
+ * The keys which fit in the array are merged there. Else, both sides are
+ * moved to red-black trees and `rb_tree_concat` joins them.
+ *
+ * @param t1 tree which has the smaller keys (reused as the result)
+ * @param t2 tree which has the greater keys (freed)
+ * @return struct rb_small_tree* concatenated tree. NULL means that the keys
+ * of t1 and t2 are not moved.
+ */
+struct rb_small_tree *rb_small_tree_concat(struct rb_small_tree *t1,
+                                           struct rb_small_tree *t2)
+{
+        struct rb_tree *tree = NULL;
+        key_t max, min;
+
+        if (rb_small_tree_minimum(t2, &min, NULL)) {
+                rb_small_tree_dealloc(t2);
+                return t1;
+        }
+        if (rb_small_tree_maximum(t1, &max, NULL) == 0 && max >= min) {
+                pr_info("invalid state key state t1.max < t2.min\n");
+                return NULL;
+        }
+
+        if (t1->nr_keys + t2->nr_keys <= RB_SMALL_KEYS) {
+                if (t1->tree) {
+                        rb_small_tree_shrink(t1);
+                }
+                if (t2->tree) {
+                        rb_small_tree_shrink(t2);
+                }
+                memcpy(&t1->keys[t1->nr_keys], t2->keys,
+                       sizeof(key_t) * t2->nr_keys);
+                memcpy(&t1->data[t1->nr_keys], t2->data,
+                       sizeof(void *) * t2->nr_keys);
+                t1->nr_keys += t2->nr_keys;
+                free(t2);
+                return t1;
+        }
+
+        if ((!t1->tree && rb_small_tree_grow(t1)) ||
+            (!t2->tree && rb_small_tree_grow(t2))) {
+                return NULL;
+        }
+        tree = rb_tree_concat(t1->tree, t2->tree,
+                              rb_tree_minimum(t2->tree, t2->tree->root));
+        if (!tree) {
+                return NULL;
+        }
+        t1->tree = tree;
+        t1->nr_keys += t2->nr_keys;
+        free(t2);
+        return t1;
+}
+
+/**
+ * @brief Bytes of the structure and the nodes
+ *
+ * @param stree small tree whole
+ * @return size_t bytes which the tree allocates (without the data)
+ */
+size_t rb_small_tree_bytes(struct rb_small_tree *stree)
+{
+        size_t bytes = sizeof(struct rb_small_tree);
+
+        if (stree->tree) {
+                bytes += sizeof(struct rb_tree) +
+                         stree->nr_keys * sizeof(struct rb_node);
+        }
+        return bytes;
+}
+
+/**
+ * @brief Does deallocation of the small tree with its data
+ *
+ * @param stree small tree whole
+ */
+void rb_small_tree_dealloc(struct rb_small_tree *stree)
+{
+        if (stree->tree) {
+                rb_tree_dealloc(stree->tree);
+        } else {
+                for (size_t i = 0; i < stree->nr_keys; i++) {
+                        free(stree->data[i]);
+                }
+        }
+        free(stree);
+}
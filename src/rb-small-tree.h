@@ -0,0 +1,84 @@
+/**
+ * @file rb-small-tree.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief small tree optimized red black tree's declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * Up to RB_SMALL_KEYS keys are kept in a sorted array inside the structure,
+ * so a tiny tree is one allocation and its search is a short binary search
+ * on one or two cache lines. The inserting of one more key moves the keys
+ * to a `struct rb_tree`. The keys go back to the array when the tree
+ * shrinks to RB_SMALL_SHRINK_KEYS keys. The gap between the two thresholds
+ * prevents the conversions back and forth on the boundary.
+ *
+ * Every operation behaves the same in both representations. The keys are
+ * unique and, like `struct rb_tree`, the tree owns the data: it is freed by
+ * delete, by the update of the same key and by dealloc.
+ */
+#ifndef RB_SMALL_TREE_H_
+#define RB_SMALL_TREE_H_
+
+#include "rb-tree.h"
+
+#define RB_SMALL_KEYS (16) /**< capacity of the inline array */
+#define RB_SMALL_SHRINK_KEYS (RB_SMALL_KEYS / 2) /**< back to the array */
+
+/**
+ * @brief Red-black tree which starts as an inline sorted array
+ *
+ */
+struct rb_small_tree {
+        struct rb_tree *tree; /**< NULL while the keys are in the array */
+        size_t nr_keys;
+        key_t keys[RB_SMALL_KEYS];
+        void *data[RB_SMALL_KEYS];
+};
+
+/**
+ * @brief Visitor of the range scan
+ *
+ * @param key visited key
+ * @param data data of the key
+ * @param arg user argument
+ * @return int 0 means continue. Not 0 stops the scan.
+ */
+typedef int (*rb_small_fn)(key_t key, void *data, void *arg);
+
+struct rb_small_tree *rb_small_tree_alloc(void);
+int rb_small_tree_search(struct rb_small_tree *stree, key_t key, void **data);
+int rb_small_tree_lower_bound(struct rb_small_tree *stree, key_t key,
+                              key_t *found, void **data);
+int rb_small_tree_successor(struct rb_small_tree *stree, key_t key,
+                            key_t *next, void **data);
+int rb_small_tree_minimum(struct rb_small_tree *stree, key_t *key,
+                          void **data);
+int rb_small_tree_maximum(struct rb_small_tree *stree, key_t *key,
+                          void **data);
+int rb_small_tree_insert(struct rb_small_tree *stree, key_t key, void *data);
+int rb_small_tree_delete(struct rb_small_tree *stree, key_t key);
+int rb_small_tree_for_each(struct rb_small_tree *stree, key_t first,
+                           key_t last, rb_small_fn fn, void *arg);
+int rb_small_tree_split(struct rb_small_tree *stree, key_t x,
+                        struct rb_small_tree **t1, struct rb_small_tree **t2);
+struct rb_small_tree *rb_small_tree_concat(struct rb_small_tree *t1,
+                                           struct rb_small_tree *t2);
+size_t rb_small_tree_bytes(struct rb_small_tree *stree);
+void rb_small_tree_dealloc(struct rb_small_tree *stree);
+
+/**
+ * @brief Check the keys are in the inline array
+ *
+ * @param stree small tree whole
+ * @return true keys are in the array
+ * @return false keys are in the red-black tree
+ */
+static inline int rb_small_tree_is_inline(struct rb_small_tree *stree)
+{
+        return stree->tree == NULL;
+}
+
+#endif
@@ -0,0 +1,596 @@
+/**
+ * @file rb-td-tree.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief top-down red black tree without parent pointers implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#include <stdlib.h>
+#include "rb-td-tree.h"
+
+/**
+ * @brief Allocation of the top-down tree
+ *
+ * @return struct rb_td_tree* allocated tree
+ */
+struct rb_td_tree *rb_td_tree_alloc(void)
+{
+        struct rb_td_tree *tdtree =
+                (struct rb_td_tree *)malloc(sizeof(struct rb_td_tree));
+
+        if (!tdtree) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+        tdtree->root = NULL;
+        tdtree->nr_keys = 0;
+        return tdtree;
+}
+
+static struct rb_td_node *rb_td_node_alloc(key_t key, void *data)
+{
+        struct rb_td_node *node =
+                (struct rb_td_node *)malloc(sizeof(struct rb_td_node));
+
+        if (!node) {
+                pr_info("Memory allocation failed\n");
+                return NULL;
+        }
+        node->key = key;
+        node->data = data;
+        node->link[RB_TD_LEFT] = node->link[RB_TD_RIGHT] = NULL;
+        node->color = RB_NODE_COLOR_RED;
+        return node;
+}
+
+static inline int rb_td_is_red(const struct rb_td_node *node)
+{
+        return node && node->color == RB_NODE_COLOR_RED;
+}
+
+/**
+ * @brief Rotate the root to the dir side and recolor
+ *
+ * @return struct rb_td_node* new (black) root of the subtree
+ */
+static struct rb_td_node *rb_td_single(struct rb_td_node *root, int dir)
+{
+        struct rb_td_node *save = root->link[!dir];
+
+        root->link[!dir] = save->link[dir];
+        save->link[dir] = root;
+        root->color = RB_NODE_COLOR_RED;
+        save->color = RB_NODE_COLOR_BLACK;
+        return save;
+}
+
+static struct rb_td_node *rb_td_double(struct rb_td_node *root, int dir)
+{
+        root->link[!dir] = rb_td_single(root->link[!dir], !dir);
+        return rb_td_single(root, dir);
+}
+
+/**
+ * @brief Report the node (NULL means no entry)
+ */
+static int rb_td_entry(const struct rb_td_node *node, key_t *key, void **data)
+{
+        if (!node) {
+                return -ENODATA;
+        }
+        if (key) {
+                *key = node->key;
+        }
+        if (data) {
+                *data = node->data;
+        }
+        return 0;
+}
+
+/**
+ * @brief Search the key
+ *
+ * @param tdtree top-down tree whole
+ * @param key the key which I want to search
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_td_tree_search(struct rb_td_tree *tdtree, key_t key, void **data)
+{
+        struct rb_td_node *node = tdtree->root;
+
+        while (node) {
+                if (node->key == key) {
+                        break;
+                }
+                node = node->link[key > node->key]; /**< no branch to predict */
+        }
+        return rb_td_entry(node, NULL, data);
+}
+
+/**
+ * @brief Find the first key which is not less than the key
+ *
+ * @param tdtree top-down tree whole
+ * @param key lower bound key
+ * @param found found key stored location (nullable)
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_td_tree_lower_bound(struct rb_td_tree *tdtree, key_t key, key_t *found,
+                           void **data)
+{
+        struct rb_td_node *node = tdtree->root, *lower = NULL;
+
+        while (node) {
+                int dir = node->key < key;
+
+                lower = dir ? lower : node; /**< a conditional move */
+                node = node->link[dir];
+        }
+        return rb_td_entry(lower, found, data);
+}
+
+/**
+ * @brief Find the first key which is greater than the key
+ *
+ * @param tdtree top-down tree whole
+ * @param key base key (it does not need to be in the tree)
+ * @param next found key stored location (nullable)
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is found. -ENODATA means not found.
+ */
+int rb_td_tree_successor(struct rb_td_tree *tdtree, key_t key, key_t *next,
+                         void **data)
+{
+        if (key == RB_MAX_KEY) {
+                return -ENODATA;
+        }
+        return rb_td_tree_lower_bound(tdtree, key + 1, next, data);
+}
+
+/**
+ * @brief Node at the end of the dir side
+ */
+static struct rb_td_node *rb_td_edge(struct rb_td_node *node, int dir)
+{
+        while (node && node->link[dir]) {
+                node = node->link[dir];
+        }
+        return node;
+}
+
+int rb_td_tree_minimum(struct rb_td_tree *tdtree, key_t *key, void **data)
+{
+        return rb_td_entry(rb_td_edge(tdtree->root, RB_TD_LEFT), key, data);
+}
+
+int rb_td_tree_maximum(struct rb_td_tree *tdtree, key_t *key, void **data)
+{
+        return rb_td_entry(rb_td_edge(tdtree->root, RB_TD_RIGHT), key, data);
+}
+
+/**
+ * @brief Insert the key and the data in one pass from the root
+ * @details
+ * The 4-node on the path is split by the color flip and the red-red
+ * violation which the flip makes with the parent is fixed by the rotation
+ * at the grandparent. So, the new red node always has a black parent or a
+ * parent which is fixed in the same step.
+ *
+ * @param tdtree top-down tree whole
+ * @param key new key
+ * @param data new data (the data of the same key is freed and updated)
+ * @return int 0 means success. -ENOMEM means that nothing is inserted.
+ */
+int rb_td_tree_insert(struct rb_td_tree *tdtree, key_t key, void *data)
+{
+        struct rb_td_node head = { 0 }; /**< false root (root is right) */
+        struct rb_td_node *node = rb_td_node_alloc(key, data);
+        struct rb_td_node *t, *g = NULL, *p = NULL, *q;
+        int dir = RB_TD_LEFT, last = RB_TD_LEFT, dir2;
+
+        if (!node) {
+                return -ENOMEM;
+        }
+        if (!tdtree->root) {
+                node->color = RB_NODE_COLOR_BLACK;
+                tdtree->root = node;
+                tdtree->nr_keys++;
+                return 0;
+        }
+
+        t = &head;
+        q = t->link[RB_TD_RIGHT] = tdtree->root;
+        for (;;) {
+                if (!q) {
+                        p->link[dir] = q = node;
+                        tdtree->nr_keys++;
+                } else if (rb_td_is_red(q->link[RB_TD_LEFT]) &&
+                           rb_td_is_red(q->link[RB_TD_RIGHT])) {
+                        q->color = RB_NODE_COLOR_RED;
+                        q->link[RB_TD_LEFT]->color = RB_NODE_COLOR_BLACK;
+                        q->link[RB_TD_RIGHT]->color = RB_NODE_COLOR_BLACK;
+                }
+
+                if (rb_td_is_red(q) && rb_td_is_red(p)) {
+                        dir2 = (t->link[RB_TD_RIGHT] == g);
+                        if (q == p->link[last]) {
+                                t->link[dir2] = rb_td_single(g, !last);
+                        } else {
+                                t->link[dir2] = rb_td_double(g, !last);
+                        }
+                }
+
+                if (q == node) {
+                        break;
+                }
+                if (q->key == key) { /**< update key's data */
+                        free(q->data);
+                        q->data = data;
+                        free(node);
+                        break;
+                }
+
+                last = dir;
+                dir = (q->key < key);
+                if (g) {
+                        t = g;
+                }
+                g = p;
+                p = q;
+                q = q->link[dir];
+        }
+
+        tdtree->root = head.link[RB_TD_RIGHT];
+        tdtree->root->color = RB_NODE_COLOR_BLACK;
+        return 0;
+}
+
+/**
+ * @brief Delete the key in one pass from the root
+ * @details
+ * The current node is made red on the way down (by the color flip or the
+ * rotation at the parent). So, the removed node, which is the key's node
+ * or its predecessor with one child at most, is red or has a red child.
+ * Then, it is unlinked without a fix up.
+ *
+ * @param tdtree top-down tree whole
+ * @param key delete target key
+ * @return int 0 means that delete success. -ENODATA means not found.
+ */
+int rb_td_tree_delete(struct rb_td_tree *tdtree, key_t key)
+{
+        struct rb_td_node head = { 0 }; /**< false root (root is right) */
+        struct rb_td_node *q = &head, *p = NULL, *g = NULL, *f = NULL, *s;
+        int dir = RB_TD_RIGHT, last, dir2;
+
+        if (!tdtree->root) {
+                return -ENODATA;
+        }
+
+        q->link[RB_TD_RIGHT] = tdtree->root;
+        while (q->link[dir]) {
+                last = dir;
+                g = p;
+                p = q;
+                q = q->link[dir];
+                dir = (q->key < key);
+                if (q->key == key) {
+                        f = q; /**< the predecessor replaces it */
+                }
+
+                if (rb_td_is_red(q) || rb_td_is_red(q->link[dir])) {
+                        continue;
+                }
+                if (rb_td_is_red(q->link[!dir])) { /**< push the red down */
+                        p = p->link[last] = rb_td_single(q, dir);
+                        continue;
+                }
+                s = p->link[!last];
+                if (!s) {
+                        continue;
+                }
+                if (!rb_td_is_red(s->link[!last]) &&
+                    !rb_td_is_red(s->link[last])) { /**< color flip */
+                        p->color = RB_NODE_COLOR_BLACK;
+                        s->color = RB_NODE_COLOR_RED;
+                        q->color = RB_NODE_COLOR_RED;
+                        continue;
+                }
+                dir2 = (g->link[RB_TD_RIGHT] == p);
+                if (rb_td_is_red(s->link[last])) {
+                        g->link[dir2] = rb_td_double(p, last);
+                } else {
+                        g->link[dir2] = rb_td_single(p, last);
+                }
+                q->color = g->link[dir2]->color = RB_NODE_COLOR_RED;
+                g->link[dir2]->link[RB_TD_LEFT]->color = RB_NODE_COLOR_BLACK;
+                g->link[dir2]->link[RB_TD_RIGHT]->color = RB_NODE_COLOR_BLACK;
+        }
+
+        if (f) {
+                free(f->data);
+                f->key = q->key;
+                f->data = q->data;
+                p->link[p->link[RB_TD_RIGHT] == q] =
+                        q->link[q->link[RB_TD_LEFT] == NULL];
+                free(q);
+                tdtree->nr_keys--;
+        }
+
+        tdtree->root = head.link[RB_TD_RIGHT];
+        if (tdtree->root) {
+                tdtree->root->color = RB_NODE_COLOR_BLACK;
+        }
+        return f ? 0 : -ENODATA;
+}
+
+/**
+ * @brief Push the node and its left spine to the stack
+ */
+static void rb_td_iter_push(struct rb_td_iter *iter, struct rb_td_node *node)
+{
+        for (; node; node = node->link[RB_TD_LEFT]) {
+                iter->stack[iter->top++] = node;
+        }
+}
+
+/**
+ * @brief Pop the next node in the key order
+ *
+ * @return struct rb_td_node* next node (NULL means the end)
+ */
+static struct rb_td_node *rb_td_iter_pop(struct rb_td_iter *iter)
+{
+        struct rb_td_node *node = NULL;
+
+        if (iter->top == 0) {
+                return NULL;
+        }
+        node = iter->stack[--iter->top];
+        rb_td_iter_push(iter, node->link[RB_TD_RIGHT]);
+        return node;
+}
+
+/**
+ * @brief Initialize the iterator at the first key which is not less than
+ * the first
+ *
+ * @param tdtree top-down tree whole
+ * @param iter iterator to initialize
+ * @param first first key of the iteration
+ */
+void rb_td_iter_init(struct rb_td_tree *tdtree, struct rb_td_iter *iter,
+                     key_t first)
+{
+        struct rb_td_node *node = tdtree->root;
+
+        iter->top = 0;
+        while (node) { /**< keep the ancestors which are not less than first */
+                if (node->key >= first) {
+                        iter->stack[iter->top++] = node;
+                        node = node->link[RB_TD_LEFT];
+                } else {
+                        node = node->link[RB_TD_RIGHT];
+                }
+        }
+}
+
+/**
+ * @brief Get the next key of the iterator
+ *
+ * @param iter initialized iterator
+ * @param key key stored location (nullable)
+ * @param data data stored location (nullable)
+ * @return int 0 means that the key is returned. -ENODATA means the end.
+ */
+int rb_td_iter_next(struct rb_td_iter *iter, key_t *key, void **data)
+{
+        return rb_td_entry(rb_td_iter_pop(iter), key, data);
+}
+
+/**
+ * @brief Visit the keys in [first, last] in the key order
+ *
+ * @param tdtree top-down tree whole
+ * @param first first key of the range
+ * @param last last key of the range (inclusive)
+ * @param fn visitor
+ * @param arg user argument
+ * @return int 0 means that every key is visited. Else, the visitor's
+ * return value which stopped the scan.
+ */
+int rb_td_tree_for_each(struct rb_td_tree *tdtree, key_t first, key_t last,
+                        rb_td_fn fn, void *arg)
+{
+        struct rb_td_iter iter;
+        struct rb_td_node *node = NULL;
+        int ret;
+
+        rb_td_iter_init(tdtree, &iter, first);
+        while ((node = rb_td_iter_pop(&iter)) && node->key <= last) {
+                ret = fn(node->key, node->data, arg);
+                if (ret) {
+                        return ret;
+                }
+        }
+        return 0;
+}
+
+/**
+ * @brief Link nodes[lo] ... nodes[hi - 1] as a balanced subtree
+ * @details
+ * The halves differ by one node at most, so every leaf is at the same
+ * depth or one more. Then, the nodes at the deepest depth are red and the
+ * others are black.
+ *
+ * @return struct rb_td_node* root of the subtree
+ */
+static struct rb_td_node *rb_td_tree_link(struct rb_td_node **nodes,
+                                          size_t lo, size_t hi,
+                                          unsigned int depth,
+                                          unsigned int red_depth)
+{
+        size_t mid = lo + (hi - lo) / 2;
+        struct rb_td_node *node = NULL;
+
+        if (lo == hi) {
+                return NULL;
+        }
+        node = nodes[mid];
+        node->link[RB_TD_LEFT] =
+                rb_td_tree_link(nodes, lo, mid, depth + 1, red_depth);
+        node->link[RB_TD_RIGHT] =
+                rb_td_tree_link(nodes, mid + 1, hi, depth + 1, red_depth);
+        node->color = (depth == red_depth) ? RB_NODE_COLOR_RED :
+                                             RB_NODE_COLOR_BLACK;
+        return node;
+}
+
+/**
+ * @brief Make the tree of the sorted nodes in O(n)
+ */
+static void rb_td_tree_build(struct rb_td_tree *tdtree,
+                             struct rb_td_node **nodes, size_t nr_keys)
+{
+        unsigned int red_depth = 0;
+
+        while (((size_t)2 << red_depth) - 1 < nr_keys) {
+                red_depth++; /**< depth of the deepest node */
+        }
+        tdtree->root = rb_td_tree_link(nodes, 0, nr_keys, 0, red_depth);
+        tdtree->nr_keys = nr_keys;
+        if (tdtree->root) {
+                tdtree->root->color = RB_NODE_COLOR_BLACK;
+        }
+}
+
+/**
+ * @brief Copy the nodes of the tree in the key order
+ */
+static void rb_td_tree_gather(struct rb_td_tree *tdtree,
+                              struct rb_td_node **nodes)
+{
+        struct rb_td_iter iter;
+        struct rb_td_node *node = NULL;
+
+        iter.top = 0;
+        rb_td_iter_push(&iter, tdtree->root);
+        while ((node = rb_td_iter_pop(&iter))) {
+                *nodes++ = node;
+        }
+}
+
+/**
+ * @brief Split tree to t1, t2 based on key value x
+ * @details
+ * Both halves are linked again from the nodes in the key order, so it
+ * takes O(n) and no node is allocated.
+ *
+ * @param tdtree split target tree (reused as t1)
+ * @param x split point (the keys less than or equal to x go to t1)
+ * @param t1 t1 stored location
+ * @param t2 t2 stored location
+ * @return int 0 means success. Else, the keys are not moved.
+ */
+int rb_td_tree_split(struct rb_td_tree *tdtree, key_t x,
+                     struct rb_td_tree **t1, struct rb_td_tree **t2)
+{
+        size_t nr_keys = tdtree->nr_keys, pos = 0;
+        struct rb_td_node **nodes = (struct rb_td_node **)malloc(
+                sizeof(struct rb_td_node *) * (nr_keys + 1));
+        struct rb_td_tree *upper = rb_td_tree_alloc();
+
+        if (!nodes || !upper) {
+                pr_info("Memory allocation failed\n");
+                free(nodes);
+                free(upper);
+                return -ENOMEM;
+        }
+        rb_td_tree_gather(tdtree, nodes);
+        while (pos < nr_keys && nodes[pos]->key <= x) {
+                pos++;
+        }
+        rb_td_tree_build(tdtree, nodes, pos);
+        rb_td_tree_build(upper, &nodes[pos], nr_keys - pos);
+        free(nodes);
+
+        *t1 = tdtree;
+        *t2 = upper;
+        return 0;
+}
+
+/**
+ * @brief Concatenate two trees (every key of t1 is less than t2's)
+ *
+ * @param t1 tree which has the smaller keys (reused as the result)
+ * @param t2 tree which has the greater keys (freed)
+ * @return struct rb_td_tree* concatenated tree. NULL means that t1 and t2
+ * are not changed.
+ */
+struct rb_td_tree *rb_td_tree_concat(struct rb_td_tree *t1,
+                                     struct rb_td_tree *t2)
+{
+        size_t nr_keys = t1->nr_keys + t2->nr_keys;
+        struct rb_td_node **nodes = NULL;
+        key_t max, min;
+
+        if (rb_td_tree_minimum(t2, &min, NULL)) {
+                rb_td_tree_dealloc(t2);
+                return t1;
+        }
+        if (rb_td_tree_maximum(t1, &max, NULL) == 0 && max >= min) {
+                pr_info("invalid state key state t1.max < t2.min\n");
+                return NULL;
+        }
+        nodes = (struct rb_td_node **)malloc(sizeof(struct rb_td_node *) *
+                                             nr_keys);
+        if (!nodes) {
+                pr_info("Memory allocation failed\n");
+                return NULL;
+        }
+        rb_td_tree_gather(t1, nodes);
+        rb_td_tree_gather(t2, &nodes[t1->nr_keys]);
+        rb_td_tree_build(t1, nodes, nr_keys);
+        free(nodes);
+        free(t2);
+        return t1;
+}
+
+/**
+ * @brief Bytes of the nodes
+ *
+ * @param tdtree top-down tree whole
+ * @return size_t bytes which the tree allocates (without the data)
+ */
+size_t rb_td_tree_bytes(struct rb_td_tree *tdtree)
+{
+        return sizeof(struct rb_td_tree) +
+               tdtree->nr_keys * sizeof(struct rb_td_node);
+}
+
+static void __rb_td_tree_dealloc(struct rb_td_node *node)
+{
+        if (!node) {
+                return;
+        }
+        __rb_td_tree_dealloc(node->link[RB_TD_LEFT]);
+        __rb_td_tree_dealloc(node->link[RB_TD_RIGHT]);
+        free(node->data);
+        free(node);
+}
+
+/**
+ * @brief Does deallocation of the top-down tree with its data
+ *
+ * @param tdtree top-down tree whole
+ */
+void rb_td_tree_dealloc(struct rb_td_tree *tdtree)
+{
+        __rb_td_tree_dealloc(tdtree->root);
+        free(tdtree);
+}
@@ -0,0 +1,93 @@
+/**
+ * @file rb-td-tree.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief top-down red black tree without parent pointers' declaration part
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @ref Guibas, L. J., & Sedgewick, R. (1978). A dichromatic framework for balanced trees. FOCS.
+ *
+ * @details
+ * Insert and delete fix the colors on the way down in one pass: insert
+ * splits the 4-nodes (a black node with two red children) before it goes
+ * down and delete pushes a red node down to the node which is removed.
+ * So, no operation goes back up and the node has no parent pointer. The
+ * in-order walk uses an explicit stack of the ancestors
+ * (`struct rb_td_iter`).
+ *
+ * The keys are unique and, like `struct rb_tree`, the tree owns the data:
+ * it is freed by delete, by the update of the same key and by dealloc.
+ */
+#ifndef RB_TD_TREE_H_
+#define RB_TD_TREE_H_
+
+#include "rb-tree.h"
+
+#define RB_TD_LEFT (0)
+#define RB_TD_RIGHT (1)
+
+/**
+ * @brief Node of the top-down tree (NULL is the leaf)
+ *
+ */
+struct rb_td_node {
+        key_t key;
+        void *data;
+        struct rb_td_node *link[2]; /**< RB_TD_LEFT and RB_TD_RIGHT */
+        enum rb_node_color color;
+};
+
+/**
+ * @brief Top-down red-black tree
+ *
+ */
+struct rb_td_tree {
+        struct rb_td_node *root;
+        size_t nr_keys;
+};
+
+/**
+ * @brief In-order iterator of the tree
+ * @warning The update of the tree invalidates the iterator.
+ *
+ */
+struct rb_td_iter {
+        struct rb_td_node *stack[RB_MAX_HEIGHT]; /**< next nodes on the top */
+        int top;
+};
+
+/**
+ * @brief Visitor of the range scan
+ *
+ * @param key visited key
+ * @param data data of the key
+ * @param arg user argument
+ * @return int 0 means continue. Not 0 stops the scan.
+ */
+typedef int (*rb_td_fn)(key_t key, void *data, void *arg);
+
+struct rb_td_tree *rb_td_tree_alloc(void);
+int rb_td_tree_search(struct rb_td_tree *tdtree, key_t key, void **data);
+int rb_td_tree_lower_bound(struct rb_td_tree *tdtree, key_t key, key_t *found,
+                           void **data);
+int rb_td_tree_successor(struct rb_td_tree *tdtree, key_t key, key_t *next,
+                         void **data);
+int rb_td_tree_minimum(struct rb_td_tree *tdtree, key_t *key, void **data);
+int rb_td_tree_maximum(struct rb_td_tree *tdtree, key_t *key, void **data);
+int rb_td_tree_insert(struct rb_td_tree *tdtree, key_t key, void *data);
+int rb_td_tree_delete(struct rb_td_tree *tdtree, key_t key);
+void rb_td_iter_init(struct rb_td_tree *tdtree, struct rb_td_iter *iter,
+                     key_t first);
+int rb_td_iter_next(struct rb_td_iter *iter, key_t *key, void **data);
+int rb_td_tree_for_each(struct rb_td_tree *tdtree, key_t first, key_t last,
+                        rb_td_fn fn, void *arg);
+int rb_td_tree_split(struct rb_td_tree *tdtree, key_t x,
+                     struct rb_td_tree **t1, struct rb_td_tree **t2);
+struct rb_td_tree *rb_td_tree_concat(struct rb_td_tree *t1,
+                                     struct rb_td_tree *t2);
+size_t rb_td_tree_bytes(struct rb_td_tree *tdtree);
+void rb_td_tree_dealloc(struct rb_td_tree *tdtree);
+
+#endif
@@ -0,0 +1,27 @@
+/**
+ * @file rb-tree-internal.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief red black tree's balancing primitives shared by the tree variants
+ * @version 0.1
+ * @date 2020-05-29
+ * 
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ * 
+ * @note The fixup and the delete only touch the color and the links of the
+ * nodes. So, any node type which embeds `struct rb_node` can reuse them.
+ * The insert compares `key_t` keys, so it is only for the plain
+ * `struct rb_node` (e.g. the wrappers which allocate and free the nodes
+ * out of their lock).
+ */
+#ifndef RB_TREE_INTERNAL_H_
+#define RB_TREE_INTERNAL_H_
+
+#include "rb-tree.h"
+
+#define RB_TREE_UPDATED (1) /**< `__rb_tree_insert` updated the key's data */
+
+void rb_tree_insert_fixup(struct rb_tree *tree, struct rb_node *z);
+int __rb_tree_insert(struct rb_tree *tree, struct rb_node *z);
+void __rb_tree_delete(struct rb_tree *tree, struct rb_node *z);
+
+#endif
@@ -10,13 +10,22 @@
  * 
  */
 #include <stdlib.h>
+#include <pthread.h>
 #include "rb-tree.h"
+#include "rb-tree-internal.h"
+#include "rb-ebr.h"
+#include "rb-arena.h"
+#include "rb-rwlock.h"
 
+/**
+ * @brief The nil is detected by its address, never by its key.
+ * So, every key_t value can be inserted.
+ */
 static struct rb_global_info rb_info = {
         .nil = { 
                 .color = RB_NODE_COLOR_BLACK,
 
-                .key = RB_NODE_NIL_KEY_VALUE,
+                .key = 0,
                 .data = NULL,
 
                 .left = NULL,
@@ -31,6 +40,17 @@ static struct rb_global_info rb_info = {
  * @return struct rb_tree* allocated red-black tree
  */
 struct rb_tree *rb_tree_alloc(void)
+{
+        return rb_tree_alloc_flags(0);
+}
+
+/**
+ * @brief Allocation of red-black tree with specific behavior
+ * 
+ * @param flags combination of RB_TREE_FLAG_* values
+ * @return struct rb_tree* allocated red-black tree
+ */
+struct rb_tree *rb_tree_alloc_flags(unsigned int flags)
 {
         struct rb_tree *tree = (struct rb_tree *)malloc(sizeof(struct rb_tree));
         if (!tree) {
@@ -41,6 +61,13 @@ struct rb_tree *rb_tree_alloc(void)
         tree->nil = &rb_info.nil;
         tree->root = tree->nil;
         tree->bh = 0;
+        tree->flags = flags;
+        atomic_init(&tree->seq, 0);
+        tree->retired = NULL;
+        tree->ebr = NULL;
+        tree->snapshot = NULL;
+        tree->cursors = NULL;
+        tree->compact = NULL;
 
         return tree;
 exception:
@@ -55,6 +82,360 @@ exception:
         return NULL;
 }
 
+/**
+ * @brief Load the value which a writer can change concurrently
+ */
+#define RB_READ_ONCE(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+
+/**
+ * @brief Load the link which a writer can publish concurrently
+ * @details
+ * This pairs with `RB_PUBLISH`, so the fields of the loaded node are
+ * initialized.
+ */
+#define RB_READ_LINK(x) __atomic_load_n(&(x), __ATOMIC_CONSUME)
+
+/**
+ * @brief Publish the link after the node which it points is initialized
+ */
+#define RB_PUBLISH(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+
+/**
+ * @brief Start the structural change which optimistic readers must detect
+ * 
+ * @param tree red-black tree whole
+ */
+static inline void rb_tree_write_begin(struct rb_tree *tree)
+{
+        unsigned long seq;
+
+        if (!(tree->flags & RB_TREE_FLAG_OPTIMISTIC)) {
+                return;
+        }
+        seq = atomic_load_explicit(&tree->seq, memory_order_relaxed);
+        atomic_store_explicit(&tree->seq, seq + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+}
+
+static inline void rb_tree_write_end(struct rb_tree *tree)
+{
+        unsigned long seq;
+
+        if (!(tree->flags & RB_TREE_FLAG_OPTIMISTIC)) {
+                return;
+        }
+        seq = atomic_load_explicit(&tree->seq, memory_order_relaxed);
+        atomic_store_explicit(&tree->seq, seq + 1, memory_order_release);
+}
+
+static void rb_node_free(void *node)
+{
+        rb_node_dealloc((struct rb_node *)node);
+}
+
+/**
+ * @brief Free the node which is unlinked from the tree
+ * @details
+ * Lock-free readers can still hold the node. So, the node is retired to
+ * the epoch based reclamation or kept in the retired list until
+ * `rb_tree_reclaim`. If the retire fails, the writer waits for the
+ * readers and frees the node at once.
+ * 
+ * @param tree red-black tree whole
+ * @param node unlinked node
+ */
+static void rb_tree_free_node(struct rb_tree *tree, struct rb_node *node)
+{
+        if (tree->snapshot) { /**< the snapshot can still reach the node */
+                node->parent = tree->snapshot->retired;
+                tree->snapshot->retired = node;
+                return;
+        }
+        if (tree->ebr) {
+                if (rb_ebr_retire(tree->ebr, node, rb_node_free)) {
+                        rb_ebr_synchronize(tree->ebr); /**< no reader has it */
+                        rb_node_dealloc(node);
+                }
+                return;
+        }
+        if (!(tree->flags & RB_TREE_FLAG_OPTIMISTIC)) {
+                rb_node_dealloc(node);
+                return;
+        }
+        node->parent = tree->retired; /**< readers never follow the parent */
+        tree->retired = node;
+}
+
+/**
+ * @brief Progress of the compaction
+ * @details
+ * The nodes are moved in the key order. The blocks grow twice, so a pass
+ * over n nodes uses O(log n) blocks without counting the nodes first.
+ * 
+ */
+struct rb_compact {
+        struct rb_arena **blocks; /**< blocks of this pass (the last is filled) */
+        size_t nr_blocks;
+        struct rb_node *next; /**< the pass continues here (nullable) */
+};
+
+/**
+ * @brief Finish the compaction pass (the moved nodes keep their blocks)
+ * 
+ * @param tree red-black tree whole
+ */
+static void rb_tree_compact_stop(struct rb_tree *tree)
+{
+        struct rb_compact *compact = tree->compact;
+
+        if (!compact) {
+                return;
+        }
+        for (size_t i = 0; i < compact->nr_blocks; i++) {
+                rb_arena_release(compact->blocks[i]);
+        }
+        free(compact->blocks);
+        free(compact);
+        tree->compact = NULL;
+}
+
+/**
+ * @brief Free the tree structure which is consumed by split or concat
+ * 
+ * @param tree consumed tree (its nodes are moved to the other tree)
+ */
+static void rb_tree_free_struct(struct rb_tree *tree)
+{
+        rb_tree_compact_stop(tree);
+        rb_tree_reclaim(tree);
+        if (tree->ebr) {
+                if (!rb_ebr_retire(tree->ebr, tree, free)) {
+                        return;
+                }
+                rb_ebr_synchronize(tree->ebr); /**< the retire failed */
+        }
+        free(tree);
+}
+
+/**
+ * @brief Slot of the snapshot map
+ * 
+ */
+struct rb_snapshot_slot {
+        struct rb_node *node; /**< origin (NULL means the empty slot) */
+        struct rb_node *copy; /**< state of the origin at the snapshot */
+};
+
+/**
+ * @brief Open addressing map from the changed nodes to their copies
+ * @details
+ * The writer never moves a published slot. A map which would be more
+ * than half full is replaced by a twice larger one, and the replaced map
+ * is kept until the snapshot is freed because readers can still probe it.
+ * 
+ */
+struct rb_snapshot_map {
+        struct rb_snapshot_map *old; /**< replaced map */
+        size_t nr_slots; /**< power of two */
+        struct rb_snapshot_slot slots[];
+};
+
+static inline size_t rb_snapshot_hash(const struct rb_node *node,
+                                      size_t nr_slots)
+{
+        uint64_t hash = (uint64_t)(uintptr_t)node * 0x9E3779B97F4A7C15ULL;
+
+        return (size_t)(hash >> 32) & (nr_slots - 1);
+}
+
+/**
+ * @brief Find the copy of the node
+ * 
+ * @param map snapshot map (nullable)
+ * @param node origin
+ * @return struct rb_node* copy (NULL means that the node is not changed)
+ */
+static struct rb_node *rb_snapshot_map_find(struct rb_snapshot_map *map,
+                                            const struct rb_node *node)
+{
+        struct rb_node *origin = NULL;
+        size_t i;
+
+        if (!map) {
+                return NULL;
+        }
+        i = rb_snapshot_hash(node, map->nr_slots);
+        for (;; i = (i + 1) & (map->nr_slots - 1)) {
+                origin = __atomic_load_n(&map->slots[i].node,
+                                         __ATOMIC_ACQUIRE);
+                if (origin == node) {
+                        return map->slots[i].copy;
+                }
+                if (!origin) {
+                        return NULL;
+                }
+        }
+}
+
+/**
+ * @brief Publish the copy of the node (the map must have an empty slot)
+ */
+static void rb_snapshot_map_add(struct rb_snapshot_map *map,
+                                struct rb_node *node, struct rb_node *copy)
+{
+        size_t i = rb_snapshot_hash(node, map->nr_slots);
+
+        while (map->slots[i].node) {
+                i = (i + 1) & (map->nr_slots - 1);
+        }
+        map->slots[i].copy = copy;
+        __atomic_store_n(&map->slots[i].node, node, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Keep the state of the node for the live snapshot
+ * @details
+ * This must be called before the key, data, left or right of the node is
+ * changed. Only the first change after `rb_tree_snapshot` copies the node.
+ * 
+ * @param tree red-black tree whole
+ * @param node the node which will be changed
+ */
+static void rb_tree_preserve(struct rb_tree *tree, struct rb_node *node)
+{
+        struct rb_snapshot *snapshot = tree->snapshot;
+        struct rb_node *copy = NULL;
+
+        if (!snapshot || node == tree->nil ||
+            rb_snapshot_map_find(snapshot->map, node)) {
+                return;
+        }
+
+        copy = snapshot->spare; /**< reserved by `rb_tree_snapshot_reserve` */
+        snapshot->spare = copy->parent;
+        snapshot->nr_spare--;
+
+        copy->key = node->key;
+        copy->data = node->data;
+        copy->left = node->left;
+        copy->right = node->right;
+        copy->parent = node; /**< origin (the snapshot never reads it) */
+
+        rb_snapshot_map_add(snapshot->map, node, copy);
+        snapshot->nr_copies++;
+        atomic_thread_fence(memory_order_release); /**< before the changes */
+}
+
+/**
+ * @brief Replace the map by a larger one which has every copy
+ * 
+ * @param snapshot live snapshot
+ * @param nr_slots slots of the new map (power of two)
+ * @return int 0 means success. -ENOMEM means allocation failed.
+ */
+static int rb_snapshot_map_grow(struct rb_snapshot *snapshot, size_t nr_slots)
+{
+        struct rb_snapshot_map *old = snapshot->map;
+        struct rb_snapshot_map *map = NULL;
+
+        map = (struct rb_snapshot_map *)calloc(
+                1, sizeof(*map) + nr_slots * sizeof(struct rb_snapshot_slot));
+        if (!map) {
+                pr_info("Memory allocation failed\n");
+                return -ENOMEM;
+        }
+        map->old = old;
+        map->nr_slots = nr_slots;
+        for (size_t i = 0; old && i < old->nr_slots; i++) {
+                if (old->slots[i].node) {
+                        rb_snapshot_map_add(map, old->slots[i].node,
+                                            old->slots[i].copy);
+                }
+        }
+        __atomic_store_n(&snapshot->map, map, __ATOMIC_RELEASE);
+        return 0;
+}
+
+/**
+ * @brief Reserve the copies and the map slots of one insert or delete
+ * 
+ * @param tree red-black tree whole
+ * @return int 0 means success. -ENOMEM means allocation failed.
+ */
+static int rb_tree_snapshot_reserve(struct rb_tree *tree)
+{
+        struct rb_snapshot *snapshot = tree->snapshot;
+        struct rb_node *copy = NULL;
+        size_t nr_slots;
+
+        if (!snapshot) {
+                return 0;
+        }
+        nr_slots = snapshot->map ? snapshot->map->nr_slots : 0;
+        if (2 * (snapshot->nr_copies + RB_SNAPSHOT_RESERVE) > nr_slots) {
+                nr_slots = nr_slots ? 2 * nr_slots : 4 * RB_SNAPSHOT_RESERVE;
+                if (rb_snapshot_map_grow(snapshot, nr_slots)) {
+                        return -ENOMEM;
+                }
+        }
+        while (snapshot->nr_spare < RB_SNAPSHOT_RESERVE) {
+                copy = (struct rb_node *)malloc(sizeof(struct rb_node));
+                if (!copy) {
+                        pr_info("Memory allocation failed\n");
+                        return -ENOMEM;
+                }
+                copy->parent = snapshot->spare;
+                snapshot->spare = copy;
+                snapshot->nr_spare++;
+        }
+        return 0;
+}
+
+/**
+ * @brief Free the snapshot with its copies and the deleted nodes
+ * 
+ * @param tree red-black tree whole
+ */
+static void rb_tree_snapshot_free(struct rb_tree *tree)
+{
+        struct rb_snapshot *snapshot = tree->snapshot;
+        struct rb_snapshot_map *map = snapshot->map;
+        struct rb_snapshot_map *old = NULL;
+        struct rb_node *node = NULL;
+        struct rb_node *next = NULL;
+
+        tree->snapshot = NULL;
+        for (size_t i = 0; map && i < map->nr_slots; i++) {
+                free(map->slots[i].copy); /**< the newest map has every copy */
+        }
+        for (; map; map = old) {
+                old = map->old;
+                free(map);
+        }
+        for (node = snapshot->spare; node; node = next) {
+                next = node->parent;
+                free(node);
+        }
+        for (node = snapshot->retired; node; node = next) {
+                next = node->parent;
+                rb_tree_free_node(tree, node);
+        }
+        free(snapshot);
+}
+
+/**
+ * @brief Free the snapshot if the reader released it
+ * 
+ * @param tree red-black tree whole
+ */
+static inline void rb_tree_snapshot_gc(struct rb_tree *tree)
+{
+        if (tree->snapshot && atomic_load_explicit(&tree->snapshot->released,
+                                                   memory_order_acquire)) {
+                rb_tree_snapshot_free(tree);
+        }
+}
+
 /**
  * @brief Red-black tree left rotation
  *     (x)                    (y)
@@ -71,6 +452,9 @@ static void rb_tree_left_rotate(struct rb_tree *tree, struct rb_node *x)
         struct rb_node *y = NULL;
 
         y = x->right; /**< set right node */
+        rb_tree_preserve(tree, x);
+        rb_tree_preserve(tree, y);
+        rb_tree_preserve(tree, x->parent);
 
         x->right = y->left; /**< move subtree */
         if (y->left != tree->nil) {
@@ -106,6 +490,9 @@ static void rb_tree_right_rotate(struct rb_tree *tree, struct rb_node *y)
         struct rb_node *x = NULL;
 
         x = y->left; /**< set left node */
+        rb_tree_preserve(tree, x);
+        rb_tree_preserve(tree, y);
+        rb_tree_preserve(tree, y->parent);
 
         y->left = x->right; /**< move subtree */
         if (x->right != tree->nil) {
@@ -129,6 +516,7 @@ static void rb_tree_right_rotate(struct rb_tree *tree, struct rb_node *y)
  * @brief Search red-black tree's node which the same value of key.
  * Based on binary search method
  * 
+ * @param tree red-black tree whole
  * @param root red-black tree's root
  * @param key the key which I want to search
  * @return struct rb_node* if find success then return specific node pointer.
@@ -136,12 +524,13 @@ static void rb_tree_right_rotate(struct rb_tree *tree, struct rb_node *y)
  * d
  * @ref Horowitz, E., Sahni, S., & Anderson-Freed, S. (1992). Fundamentals of data structures in C. WH Freeman & Co..
  */
-static struct rb_node *__rb_tree_search(struct rb_node *root, key_t key)
+static struct rb_node *__rb_tree_search(struct rb_tree *tree,
+                                        struct rb_node *root, key_t key)
 {
         struct rb_node *node = root;
-        while (node) {
+        while (node != tree->nil) {
                 if (key == node->key) { /**< Find the specific values */
-                        break;
+                        return node;
                 }
 
                 if (key < node->key) {
@@ -151,7 +540,50 @@ static struct rb_node *__rb_tree_search(struct rb_node *root, key_t key)
                 }
         }
 
-        return node;
+        return NULL;
+}
+
+/**
+ * @brief Search without any lock
+ * @details
+ * The nodes can be changed during the descent. So, the loaded values are
+ * validated by `seq` and the descent is bounded by the height limit
+ * in case that the reader meets the half-rotated links.
+ * 
+ * @param tree red-black tree whole (RB_TREE_FLAG_OPTIMISTIC)
+ * @param key the key which I want to search
+ * @return struct rb_node* found node or NULL
+ */
+static struct rb_node *rb_tree_search_optimistic(struct rb_tree *tree,
+                                                 key_t key)
+{
+        struct rb_node *node = NULL;
+        struct rb_node *bound = NULL;
+        unsigned long seq;
+        key_t node_key;
+        int depth;
+
+        do {
+                seq = rb_tree_read_begin(tree);
+                node = RB_READ_LINK(tree->root);
+                bound = NULL;
+                for (depth = 0; node != tree->nil && depth < RB_MAX_HEIGHT;
+                     depth++) {
+                        node_key = RB_READ_ONCE(node->key);
+                        if (node_key < key) {
+                                node = RB_READ_LINK(node->right);
+                        } else { /**< lower bound keeps the oldest duplicate */
+                                bound = node_key == key ? node : bound;
+                                if (node_key == key &&
+                                    !rb_tree_is_multi(tree)) {
+                                        break;
+                                }
+                                node = RB_READ_LINK(node->left);
+                        }
+                }
+        } while (depth == RB_MAX_HEIGHT || rb_tree_read_retry(tree, seq));
+
+        return bound;
 }
 
 /**
@@ -164,7 +596,118 @@ static struct rb_node *__rb_tree_search(struct rb_node *root, key_t key)
  */
 struct rb_node *rb_tree_search(struct rb_tree *tree, key_t key)
 {
-        return __rb_tree_search(tree->root, key);
+        struct rb_node *node = NULL;
+
+        if (tree->flags & RB_TREE_FLAG_OPTIMISTIC) {
+                return rb_tree_search_optimistic(tree, key);
+        }
+
+        if (!rb_tree_is_multi(tree)) {
+                return __rb_tree_search(tree, tree->root, key);
+        }
+
+        node = rb_tree_lower_bound(tree, key); /**< oldest duplicate */
+        if (node == tree->nil || node->key != key) {
+                return NULL;
+        }
+        return node;
+}
+
+/**
+ * @brief Find the first node which key is not less than the key
+ * 
+ * @param tree red-black tree whole
+ * @param key lower bound key
+ * @return struct rb_node* first node which `node->key >= key`.
+ * If there is no such node then return tree->nil
+ */
+struct rb_node *rb_tree_lower_bound(struct rb_tree *tree, key_t key)
+{
+        struct rb_node *node = tree->root;
+        struct rb_node *bound = tree->nil;
+
+        while (node != tree->nil) {
+                if (node->key < key) {
+                        node = node->right;
+                } else {
+                        bound = node;
+                        node = node->left;
+                }
+        }
+
+        return bound;
+}
+
+/**
+ * @brief Find the first node which key is greater than the key
+ * 
+ * @param tree red-black tree whole
+ * @param key upper bound key
+ * @return struct rb_node* first node which `node->key > key`.
+ * If there is no such node then return tree->nil
+ */
+struct rb_node *rb_tree_upper_bound(struct rb_tree *tree, key_t key)
+{
+        struct rb_node *node = tree->root;
+        struct rb_node *bound = tree->nil;
+
+        while (node != tree->nil) {
+                if (key < node->key) {
+                        bound = node;
+                        node = node->left;
+                } else {
+                        node = node->right;
+                }
+        }
+
+        return bound;
+}
+
+/**
+ * @brief Get the range of nodes which have the same key
+ * @details
+ * Range is [first, last). Duplicates are ordered by insertion order,
+ * so iterating with `rb_tree_successor` from first to last visits them
+ * from the oldest to the newest one.
+ * 
+ * @param tree red-black tree whole
+ * @param key key which I want to find
+ * @param first first node of the range stored location
+ * @param last next node of the range's last node stored location
+ * @return int 0 means that range is not empty. -ENODATA means there is no key.
+ */
+int rb_tree_equal_range(struct rb_tree *tree, key_t key,
+                        struct rb_node **first, struct rb_node **last)
+{
+        *first = rb_tree_lower_bound(tree, key);
+        *last = rb_tree_upper_bound(tree, key);
+
+        return (*first == *last) ? -ENODATA : 0;
+}
+
+/**
+ * @brief Count the nodes which have the same key
+ * 
+ * @param tree red-black tree whole
+ * @param key key which I want to count
+ * @return size_t number of nodes which have the key
+ */
+size_t rb_tree_count_key(struct rb_tree *tree, key_t key)
+{
+        struct rb_node *node = NULL;
+        struct rb_node *last = NULL;
+        size_t count = 0;
+
+        if (rb_tree_equal_range(tree, key, &node, &last)) {
+                return 0;
+        }
+
+        while (node != last) {
+                count++;
+                node = rb_tree_successor(tree, node);
+        }
+
+        return count;
 }
 
 /**
@@ -181,7 +724,7 @@ size_t __rb_tree_get_bh(struct rb_tree *tree, struct rb_node *root, key_t key)
 {
         size_t bh = tree->bh;
         struct rb_node *node = root;
-        while (node) {
+        while (node != tree->nil) {
                 if (key == node->key) { /**< Find the specific values */
                         break;
                 }
@@ -196,7 +739,7 @@ size_t __rb_tree_get_bh(struct rb_tree *tree, struct rb_node *root, key_t key)
                 }
         }
 
-        if (node == NULL) {
+        if (node == tree->nil) {
                 bh = RB_INVALID_BLACK_HEIGHT;
         }
 
@@ -225,7 +768,7 @@ size_t rb_tree_get_bh(struct rb_tree *tree, key_t key)
  * @param tree red-black tree structure
  * @param z new node which insert into red-black tree
  */
-static void rb_tree_insert_fixup(struct rb_tree *tree, struct rb_node *z)
+void rb_tree_insert_fixup(struct rb_tree *tree, struct rb_node *z)
 {
         struct rb_node *y = NULL;
 
@@ -274,12 +817,18 @@ static void rb_tree_insert_fixup(struct rb_tree *tree, struct rb_node *z)
 
 /**
  * @brief Insert node to red-black tree
+ * @details
+ * This only links the node. So, the caller allocates the node and does
+ * the snapshot reservation and the seqlock write section if it needs them.
+ * If the key exists (not multimap), z's data replaces the old one and z
+ * takes the old data instead of being linked. Then, the caller frees z.
  * 
  * @param tree red-black tree structure
  * @param z new node which insert into red-black tree
- * @return int successfully insert status (0: success, else: fail)
+ * @return int 0 means that z is linked. RB_TREE_UPDATED means that the key
+ * exists and z has the old data. -ENOMEM means that z is NULL.
  */
-static int __rb_tree_insert(struct rb_tree *tree, struct rb_node *z)
+int __rb_tree_insert(struct rb_tree *tree, struct rb_node *z)
 {
         struct rb_node *y = NULL;
         struct rb_node *x = NULL;
@@ -289,18 +838,15 @@ static int __rb_tree_insert(struct rb_tree *tree, struct rb_node *z)
                 return -ENOMEM;
         }
 
-        if (z->key == RB_NODE_NIL_KEY_VALUE) {
-                pr_info("%ld key value is preserved by tree->nil\n",
-                        RB_NODE_NIL_KEY_VALUE);
-                return -EINVAL;
-        }
-
         y = tree->nil;
         x = tree->root;
         while (x != tree->nil) {
-                if (x->key == z->key) { /**< update key's data */
-                        rb_node_move(x, z);
-                        return 0;
+                if (x->key == z->key && !rb_tree_is_multi(tree)) {
+                        void *prev_data = x->data; /**< update key's data */
+                        rb_tree_preserve(tree, x);
+                        x->data = z->data;
+                        z->data = prev_data;
+                        return RB_TREE_UPDATED;
                 }
                 y = x;
                 if (z->key < x->key) {
@@ -308,17 +854,9 @@ static int __rb_tree_insert(struct rb_tree *tree, struct rb_node *z)
                 } else {
                         x = x->right;
                 }
-        } /**< traverse valid insert location */
+        } /**< traverse valid insert location (duplicates go right) */
 
         z->parent = y;
-        if (y == tree->nil) { /**< set y state */
-                tree->root = z;
-        } else if (z->key < y->key) {
-                y->left = z;
-        } else {
-                y->right = z;
-        }
-
         if (z->left == NULL) {
                 z->left = tree->nil;
         }
@@ -327,6 +865,15 @@ static int __rb_tree_insert(struct rb_tree *tree, struct rb_node *z)
         }
         z->color = RB_NODE_COLOR_RED;
 
+        rb_tree_preserve(tree, y);
+        if (y == tree->nil) { /**< lock-free readers can reach z from now */
+                RB_PUBLISH(tree->root, z);
+        } else if (z->key < y->key) {
+                RB_PUBLISH(y->left, z);
+        } else {
+                RB_PUBLISH(y->right, z);
+        }
+
         rb_tree_insert_fixup(tree, z);
 
         return 0;
@@ -353,9 +900,20 @@ int rb_tree_insert(struct rb_tree *tree, const key_t key, void *data)
 
         node->data = data;
 
-        ret = __rb_tree_insert(tree, node);
-        if (ret == -EINVAL) {
+        rb_tree_snapshot_gc(tree);
+        ret = rb_tree_snapshot_reserve(tree);
+        if (ret) {
+                node->data = NULL; /**< the caller keeps the data */
                 rb_node_dealloc(node);
+                return ret;
+        }
+
+        rb_tree_write_begin(tree);
+        ret = __rb_tree_insert(tree, node);
+        rb_tree_write_end(tree);
+        if (ret == RB_TREE_UPDATED) { /**< readers can still use the data */
+                rb_tree_free_node(tree, node);
+                ret = 0;
         }
 
         return ret;
@@ -371,6 +929,7 @@ int rb_tree_insert(struct rb_tree *tree, const key_t key, void *data)
 static void rb_tree_transplant(struct rb_tree *tree, struct rb_node *prev_root,
                                struct rb_node *next_root)
 {
+        rb_tree_preserve(tree, prev_root->parent);
         if (prev_root->parent == tree->nil) {
                 tree->root = next_root;
         } else if (prev_root == prev_root->parent->left) {
@@ -379,7 +938,9 @@ static void rb_tree_transplant(struct rb_tree *tree, struct rb_node *prev_root,
                 prev_root->parent->right = next_root;
         }
 
-        next_root->parent = prev_root->parent;
+        if (next_root != tree->nil) { /**< nil is shared by every tree */
+                next_root->parent = prev_root->parent;
+        }
 }
 
 /**
@@ -479,10 +1040,15 @@ struct rb_node *rb_tree_predecessor(struct rb_tree *tree, struct rb_node *y)
  * case 3: x's sibling w is black, w's left child is red, and w's right child is black
  * case 4: x's sibling w is black, and w's right child is red
  * 
+ * The nil is shared by every tree, so its parent is never written.
+ * Instead, the parent of x is tracked in `x_parent`.
+ * 
  * @param tree red-black tree structure
  * @param x rotation key node pointer
+ * @param x_parent parent of x
  */
-static void rb_tree_delete_fixup(struct rb_tree *tree, struct rb_node *x)
+static void rb_tree_delete_fixup(struct rb_tree *tree, struct rb_node *x,
+                                 struct rb_node *x_parent)
 {
         struct rb_node *w = NULL;
         int is_forced = 0;
@@ -490,61 +1056,63 @@ static void rb_tree_delete_fixup(struct rb_tree *tree, struct rb_node *x)
 
         while (x != tree->root && x->color == RB_NODE_COLOR_BLACK) {
                 is_goes_up = 1;
-                if (x == x->parent->left) {
-                        w = x->parent->right;
+                if (x == x_parent->left) {
+                        w = x_parent->right;
                         if (w->color == RB_NODE_COLOR_RED) {
                                 w->color = RB_NODE_COLOR_BLACK;
-                                x->parent->color = RB_NODE_COLOR_RED;
-                                rb_tree_left_rotate(tree, x->parent);
-                                w = x->parent->right;
+                                x_parent->color = RB_NODE_COLOR_RED;
+                                rb_tree_left_rotate(tree, x_parent);
+                                w = x_parent->right;
                         } /**< case 1 */
 
                         if (w->left->color == RB_NODE_COLOR_BLACK &&
                             w->right->color == RB_NODE_COLOR_BLACK) {
                                 w->color = RB_NODE_COLOR_RED;
-                                x = x->parent;
+                                x = x_parent;
+                                x_parent = x->parent;
                         } /**< case 2 */
                         else {
                                 if (w->right->color == RB_NODE_COLOR_BLACK) {
                                         w->left->color = RB_NODE_COLOR_BLACK;
                                         w->color = RB_NODE_COLOR_RED;
                                         rb_tree_right_rotate(tree, w);
-                                        w = x->parent->right;
+                                        w = x_parent->right;
                                 } /**< case 3 */
 
-                                w->color = x->parent->color;
-                                x->parent->color = RB_NODE_COLOR_BLACK;
+                                w->color = x_parent->color;
+                                x_parent->color = RB_NODE_COLOR_BLACK;
                                 w->right->color = RB_NODE_COLOR_BLACK;
-                                rb_tree_left_rotate(tree, x->parent);
+                                rb_tree_left_rotate(tree, x_parent);
                                 x = tree->root; /**< case 4 */
                                 is_forced = 1;
                         }
                 } else { /**< only different part is left and right */
-                        w = x->parent->left;
+                        w = x_parent->left;
                         if (w->color == RB_NODE_COLOR_RED) {
                                 w->color = RB_NODE_COLOR_BLACK;
-                                x->parent->color = RB_NODE_COLOR_RED;
-                                rb_tree_right_rotate(tree, x->parent);
-                                w = x->parent->left;
+                                x_parent->color = RB_NODE_COLOR_RED;
+                                rb_tree_right_rotate(tree, x_parent);
+                                w = x_parent->left;
                         } /**< case 1 */
 
                         if (w->right->color == RB_NODE_COLOR_BLACK &&
                             w->left->color == RB_NODE_COLOR_BLACK) {
                                 w->color = RB_NODE_COLOR_RED;
-                                x = x->parent;
+                                x = x_parent;
+                                x_parent = x->parent;
                         } /**< case 2 */
                         else {
                                 if (w->left->color == RB_NODE_COLOR_BLACK) {
                                         w->right->color = RB_NODE_COLOR_BLACK;
                                         w->color = RB_NODE_COLOR_RED;
                                         rb_tree_left_rotate(tree, w);
-                                        w = x->parent->left;
+                                        w = x_parent->left;
                                 } /**< case 3 */
 
-                                w->color = x->parent->color;
-                                x->parent->color = RB_NODE_COLOR_BLACK;
+                                w->color = x_parent->color;
+                                x_parent->color = RB_NODE_COLOR_BLACK;
                                 w->left->color = RB_NODE_COLOR_BLACK;
-                                rb_tree_right_rotate(tree, x->parent);
+                                rb_tree_right_rotate(tree, x_parent);
                                 x = tree->root; /**< case 4 */
                                 is_forced = 1;
                         }
@@ -553,7 +1121,9 @@ static void rb_tree_delete_fixup(struct rb_tree *tree, struct rb_node *x)
         if (x == tree->nil || (is_goes_up && !is_forced && x == tree->root)) {
                 tree->bh -= 1;
         }
-        x->color = RB_NODE_COLOR_BLACK;
+        if (x != tree->nil) {
+                x->color = RB_NODE_COLOR_BLACK;
+        }
 }
 
 /**
@@ -562,40 +1132,49 @@ static void rb_tree_delete_fixup(struct rb_tree *tree, struct rb_node *x)
  * @param tree red-black tree whole
  * @param z delete target node
  */
-static void __rb_tree_delete(struct rb_tree *tree, struct rb_node *z)
+void __rb_tree_delete(struct rb_tree *tree, struct rb_node *z)
 {
         struct rb_node *x = NULL;
+        struct rb_node *x_parent = NULL;
         struct rb_node *y = NULL;
 
         enum rb_node_color y_original_color;
 
+        if (tree->compact && tree->compact->next == z) {
+                tree->compact->next = rb_tree_successor(tree, z);
+        }
         y = z;
         y_original_color = y->color;
         if (z->left == tree->nil) {
                 x = z->right;
+                x_parent = z->parent;
                 rb_tree_transplant(tree, z, z->right);
         } else if (z->right == tree->nil) {
                 x = z->left;
+                x_parent = z->parent;
                 rb_tree_transplant(tree, z, z->left);
         } else {
                 y = rb_tree_minimum(tree, z->right);
                 y_original_color = y->color;
                 x = y->right;
                 if (y->parent == z) {
-                        x->parent = y;
+                        x_parent = y;
                 } else {
+                        x_parent = y->parent;
                         rb_tree_transplant(tree, y, y->right);
+                        rb_tree_preserve(tree, y);
                         y->right = z->right;
                         y->right->parent = y;
                 }
                 rb_tree_transplant(tree, z, y);
+                rb_tree_preserve(tree, y);
                 y->left = z->left;
                 y->left->parent = y;
                 y->color = z->color;
         }
 
         if (y_original_color == RB_NODE_COLOR_BLACK) {
-                rb_tree_delete_fixup(tree, x);
+                rb_tree_delete_fixup(tree, x, x_parent);
         }
 }
 
@@ -612,18 +1191,137 @@ int rb_tree_delete(struct rb_tree *tree, key_t key)
         if (!node) {
                 return -ENODATA;
         }
+        return rb_tree_delete_node(tree, node);
+}
+
+/**
+ * @brief Delete the specific node in red-black tree
+ * @details
+ * In the multimap, `rb_tree_delete` always deletes the oldest duplicate.
+ * This function deletes the node which is found by `rb_tree_equal_range`.
+ * 
+ * @param tree red-black tree whole
+ * @param node delete target node (it must be in the tree)
+ * @return int 0 means that delete success. Not 0 means delete fail.
+ */
+int rb_tree_delete_node(struct rb_tree *tree, struct rb_node *node)
+{
+        int ret;
+
+        if (!node || node == tree->nil) {
+                return -EINVAL;
+        }
+        rb_tree_snapshot_gc(tree);
+        ret = rb_tree_snapshot_reserve(tree);
+        if (ret) {
+                return ret;
+        }
+        rb_tree_write_begin(tree);
         __rb_tree_delete(tree, node);
-        rb_node_dealloc(node);
+        rb_tree_write_end(tree);
+        rb_tree_free_node(tree, node);
         return 0;
 }
 
+/**
+ * @brief Find the tree which contains the node x
+ * 
+ * @param t1 first candidate tree
+ * @param t2 second candidate tree
+ * @param x target node
+ * @return struct rb_tree* tree which contains x. If x is not linked to
+ * any tree (allocated by `rb_node_alloc`) then return NULL
+ */
+static struct rb_tree *rb_node_owner(struct rb_tree *t1, struct rb_tree *t2,
+                                     struct rb_node *x)
+{
+        if (x->parent == NULL) {
+                return NULL;
+        }
+
+        while (x->parent != t1->nil) {
+                x = x->parent;
+        }
+
+        if (x == t1->root) {
+                return t1;
+        }
+        if (x == t2->root) {
+                return t2;
+        }
+        return NULL;
+}
+
+/**
+ * @brief Join t1, x and t2 into t1
+ * @details
+ * x replaces the black node of the taller tree's spine whose black height
+ * is the same as the other tree's. So, this takes O(|t1->bh - t2->bh| + 1)
+ * and the rebalancing of `rb_tree_insert_fixup`. After this, t2 is empty.
+ * 
+ * @param t1 tree which have all value is smaller than x->key (result)
+ * @param x detached node which value is max(t1->key) <= x <= min(t2->key)
+ * @param t2 tree which have all value is greater than x->key
+ * 
+ * @ref Introduction to Algorithms(CLRS) ▶ red-black tree chapter ▶ problem 13-2
+ */
+static void __rb_tree_join(struct rb_tree *t1, struct rb_node *x,
+                           struct rb_tree *t2)
+{
+        struct rb_tree *taller = (t1->bh >= t2->bh) ? t1 : t2;
+        struct rb_tree *other = (taller == t1) ? t2 : t1;
+        struct rb_node *parent = taller->nil;
+        struct rb_node *y = taller->root;
+        size_t bh = taller->bh;
+        const int is_left = (taller == t2); /**< walk the left spine */
+
+        while (y != taller->nil &&
+               (bh != other->bh || y->color != RB_NODE_COLOR_BLACK)) {
+                if (y->color == RB_NODE_COLOR_BLACK) {
+                        bh -= 1;
+                }
+                parent = y;
+                y = is_left ? y->left : y->right;
+        }
+
+        rb_tree_preserve(taller, parent);
+        x->parent = parent;
+        if (parent == taller->nil) {
+                taller->root = x;
+        } else if (is_left) {
+                parent->left = x;
+        } else {
+                parent->right = x;
+        }
+        x->left = is_left ? other->root : y;
+        x->right = is_left ? y : other->root;
+        if (x->left != taller->nil) {
+                x->left->parent = x;
+        }
+        if (x->right != taller->nil) {
+                x->right->parent = x;
+        }
+        x->color = RB_NODE_COLOR_RED;
+
+        rb_tree_insert_fixup(taller, x);
+
+        t1->root = taller->root;
+        t1->bh = taller->bh;
+        t2->root = t2->nil;
+        t2->bh = 0;
+}
+
 /**
  * @brief Concatenate two red-black tree by using node x
+ * @details
+ * If x is a node of t1 or t2, it is detached first. In the unique key
+ * tree, the fresh x replaces the node which has the same key.
  * 
  * @param t1 red-black tree which have all value is smaller than x->key
  * @param t2 red-black tree which have all value is greater than x->key
  * @param x node which value is over max(t1->key) < x < min(t2->key)
- * @return struct rb_tree* 
+ * (in multimap, max(t1->key) <= x <= min(t2->key))
+ * @return struct rb_tree* concatenated tree (t1 and t2 are freed)
  * 
  * @ref Introduction to Algorithms(CLRS) ▶ red-black tree chapter ▶ problem 13-2
  */
@@ -631,109 +1329,163 @@ struct rb_tree *rb_tree_concat(struct rb_tree *t1, struct rb_tree *t2,
                                struct rb_node *x)
 {
         struct rb_tree *new_tree = NULL;
-        struct rb_node *y = NULL;
+        struct rb_tree *owner = NULL;
         struct rb_node *x1_max_node = NULL;
         struct rb_node *x2_min_node = NULL;
+        struct rb_node **tail = NULL;
 
-        key_t x1_max_key = RB_NODE_NIL_KEY_VALUE;
-        key_t x2_min_key = RB_NODE_NIL_KEY_VALUE;
-
-        size_t bh = 0;
+        rb_tree_snapshot_gc(t1);
+        rb_tree_snapshot_gc(t2);
+        if (t1->snapshot || t2->snapshot) {
+                pr_info("tree which has the live snapshot cannot be consumed\n");
+                return NULL;
+        }
 
         x1_max_node = rb_tree_maximum(t1, t1->root);
         x2_min_node = rb_tree_minimum(t2, t2->root);
 
-        x1_max_key = x1_max_node->key;
-        x2_min_key = x2_min_node->key;
+        /**< The same key is allowed only if the tree is multimap */
+        if ((x1_max_node != t1->nil && x1_max_node->key > x->key) ||
+            (x2_min_node != t2->nil && x->key > x2_min_node->key)) {
+                pr_info("invalid state key state x1.key <= x.key(%" RB_KEY_FMT
+                        ") <= x2.key\n",
+                        x->key);
+                return NULL;
+        }
 
-        /**< Originally allow the same key. But this version doesn't allow it */
-        if (!(x1_max_key <= x->key && x->key <= x2_min_key)) {
-                pr_info("invalid state key state x1.key(%ld) <= x.key(%ld) <= x2.key(%ld)\n",
-                        x1_max_key, x->key, x2_min_key);
+        new_tree = rb_tree_alloc();
+        if (!new_tree) {
+                pr_info("new tree allocation failed...\n");
                 return NULL;
         }
 
-        if (x->key == x1_max_key || x->key == x2_min_key) {
+        owner = rb_node_owner(t1, t2, x);
+        if (owner) { /**< x must be detached from its tree */
                 struct rb_node *prev_x = x;
-                struct rb_tree *tree = (x->key == x1_max_key ? t1 : t2);
-                __rb_tree_delete(tree, prev_x);
                 x = rb_node_alloc(prev_x->key);
+                if (!x) {
+                        pr_info("node allocation failed...\n");
+                        free(new_tree);
+                        return NULL;
+                }
+                rb_tree_write_begin(owner);
+                __rb_tree_delete(owner, prev_x);
+                rb_tree_write_end(owner);
                 x->data = prev_x->data;
                 prev_x->data = NULL;
-                rb_node_dealloc(prev_x);
+                rb_tree_free_node(owner, prev_x);
+        } else if (!rb_tree_is_multi(t1)) { /**< fresh x updates the key */
+                if (x1_max_node != t1->nil && x1_max_node->key == x->key) {
+                        rb_tree_delete_node(t1, x1_max_node);
+                } else if (x2_min_node != t2->nil &&
+                           x2_min_node->key == x->key) {
+                        rb_tree_delete_node(t2, x2_min_node);
+                }
         }
 
-        new_tree = rb_tree_alloc();
-        if (!new_tree) {
-                pr_info("new tree allocation failed...\n");
-                return NULL;
+        rb_tree_write_begin(t1);
+        rb_tree_write_begin(t2);
+        __rb_tree_join(t1, x, t2);
+        rb_tree_write_end(t2);
+        rb_tree_write_end(t1);
+
+        rb_tree_copy(new_tree, t1);
+        new_tree->cursors = NULL;
+        new_tree->compact = NULL;
+        t1->retired = NULL; /**< new_tree owns the retired nodes */
+        for (tail = &new_tree->retired; *tail; tail = &(*tail)->parent) {
         }
+        *tail = t2->retired;
+        t2->retired = NULL;
 
-        if (t1->bh >= t2->bh) {
-                y = t1->root;
-                bh = t1->bh;
-                while (bh != t2->bh) {
-                        if (y->right != t1->nil) {
-                                y = y->right;
-                        } else if (y->left != t1->nil) {
-                                y = y->left;
-                        } else {
-                                break;
-                        }
+        rb_tree_free_struct(t1);
+        rb_tree_free_struct(t2);
 
-                        if (y->color == RB_NODE_COLOR_BLACK) {
-                                bh -= 1;
-                        }
-                }
-
-                rb_tree_transplant(t1, y, x);
-                x->left = y;
-                x->right = t2->root;
-                y->parent = x;
-                t2->root->parent = x;
+        return new_tree;
+}
 
-                rb_tree_insert_fixup(t1, x);
+/**
+ * @brief Make the subtree the standalone tree
+ * 
+ * @param tree tree which contains the subtree
+ * @param sub location where the subtree is stored
+ * @param root the root of the subtree
+ * @param bh black height of the root
+ */
+static void rb_tree_subtree(struct rb_tree *tree, struct rb_tree *sub,
+                            struct rb_node *root, size_t bh)
+{
+        rb_tree_copy(sub, tree);
+        sub->retired = NULL;
+        sub->cursors = NULL;
+        sub->compact = NULL;
+        sub->root = root;
+        sub->bh = bh;
+        if (root == tree->nil) {
+                return;
+        }
+        root->parent = tree->nil;
+        if (root->color == RB_NODE_COLOR_RED) { /**< root must be black */
+                root->color = RB_NODE_COLOR_BLACK;
+                sub->bh += 1;
+        }
+}
 
-                rb_tree_copy(new_tree, t1);
-        } else { /**> symmetric of previous sequence */
-                y = t2->root;
-                bh = t2->bh;
-                while (bh != t1->bh) {
-                        if (y->left != t2->nil) {
-                                y = y->left;
-                        } else if (y->right != t2->nil) {
-                                y = y->right;
-                        } else {
-                                break;
-                        }
+/**
+ * @brief Split the nodes of the tree to t1, t2 based on key value x
+ * @details
+ * The subtrees which hang off the search path of x are joined from the
+ * bottom by `__rb_tree_join`. The black heights of the joined trees
+ * telescope, so this takes O(log n). The nodes are moved, not copied.
+ * 
+ * @param tree split target tree (empty after the split)
+ * @param x split point (the keys less than or equal to x go to t1)
+ * @param t1 empty tree which gets the lower part
+ * @param t2 empty tree which gets the upper part
+ */
+static void __rb_tree_split(struct rb_tree *tree, const key_t x,
+                            struct rb_tree *t1, struct rb_tree *t2)
+{
+        struct rb_node *path[RB_MAX_HEIGHT];
+        size_t heights[RB_MAX_HEIGHT];
+        struct rb_tree sub;
+        struct rb_node *k = NULL;
+        size_t bh = 0;
+        int depth = 0;
 
-                        if (y->color == RB_NODE_COLOR_BLACK) {
-                                bh -= 1;
-                        }
+        k = tree->root;
+        bh = tree->bh;
+        while (k != tree->nil) { /**< search path of x */
+                path[depth] = k;
+                heights[depth++] = bh;
+                if (k->color == RB_NODE_COLOR_BLACK) {
+                        bh -= 1;
                 }
-
-                rb_tree_transplant(t2, y, x);
-                x->left = t1->root;
-                x->right = y;
-                y->parent = x;
-                t1->root->parent = x;
-
-                rb_tree_insert_fixup(t2, x);
-
-                rb_tree_copy(new_tree, t2);
+                k = (x < k->key) ? k->left : k->right;
         }
 
-        free(t1);
-        free(t2);
-
-        return new_tree;
+        while (depth-- > 0) {
+                k = path[depth];
+                bh = heights[depth] - (k->color == RB_NODE_COLOR_BLACK);
+                if (x < k->key) { /**< t2 has the keys of k's left subtree */
+                        rb_tree_subtree(tree, &sub, k->right, bh);
+                        __rb_tree_join(t2, k, &sub);
+                } else { /**< t1 has the keys of k's right subtree */
+                        rb_tree_subtree(tree, &sub, k->left, bh);
+                        __rb_tree_join(&sub, k, t1);
+                        t1->root = sub.root;
+                        t1->bh = sub.bh;
+                }
+        }
+        tree->root = tree->nil;
+        tree->bh = 0;
 }
 
 /**
  * @brief Split tree to t1, t2 based on key value x
  * 
- * @param tree split target tree
- * @param x split point
+ * @param tree split target tree (freed after the split)
+ * @param x split point (the keys less than or equal to x go to t1)
  * @param result1 t1 stored location
  * @param result2 t2 stored location
  * @return int If return value is 0 then success.
@@ -744,46 +1496,35 @@ int rb_tree_split(struct rb_tree *tree, const key_t x, struct rb_tree **result1,
 {
         struct rb_tree *t1 = NULL;
         struct rb_tree *t2 = NULL;
-
-        struct rb_node *k = NULL;
-
         int ret = 0;
 
-        t1 = rb_tree_alloc();
+        rb_tree_snapshot_gc(tree);
+        if (tree->snapshot) {
+                pr_info("tree which has the live snapshot cannot be consumed\n");
+                ret = -EBUSY;
+                goto exception;
+        }
+
+        t1 = rb_tree_alloc_flags(tree->flags);
         if (!t1) {
                 ret = -ENOMEM;
                 goto exception;
         }
-        t2 = rb_tree_alloc();
+        t2 = rb_tree_alloc_flags(tree->flags);
         if (!t2) {
                 ret = -ENOMEM;
                 goto exception;
         }
+        t1->ebr = tree->ebr;
+        t2->ebr = tree->ebr;
 
-        k = tree->root;
-
-        while (k != tree->nil) {
-                struct rb_node *temp = k;
-                if (x < k->key) {
-                        if (k->right != tree->nil) {
-                                __rb_tree_insert(t2, k->right);
-                        }
-                        rb_tree_insert(t2, k->key, k->data);
-                        k = k->left;
-                } else {
-                        if (k->left != tree->nil) {
-                                __rb_tree_insert(t1, k->left);
-                        }
-                        rb_tree_insert(t1, k->key, k->data);
-                        k = k->right;
-                }
-
-                free(temp);
-        }
+        rb_tree_write_begin(tree);
+        __rb_tree_split(tree, x, t1, t2);
+        rb_tree_write_end(tree);
 
         *result1 = t1;
         *result2 = t2;
-        free(tree);
+        rb_tree_free_struct(tree);
         return ret;
 exception:
         if (t1) {
@@ -797,6 +1538,597 @@ exception:
         return ret;
 }
 
+/**
+ * @brief Part of the batch which a thread applies to its own subtree
+ * 
+ */
+struct rb_batch_part {
+        pthread_t thread;
+        struct rb_tree tree; /**< keys in (previous pivot, pivot] */
+        struct rb_batch_op **ops; /**< sorted operations of the part */
+        size_t nr_ops;
+        int is_running; /**< the thread is created */
+};
+
+/**
+ * @brief Apply an operation of the batch
+ * 
+ * @param tree target tree
+ * @param op operation (the result is stored in op->ret)
+ */
+static void rb_tree_apply_op(struct rb_tree *tree, struct rb_batch_op *op)
+{
+        switch (op->type) {
+        case RB_BATCH_INSERT:
+                op->ret = rb_tree_insert(tree, op->key, op->data);
+                break;
+        case RB_BATCH_DELETE:
+                op->ret = rb_tree_delete(tree, op->key);
+                break;
+        default:
+                op->ret = -EINVAL;
+                break;
+        }
+}
+
+static void *rb_tree_apply_part(void *arg)
+{
+        struct rb_batch_part *part = (struct rb_batch_part *)arg;
+
+        for (size_t i = 0; i < part->nr_ops; i++) {
+                rb_tree_apply_op(&part->tree, part->ops[i]);
+        }
+        return NULL;
+}
+
+/**
+ * @brief Sort order of the batch (the same keys keep the batch order)
+ */
+static int rb_batch_op_cmp(const void *a, const void *b)
+{
+        const struct rb_batch_op *x = *(struct rb_batch_op *const *)a;
+        const struct rb_batch_op *y = *(struct rb_batch_op *const *)b;
+
+        if (x->key != y->key) {
+                return (x->key < y->key) ? -1 : 1;
+        }
+        return (x < y) ? -1 : (x > y);
+}
+
+/**
+ * @brief Join the part to the right end of the result without allocation
+ * 
+ * @param result tree which has the smaller keys
+ * @param part tree which has the greater keys (empty after this)
+ */
+static void rb_tree_append_part(struct rb_tree *result, struct rb_tree *part)
+{
+        struct rb_node *x = NULL;
+
+        if (part->root == part->nil) {
+                return;
+        }
+        if (result->root == result->nil) {
+                result->root = part->root;
+                result->bh = part->bh;
+                part->root = part->nil;
+                part->bh = 0;
+                return;
+        }
+        x = rb_tree_maximum(result, result->root); /**< reuse as joint node */
+        __rb_tree_delete(result, x);
+        __rb_tree_join(result, x, part);
+}
+
+/**
+ * @brief Apply the batch of insert and delete operations
+ * @details
+ * The batch is sorted and cut into `nthreads` parts whose keys do not
+ * overlap. The tree is split at the last key of each part, each thread
+ * applies its part to its own subtree, and the subtrees are joined back.
+ * Both the splits and the joins take O(log n) per part. The operations
+ * of the same key are applied in the batch order. If the batch is too
+ * small to pay the threads, it is applied in the batch order by the
+ * current thread.
+ * 
+ * The writers must be serialized by the caller as usual. Optimistic
+ * readers retry until the whole batch is applied.
+ * 
+ * @param tree target tree
+ * @param ops operations (each result is stored in its `ret`)
+ * @param n number of the operations
+ * @param nthreads number of the threads which apply the batch
+ * @return int 0 means that the batch is applied. -EBUSY means that a
+ * snapshot is live. -ENOMEM means that nothing is applied.
+ */
+int rb_tree_apply_batch(struct rb_tree *tree, struct rb_batch_op *ops,
+                        size_t n, int nthreads)
+{
+        struct rb_batch_op **sorted = NULL;
+        struct rb_batch_part *parts = NULL;
+        struct rb_tree rest, upper;
+        struct rb_node **tail = NULL;
+        size_t nr_parts, begin = 0, end;
+        int ret = 0;
+
+        nr_parts = (nthreads > 1) ? (size_t)nthreads : 1;
+        if (nr_parts > n / RB_BATCH_MIN_OPS) {
+                nr_parts = n / RB_BATCH_MIN_OPS;
+        }
+        if (nr_parts <= 1) {
+                for (size_t i = 0; i < n; i++) {
+                        rb_tree_apply_op(tree, &ops[i]);
+                }
+                return 0;
+        }
+
+        rb_tree_snapshot_gc(tree);
+        if (tree->snapshot) {
+                pr_info("tree which has the live snapshot cannot be split\n");
+                return -EBUSY;
+        }
+
+        sorted = (struct rb_batch_op **)malloc(sizeof(*sorted) * n);
+        parts = (struct rb_batch_part *)calloc(nr_parts, sizeof(*parts));
+        if (!sorted || !parts) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                ret = -ENOMEM;
+                goto out;
+        }
+        for (size_t i = 0; i < n; i++) {
+                sorted[i] = &ops[i];
+        }
+        qsort(sorted, n, sizeof(*sorted), rb_batch_op_cmp);
+
+        rb_tree_write_begin(tree);
+        rb_tree_copy(&rest, tree);
+        rest.retired = NULL;
+        for (size_t i = 0; i < nr_parts; i++) {
+                end = (i == nr_parts - 1) ? n : (i + 1) * n / nr_parts;
+                if (end < begin) {
+                        end = begin;
+                }
+                while (end > 0 && end < n &&
+                       sorted[end]->key == sorted[end - 1]->key) {
+                        end++; /**< the same key goes to the same part */
+                }
+                parts[i].ops = &sorted[begin];
+                parts[i].nr_ops = end - begin;
+
+                rb_tree_copy(&parts[i].tree, &rest);
+                parts[i].tree.root = rest.nil;
+                parts[i].tree.bh = 0;
+                atomic_init(&parts[i].tree.seq, 0); /**< private until joined */
+                if (i < nr_parts - 1 && end > begin) {
+                        rb_tree_copy(&upper, &parts[i].tree);
+                        __rb_tree_split(&rest, sorted[end - 1]->key,
+                                        &parts[i].tree, &upper);
+                        rest.root = upper.root;
+                        rest.bh = upper.bh;
+                } else if (i == nr_parts - 1) {
+                        parts[i].tree.root = rest.root;
+                        parts[i].tree.bh = rest.bh;
+                }
+                begin = end;
+        }
+
+        for (size_t i = 1; i < nr_parts; i++) {
+                parts[i].is_running = !pthread_create(&parts[i].thread, NULL,
+                                                      rb_tree_apply_part,
+                                                      &parts[i]);
+                if (!parts[i].is_running) { /**< apply it by myself */
+                        rb_tree_apply_part(&parts[i]);
+                }
+        }
+        rb_tree_apply_part(&parts[0]);
+
+        tail = &tree->retired;
+        for (size_t i = 0; i < nr_parts; i++) {
+                if (parts[i].is_running) {
+                        pthread_join(parts[i].thread, NULL);
+                }
+                if (i > 0) {
+                        rb_tree_append_part(&parts[0].tree, &parts[i].tree);
+                }
+                while (*tail) {
+                        tail = &(*tail)->parent;
+                }
+                *tail = parts[i].tree.retired; /**< deferred free nodes */
+        }
+        tree->root = parts[0].tree.root;
+        tree->bh = parts[0].tree.bh;
+        rb_tree_write_end(tree);
+out:
+        free(sorted);
+        free(parts);
+        return ret;
+}
+
+/**
+ * @brief Count the cache lines on the search paths of the subtree
+ * @details
+ * The search reads the key, data, left and right of each node on the path.
+ * A line which is already read on the path is not counted again.
+ * 
+ * @param tree red-black tree whole
+ * @param node the root of the subtree
+ * @param path lines which are read on the path to the node
+ * @param nr_lines number of the lines in the path
+ * @return size_t sum of the lines of the searches of every node
+ */
+static size_t rb_tree_count_lines(struct rb_tree *tree, struct rb_node *node,
+                                  uintptr_t *path, int nr_lines)
+{
+        uintptr_t first, last;
+        int top = nr_lines, i;
+
+        if (node == tree->nil) {
+                return 0;
+        }
+        first = (uintptr_t)&node->key / RB_CACHE_LINE_SIZE;
+        last = ((uintptr_t)&node->right + sizeof(node->right) - 1) /
+               RB_CACHE_LINE_SIZE;
+        for (uintptr_t line = first; line <= last; line++) {
+                for (i = 0; i < nr_lines && path[i] != line; i++)
+                        ;
+                if (i == nr_lines) {
+                        path[top++] = line;
+                }
+        }
+        return (size_t)top + rb_tree_count_lines(tree, node->left, path, top) +
+               rb_tree_count_lines(tree, node->right, path, top);
+}
+
+static size_t rb_tree_count_nodes(struct rb_tree *tree, struct rb_node *node)
+{
+        if (node == tree->nil) {
+                return 0;
+        }
+        return 1 + rb_tree_count_nodes(tree, node->left) +
+               rb_tree_count_nodes(tree, node->right);
+}
+
+/**
+ * @brief Average cache lines which a successful search reads
+ * 
+ * @param tree red-black tree whole
+ * @return double average of the searches of every key (0 if empty)
+ */
+double rb_tree_search_lines(struct rb_tree *tree)
+{
+        uintptr_t path[2 * RB_MAX_HEIGHT];
+        size_t nr_nodes = rb_tree_count_nodes(tree, tree->root);
+
+        if (!nr_nodes) {
+                return 0;
+        }
+        return (double)rb_tree_count_lines(tree, tree->root, path, 0) /
+               (double)nr_nodes;
+}
+
+static int rb_tree_height(struct rb_tree *tree, struct rb_node *node)
+{
+        int left, right;
+
+        if (node == tree->nil) {
+                return 0;
+        }
+        left = rb_tree_height(tree, node->left);
+        right = rb_tree_height(tree, node->right);
+        return 1 + (left > right ? left : right);
+}
+
+/**
+ * @brief Copy the node to the arena
+ * @details
+ * The parent of the origin points to the copy until the links are
+ * rewired. The lock-free readers never follow the parent.
+ */
+static void rb_tree_relayout_copy(struct rb_node *node, struct rb_arena *arena)
+{
+        struct rb_node *copy = rb_arena_node(arena);
+
+        copy->color = node->color;
+        copy->key = node->key;
+        copy->data = node->data;
+        copy->left = node->left;
+        copy->right = node->right;
+        copy->parent = node->parent;
+        node->parent = copy;
+}
+
+static void rb_tree_veb_place(struct rb_tree *tree, struct rb_node *node,
+                              int height, struct rb_arena *arena);
+
+/**
+ * @brief Place the bottom subtrees which hang `depth` levels below the node
+ */
+static void rb_tree_veb_bottom(struct rb_tree *tree, struct rb_node *node,
+                               int depth, int height, struct rb_arena *arena)
+{
+        if (node == tree->nil) {
+                return;
+        }
+        if (depth == 0) {
+                rb_tree_veb_place(tree, node, height, arena);
+                return;
+        }
+        rb_tree_veb_bottom(tree, node->left, depth - 1, height, arena);
+        rb_tree_veb_bottom(tree, node->right, depth - 1, height, arena);
+}
+
+/**
+ * @brief Place the top `height` levels of the subtree in van Emde Boas order
+ * @details
+ * The top half of the levels is placed first and then each bottom subtree
+ * from the left, all recursively. So, any subtree of about B nodes on a
+ * search path is in O(1) blocks of B nodes for every block size B.
+ */
+static void rb_tree_veb_place(struct rb_tree *tree, struct rb_node *node,
+                              int height, struct rb_arena *arena)
+{
+        int top;
+
+        if (node == tree->nil || height <= 0) {
+                return;
+        }
+        if (height == 1) {
+                rb_tree_relayout_copy(node, arena);
+                return;
+        }
+        top = height / 2;
+        rb_tree_veb_place(tree, node, top, arena);
+        rb_tree_veb_bottom(tree, node, top, height - top, arena);
+}
+
+static inline struct rb_node *rb_tree_relayout_link(struct rb_tree *tree,
+                                                    struct rb_node *node)
+{
+        return (node == tree->nil) ? node : node->parent;
+}
+
+/**
+ * @brief Free the old nodes which are moved to the arena
+ */
+static void rb_tree_relayout_free(struct rb_tree *tree, struct rb_node *node)
+{
+        struct rb_node *left, *right;
+
+        if (node == tree->nil) {
+                return;
+        }
+        left = node->left;
+        right = node->right;
+        node->data = NULL; /**< moved to the copy */
+        rb_tree_free_node(tree, node);
+        rb_tree_relayout_free(tree, left);
+        rb_tree_relayout_free(tree, right);
+}
+
+/**
+ * @brief Move every node to one block in van Emde Boas order
+ * @details
+ * The nodes are copied to a new arena and the links are rewired to the
+ * copies. The old nodes are freed like the deleted nodes, so optimistic
+ * and EBR readers can still walk them. The key, data and color are kept,
+ * but the node pointers which the caller holds are invalid after this
+ * except the attached cursors. The nodes must be allocated by
+ * `rb_tree_insert`.
+ * 
+ * @param tree red-black tree whole
+ * @param stats before and after average cache lines per search (nullable)
+ * @return int 0 means success. -EBUSY means that a snapshot is live.
+ * -ENOMEM means that nothing is changed.
+ */
+int rb_tree_relayout(struct rb_tree *tree, struct rb_relayout_stats *stats)
+{
+        struct rb_arena *arena = NULL;
+        struct rb_node *copy = NULL, *old_root = NULL;
+        struct rb_cursor *cursor = NULL;
+        size_t nr_nodes;
+
+        if (tree->snapshot) {
+                return -EBUSY; /**< the snapshot still reads the old nodes */
+        }
+        rb_tree_compact_stop(tree); /**< every node moves anyway */
+        nr_nodes = rb_tree_count_nodes(tree, tree->root);
+        if (stats) {
+                stats->nr_nodes = nr_nodes;
+                stats->lines_before = rb_tree_search_lines(tree);
+        }
+        if (nr_nodes) {
+                arena = rb_arena_alloc(nr_nodes);
+                if (!arena) {
+                        return -ENOMEM;
+                }
+
+                rb_tree_write_begin(tree);
+                rb_tree_veb_place(tree, tree->root,
+                                  rb_tree_height(tree, tree->root), arena);
+                for (size_t i = 0; i < arena->nr_used; i++) {
+                        copy = rb_arena_at(arena, i);
+                        copy->left = rb_tree_relayout_link(tree, copy->left);
+                        copy->right = rb_tree_relayout_link(tree, copy->right);
+                        copy->parent = rb_tree_relayout_link(tree, copy->parent);
+                }
+                old_root = tree->root;
+                tree->root = rb_tree_relayout_link(tree, old_root);
+                for (cursor = tree->cursors; cursor; cursor = cursor->next) {
+                        cursor->node = rb_tree_relayout_link(tree,
+                                                             cursor->node);
+                }
+                rb_tree_relayout_free(tree, old_root);
+                rb_tree_write_end(tree);
+                rb_arena_release(arena);
+        }
+        if (stats) {
+                stats->lines_after = rb_tree_search_lines(tree);
+        }
+        return 0;
+}
+
+/**
+ * @brief Attach the cursor which follows the node when it moves
+ * 
+ * @param tree red-black tree whole
+ * @param cursor cursor (the caller owns the memory)
+ * @param node node of the tree (tree->nil is allowed)
+ */
+void rb_tree_cursor_attach(struct rb_tree *tree, struct rb_cursor *cursor,
+                           struct rb_node *node)
+{
+        cursor->node = node;
+        cursor->next = tree->cursors;
+        tree->cursors = cursor;
+}
+
+void rb_tree_cursor_detach(struct rb_tree *tree, struct rb_cursor *cursor)
+{
+        struct rb_cursor **link = &tree->cursors;
+
+        while (*link && *link != cursor) {
+                link = &(*link)->next;
+        }
+        if (*link) {
+                *link = cursor->next;
+        }
+        cursor->next = NULL;
+}
+
+/**
+ * @brief Get the next node of the current block (a new block if it is full)
+ */
+static struct rb_node *rb_tree_compact_slot(struct rb_compact *compact)
+{
+        struct rb_arena **blocks = NULL;
+        struct rb_arena *block = NULL;
+        struct rb_node *slot = NULL;
+        size_t capacity = RB_COMPACT_BLOCK_NODES;
+
+        if (compact->nr_blocks) {
+                block = compact->blocks[compact->nr_blocks - 1];
+                slot = rb_arena_node(block);
+                if (slot) {
+                        return slot;
+                }
+                capacity = 2 * block->capacity;
+        }
+        blocks = (struct rb_arena **)realloc(
+                compact->blocks, sizeof(*blocks) * (compact->nr_blocks + 1));
+        if (!blocks) {
+                return NULL;
+        }
+        compact->blocks = blocks;
+        block = rb_arena_alloc(capacity);
+        if (!block) {
+                return NULL;
+        }
+        compact->blocks[compact->nr_blocks++] = block;
+        return rb_arena_node(block);
+}
+
+/**
+ * @brief Move the node to the slot and fix the links which point to it
+ */
+static void rb_tree_compact_move(struct rb_tree *tree, struct rb_node *node,
+                                 struct rb_node *slot)
+{
+        struct rb_cursor *cursor = NULL;
+
+        slot->color = node->color;
+        slot->key = node->key;
+        slot->data = node->data;
+        slot->left = node->left;
+        slot->right = node->right;
+        slot->parent = node->parent;
+
+        if (node->parent == tree->nil) {
+                tree->root = slot;
+        } else if (node->parent->left == node) {
+                node->parent->left = slot;
+        } else {
+                node->parent->right = slot;
+        }
+        if (node->left != tree->nil) {
+                node->left->parent = slot;
+        }
+        if (node->right != tree->nil) {
+                node->right->parent = slot;
+        }
+        for (cursor = tree->cursors; cursor; cursor = cursor->next) {
+                if (cursor->node == node) {
+                        cursor->node = slot;
+                }
+        }
+
+        node->data = NULL; /**< moved to the slot */
+        rb_tree_free_node(tree, node);
+}
+
+/**
+ * @brief Move at most `budget` nodes to the contiguous blocks
+ * @details
+ * Each call continues the pass from the node where the previous call
+ * stopped and moves the nodes in the key order, so a call walks at most
+ * `budget` nodes. So, the in-order walk
+ * and the lower levels of the searches read the neighbor nodes. The tree
+ * can be changed between the calls. The nodes which are inserted behind
+ * the pass are moved by the next pass. The attached cursors follow their
+ * nodes, but the other node pointers of the caller are invalid after the
+ * call. The nodes must be allocated by `rb_tree_insert`.
+ * 
+ * @param tree red-black tree whole
+ * @param budget maximum number of the nodes which are moved by this call
+ * @return int 0 means that the pass is finished. -EAGAIN means that the
+ * pass continues. -EBUSY means that a snapshot is live. -ENOMEM means
+ * that the allocation failed (the pass can be continued later).
+ */
+int rb_tree_compact(struct rb_tree *tree, size_t budget)
+{
+        struct rb_compact *compact = tree->compact;
+        struct rb_node *node = NULL, *next = NULL, *slot = NULL;
+        int ret = -EAGAIN;
+
+        rb_tree_snapshot_gc(tree);
+        if (tree->snapshot) {
+                return -EBUSY; /**< the snapshot still reads the old nodes */
+        }
+        if (!compact) {
+                compact = (struct rb_compact *)calloc(1, sizeof(*compact));
+                if (!compact) {
+                        pr_info("Memory shortage detected! Allocation failed...");
+                        return -ENOMEM;
+                }
+                tree->compact = compact;
+        }
+
+        node = compact->next;
+        if (!node) {
+                node = rb_tree_minimum(tree, tree->root);
+        }
+        rb_tree_write_begin(tree);
+        while (budget > 0 && node != tree->nil) {
+                next = rb_tree_successor(tree, node);
+                slot = rb_tree_compact_slot(compact);
+                if (!slot) {
+                        pr_info("Memory shortage detected! Allocation failed...");
+                        ret = -ENOMEM;
+                        break;
+                }
+                rb_tree_compact_move(tree, node, slot);
+                node = next;
+                budget--;
+        }
+        compact->next = node; /**< `__rb_tree_delete` moves it forward */
+        rb_tree_write_end(tree);
+
+        if (ret == -EAGAIN && node == tree->nil) {
+                rb_tree_compact_stop(tree);
+                ret = 0;
+        }
+        return ret;
+}
+
 /**
  * @brief Does deallocation of the red-black tree subtree
  * 
@@ -817,6 +2149,25 @@ static void __rb_tree_dealloc(struct rb_tree *tree, struct rb_node *node)
         rb_node_dealloc(node);
 }
 
+/**
+ * @brief Free the retired nodes
+ * @warning No optimistic reader can be in `rb_tree_search` at this point.
+ * 
+ * @param tree red-black tree whole
+ */
+void rb_tree_reclaim(struct rb_tree *tree)
+{
+        struct rb_node *node = tree->retired;
+        struct rb_node *next = NULL;
+
+        while (node) {
+                next = node->parent;
+                rb_node_dealloc(node);
+                node = next;
+        }
+        tree->retired = NULL;
+}
+
 /**
  * @brief Does deallocation fo the red-black tree
  * 
@@ -824,14 +2175,171 @@ static void __rb_tree_dealloc(struct rb_tree *tree, struct rb_node *node)
  */
 void rb_tree_dealloc(struct rb_tree *tree)
 {
+        rb_tree_compact_stop(tree);
+        if (tree->snapshot) {
+                rb_tree_snapshot_free(tree);
+        }
         __rb_tree_dealloc(tree, tree->root);
         tree->root = NULL;
+        rb_tree_reclaim(tree);
 
         tree->nil = NULL;
 
         free(tree);
 }
 
+/**
+ * @brief Take the frozen read-only view of the tree
+ * @details
+ * This is serialized with the writers like `rb_tree_insert`. But the
+ * iteration of the snapshot takes no lock, so it can run during the
+ * writes. Only one snapshot can be live at a time.
+ * 
+ * @param tree red-black tree whole
+ * @return struct rb_snapshot* snapshot (NULL means the previous snapshot is
+ * not released or allocation failed)
+ */
+struct rb_snapshot *rb_tree_snapshot(struct rb_tree *tree)
+{
+        struct rb_snapshot *snapshot = NULL;
+
+        rb_tree_snapshot_gc(tree);
+        if (tree->snapshot) {
+                pr_info("previous snapshot is not released\n");
+                return NULL;
+        }
+
+        snapshot = (struct rb_snapshot *)malloc(sizeof(struct rb_snapshot));
+        if (!snapshot) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+        snapshot->root = tree->root;
+        snapshot->nil = tree->nil;
+        atomic_init(&snapshot->released, 0);
+        snapshot->map = NULL;
+        snapshot->nr_copies = 0;
+        snapshot->spare = NULL;
+        snapshot->nr_spare = 0;
+        snapshot->retired = NULL;
+
+        tree->snapshot = snapshot;
+        return snapshot;
+}
+
+/**
+ * @brief Read the node as it was at the snapshot
+ * @details
+ * The writer publishes the copy before it changes the node. So, if the
+ * copy is not published after the fields are read, the fields are not
+ * changed yet.
+ * 
+ * @param snapshot snapshot of the tree
+ * @param node node which the snapshot can reach
+ * @param view location where the state is stored
+ */
+static void rb_snapshot_view(struct rb_snapshot *snapshot,
+                             struct rb_node *node, struct rb_node *view)
+{
+        struct rb_node *copy = rb_snapshot_map_find(
+                __atomic_load_n(&snapshot->map, __ATOMIC_ACQUIRE), node);
+
+        if (!copy) {
+                view->key = RB_READ_ONCE(node->key);
+                view->data = RB_READ_ONCE(node->data);
+                view->left = RB_READ_ONCE(node->left);
+                view->right = RB_READ_ONCE(node->right);
+                atomic_thread_fence(memory_order_acquire);
+                copy = rb_snapshot_map_find(
+                        __atomic_load_n(&snapshot->map, __ATOMIC_ACQUIRE),
+                        node);
+                if (!copy) {
+                        return;
+                }
+        }
+        view->key = copy->key; /**< the copy is never changed */
+        view->data = copy->data;
+        view->left = copy->left;
+        view->right = copy->right;
+}
+
+/**
+ * @brief Push the node and its left spine which are not less than first
+ * 
+ * @param iter snapshot iterator
+ * @param node the root of the subtree
+ * @param first lower bound of the keys
+ */
+static void rb_snapshot_iter_push(struct rb_snapshot_iter *iter,
+                                  struct rb_node *node, key_t first)
+{
+        struct rb_node view;
+
+        while (node != iter->snapshot->nil) {
+                rb_snapshot_view(iter->snapshot, node, &view);
+                if (view.key >= first) {
+                        iter->stack[iter->top++] = node;
+                        node = view.left;
+                } else {
+                        node = view.right;
+                }
+        }
+}
+
+/**
+ * @brief Start the in-order iteration of the snapshot
+ * 
+ * @param snapshot snapshot of the tree
+ * @param iter iterator which will be initialized
+ * @param first first key of the iteration
+ */
+void rb_snapshot_iter_init(struct rb_snapshot *snapshot,
+                           struct rb_snapshot_iter *iter, key_t first)
+{
+        iter->snapshot = snapshot;
+        iter->top = 0;
+        rb_snapshot_iter_push(iter, snapshot->root, first);
+}
+
+/**
+ * @brief Get the next key and data of the snapshot
+ * 
+ * @param iter snapshot iterator
+ * @param key location where the key is stored
+ * @param data location where the data is stored (nullable)
+ * @return int 0 means success. -ENODATA means the end of the snapshot.
+ */
+int rb_snapshot_iter_next(struct rb_snapshot_iter *iter, key_t *key,
+                          void **data)
+{
+        struct rb_node view;
+
+        if (iter->top == 0) {
+                return -ENODATA;
+        }
+
+        rb_snapshot_view(iter->snapshot, iter->stack[--iter->top], &view);
+        *key = view.key;
+        if (data) {
+                *data = view.data;
+        }
+        rb_snapshot_iter_push(iter, view.right, 0);
+        return 0;
+}
+
+/**
+ * @brief Finish the use of the snapshot
+ * @details
+ * The writer frees the snapshot at its next operation. So, the snapshot
+ * and its data cannot be used after this.
+ * 
+ * @param snapshot snapshot of the tree
+ */
+void rb_snapshot_release(struct rb_snapshot *snapshot)
+{
+        atomic_store_explicit(&snapshot->released, 1, memory_order_release);
+}
+
 #ifdef RB_TREE_DEBUG
 static void __rb_tree_dump(struct rb_tree *tree, struct rb_node *root,
                            size_t indent)
@@ -850,7 +2358,7 @@ static void __rb_tree_dump(struct rb_tree *tree, struct rb_node *root,
         for (size_t i = INDENT_SIZE; i < indent; i++) {
                 printf(" ");
         }
-        printf("%ld\n", root->key);
+        printf("%" RB_KEY_FMT "\n", root->key);
 
         __rb_tree_dump(tree, root->left, indent);
 }
@@ -20,6 +20,8 @@
 #include <string.h>
 #include <errno.h>
 #include <limits.h>
+#include <inttypes.h>
+#include <stdatomic.h>
 
 #ifdef key_t
 #warning "already key_t is defined"
@@ -28,8 +30,15 @@ typedef uint64_t key_t;
 #endif
 
 #define RB_INVALID_BLACK_HEIGHT (-1)
-#define RB_MAX_KEY ((key_t)(LONG_MAX))
-#define RB_NODE_NIL_KEY_VALUE (RB_MAX_KEY)
+
+#define RB_TREE_FLAG_MULTI (1U << 0) /**< allow duplicate keys (multimap) */
+#define RB_TREE_FLAG_OPTIMISTIC (1U << 1) /**< lock-free readers (seqlock) */
+#define RB_MAX_KEY ((key_t)(UINT64_MAX)) /**< every key_t value is valid */
+#define RB_KEY_FMT PRIu64
+#define RB_MAX_HEIGHT (128) /**< 2 * log2(n + 1) <= 2 * 64 */
+#define RB_SNAPSHOT_RESERVE (16) /**< node copies per insert or delete */
+#define RB_BATCH_MIN_OPS (1024) /**< operations per thread worth a split */
+#define RB_COMPACT_BLOCK_NODES (1024) /**< first block of the compaction */
 
 #ifndef pr_info
 #define pr_info(msg, ...)                                                      \
@@ -54,6 +63,7 @@ enum rb_node_color {
  */
 struct rb_node {
         enum rb_node_color color;
+        unsigned int pooled; /**< slot number in a rb_arena (see rb-arena.h) */
 
         key_t key;
         void *data; /**< must be allocated in HEAP location */
@@ -62,22 +72,121 @@ struct rb_node {
         struct rb_node *parent; /**< same as P in CLRS books */
 };
 
+struct rb_ebr; /**< see rb-ebr.h */
+struct rb_compact; /**< progress of `rb_tree_compact` */
+struct rb_snapshot_map; /**< changed node to its copy */
+void rb_arena_put(struct rb_node *node); /**< see rb-arena.h */
+
+/**
+ * @brief Frozen read-only view of the tree
+ * @details
+ * While the snapshot is live, the writer copies the key, data and links
+ * of a node to the snapshot map before it changes them for the first
+ * time, and deleted nodes are not freed. So, the snapshot sees every node
+ * as it was at `rb_tree_snapshot`. The trees without the snapshot pay
+ * nothing for it. The copies and the deleted nodes are freed by the writer
+ * after `rb_snapshot_release`.
+ * 
+ */
+struct rb_snapshot {
+        struct rb_node *root; /**< root at the snapshot */
+        struct rb_node *nil;
+        atomic_int released;
+        struct rb_snapshot_map *map; /**< copies of the changed nodes */
+        size_t nr_copies;
+        struct rb_node *spare; /**< reserved copies (linked by parent) */
+        size_t nr_spare;
+        struct rb_node *retired; /**< deleted nodes (linked by parent) */
+};
+
+/**
+ * @brief In-order iterator of the snapshot
+ * 
+ */
+struct rb_snapshot_iter {
+        struct rb_snapshot *snapshot;
+        struct rb_node *stack[RB_MAX_HEIGHT];
+        int top;
+};
+
+/**
+ * @brief Operation type of `rb_tree_apply_batch`
+ * 
+ */
+enum rb_batch_type {
+        RB_BATCH_INSERT,
+        RB_BATCH_DELETE,
+};
+
+/**
+ * @brief Operation of `rb_tree_apply_batch`
+ * 
+ */
+struct rb_batch_op {
+        enum rb_batch_type type;
+        key_t key;
+        void *data; /**< new node's data (insert only) */
+        int ret; /**< result of the operation */
+};
+
+/**
+ * @brief Result of `rb_tree_relayout`
+ * 
+ */
+struct rb_relayout_stats {
+        size_t nr_nodes;
+        double lines_before; /**< average cache lines per search */
+        double lines_after;
+};
+
+/**
+ * @brief Node pointer which the tree fixes up when it moves the node
+ * @details
+ * `rb_tree_relayout` and `rb_tree_compact` move the nodes. The node
+ * pointers which the caller keeps over them must be attached by
+ * `rb_tree_cursor_attach`.
+ * 
+ */
+struct rb_cursor {
+        struct rb_node *node;
+        struct rb_cursor *next;
+};
+
 struct rb_global_info {
         struct rb_node nil;
 };
 
 /**
  * @brief Red black tree structure
+ * @details
+ * In RB_TREE_FLAG_OPTIMISTIC mode, the writers must be serialized by the
+ * caller but `rb_tree_search` takes no lock. The writers make `seq` odd
+ * during the structural changes and the readers retry if `seq` is changed.
+ * Deleted nodes are kept in `retired` until `rb_tree_reclaim`. If `ebr`
+ * is set, they are retired to the epoch based reclamation instead.
  * 
  */
 struct rb_tree {
         struct rb_node *root;
         struct rb_node *nil; /**< same as Nil in CLRS books */
         size_t bh;
+        unsigned int flags; /**< RB_TREE_FLAG_* */
+        atomic_ulong seq; /**< odd while a writer changes the structure */
+        struct rb_node *retired; /**< deferred free nodes (linked by parent) */
+        struct rb_ebr *ebr; /**< reclamation domain (nullable) */
+        struct rb_snapshot *snapshot; /**< live snapshot (nullable) */
+        struct rb_cursor *cursors; /**< attached cursors */
+        struct rb_compact *compact; /**< compaction in progress (nullable) */
 };
 
 struct rb_tree *rb_tree_alloc(void);
+struct rb_tree *rb_tree_alloc_flags(unsigned int flags);
 struct rb_node *rb_tree_search(struct rb_tree *tree, key_t key);
+struct rb_node *rb_tree_lower_bound(struct rb_tree *tree, key_t key);
+struct rb_node *rb_tree_upper_bound(struct rb_tree *tree, key_t key);
+int rb_tree_equal_range(struct rb_tree *tree, key_t key,
+                        struct rb_node **first, struct rb_node **last);
+size_t rb_tree_count_key(struct rb_tree *tree, key_t key);
 size_t rb_tree_get_bh(struct rb_tree *tree, key_t key);
 int rb_tree_insert(struct rb_tree *tree, const key_t key, void *data);
 struct rb_node *rb_tree_minimum(struct rb_tree *tree, struct rb_node *root);
@@ -89,7 +198,23 @@ struct rb_tree *rb_tree_concat(struct rb_tree *t1, struct rb_tree *t2,
 int rb_tree_split(struct rb_tree *tree, const key_t x, struct rb_tree **result1,
                   struct rb_tree **result2);
 int rb_tree_delete(struct rb_tree *tree, key_t key);
+int rb_tree_apply_batch(struct rb_tree *tree, struct rb_batch_op *ops,
+                        size_t n, int nthreads);
+int rb_tree_delete_node(struct rb_tree *tree, struct rb_node *node);
+double rb_tree_search_lines(struct rb_tree *tree);
+int rb_tree_relayout(struct rb_tree *tree, struct rb_relayout_stats *stats);
+int rb_tree_compact(struct rb_tree *tree, size_t budget);
+void rb_tree_cursor_attach(struct rb_tree *tree, struct rb_cursor *cursor,
+                           struct rb_node *node);
+void rb_tree_cursor_detach(struct rb_tree *tree, struct rb_cursor *cursor);
+void rb_tree_reclaim(struct rb_tree *tree);
 void rb_tree_dealloc(struct rb_tree *tree);
+struct rb_snapshot *rb_tree_snapshot(struct rb_tree *tree);
+void rb_snapshot_iter_init(struct rb_snapshot *snapshot,
+                           struct rb_snapshot_iter *iter, key_t first);
+int rb_snapshot_iter_next(struct rb_snapshot_iter *iter, key_t *key,
+                          void **data);
+void rb_snapshot_release(struct rb_snapshot *snapshot);
 
 #ifdef RB_TREE_DEBUG
 void rb_tree_dump(struct rb_tree *tree);
@@ -106,6 +231,80 @@ static inline void rb_tree_copy(struct rb_tree *dest, struct rb_tree *src)
         memcpy(dest, src, sizeof(struct rb_tree));
 }
 
+/**
+ * @brief Free the deleted nodes by the epoch based reclamation
+ * @details
+ * Readers must wrap the search and the use of the found node with
+ * `rb_ebr_enter` and `rb_ebr_exit`. Then, `rb_tree_reclaim` is not needed.
+ * @warning The writers must not be in the critical section. When the
+ * retire fails, the writer calls `rb_ebr_synchronize`.
+ * 
+ * @param tree red-black tree whole
+ * @param ebr reclamation domain (NULL disables it)
+ */
+static inline void rb_tree_set_ebr(struct rb_tree *tree, struct rb_ebr *ebr)
+{
+        tree->ebr = ebr;
+}
+
+/**
+ * @brief Check the tree keeps duplicate keys
+ * 
+ * @param tree red-black tree whole
+ * @return true tree is multimap
+ * @return false tree has unique keys
+ */
+static inline int rb_tree_is_multi(struct rb_tree *tree)
+{
+        return !!(tree->flags & RB_TREE_FLAG_MULTI);
+}
+
+/**
+ * @brief Check the tree has the snapshot which is not released yet
+ * 
+ * @param tree red-black tree whole
+ * @return true the tree cannot be consumed by split or concat
+ * @return false no live snapshot
+ */
+static inline int rb_tree_has_snapshot(struct rb_tree *tree)
+{
+        struct rb_snapshot *snapshot = tree->snapshot;
+
+        return snapshot && !atomic_load_explicit(&snapshot->released,
+                                                 memory_order_acquire);
+}
+
+/**
+ * @brief Start the optimistic read section
+ * 
+ * @param tree red-black tree whole
+ * @return unsigned long sequence which must be passed to `rb_tree_read_retry`
+ */
+static inline unsigned long rb_tree_read_begin(struct rb_tree *tree)
+{
+        unsigned long seq;
+
+        while ((seq = atomic_load_explicit(&tree->seq, memory_order_acquire)) &
+               1) {
+                /**< writer is changing the structure */
+        }
+        return seq;
+}
+
+/**
+ * @brief Check the optimistic read section is overlapped with a writer
+ * 
+ * @param tree red-black tree whole
+ * @param seq return value of `rb_tree_read_begin`
+ * @return true the read values can be inconsistent (read again)
+ * @return false the read values are consistent
+ */
+static inline int rb_tree_read_retry(struct rb_tree *tree, unsigned long seq)
+{
+        atomic_thread_fence(memory_order_acquire);
+        return atomic_load_explicit(&tree->seq, memory_order_relaxed) != seq;
+}
+
 /**
  * @brief Node check if the node is equal to tree->nil
  * 
@@ -129,17 +328,13 @@ static inline struct rb_node *rb_node_alloc(const key_t key)
 {
         struct rb_node *new_node = NULL;
 
-        if (key >= RB_MAX_KEY) {
-                pr_info("Invalid key value\n");
-                return NULL;
-        }
-
         new_node = (struct rb_node *)malloc(sizeof(struct rb_node));
         if (!new_node) {
                 pr_info("Memory allocation failed\n");
                 return NULL;
         }
         new_node->color = RB_NODE_COLOR_UNDEFINED;
+        new_node->pooled = 0;
         new_node->parent = new_node->left = new_node->right = NULL;
         new_node->data = NULL;
 
@@ -159,6 +354,10 @@ static inline void rb_node_dealloc(struct rb_node *node)
         if (node->data) {
                 free(node->data);
         }
+        if (node->pooled) {
+                rb_arena_put(node);
+                return;
+        }
         free(node);
 }
 
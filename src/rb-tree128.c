@@ -0,0 +1,183 @@
+/**
+ * @file rb-tree128.c
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief red black tree with 128-bit composite keys implementation
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ */
+#include <stdlib.h>
+#include "rb-tree128.h"
+
+RB_GENERATE_STATIC(__rb_tree128, rb_node128, entry, struct rb_key128, key,
+                   RB_KEY128_CMP)
+
+/**
+ * @brief Allocation of 128-bit key red-black tree
+ *
+ * @return struct rb_tree128* allocated red-black tree
+ */
+struct rb_tree128 *rb_tree128_alloc(void)
+{
+        struct rb_tree128 *tree =
+                (struct rb_tree128 *)malloc(sizeof(struct rb_tree128));
+        if (!tree) {
+                pr_info("Memory shortage detected! Allocation failed...");
+                return NULL;
+        }
+
+        __rb_tree128_init(&tree->head);
+        tree->nr_nodes = 0;
+
+        return tree;
+}
+
+/**
+ * @brief Search the node which has the same key
+ *
+ * @param tree 128-bit key red-black tree
+ * @param key the key which I want to search
+ * @return struct rb_node128* if find success then return specific node pointer.
+ * but if find failed then return NULL pointer
+ */
+struct rb_node128 *rb_tree128_search(struct rb_tree128 *tree,
+                                     struct rb_key128 key)
+{
+        return __rb_tree128_search(&tree->head, key);
+}
+
+/**
+ * @brief Find the first node which key is not less than the key
+ *
+ * @param tree 128-bit key red-black tree
+ * @param key lower bound key
+ * @return struct rb_node128* first node which key is not less than the key.
+ * If there is no such node then return NULL
+ */
+struct rb_node128 *rb_tree128_lower_bound(struct rb_tree128 *tree,
+                                          struct rb_key128 key)
+{
+        return __rb_tree128_lower_bound(&tree->head, key);
+}
+
+/**
+ * @brief Deallocation 128-bit key node
+ *
+ * @param node deallocate target
+ */
+static void rb_node128_dealloc(struct rb_node128 *node)
+{
+        if (node->data) {
+                free(node->data);
+        }
+        free(node);
+}
+
+/**
+ * @brief Insert the key and data to the tree
+ * @details
+ * If the key already exists then the data is updated.
+ *
+ * @param tree 128-bit key red-black tree
+ * @param key new node's key
+ * @param data new node's data (must be allocated in HEAP location)
+ * @return int successfully insert status (0: success, else: fail)
+ */
+int rb_tree128_insert(struct rb_tree128 *tree, struct rb_key128 key,
+                      void *data)
+{
+        struct rb_node128 *node = NULL;
+        struct rb_node128 *exist = NULL;
+
+        node = (struct rb_node128 *)malloc(sizeof(struct rb_node128));
+        if (!node) {
+                pr_info("Memory allocation failed\n");
+                return -ENOMEM;
+        }
+        node->key = key;
+        node->data = data;
+
+        exist = __rb_tree128_insert(&tree->head, node);
+        if (exist) { /**< update key's data */
+                node->data = exist->data;
+                exist->data = data;
+                rb_node128_dealloc(node);
+                return 0;
+        }
+
+        tree->nr_nodes++;
+        return 0;
+}
+
+/**
+ * @brief Delete the node which has the same key
+ *
+ * @param tree 128-bit key red-black tree
+ * @param key delete target node's key
+ * @return int 0 means that delete success. Not 0 means delete fail.
+ */
+int rb_tree128_delete(struct rb_tree128 *tree, struct rb_key128 key)
+{
+        struct rb_node128 *node = __rb_tree128_search(&tree->head, key);
+        if (!node) {
+                return -ENODATA;
+        }
+
+        __rb_tree128_remove(&tree->head, node);
+        rb_node128_dealloc(node);
+        tree->nr_nodes--;
+
+        return 0;
+}
+
+struct rb_node128 *rb_tree128_first(struct rb_tree128 *tree)
+{
+        return __rb_tree128_minimum(&tree->head);
+}
+
+struct rb_node128 *rb_tree128_last(struct rb_tree128 *tree)
+{
+        return __rb_tree128_maximum(&tree->head);
+}
+
+struct rb_node128 *rb_tree128_next(struct rb_node128 *node)
+{
+        return __rb_tree128_successor(node);
+}
+
+struct rb_node128 *rb_tree128_prev(struct rb_node128 *node)
+{
+        return __rb_tree128_predecessor(node);
+}
+
+/**
+ * @brief Does deallocation of the 128-bit key subtree
+ *
+ * @param node the root of the subtree
+ */
+static void __rb_tree128_dealloc(struct rb_node128 *node)
+{
+        if (!node) {
+                return;
+        }
+
+        __rb_tree128_dealloc(RB_GEN_LEFT(node, entry));
+        __rb_tree128_dealloc(RB_GEN_RIGHT(node, entry));
+
+        rb_node128_dealloc(node);
+}
+
+/**
+ * @brief Does deallocation of the 128-bit key red-black tree
+ *
+ * @param tree 128-bit key red-black tree
+ */
+void rb_tree128_dealloc(struct rb_tree128 *tree)
+{
+        __rb_tree128_dealloc(tree->head.rbh_root);
+        tree->head.rbh_root = NULL;
+
+        free(tree);
+}
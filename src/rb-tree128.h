@@ -0,0 +1,82 @@
+/**
+ * @file rb-tree128.h
+ * @author BlaCkinkGJ (ss5kijun@gmail.com)
+ * @brief red black tree with 128-bit composite keys
+ * @version 0.1
+ * @date 2020-05-29
+ *
+ * @copyright Copyright (c) 2020 BlaCkinkGJ
+ *
+ * @details
+ * The key is (hi, lo) pair which is ordered by `hi` first. So, composite
+ * keys like (shard, id) can be used without remapping them to 64-bit.
+ * The algorithms are generated by `rb-generate.h`.
+ */
+#ifndef RB_TREE128_H_
+#define RB_TREE128_H_
+
+#include "rb-tree.h"
+#include "rb-generate.h"
+
+/**
+ * @brief 128-bit key (hi is compared first)
+ *
+ */
+struct rb_key128 {
+        uint64_t hi;
+        uint64_t lo;
+};
+
+#define RB_KEY128_CMP(a, b)                                                    \
+        ((a).hi != (b).hi ? RB_GEN_CMP((a).hi, (b).hi) :                       \
+                            RB_GEN_CMP((a).lo, (b).lo))
+
+/**
+ * @brief Red black tree's node with 128-bit key
+ *
+ */
+struct rb_node128 {
+        struct rb_key128 key;
+        RB_GEN_ENTRY(rb_node128) entry;
+        void *data; /**< must be allocated in HEAP location */
+};
+
+RB_GEN_HEAD(__rb_tree128, rb_node128);
+
+/**
+ * @brief Red black tree with 128-bit key
+ *
+ */
+struct rb_tree128 {
+        struct __rb_tree128 head;
+        size_t nr_nodes;
+};
+
+struct rb_tree128 *rb_tree128_alloc(void);
+struct rb_node128 *rb_tree128_search(struct rb_tree128 *tree,
+                                     struct rb_key128 key);
+struct rb_node128 *rb_tree128_lower_bound(struct rb_tree128 *tree,
+                                          struct rb_key128 key);
+int rb_tree128_insert(struct rb_tree128 *tree, struct rb_key128 key,
+                      void *data);
+int rb_tree128_delete(struct rb_tree128 *tree, struct rb_key128 key);
+struct rb_node128 *rb_tree128_first(struct rb_tree128 *tree);
+struct rb_node128 *rb_tree128_last(struct rb_tree128 *tree);
+struct rb_node128 *rb_tree128_next(struct rb_node128 *node);
+struct rb_node128 *rb_tree128_prev(struct rb_node128 *node);
+void rb_tree128_dealloc(struct rb_tree128 *tree);
+
+/**
+ * @brief Make the 128-bit key
+ *
+ * @param hi upper 64-bit (e.g. shard)
+ * @param lo lower 64-bit (e.g. id)
+ * @return struct rb_key128 composite key
+ */
+static inline struct rb_key128 rb_key128_make(uint64_t hi, uint64_t lo)
+{
+        struct rb_key128 key = { .hi = hi, .lo = lo };
+        return key;
+}
+
+#endif
@@ -0,0 +1,218 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+
+#include "rb-art.h"
+#include "unity.h"
+
+#define INSERT_SIZE (5000)
+
+struct rb_art *art;
+
+void setUp(void)
+{
+        art = rb_art_alloc();
+        TEST_ASSERT_NOT_NULL(art);
+}
+
+void tearDown(void)
+{
+        if (art) {
+                rb_art_dealloc(art);
+        }
+}
+
+static key_t *key_data(key_t key)
+{
+        key_t *data = (key_t *)malloc(sizeof(key_t));
+
+        TEST_ASSERT_NOT_NULL(data);
+        *data = key;
+        return data;
+}
+
+static key_t sparse_key(void)
+{
+        return ((key_t)rand() << 40) ^ ((key_t)rand() << 20) ^ (key_t)rand();
+}
+
+/**
+ * @brief Check the subtree which keys have `base` in the first depth bytes
+ *
+ * @return size_t number of the leaves
+ */
+static size_t check_node(struct rb_art_node *node, key_t base,
+                         unsigned int depth)
+{
+        static const unsigned int capacity[] = { 0, 4, 16, 48, 256 };
+        size_t nr_keys = 0;
+        unsigned int nr_children = 0;
+
+        if (node->type == RB_ART_LEAF) {
+                struct rb_art_leaf *leaf = (struct rb_art_leaf *)node;
+
+                if (depth > 0) {
+                        TEST_ASSERT_EQUAL(base >> (64 - 8 * depth),
+                                          leaf->key >> (64 - 8 * depth));
+                }
+                TEST_ASSERT_EQUAL(leaf->key, *(key_t *)leaf->data);
+                return 1;
+        }
+        TEST_ASSERT_TRUE(node->nr_children >= 2);
+        TEST_ASSERT_TRUE(node->nr_children <= capacity[node->type]);
+        for (unsigned int i = 0; i < node->prefix_len; i++, depth++) {
+                base |= (key_t)node->prefix[i] << (56 - 8 * depth);
+        }
+        TEST_ASSERT_TRUE(depth < RB_ART_KEY_BYTES);
+        for (unsigned int byte = 0; byte < 256; byte++) {
+                struct rb_art_node *child = NULL;
+
+                switch (node->type) {
+                case RB_ART_NODE4:
+                case RB_ART_NODE16: {
+                        uint8_t *keys = (node->type == RB_ART_NODE4) ?
+                                ((struct rb_art_node4 *)node)->keys :
+                                ((struct rb_art_node16 *)node)->keys;
+                        struct rb_art_node **children =
+                                (node->type == RB_ART_NODE4) ?
+                                ((struct rb_art_node4 *)node)->children :
+                                ((struct rb_art_node16 *)node)->children;
+
+                        for (unsigned int i = 0; i < node->nr_children; i++) {
+                                TEST_ASSERT_TRUE(i == 0 || keys[i - 1] < keys[i]);
+                                if (keys[i] == byte) {
+                                        child = children[i];
+                                }
+                        }
+                        break;
+                }
+                case RB_ART_NODE48: {
+                        struct rb_art_node48 *n = (struct rb_art_node48 *)node;
+
+                        child = n->index[byte] ? n->children[n->index[byte] - 1] :
+                                                 NULL;
+                        TEST_ASSERT_TRUE(!n->index[byte] || child);
+                        break;
+                }
+                case RB_ART_NODE256:
+                        child = ((struct rb_art_node256 *)node)->children[byte];
+                        break;
+                default:
+                        TEST_FAIL();
+                }
+                if (child) {
+                        nr_children++;
+                        nr_keys += check_node(child,
+                                              base | ((key_t)byte
+                                                      << (56 - 8 * depth)),
+                                              depth + 1);
+                }
+        }
+        TEST_ASSERT_EQUAL(node->nr_children, nr_children);
+        return nr_keys;
+}
+
+static void check_art(struct rb_art *target)
+{
+        TEST_ASSERT_EQUAL(target->nr_keys,
+                          target->root ? check_node(target->root, 0, 0) : 0);
+}
+
+/**
+ * @brief Expected type of the node which has nr_children children
+ *
+ * @param grown the node is reached by the inserts (else by the deletes)
+ */
+static enum rb_art_type node_type(unsigned int nr_children, int grown)
+{
+        if (nr_children == 1) {
+                return RB_ART_LEAF; /**< collapsed to the only child */
+        }
+        if (nr_children <= (grown ? 4 : 3)) {
+                return RB_ART_NODE4;
+        }
+        if (nr_children <= (grown ? 16 : 12)) {
+                return RB_ART_NODE16;
+        }
+        if (nr_children <= (grown ? 48 : 37)) {
+                return RB_ART_NODE48;
+        }
+        return RB_ART_NODE256;
+}
+
+void test_rb_art_node_types(void)
+{
+        /**< the keys differ only in the last byte, so the root has them */
+        for (unsigned int byte = 0; byte < 256; byte++) {
+                TEST_ASSERT_EQUAL(0, rb_art_insert(art, byte,
+                                                   key_data(byte)));
+                TEST_ASSERT_EQUAL(node_type(byte + 1, 1), art->root->type);
+        }
+        check_art(art);
+        TEST_ASSERT_EQUAL(RB_ART_KEY_BYTES - 1, art->root->prefix_len);
+
+        for (unsigned int byte = 255; byte > 0; byte--) {
+                TEST_ASSERT_EQUAL(0, rb_art_delete(art, byte));
+                TEST_ASSERT_EQUAL(node_type(byte, 0), art->root->type);
+                if (byte % 16 == 0) {
+                        check_art(art);
+                }
+        }
+        TEST_ASSERT_EQUAL(1, art->nr_keys);
+        TEST_ASSERT_EQUAL(-ENODATA, rb_art_delete(art, 1));
+        TEST_ASSERT_EQUAL(0, rb_art_delete(art, 0));
+        TEST_ASSERT_NULL(art->root);
+}
+
+void test_rb_art_random(void)
+{
+        struct rb_art *t1 = NULL, *t2 = NULL;
+        key_t found;
+        size_t nr_keys;
+
+        srand(29);
+        for (int i = 0; i < 4 * INSERT_SIZE; i++) {
+                key_t key = (i % 2) ? (key_t)(rand() % INSERT_SIZE) :
+                                      sparse_key();
+
+                if (rand() % 3) {
+                        TEST_ASSERT_EQUAL(0, rb_art_insert(art, key,
+                                                           key_data(key)));
+                } else {
+                        rb_art_delete(art, (key_t)(rand() % INSERT_SIZE));
+                }
+                if (i % 997 == 0) {
+                        check_art(art);
+                }
+        }
+        check_art(art);
+
+        nr_keys = art->nr_keys;
+        for (int round = 0; round < 64; round++) {
+                key_t x = (round % 2) ? (key_t)(rand() % INSERT_SIZE) :
+                                        sparse_key();
+
+                TEST_ASSERT_EQUAL(0, rb_art_split(art, x, &t1, &t2));
+                check_art(t1);
+                check_art(t2);
+                art = rb_art_concat(t1, t2);
+                TEST_ASSERT_NOT_NULL(art);
+                TEST_ASSERT_EQUAL(nr_keys, art->nr_keys);
+        }
+        check_art(art);
+
+        while (rb_art_minimum(art, &found, NULL) == 0) {
+                TEST_ASSERT_EQUAL(0, rb_art_delete(art, found));
+        }
+        check_art(art);
+        TEST_ASSERT_NULL(art->root);
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_art_node_types);
+        RUN_TEST(test_rb_art_random);
+
+        return UNITY_END();
+}
@@ -0,0 +1,171 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+
+#include "rb-bptree.h"
+#include "unity.h"
+
+#define INSERT_SIZE (5000)
+
+struct rb_bptree *bptree;
+
+void setUp(void)
+{
+        bptree = rb_bptree_alloc();
+        TEST_ASSERT_NOT_NULL(bptree);
+}
+
+void tearDown(void)
+{
+        if (bptree) {
+                rb_bptree_dealloc(bptree);
+        }
+}
+
+static key_t *key_data(key_t key)
+{
+        key_t *data = (key_t *)malloc(sizeof(key_t));
+
+        TEST_ASSERT_NOT_NULL(data);
+        *data = key;
+        return data;
+}
+
+/**
+ * @brief Check the node which covers [lo, hi) and return the number of keys
+ */
+static size_t check_node(struct rb_bptree *target,
+                         struct rb_bptree_node *node, key_t lo, key_t hi,
+                         int has_hi, size_t depth,
+                         struct rb_bptree_leaf **leaf)
+{
+        size_t nr_keys = 0;
+
+        if (node != target->root) {
+                TEST_ASSERT_TRUE(node->nr_keys >= (node->is_leaf ?
+                                                           RB_BPTREE_LEAF_MIN :
+                                                           RB_BPTREE_INNER_MIN));
+        }
+        TEST_ASSERT_TRUE(node->nr_keys > 0);
+        if (node->is_leaf) {
+                struct rb_bptree_leaf *cur = (struct rb_bptree_leaf *)node;
+
+                TEST_ASSERT_EQUAL(target->height, depth);
+                TEST_ASSERT_EQUAL_PTR(*leaf, cur); /**< chain is in order */
+                *leaf = cur->next;
+                if (cur->next) {
+                        TEST_ASSERT_EQUAL_PTR(cur, cur->next->prev);
+                } else {
+                        TEST_ASSERT_EQUAL_PTR(target->tail, cur);
+                }
+                for (unsigned int i = 0; i < cur->hdr.nr_keys; i++) {
+                        TEST_ASSERT_TRUE(cur->keys[i] >= lo);
+                        TEST_ASSERT_TRUE(!has_hi || cur->keys[i] < hi);
+                        TEST_ASSERT_TRUE(i == 0 ||
+                                         cur->keys[i - 1] < cur->keys[i]);
+                        TEST_ASSERT_EQUAL(cur->keys[i], *(key_t *)cur->data[i]);
+                }
+                return cur->hdr.nr_keys;
+        }
+        struct rb_bptree_inner *inner = (struct rb_bptree_inner *)node;
+        for (unsigned int i = 0; i <= inner->hdr.nr_keys; i++) {
+                key_t child_lo = (i == 0) ? lo : inner->keys[i - 1];
+                key_t child_hi = (i == inner->hdr.nr_keys) ? hi : inner->keys[i];
+                int child_has_hi = (i == inner->hdr.nr_keys) ? has_hi : 1;
+
+                TEST_ASSERT_TRUE(i == 0 || i == inner->hdr.nr_keys ||
+                                 inner->keys[i - 1] < inner->keys[i]);
+                nr_keys += check_node(target, inner->children[i], child_lo,
+                                      child_hi, child_has_hi, depth + 1, leaf);
+        }
+        return nr_keys;
+}
+
+static void check_bptree(struct rb_bptree *target)
+{
+        struct rb_bptree_leaf *leaf = target->head;
+
+        if (!target->root) {
+                TEST_ASSERT_NULL(target->head);
+                TEST_ASSERT_NULL(target->tail);
+                TEST_ASSERT_EQUAL(0, target->nr_keys);
+                return;
+        }
+        TEST_ASSERT_NULL(target->head->prev);
+        TEST_ASSERT_EQUAL(target->nr_keys,
+                          check_node(target, target->root, 0, 0, 0, 0, &leaf));
+        TEST_ASSERT_NULL(leaf);
+}
+
+void test_rb_bptree_random(void)
+{
+        srand(17);
+        for (int i = 0; i < 4 * INSERT_SIZE; i++) {
+                key_t key = (key_t)(rand() % INSERT_SIZE);
+
+                if (rand() % 3) {
+                        TEST_ASSERT_EQUAL(0, rb_bptree_insert(bptree, key,
+                                                              key_data(key)));
+                } else {
+                        rb_bptree_delete(bptree, key);
+                }
+                if (i % 997 == 0) {
+                        check_bptree(bptree);
+                }
+        }
+        check_bptree(bptree);
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                rb_bptree_delete(bptree, key);
+        }
+        check_bptree(bptree);
+        TEST_ASSERT_EQUAL(-ENODATA, rb_bptree_minimum(bptree, NULL, NULL));
+}
+
+void test_rb_bptree_split_concat(void)
+{
+        struct rb_bptree *t1 = NULL, *t2 = NULL;
+        key_t found;
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                TEST_ASSERT_EQUAL(0, rb_bptree_insert(bptree, key * 2,
+                                                      key_data(key * 2)));
+        }
+        /**< split at every kind of the position in the leaf */
+        for (key_t x = 0; x < 2 * INSERT_SIZE; x += 331) {
+                TEST_ASSERT_EQUAL(0, rb_bptree_split(bptree, x, &t1, &t2));
+                check_bptree(t1);
+                check_bptree(t2);
+                TEST_ASSERT_EQUAL(x / 2 + 1, t1->nr_keys);
+                TEST_ASSERT_EQUAL(0, rb_bptree_maximum(t1, &found, NULL));
+                TEST_ASSERT_TRUE(found <= x);
+                TEST_ASSERT_EQUAL(0, rb_bptree_minimum(t2, &found, NULL));
+                TEST_ASSERT_TRUE(found > x);
+                TEST_ASSERT_NULL(rb_bptree_concat(t2, t1));
+                bptree = rb_bptree_concat(t1, t2);
+                TEST_ASSERT_NOT_NULL(bptree);
+                check_bptree(bptree);
+                TEST_ASSERT_EQUAL(INSERT_SIZE, bptree->nr_keys);
+        }
+
+        /**< empty sides */
+        TEST_ASSERT_EQUAL(0, rb_bptree_split(bptree, RB_MAX_KEY, &t1, &t2));
+        TEST_ASSERT_NULL(t2->root);
+        bptree = rb_bptree_concat(t1, t2);
+        TEST_ASSERT_NOT_NULL(bptree);
+        t1 = rb_bptree_alloc();
+        TEST_ASSERT_NOT_NULL(t1);
+        bptree = rb_bptree_concat(t1, bptree);
+        TEST_ASSERT_NOT_NULL(bptree);
+        check_bptree(bptree);
+        TEST_ASSERT_EQUAL(INSERT_SIZE, bptree->nr_keys);
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_bptree_random);
+        RUN_TEST(test_rb_bptree_split_concat);
+
+        return UNITY_END();
+}
@@ -0,0 +1,130 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+
+#include "rb-bucket-tree.h"
+#include "unity.h"
+
+#define INSERT_SIZE (5000)
+
+struct rb_bucket_tree *btree;
+
+void setUp(void)
+{
+        btree = rb_bucket_tree_alloc();
+        TEST_ASSERT_NOT_NULL(btree);
+}
+
+void tearDown(void)
+{
+        if (btree) {
+                rb_bucket_tree_dealloc(btree);
+        }
+}
+
+static key_t *key_data(key_t key)
+{
+        key_t *data = (key_t *)malloc(sizeof(key_t));
+
+        TEST_ASSERT_NOT_NULL(data);
+        *data = key;
+        return data;
+}
+
+static void check_bucket_tree(struct rb_bucket_tree *target)
+{
+        struct rb_tree *buckets = target->tree;
+        struct rb_node *node = rb_tree_minimum(buckets, buckets->root);
+        struct rb_bucket *bucket = NULL;
+        size_t nr_keys = 0;
+        key_t prev = 0;
+
+        for (; node != buckets->nil; node = rb_tree_successor(buckets, node)) {
+                bucket = (struct rb_bucket *)node->data;
+                TEST_ASSERT_TRUE(bucket->nr_keys > 0);
+                TEST_ASSERT_TRUE(bucket->nr_keys <= RB_BUCKET_KEYS);
+                TEST_ASSERT_EQUAL(bucket->keys[0], node->key);
+                for (unsigned int i = 0; i < bucket->nr_keys; i++) {
+                        TEST_ASSERT_TRUE(nr_keys == 0 || prev < bucket->keys[i]);
+                        TEST_ASSERT_EQUAL(bucket->keys[i],
+                                          *(key_t *)bucket->data[i]);
+                        prev = bucket->keys[i];
+                        nr_keys++;
+                }
+        }
+        TEST_ASSERT_EQUAL(target->nr_keys, nr_keys);
+}
+
+void test_rb_bucket_tree_fill(void)
+{
+        srand(37);
+        for (int i = 0; i < 4 * INSERT_SIZE; i++) {
+                key_t key = (key_t)(rand() % INSERT_SIZE);
+
+                if (rand() % 3) {
+                        TEST_ASSERT_EQUAL(0, rb_bucket_tree_insert(
+                                                     btree, key, key_data(key)));
+                } else {
+                        rb_bucket_tree_delete(btree, key);
+                }
+                if (i % 997 == 0) {
+                        check_bucket_tree(btree);
+                }
+        }
+        check_bucket_tree(btree);
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                rb_bucket_tree_delete(btree, key);
+        }
+        check_bucket_tree(btree);
+        TEST_ASSERT_EQUAL_PTR(btree->tree->nil, btree->tree->root);
+}
+
+void test_rb_bucket_tree_split_fill(void)
+{
+        struct rb_bucket_tree *t1 = NULL, *t2 = NULL;
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                TEST_ASSERT_EQUAL(0, rb_bucket_tree_insert(btree, key * 2,
+                                                           key_data(key * 2)));
+        }
+        for (key_t x = 0; x < 2 * INSERT_SIZE; x += 331) {
+                TEST_ASSERT_EQUAL(0, rb_bucket_tree_split(btree, x, &t1, &t2));
+                check_bucket_tree(t1);
+                check_bucket_tree(t2);
+                TEST_ASSERT_EQUAL(x / 2 + 1, t1->nr_keys);
+                btree = rb_bucket_tree_concat(t1, t2);
+                TEST_ASSERT_NOT_NULL(btree);
+                check_bucket_tree(btree);
+                TEST_ASSERT_EQUAL(INSERT_SIZE, btree->nr_keys);
+        }
+}
+
+void test_rb_bucket_tree_bytes(void)
+{
+        size_t bytes;
+
+        TEST_ASSERT_EQUAL(0, rb_bucket_tree_bytes(btree));
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                TEST_ASSERT_EQUAL(0, rb_bucket_tree_insert(btree, key * 3,
+                                                           key_data(key * 3)));
+        }
+        check_bucket_tree(btree);
+        bytes = rb_bucket_tree_bytes(btree);
+        /**< at least half full buckets share a node */
+        TEST_ASSERT_TRUE(bytes / INSERT_SIZE <
+                         (sizeof(struct rb_node) + sizeof(struct rb_bucket)) /
+                                 (RB_BUCKET_KEYS / 2) +
+                                 1);
+        TEST_ASSERT_TRUE(bytes / INSERT_SIZE < sizeof(struct rb_node));
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_bucket_tree_fill);
+        RUN_TEST(test_rb_bucket_tree_split_fill);
+        RUN_TEST(test_rb_bucket_tree_bytes);
+
+        return UNITY_END();
+}
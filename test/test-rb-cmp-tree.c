@@ -0,0 +1,175 @@
+#include <stdlib.h>
+#include <errno.h>
+
+#include "rb-cmp-tree.h"
+#include "unity.h"
+
+#define INSERT_SIZE (1000)
+
+struct tuple_key {
+        uint64_t tenant;
+        uint64_t id;
+};
+
+static int nr_full_compare;
+struct rb_cmp_tree *ctree;
+
+static int tuple_cmp(const void *a, const void *b)
+{
+        const struct tuple_key *x = (const struct tuple_key *)a;
+        const struct tuple_key *y = (const struct tuple_key *)b;
+
+        nr_full_compare++;
+        if (x->tenant != y->tenant) {
+                return x->tenant < y->tenant ? -1 : 1;
+        }
+        return (x->id > y->id) - (x->id < y->id);
+}
+
+static uint64_t tuple_prefix(const void *key)
+{
+        return ((const struct tuple_key *)key)->tenant;
+}
+
+static char *str_dup(const char *str)
+{
+        char *dup = (char *)malloc(strlen(str) + 1);
+        strcpy(dup, str);
+        return dup;
+}
+
+void setUp(void)
+{
+        ctree = NULL;
+        nr_full_compare = 0;
+}
+
+void tearDown(void)
+{
+        if (ctree) {
+                rb_cmp_tree_dealloc(ctree);
+        }
+}
+
+void test_rb_cmp_str(void)
+{
+        const char *words[] = { "banana", "apple", "apple-pie", "cherry",
+                                "applesauce", "b", "" };
+        const char *expects[] = { "", "apple", "apple-pie", "applesauce",
+                                  "b", "banana", "cherry" };
+        const int nr_words = (int)(sizeof(words) / sizeof(char *));
+        struct rb_cmp_node *cnode;
+        int i;
+
+        ctree = rb_cmp_tree_alloc(rb_cmp_str, rb_prefix_str);
+        TEST_ASSERT_NOT_NULL(ctree);
+        for (i = 0; i < nr_words; i++) {
+                TEST_ASSERT_EQUAL(0, rb_cmp_tree_insert(ctree, str_dup(words[i]),
+                                                        NULL));
+        }
+
+        for (i = 0, cnode = rb_cmp_tree_first(ctree); cnode;
+             i++, cnode = rb_cmp_tree_next(ctree, cnode)) {
+                TEST_ASSERT_EQUAL_STRING(expects[i], cnode->key);
+        }
+        TEST_ASSERT_EQUAL(nr_words, i);
+
+        TEST_ASSERT_NOT_NULL(rb_cmp_tree_search(ctree, "applesauce"));
+        TEST_ASSERT_NULL(rb_cmp_tree_search(ctree, "apples"));
+        TEST_ASSERT_EQUAL_STRING(
+                "applesauce", rb_cmp_tree_lower_bound(ctree, "apples")->key);
+        TEST_ASSERT_NULL(rb_cmp_tree_lower_bound(ctree, "zebra"));
+
+        TEST_ASSERT_EQUAL(0, rb_cmp_tree_delete(ctree, "apple"));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_cmp_tree_delete(ctree, "apple"));
+        TEST_ASSERT_NULL(rb_cmp_tree_search(ctree, "apple"));
+}
+
+void test_rb_cmp_update(void)
+{
+        struct rb_cmp_node *cnode;
+
+        ctree = rb_cmp_tree_alloc(rb_cmp_str, rb_prefix_str);
+        TEST_ASSERT_NOT_NULL(ctree);
+        TEST_ASSERT_EQUAL(0, rb_cmp_tree_insert(ctree, str_dup("key"),
+                                                str_dup("old")));
+        TEST_ASSERT_EQUAL(0, rb_cmp_tree_insert(ctree, str_dup("key"),
+                                                str_dup("new")));
+
+        cnode = rb_cmp_tree_search(ctree, "key");
+        TEST_ASSERT_NOT_NULL(cnode);
+        TEST_ASSERT_EQUAL_STRING("new", cnode->node.data);
+        TEST_ASSERT_NULL(rb_cmp_tree_next(ctree, cnode));
+}
+
+void test_rb_cmp_double(void)
+{
+        double values[] = { 3.5, -1.25, 0.0, -1000.0, 1e300, -0.5 };
+        double expects[] = { -1000.0, -1.25, -0.5, 0.0, 3.5, 1e300 };
+        const int nr_values = (int)(sizeof(values) / sizeof(double));
+        struct rb_cmp_node *cnode;
+        int i;
+
+        ctree = rb_cmp_tree_alloc(rb_cmp_double, rb_prefix_double);
+        TEST_ASSERT_NOT_NULL(ctree);
+        for (i = 0; i < nr_values; i++) {
+                double *key = (double *)malloc(sizeof(double));
+                *key = values[i];
+                TEST_ASSERT_EQUAL(0, rb_cmp_tree_insert(ctree, key, NULL));
+        }
+
+        for (i = 0, cnode = rb_cmp_tree_first(ctree); cnode;
+             i++, cnode = rb_cmp_tree_next(ctree, cnode)) {
+                TEST_ASSERT_TRUE(expects[i] == *(double *)cnode->key);
+        }
+        TEST_ASSERT_EQUAL(nr_values, i);
+}
+
+void test_rb_cmp_prefix_skips_compare(void)
+{
+        struct tuple_key key;
+        int i;
+
+        ctree = rb_cmp_tree_alloc(tuple_cmp, tuple_prefix);
+        TEST_ASSERT_NOT_NULL(ctree);
+        for (i = 0; i < INSERT_SIZE; i++) {
+                struct tuple_key *new_key =
+                        (struct tuple_key *)malloc(sizeof(struct tuple_key));
+                new_key->tenant = (uint64_t)i;
+                new_key->id = (uint64_t)(INSERT_SIZE - i);
+                TEST_ASSERT_EQUAL(0, rb_cmp_tree_insert(ctree, new_key, NULL));
+        }
+
+        /**< distinct tenants: only the matched node needs the full compare */
+        nr_full_compare = 0;
+        for (i = 0; i < INSERT_SIZE; i++) {
+                key.tenant = (uint64_t)i;
+                key.id = (uint64_t)(INSERT_SIZE - i);
+                TEST_ASSERT_NOT_NULL(rb_cmp_tree_search(ctree, &key));
+        }
+        TEST_ASSERT_EQUAL(INSERT_SIZE, nr_full_compare);
+
+        key.tenant = 7;
+        key.id = 0;
+        TEST_ASSERT_NULL(rb_cmp_tree_search(ctree, &key));
+        for (i = 0; i < INSERT_SIZE; i += 2) {
+                key.tenant = (uint64_t)i;
+                key.id = (uint64_t)(INSERT_SIZE - i);
+                TEST_ASSERT_EQUAL(0, rb_cmp_tree_delete(ctree, &key));
+        }
+        key.tenant = 1;
+        key.id = INSERT_SIZE - 1;
+        TEST_ASSERT_NOT_NULL(rb_cmp_tree_search(ctree, &key));
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_cmp_str);
+        RUN_TEST(test_rb_cmp_update);
+        RUN_TEST(test_rb_cmp_double);
+        RUN_TEST(test_rb_cmp_prefix_skips_compare);
+
+        return UNITY_END();
+}
@@ -0,0 +1,186 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "rb-tree.h"
+#include "rb-ebr.h"
+#include "unity.h"
+
+#define INSERT_SIZE (1000)
+#define NR_READERS (4)
+#define NR_ROUNDS (20)
+
+struct rb_ebr *ebr;
+static atomic_int nr_freed;
+static atomic_int stop;
+
+struct reader_arg {
+        pthread_t thread;
+        struct rb_tree *tree;
+        int nr_missed;
+};
+
+void setUp(void)
+{
+        ebr = rb_ebr_alloc();
+        TEST_ASSERT_NOT_NULL(ebr);
+        atomic_store(&nr_freed, 0);
+        atomic_store(&stop, 0);
+}
+
+void tearDown(void)
+{
+        if (ebr) {
+                rb_ebr_dealloc(ebr);
+        }
+}
+
+static void count_free(void *ptr)
+{
+        atomic_fetch_add(&nr_freed, 1);
+        free(ptr);
+}
+
+static void *pinned_reader(void *arg)
+{
+        atomic_int *entered = (atomic_int *)arg;
+
+        rb_ebr_enter(ebr);
+        atomic_store(entered, 1);
+        while (!atomic_load(&stop)) {
+                sched_yield();
+        }
+        rb_ebr_exit(ebr);
+        return NULL;
+}
+
+void test_rb_ebr_retire(void)
+{
+        pthread_t thread;
+        atomic_int entered = 0;
+
+        TEST_ASSERT_EQUAL(0, pthread_create(&thread, NULL, pinned_reader,
+                                            &entered));
+        while (!atomic_load(&entered)) {
+                sched_yield();
+        }
+
+        for (int i = 0; i < 2 * RB_EBR_BATCH_SIZE; i++) {
+                TEST_ASSERT_EQUAL(0, rb_ebr_retire(ebr, malloc(16), count_free));
+        }
+        rb_ebr_collect(ebr);
+        TEST_ASSERT_EQUAL(0, atomic_load(&nr_freed)); /**< reader pins epoch */
+
+        atomic_store(&stop, 1);
+        pthread_join(thread, NULL);
+        rb_ebr_synchronize(ebr);
+        TEST_ASSERT_EQUAL(2 * RB_EBR_BATCH_SIZE, atomic_load(&nr_freed));
+
+        rb_ebr_enter(ebr); /**< nested sections */
+        rb_ebr_enter(ebr);
+        rb_ebr_exit(ebr);
+        rb_ebr_exit(ebr);
+        TEST_ASSERT_EQUAL(0, rb_ebr_retire(ebr, malloc(16), count_free));
+        rb_ebr_synchronize(ebr);
+        TEST_ASSERT_EQUAL(2 * RB_EBR_BATCH_SIZE + 1, atomic_load(&nr_freed));
+}
+
+static void *reader(void *arg)
+{
+        struct reader_arg *rarg = (struct reader_arg *)arg;
+        struct rb_node *node = NULL;
+
+        for (int round = 0; round < NR_ROUNDS; round++) {
+                for (key_t key = 0; key < INSERT_SIZE; key += 2) {
+                        rb_ebr_enter(ebr);
+                        node = rb_tree_search(rarg->tree, key);
+                        if (!node || node == rarg->tree->nil ||
+                            *(key_t *)node->data != key) { /**< use after free */
+                                rarg->nr_missed++;
+                        }
+                        rb_ebr_exit(ebr);
+                }
+        }
+        return NULL;
+}
+
+static key_t *key_data(key_t key)
+{
+        key_t *data = (key_t *)malloc(sizeof(key_t));
+        *data = key;
+        return data;
+}
+
+void test_rb_ebr_tree_delete(void)
+{
+        struct reader_arg readers[NR_READERS];
+        struct rb_tree *tree = rb_tree_alloc_flags(RB_TREE_FLAG_OPTIMISTIC);
+
+        TEST_ASSERT_NOT_NULL(tree);
+        rb_tree_set_ebr(tree, ebr);
+        for (key_t key = 0; key < INSERT_SIZE; key += 2) {
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, key, key_data(key)));
+        }
+
+        for (int i = 0; i < NR_READERS; i++) {
+                readers[i].tree = tree;
+                readers[i].nr_missed = 0;
+                TEST_ASSERT_EQUAL(0, pthread_create(&readers[i].thread, NULL,
+                                                    reader, &readers[i]));
+        }
+        for (int round = 0; round < NR_ROUNDS; round++) { /**< odd keys only */
+                for (key_t key = 1; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(
+                                0, rb_tree_insert(tree, key, key_data(key)));
+                }
+                for (key_t key = 1; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(0, rb_tree_delete(tree, key));
+                }
+        }
+        for (int i = 0; i < NR_READERS; i++) {
+                pthread_join(readers[i].thread, NULL);
+                TEST_ASSERT_EQUAL(0, readers[i].nr_missed);
+        }
+        TEST_ASSERT_NULL(tree->retired);
+
+        rb_tree_dealloc(tree);
+}
+
+void test_rb_ebr_split_and_concat(void)
+{
+        struct rb_tree *tree = rb_tree_alloc();
+        struct rb_tree *t1 = NULL;
+        struct rb_tree *t2 = NULL;
+
+        TEST_ASSERT_NOT_NULL(tree);
+        rb_tree_set_ebr(tree, ebr);
+        for (key_t key = 1; key <= 100; key++) {
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, key, key_data(key)));
+        }
+
+        TEST_ASSERT_EQUAL(0, rb_tree_split(tree, 50, &t1, &t2));
+        TEST_ASSERT_EQUAL_PTR(ebr, t1->ebr);
+        TEST_ASSERT_EQUAL_PTR(ebr, t2->ebr);
+        TEST_ASSERT_EQUAL(50, *(key_t *)rb_tree_search(t1, 50)->data);
+        TEST_ASSERT_EQUAL(51, *(key_t *)rb_tree_search(t2, 51)->data);
+
+        tree = rb_tree_concat(t1, t2, rb_tree_search(t2, 51));
+        TEST_ASSERT_NOT_NULL(tree);
+        for (key_t key = 1; key <= 100; key++) {
+                TEST_ASSERT_EQUAL(key, *(key_t *)rb_tree_search(tree, key)->data);
+        }
+
+        rb_ebr_synchronize(ebr); /**< consumed trees and nodes are freed */
+        rb_tree_dealloc(tree);
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_ebr_retire);
+        RUN_TEST(test_rb_ebr_tree_delete);
+        RUN_TEST(test_rb_ebr_split_and_concat);
+
+        return UNITY_END();
+}
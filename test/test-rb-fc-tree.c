@@ -0,0 +1,164 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "rb-fc-tree.h"
+#include "unity.h"
+
+#define INSERT_SIZE (2000)
+#define NR_WRITERS (8)
+
+struct rb_fc_tree *fctree;
+
+struct writer_arg {
+        pthread_t thread;
+        key_t base;
+        int nr_failed;
+};
+
+void setUp(void)
+{
+        fctree = rb_fc_tree_alloc(0);
+        TEST_ASSERT_NOT_NULL(fctree);
+}
+
+void tearDown(void)
+{
+        if (fctree) {
+                rb_fc_tree_dealloc(fctree);
+        }
+}
+
+static int get_data(struct rb_node *node, void *arg)
+{
+        *(void **)arg = node->data;
+        return 0;
+}
+
+static size_t count_node(struct rb_tree *tree)
+{
+        size_t count = 0;
+
+        for (struct rb_node *node = rb_tree_minimum(tree, tree->root);
+             node != tree->nil; node = rb_tree_successor(tree, node)) {
+                count++;
+        }
+        return count;
+}
+
+void test_rb_fc_single_thread(void)
+{
+        void *data = malloc(sizeof(int)); /**< the tree owns the data */
+        void *found = NULL;
+
+        TEST_ASSERT_NOT_NULL(data);
+        /**< the combiner skips the seqlock of the optimistic readers */
+        TEST_ASSERT_NULL(rb_fc_tree_alloc(RB_TREE_FLAG_OPTIMISTIC));
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                TEST_ASSERT_EQUAL(0, rb_fc_tree_insert(fctree, key, NULL));
+        }
+        TEST_ASSERT_EQUAL(0, rb_fc_tree_insert(fctree, 5, data)); /**< update */
+        TEST_ASSERT_EQUAL(0, rb_fc_tree_search(fctree, 5, get_data, &found));
+        TEST_ASSERT_EQUAL_PTR(data, found);
+
+        TEST_ASSERT_EQUAL(0, rb_fc_tree_delete(fctree, 5));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_fc_tree_delete(fctree, 5));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_fc_tree_search(fctree, 5, NULL, NULL));
+        TEST_ASSERT_EQUAL(INSERT_SIZE - 1, count_node(fctree->tree));
+        TEST_ASSERT_EQUAL(INSERT_SIZE + 3, atomic_load(&fctree->nr_combined));
+}
+
+static void *writer(void *arg)
+{
+        struct writer_arg *warg = (struct writer_arg *)arg;
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                if (rb_fc_tree_insert(fctree, warg->base + key, NULL)) {
+                        warg->nr_failed++;
+                }
+        }
+        for (key_t key = 0; key < INSERT_SIZE; key += 2) {
+                if (rb_fc_tree_delete(fctree, warg->base + key)) {
+                        warg->nr_failed++;
+                }
+        }
+        return NULL;
+}
+
+void test_rb_fc_parallel_write(void)
+{
+        struct writer_arg writers[NR_WRITERS];
+        unsigned long nr_ops = NR_WRITERS * (INSERT_SIZE + INSERT_SIZE / 2);
+
+        for (int i = 0; i < NR_WRITERS; i++) {
+                writers[i].base = (key_t)i * INSERT_SIZE;
+                writers[i].nr_failed = 0;
+                TEST_ASSERT_EQUAL(0, pthread_create(&writers[i].thread, NULL,
+                                                    writer, &writers[i]));
+        }
+        for (int i = 0; i < NR_WRITERS; i++) {
+                pthread_join(writers[i].thread, NULL);
+                TEST_ASSERT_EQUAL(0, writers[i].nr_failed);
+        }
+
+        TEST_ASSERT_EQUAL(NR_WRITERS * INSERT_SIZE / 2,
+                          count_node(fctree->tree));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_fc_tree_search(fctree, 0, NULL, NULL));
+        TEST_ASSERT_EQUAL(0, rb_fc_tree_search(fctree, 1, NULL, NULL));
+        TEST_ASSERT_EQUAL(nr_ops, atomic_load(&fctree->nr_combined));
+        TEST_ASSERT_TRUE(atomic_load(&fctree->nr_batches) <= nr_ops);
+}
+
+static pthread_barrier_t barrier;
+
+static void *contender(void *arg)
+{
+        struct writer_arg *warg = (struct writer_arg *)arg;
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                if (rb_fc_tree_insert(fctree, key, NULL)) {
+                        warg->nr_failed++;
+                }
+        }
+        pthread_barrier_wait(&barrier);
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                if (rb_fc_tree_delete(fctree, key) == 0) {
+                        warg->base++; /**< number of the deleted keys */
+                }
+        }
+        return NULL;
+}
+
+void test_rb_fc_same_keys(void)
+{
+        struct writer_arg writers[NR_WRITERS];
+        key_t nr_deleted = 0;
+
+        TEST_ASSERT_EQUAL(0, pthread_barrier_init(&barrier, NULL, NR_WRITERS));
+        for (int i = 0; i < NR_WRITERS; i++) {
+                writers[i].base = 0;
+                writers[i].nr_failed = 0;
+                TEST_ASSERT_EQUAL(0, pthread_create(&writers[i].thread, NULL,
+                                                    contender, &writers[i]));
+        }
+        for (int i = 0; i < NR_WRITERS; i++) {
+                pthread_join(writers[i].thread, NULL);
+                TEST_ASSERT_EQUAL(0, writers[i].nr_failed);
+                nr_deleted += writers[i].base;
+        }
+        pthread_barrier_destroy(&barrier);
+
+        TEST_ASSERT_EQUAL(INSERT_SIZE, nr_deleted); /**< each key once */
+        TEST_ASSERT_EQUAL(0, count_node(fctree->tree));
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_fc_single_thread);
+        RUN_TEST(test_rb_fc_parallel_write);
+        RUN_TEST(test_rb_fc_same_keys);
+
+        return UNITY_END();
+}
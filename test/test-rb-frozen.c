@@ -0,0 +1,172 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+
+#include "rb-frozen.h"
+#include "unity.h"
+
+#define INSERT_SIZE (1000)
+
+struct rb_tree *tree;
+struct rb_frozen *frozen;
+
+void setUp(void)
+{
+        tree = rb_tree_alloc();
+        TEST_ASSERT_NOT_NULL(tree);
+        frozen = NULL;
+}
+
+void tearDown(void)
+{
+        if (frozen) {
+                rb_frozen_dealloc(frozen);
+        }
+        rb_tree_dealloc(tree);
+}
+
+static key_t *key_data(key_t key)
+{
+        key_t *data = (key_t *)malloc(sizeof(key_t));
+
+        TEST_ASSERT_NOT_NULL(data);
+        *data = key;
+        return data;
+}
+
+static int collect(key_t key, void *data, void *arg)
+{
+        key_t **cursor = (key_t **)arg;
+
+        TEST_ASSERT_EQUAL(key, *(key_t *)data);
+        *(*cursor)++ = key;
+        return 0;
+}
+
+void test_rb_frozen_search(void)
+{
+        struct rb_node *node = NULL;
+        void *data = NULL;
+        key_t found;
+
+        srand(11);
+        for (int i = 0; i < INSERT_SIZE; i++) {
+                key_t key = (key_t)(rand() % (4 * INSERT_SIZE)) * 2;
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, key, key_data(key)));
+        }
+        TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, RB_MAX_KEY,
+                                            key_data(RB_MAX_KEY)));
+        frozen = rb_tree_freeze(tree);
+        TEST_ASSERT_NOT_NULL(frozen);
+
+        for (key_t key = 0; key < 8 * INSERT_SIZE + 2; key++) {
+                node = rb_tree_search(tree, key);
+                TEST_ASSERT_EQUAL(node ? 0 : -ENODATA,
+                                  rb_frozen_search(frozen, key, &data));
+                if (node) {
+                        TEST_ASSERT_EQUAL_PTR(node->data, data);
+                }
+                node = rb_tree_lower_bound(tree, key);
+                TEST_ASSERT_EQUAL(0, rb_frozen_lower_bound(frozen, key, &found,
+                                                           &data));
+                TEST_ASSERT_EQUAL(node->key, found);
+                TEST_ASSERT_EQUAL_PTR(node->data, data);
+        }
+        TEST_ASSERT_EQUAL(0, rb_frozen_search(frozen, RB_MAX_KEY, NULL));
+}
+
+void test_rb_frozen_range(void)
+{
+        key_t keys[INSERT_SIZE];
+        key_t *cursor = keys;
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, key * 3,
+                                                    key_data(key * 3)));
+        }
+        frozen = rb_tree_freeze(tree);
+        TEST_ASSERT_NOT_NULL(frozen);
+
+        TEST_ASSERT_EQUAL(0, rb_frozen_for_each(frozen, 0, RB_MAX_KEY, collect,
+                                                &cursor));
+        TEST_ASSERT_EQUAL(INSERT_SIZE, cursor - keys);
+        for (key_t i = 0; i < INSERT_SIZE; i++) {
+                TEST_ASSERT_EQUAL(i * 3, keys[i]);
+        }
+
+        cursor = keys;
+        TEST_ASSERT_EQUAL(0, rb_frozen_for_each(frozen, 10, 20, collect,
+                                                &cursor));
+        TEST_ASSERT_EQUAL(3, cursor - keys); /**< 12, 15 and 18 */
+        TEST_ASSERT_EQUAL(12, keys[0]);
+        TEST_ASSERT_EQUAL(18, keys[2]);
+        TEST_ASSERT_EQUAL(-ENODATA, rb_frozen_lower_bound(frozen, 3 * INSERT_SIZE,
+                                                          NULL, NULL));
+}
+
+void test_rb_frozen_kary(void)
+{
+        struct rb_node *node = NULL;
+        void *data = NULL;
+        key_t found;
+
+        for (size_t size = 0; size < 3 * RB_FROZEN_BLOCK_KEYS; size++) {
+                frozen = rb_tree_freeze_layout(tree, RB_FROZEN_KARY);
+                TEST_ASSERT_NOT_NULL(frozen);
+                TEST_ASSERT_EQUAL(RB_FROZEN_KARY, frozen->layout);
+                for (key_t key = 0; key <= 2 * size + 1; key++) {
+                        node = rb_tree_lower_bound(tree, key);
+                        TEST_ASSERT_EQUAL(node != tree->nil ? 0 : -ENODATA,
+                                          rb_frozen_lower_bound(frozen, key,
+                                                                &found, &data));
+                        if (node != tree->nil) {
+                                TEST_ASSERT_EQUAL(node->key, found);
+                                TEST_ASSERT_EQUAL_PTR(node->data, data);
+                        }
+                }
+                rb_frozen_dealloc(frozen);
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, 2 * size + 1,
+                                                    key_data(2 * size + 1)));
+        }
+
+        srand(13);
+        for (int i = 0; i < INSERT_SIZE; i++) {
+                key_t key = (key_t)(rand() % (4 * INSERT_SIZE)) * 2;
+                rb_tree_insert(tree, key, key_data(key));
+        }
+        TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, RB_MAX_KEY,
+                                            key_data(RB_MAX_KEY)));
+        frozen = rb_tree_freeze_layout(tree, RB_FROZEN_KARY);
+        TEST_ASSERT_NOT_NULL(frozen);
+        for (key_t key = 0; key < 8 * INSERT_SIZE + 2; key++) {
+                node = rb_tree_lower_bound(tree, key);
+                TEST_ASSERT_EQUAL(0, rb_frozen_lower_bound(frozen, key, &found,
+                                                           &data));
+                TEST_ASSERT_EQUAL(node->key, found);
+                TEST_ASSERT_EQUAL_PTR(node->data, data);
+        }
+        TEST_ASSERT_EQUAL(0, rb_frozen_search(frozen, RB_MAX_KEY, NULL));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_frozen_search(frozen, 8 * INSERT_SIZE + 1,
+                                                     NULL));
+}
+
+void test_rb_frozen_empty(void)
+{
+        frozen = rb_tree_freeze(tree);
+        TEST_ASSERT_NOT_NULL(frozen);
+        TEST_ASSERT_EQUAL(0, frozen->nr_keys);
+        TEST_ASSERT_EQUAL(-ENODATA, rb_frozen_search(frozen, 0, NULL));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_frozen_lower_bound(frozen, 0, NULL,
+                                                          NULL));
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_frozen_search);
+        RUN_TEST(test_rb_frozen_range);
+        RUN_TEST(test_rb_frozen_kary);
+        RUN_TEST(test_rb_frozen_empty);
+
+        return UNITY_END();
+}
@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "rb-generate.h"
+#include "unity.h"
+
+#define INSERT_SIZE (1000)
+
+struct item {
+        uint64_t key;
+        RB_GEN_ENTRY(item) entry;
+};
+
+RB_GEN_HEAD(item_tree, item);
+RB_GENERATE_STATIC(item_tree, item, entry, uint64_t, key, RB_GEN_CMP)
+
+struct pair_key {
+        uint32_t shard;
+        uint64_t id;
+};
+
+#define PAIR_CMP(a, b)                                                         \
+        ((a).shard != (b).shard ? RB_GEN_CMP((a).shard, (b).shard) :           \
+                                  RB_GEN_CMP((a).id, (b).id))
+
+struct pair_item {
+        struct pair_key key;
+        RB_GEN_ENTRY(pair_item) link;
+};
+
+RB_GEN_HEAD(pair_tree, pair_item);
+RB_GENERATE_STATIC(pair_tree, pair_item, link, struct pair_key, key, PAIR_CMP)
+
+struct item_tree head;
+struct item *items;
+
+/**
+ * @brief Check red-black properties and return the black height
+ */
+static int item_tree_check(struct item *node, struct item *parent)
+{
+        int left_bh, right_bh;
+
+        if (node == NULL) {
+                return 1;
+        }
+
+        TEST_ASSERT_EQUAL_PTR(parent, RB_GEN_PARENT(node, entry));
+        if (RB_GEN_COLOR(node, entry) == RB_GEN_RED) {
+                TEST_ASSERT_TRUE(RB_GEN_IS_BLACK(RB_GEN_LEFT(node, entry), entry));
+                TEST_ASSERT_TRUE(RB_GEN_IS_BLACK(RB_GEN_RIGHT(node, entry), entry));
+        }
+        if (RB_GEN_LEFT(node, entry)) {
+                TEST_ASSERT_TRUE(RB_GEN_LEFT(node, entry)->key < node->key);
+        }
+        if (RB_GEN_RIGHT(node, entry)) {
+                TEST_ASSERT_TRUE(RB_GEN_RIGHT(node, entry)->key > node->key);
+        }
+
+        left_bh = item_tree_check(RB_GEN_LEFT(node, entry), node);
+        right_bh = item_tree_check(RB_GEN_RIGHT(node, entry), node);
+        TEST_ASSERT_EQUAL(left_bh, right_bh);
+
+        return left_bh + (RB_GEN_COLOR(node, entry) == RB_GEN_BLACK);
+}
+
+void setUp(void)
+{
+        item_tree_init(&head);
+        items = (struct item *)malloc(sizeof(struct item) * INSERT_SIZE);
+        TEST_ASSERT_NOT_NULL(items);
+}
+
+void tearDown(void)
+{
+        free(items);
+}
+
+void test_rb_gen_insert_and_search(void)
+{
+        for (int i = 0; i < INSERT_SIZE; i++) {
+                items[i].key = (uint64_t)rand() * 7919 + i; /**< unique key */
+                TEST_ASSERT_NULL(item_tree_insert(&head, &items[i]));
+        }
+        item_tree_check(head.rbh_root, NULL);
+        TEST_ASSERT_EQUAL(RB_GEN_BLACK, RB_GEN_COLOR(head.rbh_root, entry));
+
+        for (int i = 0; i < INSERT_SIZE; i++) {
+                TEST_ASSERT_EQUAL_PTR(&items[i],
+                                      item_tree_search(&head, items[i].key));
+        }
+        TEST_ASSERT_EQUAL_PTR(&items[0], item_tree_insert(&head, &items[0]));
+}
+
+void test_rb_gen_full_key_space(void)
+{
+        uint64_t keys[] = { UINT64_MAX, 0, (uint64_t)INT64_MAX,
+                            (uint64_t)INT64_MAX + 1, UINT64_MAX - 1 };
+        const int nr_keys = (int)(sizeof(keys) / sizeof(uint64_t));
+        struct item *cur;
+        uint64_t prev = 0;
+        int count = 0;
+
+        for (int i = 0; i < nr_keys; i++) {
+                items[i].key = keys[i];
+                TEST_ASSERT_NULL(item_tree_insert(&head, &items[i]));
+        }
+        for (cur = item_tree_minimum(&head); cur;
+             cur = item_tree_successor(cur), count++) {
+                TEST_ASSERT_TRUE(count == 0 || prev < cur->key);
+                prev = cur->key;
+        }
+        TEST_ASSERT_EQUAL(nr_keys, count);
+        TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, item_tree_maximum(&head)->key);
+        TEST_ASSERT_EQUAL_UINT64(
+                UINT64_MAX - 1,
+                item_tree_predecessor(item_tree_maximum(&head))->key);
+}
+
+void test_rb_gen_remove(void)
+{
+        for (int i = 0; i < INSERT_SIZE; i++) {
+                items[i].key = (uint64_t)i;
+                TEST_ASSERT_NULL(item_tree_insert(&head, &items[i]));
+        }
+
+        for (int i = 0; i < INSERT_SIZE; i += 3) {
+                TEST_ASSERT_EQUAL_PTR(&items[i],
+                                      item_tree_remove(&head, &items[i]));
+                TEST_ASSERT_NULL(item_tree_search(&head, (uint64_t)i));
+        }
+        item_tree_check(head.rbh_root, NULL);
+
+        TEST_ASSERT_EQUAL_PTR(&items[1], item_tree_lower_bound(&head, 0));
+        TEST_ASSERT_EQUAL_PTR(&items[4], item_tree_lower_bound(&head, 3));
+        TEST_ASSERT_NULL(item_tree_lower_bound(&head, INSERT_SIZE));
+
+        for (int i = 0; i < INSERT_SIZE; i++) {
+                if (i % 3) {
+                        item_tree_remove(&head, &items[i]);
+                        item_tree_check(head.rbh_root, NULL);
+                }
+        }
+        TEST_ASSERT_NULL(head.rbh_root);
+}
+
+void test_rb_gen_struct_key(void)
+{
+        struct pair_tree pairs;
+        struct pair_item nodes[6];
+        struct pair_key key = { .shard = 1, .id = 0 };
+        uint32_t shards[] = { 2, 1, 1, 0, 2, 1 };
+        uint64_t ids[] = { 5, 9, UINT64_MAX, 7, 0, 3 };
+
+        pair_tree_init(&pairs);
+        for (int i = 0; i < 6; i++) {
+                nodes[i].key.shard = shards[i];
+                nodes[i].key.id = ids[i];
+                TEST_ASSERT_NULL(pair_tree_insert(&pairs, &nodes[i]));
+        }
+
+        TEST_ASSERT_EQUAL_PTR(&nodes[5], pair_tree_lower_bound(&pairs, key));
+        key.id = 9;
+        TEST_ASSERT_EQUAL_PTR(&nodes[1], pair_tree_search(&pairs, key));
+        TEST_ASSERT_EQUAL_PTR(&nodes[2], pair_tree_successor(&nodes[1]));
+        TEST_ASSERT_EQUAL_PTR(&nodes[4], pair_tree_successor(&nodes[2]));
+        TEST_ASSERT_EQUAL_PTR(&nodes[3], pair_tree_minimum(&pairs));
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_gen_insert_and_search);
+        RUN_TEST(test_rb_gen_full_key_space);
+        RUN_TEST(test_rb_gen_remove);
+        RUN_TEST(test_rb_gen_struct_key);
+
+        return UNITY_END();
+}
@@ -0,0 +1,320 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+
+#include "rb-index.h"
+#include "unity.h"
+
+#define INSERT_SIZE (3000)
+
+struct rb_tree *tree; /**< reference */
+
+void setUp(void)
+{
+        tree = rb_tree_alloc();
+        TEST_ASSERT_NOT_NULL(tree);
+}
+
+void tearDown(void)
+{
+        rb_tree_dealloc(tree);
+}
+
+static key_t *key_data(key_t key)
+{
+        key_t *data = (key_t *)malloc(sizeof(key_t));
+
+        TEST_ASSERT_NOT_NULL(data);
+        *data = key;
+        return data;
+}
+
+static key_t sparse_key(void)
+{
+        return ((key_t)rand() << 40) ^ ((key_t)rand() << 20) ^ (key_t)rand();
+}
+
+static int collect(key_t key, void *data, void *arg)
+{
+        key_t **cursor = (key_t **)arg;
+
+        TEST_ASSERT_TRUE(data == NULL || key == *(key_t *)data);
+        *(*cursor)++ = key;
+        return 0;
+}
+
+/**
+ * @brief Compare every operation of the index with the reference
+ */
+static void compare(struct rb_index *index, struct rb_tree *reference)
+{
+        struct rb_node *node = NULL, *next = NULL;
+        key_t *keys = NULL, *cursor = NULL;
+        size_t nr_keys = 0;
+        void *data = NULL;
+        key_t found;
+
+        for (node = rb_tree_minimum(reference, reference->root);
+             node != reference->nil; node = next) {
+                next = rb_tree_successor(reference, node);
+                TEST_ASSERT_EQUAL(0, rb_index_search(index, node->key, &data));
+                TEST_ASSERT_EQUAL(node->key, *(key_t *)data);
+                TEST_ASSERT_EQUAL(rb_tree_search(reference, node->key + 1) ?
+                                          0 :
+                                          -ENODATA,
+                                  rb_index_search(index, node->key + 1, NULL));
+                TEST_ASSERT_EQUAL(next != reference->nil ? 0 : -ENODATA,
+                                  rb_index_successor(index, node->key, &found,
+                                                     NULL));
+                if (next != reference->nil) {
+                        TEST_ASSERT_EQUAL(next->key, found);
+                }
+                nr_keys++;
+        }
+
+        node = rb_tree_minimum(reference, reference->root);
+        TEST_ASSERT_EQUAL(node != reference->nil ? 0 : -ENODATA,
+                          rb_index_minimum(index, &found, NULL));
+        if (node != reference->nil) {
+                TEST_ASSERT_EQUAL(node->key, found);
+                TEST_ASSERT_EQUAL(0, rb_index_maximum(index, &found, NULL));
+                TEST_ASSERT_EQUAL(rb_tree_maximum(reference, reference->root)
+                                          ->key,
+                                  found);
+        }
+
+        keys = (key_t *)malloc(sizeof(key_t) * (nr_keys + 1));
+        TEST_ASSERT_NOT_NULL(keys);
+        cursor = keys;
+        TEST_ASSERT_EQUAL(0, rb_index_for_each(index, 0, RB_MAX_KEY, collect,
+                                               &cursor));
+        TEST_ASSERT_EQUAL(nr_keys, cursor - keys);
+        node = rb_tree_minimum(reference, reference->root);
+        for (size_t i = 0; i < nr_keys; i++) {
+                TEST_ASSERT_EQUAL(node->key, keys[i]);
+                node = rb_tree_successor(reference, node);
+        }
+        free(keys);
+}
+
+static int sum(key_t key, void *data, void *arg)
+{
+        TEST_ASSERT_EQUAL(key, *(key_t *)data);
+        *(key_t *)arg += key;
+        return 0;
+}
+
+/**
+ * @brief Run the same operations and return the digest of the result
+ */
+static key_t run_ops(enum rb_index_engine engine)
+{
+        struct rb_index *index = rb_index_alloc(engine);
+        key_t digest = 0, found, prev;
+        void *data = NULL;
+
+        TEST_ASSERT_NOT_NULL(index);
+        srand(23);
+        for (int i = 0; i < 3 * INSERT_SIZE; i++) {
+                key_t key = (key_t)(rand() % INSERT_SIZE);
+
+                if (rand() % 4) {
+                        TEST_ASSERT_EQUAL(0, rb_index_insert(index, key,
+                                                             key_data(key)));
+                } else if (rb_index_delete(index, key) == 0) {
+                        digest += key;
+                }
+        }
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                if (rb_index_search(index, key, &data) == 0) {
+                        TEST_ASSERT_EQUAL(key, *(key_t *)data);
+                        digest = digest * 31 + key;
+                }
+        }
+        TEST_ASSERT_EQUAL(0, rb_index_minimum(index, &found, NULL));
+        for (prev = found; rb_index_successor(index, prev, &found, NULL) == 0;
+             prev = found) {
+                TEST_ASSERT_TRUE(prev < found);
+        }
+        TEST_ASSERT_EQUAL(0, rb_index_maximum(index, &found, NULL));
+        TEST_ASSERT_EQUAL(prev, found);
+        TEST_ASSERT_EQUAL(0, rb_index_for_each(index, 100, 200, sum, &digest));
+        rb_index_dealloc(index);
+        return digest;
+}
+
+void test_rb_index_engines(void)
+{
+        key_t expected = run_ops(RB_INDEX_RB_TREE);
+
+        for (int engine = 0; engine < RB_INDEX_NR_ENGINES; engine++) {
+                TEST_ASSERT_NOT_NULL(rb_index_engine_name(engine));
+                TEST_ASSERT_EQUAL(expected, run_ops(engine));
+        }
+        TEST_ASSERT_NULL(rb_index_alloc(RB_INDEX_NR_ENGINES));
+        TEST_ASSERT_NULL(rb_index_engine_name(RB_INDEX_NR_ENGINES));
+}
+
+void test_rb_index_random(void)
+{
+        struct rb_index *index = NULL;
+        key_t found;
+
+        for (int engine = 0; engine < RB_INDEX_NR_ENGINES; engine++) {
+                index = rb_index_alloc(engine);
+                TEST_ASSERT_NOT_NULL(index);
+                srand(29);
+                for (int i = 0; i < 4 * INSERT_SIZE; i++) {
+                        key_t key = (i % 2) ? (key_t)(rand() % INSERT_SIZE) :
+                                              sparse_key();
+
+                        if (rand() % 3) {
+                                rb_tree_insert(tree, key, key_data(key));
+                                TEST_ASSERT_EQUAL(0, rb_index_insert(
+                                                             index, key,
+                                                             key_data(key)));
+                        } else {
+                                key = (key_t)(rand() % INSERT_SIZE);
+                                TEST_ASSERT_EQUAL(rb_tree_delete(tree, key),
+                                                  rb_index_delete(index, key));
+                        }
+                }
+                compare(index, tree);
+
+                while (rb_index_minimum(index, &found, NULL) == 0) {
+                        TEST_ASSERT_EQUAL(0, rb_tree_delete(tree, found));
+                        TEST_ASSERT_EQUAL(0, rb_index_delete(index, found));
+                }
+                TEST_ASSERT_EQUAL_PTR(tree->nil, tree->root);
+                TEST_ASSERT_EQUAL(-ENODATA, rb_index_maximum(index, NULL,
+                                                             NULL));
+                TEST_ASSERT_EQUAL(-ENODATA, rb_index_delete(index, 0));
+                rb_index_dealloc(index);
+        }
+}
+
+void test_rb_index_split_concat(void)
+{
+        struct rb_index *index = NULL, *lo = NULL, *hi = NULL;
+        key_t found;
+
+        for (int engine = 0; engine < RB_INDEX_NR_ENGINES; engine++) {
+                index = rb_index_alloc(engine);
+                TEST_ASSERT_NOT_NULL(index);
+                for (key_t key = 0; key < INSERT_SIZE; key++) {
+                        TEST_ASSERT_EQUAL(0, rb_index_insert(index, key,
+                                                             key_data(key)));
+                }
+                TEST_ASSERT_EQUAL(0, rb_index_split(index, INSERT_SIZE / 3,
+                                                    &lo, &hi));
+                TEST_ASSERT_EQUAL(0, rb_index_maximum(lo, &found, NULL));
+                TEST_ASSERT_EQUAL(INSERT_SIZE / 3, found);
+                TEST_ASSERT_EQUAL(0, rb_index_minimum(hi, &found, NULL));
+                TEST_ASSERT_EQUAL(INSERT_SIZE / 3 + 1, found);
+
+                TEST_ASSERT_NULL(rb_index_concat(hi, lo)); /**< wrong order */
+                index = rb_index_concat(lo, hi);
+                TEST_ASSERT_NOT_NULL(index);
+                for (key_t key = 0; key < INSERT_SIZE; key++) {
+                        TEST_ASSERT_EQUAL(0, rb_index_search(index, key, NULL));
+                }
+                TEST_ASSERT_EQUAL(-ENODATA,
+                                  rb_index_search(index, INSERT_SIZE, NULL));
+
+                TEST_ASSERT_EQUAL(0, rb_index_split(index, RB_MAX_KEY, &lo,
+                                                    &hi));
+                TEST_ASSERT_EQUAL(-ENODATA, rb_index_minimum(hi, NULL, NULL));
+                index = rb_index_concat(lo, hi);
+                TEST_ASSERT_NOT_NULL(index);
+                TEST_ASSERT_EQUAL(0, rb_index_maximum(index, &found, NULL));
+                TEST_ASSERT_EQUAL(INSERT_SIZE - 1, found);
+                rb_index_dealloc(index);
+        }
+}
+
+void test_rb_index_split_concat_random(void)
+{
+        struct rb_index *index = NULL, *lo = NULL, *hi = NULL;
+        struct rb_node *node = NULL;
+        key_t found;
+
+        for (int engine = 0; engine < RB_INDEX_NR_ENGINES; engine++) {
+                index = rb_index_alloc(engine);
+                TEST_ASSERT_NOT_NULL(index);
+                srand(31);
+                for (int i = 0; i < INSERT_SIZE; i++) {
+                        key_t key = (i % 2) ? (key_t)i : sparse_key();
+
+                        rb_tree_insert(tree, key, key_data(key));
+                        TEST_ASSERT_EQUAL(0, rb_index_insert(index, key,
+                                                             key_data(key)));
+                }
+                for (int round = 0; round < 64; round++) {
+                        key_t x = (round % 2) ? (key_t)(rand() % INSERT_SIZE) :
+                                                sparse_key();
+
+                        TEST_ASSERT_EQUAL(0, rb_index_split(index, x, &lo,
+                                                            &hi));
+                        node = rb_tree_upper_bound(tree, x);
+                        TEST_ASSERT_EQUAL(node != tree->nil ? 0 : -ENODATA,
+                                          rb_index_minimum(hi, &found, NULL));
+                        if (node != tree->nil) {
+                                TEST_ASSERT_EQUAL(node->key, found);
+                        }
+                        if (rb_index_maximum(lo, &found, NULL) == 0) {
+                                TEST_ASSERT_TRUE(found <= x);
+                                if (node != tree->nil) {
+                                        TEST_ASSERT_NULL(
+                                                rb_index_concat(hi, lo));
+                                }
+                        }
+                        index = rb_index_concat(lo, hi);
+                        TEST_ASSERT_NOT_NULL(index);
+                }
+                compare(index, tree);
+
+                /**< the linked index is still updatable */
+                node = rb_tree_minimum(tree, tree->root);
+                found = node->key;
+                TEST_ASSERT_EQUAL(0, rb_tree_delete(tree, found));
+                TEST_ASSERT_EQUAL(0, rb_index_delete(index, found));
+                rb_tree_insert(tree, found + 1, key_data(found + 1));
+                TEST_ASSERT_EQUAL(0, rb_index_insert(index, found + 1,
+                                                     key_data(found + 1)));
+                compare(index, tree);
+                rb_index_dealloc(index);
+
+                rb_tree_dealloc(tree); /**< the next engine starts over */
+                tree = rb_tree_alloc();
+                TEST_ASSERT_NOT_NULL(tree);
+        }
+}
+
+void test_rb_index_mixed_engines(void)
+{
+        struct rb_index *lo = rb_index_alloc(RB_INDEX_RB_TREE);
+        struct rb_index *hi = rb_index_alloc(RB_INDEX_BPTREE);
+
+        TEST_ASSERT_NOT_NULL(lo);
+        TEST_ASSERT_NOT_NULL(hi);
+        TEST_ASSERT_EQUAL(0, rb_index_insert(lo, 1, key_data(1)));
+        TEST_ASSERT_EQUAL(0, rb_index_insert(hi, 2, key_data(2)));
+        TEST_ASSERT_NULL(rb_index_concat(lo, hi));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_index_delete(hi, 1));
+        TEST_ASSERT_EQUAL(0, rb_index_delete(hi, 2));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_index_minimum(hi, NULL, NULL));
+        rb_index_dealloc(lo);
+        rb_index_dealloc(hi);
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_index_engines);
+        RUN_TEST(test_rb_index_random);
+        RUN_TEST(test_rb_index_split_concat);
+        RUN_TEST(test_rb_index_split_concat_random);
+        RUN_TEST(test_rb_index_mixed_engines);
+
+        return UNITY_END();
+}
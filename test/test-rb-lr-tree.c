@@ -0,0 +1,230 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "rb-lr-tree.h"
+#include "unity.h"
+
+#define INSERT_SIZE (1000)
+#define NR_READERS (4)
+#define NR_ROUNDS (20)
+
+struct rb_lr_tree *lrtree;
+
+struct reader_arg {
+        pthread_t thread;
+        int nr_missed;
+        int nr_broken; /**< visited data which is not the key's */
+};
+
+void setUp(void)
+{
+        lrtree = rb_lr_tree_alloc(0);
+        TEST_ASSERT_NOT_NULL(lrtree);
+}
+
+void tearDown(void)
+{
+        if (lrtree) {
+                rb_lr_tree_dealloc(lrtree);
+        }
+}
+
+static int get_data(struct rb_node *node, void *arg)
+{
+        *(void **)arg = node->data;
+        return 0;
+}
+
+/**
+ * @brief Check that both instances have the same keys and data
+ *
+ * @return size_t number of the nodes
+ */
+static size_t check_instances(void)
+{
+        struct rb_tree *t0 = lrtree->trees[0], *t1 = lrtree->trees[1];
+        struct rb_node *x = rb_tree_minimum(t0, t0->root);
+        struct rb_node *y = rb_tree_minimum(t1, t1->root);
+        size_t count = 0;
+
+        while (x != t0->nil && y != t1->nil) {
+                TEST_ASSERT_EQUAL(x->key, y->key);
+                TEST_ASSERT_EQUAL_PTR(x->data, y->data);
+                x = rb_tree_successor(t0, x);
+                y = rb_tree_successor(t1, y);
+                count++;
+        }
+        TEST_ASSERT_EQUAL_PTR(t0->nil, x);
+        TEST_ASSERT_EQUAL_PTR(t1->nil, y);
+        return count;
+}
+
+void test_rb_lr_data_ownership(void)
+{
+        void *found = NULL;
+        void *data = NULL;
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                data = malloc(sizeof(key_t)); /**< freed once by the tree */
+                TEST_ASSERT_NOT_NULL(data);
+                TEST_ASSERT_EQUAL(0, rb_lr_tree_insert(lrtree, key, data));
+        }
+        data = malloc(sizeof(key_t));
+        TEST_ASSERT_EQUAL(0, rb_lr_tree_insert(lrtree, 7, data)); /**< update */
+        TEST_ASSERT_EQUAL(0, rb_lr_tree_search(lrtree, 7, get_data, &found));
+        TEST_ASSERT_EQUAL_PTR(data, found);
+
+        for (key_t key = 0; key < INSERT_SIZE; key += 2) {
+                TEST_ASSERT_EQUAL(0, rb_lr_tree_delete(lrtree, key));
+        }
+        TEST_ASSERT_EQUAL(-ENODATA, rb_lr_tree_delete(lrtree, 0));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_lr_tree_search(lrtree, 0, NULL, NULL));
+        TEST_ASSERT_EQUAL(0, rb_lr_tree_lower_bound(lrtree, 0, get_data,
+                                                    &found));
+        TEST_ASSERT_EQUAL(INSERT_SIZE / 2, check_instances());
+}
+
+void test_rb_lr_multi(void)
+{
+        /**< the replay skips the seqlock of the optimistic readers */
+        TEST_ASSERT_NULL(rb_lr_tree_alloc(RB_TREE_FLAG_OPTIMISTIC));
+        rb_lr_tree_dealloc(lrtree);
+        lrtree = rb_lr_tree_alloc(RB_TREE_FLAG_MULTI);
+        TEST_ASSERT_NOT_NULL(lrtree);
+
+        for (int i = 0; i < 3; i++) {
+                TEST_ASSERT_EQUAL(0, rb_lr_tree_insert(lrtree, 1,
+                                                       malloc(sizeof(int))));
+        }
+        TEST_ASSERT_EQUAL(0, rb_lr_tree_delete(lrtree, 1));
+        TEST_ASSERT_EQUAL(2, check_instances());
+}
+
+static atomic_int stop;
+
+static void *reader(void *arg)
+{
+        struct reader_arg *rarg = (struct reader_arg *)arg;
+
+        while (!atomic_load(&stop)) {
+                for (key_t key = 0; key < INSERT_SIZE; key += 2) {
+                        if (rb_lr_tree_search(lrtree, key, NULL, NULL)) {
+                                rarg->nr_missed++;
+                        }
+                }
+        }
+        return NULL;
+}
+
+void test_rb_lr_concurrent_read(void)
+{
+        struct reader_arg readers[NR_READERS];
+
+        for (key_t key = 0; key < INSERT_SIZE; key += 2) {
+                TEST_ASSERT_EQUAL(0, rb_lr_tree_insert(lrtree, key, NULL));
+        }
+
+        atomic_store(&stop, 0);
+        for (int i = 0; i < NR_READERS; i++) {
+                readers[i].nr_missed = 0;
+                TEST_ASSERT_EQUAL(0, pthread_create(&readers[i].thread, NULL,
+                                                    reader, &readers[i]));
+        }
+        for (int round = 0; round < NR_ROUNDS; round++) { /**< odd keys only */
+                for (key_t key = 1; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(0, rb_lr_tree_insert(lrtree, key,
+                                                               NULL));
+                }
+                for (key_t key = 1; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(0, rb_lr_tree_delete(lrtree, key));
+                }
+        }
+        atomic_store(&stop, 1);
+        for (int i = 0; i < NR_READERS; i++) {
+                pthread_join(readers[i].thread, NULL);
+                TEST_ASSERT_EQUAL(0, readers[i].nr_missed);
+        }
+
+        TEST_ASSERT_EQUAL(INSERT_SIZE / 2, check_instances());
+}
+
+static key_t *key_data(key_t key)
+{
+        key_t *data = (key_t *)malloc(sizeof(key_t));
+
+        TEST_ASSERT_NOT_NULL(data);
+        *data = key;
+        return data;
+}
+
+/**
+ * @brief Read the data slowly (the writer can replace it meanwhile)
+ */
+static int check_data(struct rb_node *node, void *arg)
+{
+        struct reader_arg *rarg = (struct reader_arg *)arg;
+
+        sched_yield();
+        if (*(key_t *)node->data != node->key) {
+                rarg->nr_broken++;
+        }
+        return 0;
+}
+
+static void *data_reader(void *arg)
+{
+        struct reader_arg *rarg = (struct reader_arg *)arg;
+
+        while (!atomic_load(&stop)) {
+                for (key_t key = 1; key < INSERT_SIZE; key += 2) {
+                        rb_lr_tree_search(lrtree, key, check_data, rarg);
+                }
+        }
+        return NULL;
+}
+
+void test_rb_lr_concurrent_data(void)
+{
+        struct reader_arg readers[NR_READERS];
+
+        atomic_store(&stop, 0);
+        for (int i = 0; i < NR_READERS; i++) {
+                readers[i].nr_broken = 0;
+                TEST_ASSERT_EQUAL(0, pthread_create(&readers[i].thread, NULL,
+                                                    data_reader, &readers[i]));
+        }
+        for (int round = 0; round < NR_ROUNDS; round++) {
+                for (key_t key = 1; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(0, rb_lr_tree_insert(lrtree, key,
+                                                               key_data(key)));
+                }
+                for (key_t key = 1; key < INSERT_SIZE; key += 4) { /**< update */
+                        TEST_ASSERT_EQUAL(0, rb_lr_tree_insert(lrtree, key,
+                                                               key_data(key)));
+                }
+                for (key_t key = 1; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(0, rb_lr_tree_delete(lrtree, key));
+                }
+        }
+        atomic_store(&stop, 1);
+        for (int i = 0; i < NR_READERS; i++) {
+                pthread_join(readers[i].thread, NULL);
+                TEST_ASSERT_EQUAL(0, readers[i].nr_broken);
+        }
+
+        TEST_ASSERT_EQUAL(0, check_instances());
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_lr_data_ownership);
+        RUN_TEST(test_rb_lr_multi);
+        RUN_TEST(test_rb_lr_concurrent_read);
+        RUN_TEST(test_rb_lr_concurrent_data);
+
+        return UNITY_END();
+}
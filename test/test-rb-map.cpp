@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <string>
+
+#include "rb-map.hpp"
+#include "unity.h"
+
+#define INSERT_SIZE (1000)
+
+/**
+ * @brief Memory resource which counts the live allocations
+ */
+class counting_resource : public std::pmr::memory_resource
+{
+    public:
+        int nr_allocs = 0;
+
+    private:
+        void *do_allocate(std::size_t bytes, std::size_t align) override
+        {
+                nr_allocs++;
+                return std::pmr::new_delete_resource()->allocate(bytes, align);
+        }
+        void do_deallocate(void *ptr, std::size_t bytes,
+                           std::size_t align) override
+        {
+                nr_allocs--;
+                std::pmr::new_delete_resource()->deallocate(ptr, bytes, align);
+        }
+        bool do_is_equal(const std::pmr::memory_resource &other) const
+                noexcept override
+        {
+                return this == &other;
+        }
+};
+
+/**
+ * @brief Mapped type which counts the live objects
+ */
+struct tracked {
+        static int nr_alive;
+        int value;
+
+        explicit tracked(int v = 0) : value(v)
+        {
+                nr_alive++;
+        }
+        tracked(const tracked &other) : value(other.value)
+        {
+                nr_alive++;
+        }
+        ~tracked()
+        {
+                nr_alive--;
+        }
+        bool operator==(const tracked &other) const
+        {
+                return value == other.value;
+        }
+};
+
+int tracked::nr_alive = 0;
+
+void setUp(void)
+{
+        tracked::nr_alive = 0;
+}
+
+void tearDown(void)
+{
+}
+
+void test_rb_map_insert_and_find(void)
+{
+        rb::map<int, int> map;
+        std::map<int, int> expect;
+
+        srand(0);
+        for (int i = 0; i < INSERT_SIZE; i++) {
+                int key = rand() % (INSERT_SIZE * 2);
+                TEST_ASSERT_EQUAL(expect.insert({ key, i }).second,
+                                  map.insert({ key, i }).second);
+        }
+        TEST_ASSERT_EQUAL(expect.size(), map.size());
+        TEST_ASSERT_TRUE(map.verify() > 0);
+        TEST_ASSERT_TRUE(std::equal(map.begin(), map.end(), expect.begin(),
+                                    expect.end()));
+
+        for (int key = -1; key <= INSERT_SIZE * 2; key++) {
+                TEST_ASSERT_EQUAL(expect.count(key), map.count(key));
+                TEST_ASSERT_EQUAL(expect.lower_bound(key) == expect.end(),
+                                  map.lower_bound(key) == map.end());
+                if (map.upper_bound(key) != map.end()) {
+                        TEST_ASSERT_EQUAL(expect.upper_bound(key)->first,
+                                          map.upper_bound(key)->first);
+                }
+        }
+        TEST_ASSERT_EQUAL(expect.begin()->first, map.begin()->first);
+        TEST_ASSERT_EQUAL(expect.rbegin()->first, map.rbegin()->first);
+        TEST_ASSERT_EQUAL(expect.rbegin()->first, std::prev(map.end())->first);
+}
+
+void test_rb_map_erase(void)
+{
+        rb::map<int, int> map;
+        rb::map<int, int>::iterator it;
+
+        for (int i = 0; i < INSERT_SIZE; i++) {
+                map[i] = i * 2;
+        }
+        for (int i = 0; i < INSERT_SIZE; i += 3) {
+                TEST_ASSERT_EQUAL(1, map.erase(i));
+                TEST_ASSERT_EQUAL(0, map.erase(i));
+        }
+        TEST_ASSERT_TRUE(map.verify() > 0);
+        TEST_ASSERT_EQUAL(1, map.begin()->first);
+
+        it = map.erase(map.find(1));
+        TEST_ASSERT_EQUAL(2, it->first);
+        TEST_ASSERT_EQUAL(2, map.begin()->first);
+
+        it = map.erase(map.lower_bound(100), map.lower_bound(200));
+        TEST_ASSERT_EQUAL(200, it->first);
+        TEST_ASSERT_TRUE(map.verify() > 0);
+
+        while (!map.empty()) {
+                map.erase(std::prev(map.end()));
+                TEST_ASSERT_TRUE(map.verify() >= 0);
+        }
+        TEST_ASSERT_TRUE(map.begin() == map.end());
+}
+
+void test_rb_map_move_only(void)
+{
+        rb::map<int, std::unique_ptr<int> > map;
+        rb::map<int, std::unique_ptr<int> > moved;
+
+        for (int i = 0; i < INSERT_SIZE; i++) {
+                TEST_ASSERT_TRUE(
+                        map.emplace(i, std::make_unique<int>(i)).second);
+        }
+        TEST_ASSERT_FALSE(map.try_emplace(0, std::make_unique<int>(-1)).second);
+        TEST_ASSERT_EQUAL(0, *map.at(0));
+        map.insert_or_assign(0, std::make_unique<int>(-1));
+        TEST_ASSERT_EQUAL(-1, *map[0]);
+
+        moved = std::move(map);
+        TEST_ASSERT_TRUE(map.empty());
+        TEST_ASSERT_EQUAL(INSERT_SIZE, moved.size());
+        TEST_ASSERT_EQUAL(INSERT_SIZE - 1, *moved.at(INSERT_SIZE - 1));
+        TEST_ASSERT_TRUE(moved.verify() > 0);
+}
+
+void test_rb_map_destructor(void)
+{
+        {
+                rb::map<int, tracked> map;
+                for (int i = 0; i < INSERT_SIZE; i++) {
+                        map.try_emplace(i, i);
+                }
+                map.emplace(0, tracked(0)); /**< duplicated key is destroyed */
+                TEST_ASSERT_EQUAL(INSERT_SIZE, tracked::nr_alive);
+
+                rb::map<int, tracked> copy(map);
+                TEST_ASSERT_EQUAL(INSERT_SIZE * 2, tracked::nr_alive);
+                TEST_ASSERT_TRUE(copy == map);
+                TEST_ASSERT_TRUE(copy.verify() > 0);
+
+                copy.erase(copy.begin(), copy.end());
+                TEST_ASSERT_EQUAL(INSERT_SIZE, tracked::nr_alive);
+        }
+        TEST_ASSERT_EQUAL(0, tracked::nr_alive);
+}
+
+void test_rb_map_pmr(void)
+{
+        counting_resource resource;
+        counting_resource other;
+
+        {
+                rb::pmr::map<std::pmr::string, std::pmr::string> map(
+                        &resource);
+                map.emplace("a long key which is not in SSO buffer",
+                            "a long value which is not in SSO buffer");
+                map.try_emplace("b", "value");
+                /**< node, key and value are allocated from the resource */
+                TEST_ASSERT_EQUAL(3 + 1, resource.nr_allocs);
+                TEST_ASSERT_TRUE(map.begin()->second.get_allocator().resource() ==
+                                 &resource);
+
+                rb::pmr::map<std::pmr::string, std::pmr::string> copy(map,
+                                                                      &other);
+                TEST_ASSERT_EQUAL(3 + 1, other.nr_allocs);
+                copy = std::move(map); /**< different resources: per element */
+                TEST_ASSERT_EQUAL(3 + 1, other.nr_allocs);
+                TEST_ASSERT_EQUAL(2, copy.size());
+        }
+        TEST_ASSERT_EQUAL(0, resource.nr_allocs);
+        TEST_ASSERT_EQUAL(0, other.nr_allocs);
+}
+
+void test_rb_map_algorithms(void)
+{
+        rb::map<int, int, std::greater<int> > map = { { 1, 10 },
+                                                      { 3, 30 },
+                                                      { 2, 20 } };
+        rb::map<int, int, std::greater<int> > other;
+
+        TEST_ASSERT_EQUAL(3, map.begin()->first);
+        TEST_ASSERT_EQUAL(60, std::accumulate(map.begin(), map.end(), 0,
+                                              [](int sum, const auto &kv) {
+                                                      return sum + kv.second;
+                                              }));
+        TEST_ASSERT_EQUAL(3, std::distance(map.cbegin(), map.cend()));
+        TEST_ASSERT_EQUAL(1, map.rbegin()->first);
+        TEST_ASSERT_EQUAL(20, std::find_if(map.begin(), map.end(),
+                                           [](const auto &kv) {
+                                                   return kv.first == 2;
+                                           })->second);
+
+        other.swap(map);
+        TEST_ASSERT_TRUE(map.empty());
+        TEST_ASSERT_EQUAL(3, other.size());
+        TEST_ASSERT_EQUAL(1, std::prev(other.end())->first);
+        TEST_ASSERT_TRUE(other.verify() > 0);
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_map_insert_and_find);
+        RUN_TEST(test_rb_map_erase);
+        RUN_TEST(test_rb_map_move_only);
+        RUN_TEST(test_rb_map_destructor);
+        RUN_TEST(test_rb_map_pmr);
+        RUN_TEST(test_rb_map_algorithms);
+
+        return UNITY_END();
+}
@@ -0,0 +1,179 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+
+#include "rb-pool-tree.h"
+#include "unity.h"
+
+#define INSERT_SIZE (5000)
+
+struct rb_pool_tree *pool;
+
+void setUp(void)
+{
+        pool = rb_pool_tree_alloc();
+        TEST_ASSERT_NOT_NULL(pool);
+}
+
+void tearDown(void)
+{
+        if (pool) {
+                rb_pool_tree_dealloc(pool);
+        }
+}
+
+static key_t *key_data(key_t key)
+{
+        key_t *data = (key_t *)malloc(sizeof(key_t));
+
+        TEST_ASSERT_NOT_NULL(data);
+        *data = key;
+        return data;
+}
+
+/**
+ * @brief Check the red-black properties of the subtree
+ *
+ * @return int black height of the subtree
+ */
+static int check_node(struct rb_pool_tree *target, uint32_t x, uint32_t parent,
+                      key_t *prev, size_t *nr_keys)
+{
+        struct rb_pool_node *nodes = target->nodes;
+        int left, right;
+
+        if (x == RB_POOL_NIL) {
+                return 1;
+        }
+        TEST_ASSERT_TRUE(x < target->nr_slots);
+        TEST_ASSERT_EQUAL(parent, nodes[x].parent & ~RB_POOL_RED);
+        if (nodes[x].parent & RB_POOL_RED) {
+                TEST_ASSERT_FALSE(nodes[nodes[x].left].parent & RB_POOL_RED);
+                TEST_ASSERT_FALSE(nodes[nodes[x].right].parent & RB_POOL_RED);
+        }
+        left = check_node(target, nodes[x].left, x, prev, nr_keys);
+        TEST_ASSERT_TRUE(*nr_keys == 0 || *prev < nodes[x].key);
+        *prev = nodes[x].key;
+        (*nr_keys)++;
+        right = check_node(target, nodes[x].right, x, prev, nr_keys);
+        TEST_ASSERT_EQUAL(left, right);
+        return left + !(nodes[x].parent & RB_POOL_RED);
+}
+
+static void check_pool(struct rb_pool_tree *target)
+{
+        size_t nr_keys = 0;
+        key_t prev = 0;
+
+        TEST_ASSERT_FALSE(target->nodes[target->root].parent & RB_POOL_RED);
+        TEST_ASSERT_FALSE(target->nodes[RB_POOL_NIL].parent & RB_POOL_RED);
+        check_node(target, target->root, RB_POOL_NIL, &prev, &nr_keys);
+        TEST_ASSERT_EQUAL(target->nr_keys, nr_keys);
+        TEST_ASSERT_TRUE(target->nr_slots <= target->capacity);
+}
+
+void test_rb_pool_tree_random(void)
+{
+        TEST_ASSERT_EQUAL(24, sizeof(struct rb_pool_node));
+        srand(43);
+        for (int i = 0; i < 4 * INSERT_SIZE; i++) {
+                key_t key = (key_t)(rand() % INSERT_SIZE);
+
+                if (rand() % 3) {
+                        TEST_ASSERT_EQUAL(0, rb_pool_tree_insert(
+                                                     pool, key, key_data(key)));
+                } else {
+                        rb_pool_tree_delete(pool, key);
+                }
+                if (i % 997 == 0) {
+                        check_pool(pool);
+                }
+        }
+        check_pool(pool);
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                rb_pool_tree_delete(pool, key);
+        }
+        check_pool(pool);
+        TEST_ASSERT_EQUAL(RB_POOL_NIL, pool->root);
+}
+
+void test_rb_pool_tree_rebuild(void)
+{
+        struct rb_pool_tree *t1 = NULL, *t2 = NULL;
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                TEST_ASSERT_EQUAL(0, rb_pool_tree_insert(pool, key * 2,
+                                                         key_data(key * 2)));
+        }
+        for (key_t x = 0; x < 2 * INSERT_SIZE; x += 331) {
+                TEST_ASSERT_EQUAL(0, rb_pool_tree_split(pool, x, &t1, &t2));
+                check_pool(t1);
+                check_pool(t2);
+                TEST_ASSERT_EQUAL(x / 2 + 1, t1->nr_keys);
+                pool = rb_pool_tree_concat(t1, t2);
+                TEST_ASSERT_NOT_NULL(pool);
+                check_pool(pool);
+                TEST_ASSERT_EQUAL(INSERT_SIZE, pool->nr_keys);
+        }
+        /**< the tree which is built again is still updatable */
+        TEST_ASSERT_EQUAL(0, rb_pool_tree_delete(pool, 0));
+        TEST_ASSERT_EQUAL(0, rb_pool_tree_insert(pool, 1, key_data(1)));
+        check_pool(pool);
+}
+
+void test_rb_pool_tree_relocate(void)
+{
+        struct rb_pool_node *copy = NULL;
+        uint32_t nr_slots;
+        size_t bytes;
+        void *data = NULL;
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                TEST_ASSERT_EQUAL(0, rb_pool_tree_insert(pool, key * 3, NULL));
+        }
+        TEST_ASSERT_NULL(pool->data); /**< key-only tree */
+        bytes = rb_pool_tree_bytes(pool);
+        TEST_ASSERT_TRUE(bytes < sizeof(struct rb_pool_tree) +
+                                         2 * INSERT_SIZE *
+                                                 sizeof(struct rb_pool_node));
+
+        /**< the pool has no pointer, so a byte copy is the same tree */
+        copy = (struct rb_pool_node *)malloc(sizeof(struct rb_pool_node) *
+                                             pool->capacity);
+        TEST_ASSERT_NOT_NULL(copy);
+        memcpy(copy, pool->nodes, sizeof(struct rb_pool_node) * pool->capacity);
+        memset(pool->nodes, 0xff, sizeof(struct rb_pool_node) * pool->capacity);
+        free(pool->nodes);
+        pool->nodes = copy;
+        check_pool(pool);
+
+        /**< the first data allocates the data array */
+        TEST_ASSERT_EQUAL(0, rb_pool_tree_insert(pool, 15, key_data(15)));
+        TEST_ASSERT_NOT_NULL(pool->data);
+        TEST_ASSERT_EQUAL(0, rb_pool_tree_search(pool, 15, &data));
+        TEST_ASSERT_EQUAL(15, *(key_t *)data);
+        TEST_ASSERT_EQUAL(0, rb_pool_tree_search(pool, 12, &data));
+        TEST_ASSERT_NULL(data);
+        TEST_ASSERT_TRUE(rb_pool_tree_bytes(pool) > bytes);
+
+        /**< the freed nodes are reused before the pool grows */
+        nr_slots = pool->nr_slots;
+        TEST_ASSERT_EQUAL(0, rb_pool_tree_delete(pool, 15));
+        TEST_ASSERT_EQUAL(0, rb_pool_tree_delete(pool, 18));
+        TEST_ASSERT_EQUAL(0, rb_pool_tree_insert(pool, 16, key_data(16)));
+        TEST_ASSERT_EQUAL(0, rb_pool_tree_insert(pool, 17, NULL));
+        TEST_ASSERT_EQUAL(nr_slots, pool->nr_slots);
+        TEST_ASSERT_EQUAL(-ENODATA, rb_pool_tree_delete(pool, 18));
+        check_pool(pool);
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_pool_tree_random);
+        RUN_TEST(test_rb_pool_tree_rebuild);
+        RUN_TEST(test_rb_pool_tree_relocate);
+
+        return UNITY_END();
+}
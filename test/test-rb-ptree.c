@@ -0,0 +1,213 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "rb-ptree.h"
+#include "unity.h"
+
+#define INSERT_SIZE (1000)
+#define NR_VERSIONS (8)
+#define NR_ROUNDS (200)
+
+struct rb_ptree *ptree;
+
+void setUp(void)
+{
+        ptree = rb_ptree_alloc();
+        TEST_ASSERT_NOT_NULL(ptree);
+}
+
+void tearDown(void)
+{
+        if (ptree) {
+                rb_ptree_dealloc(ptree);
+        }
+}
+
+/**
+ * @brief Check the order and the red-black properties of the subtree
+ *
+ * @return int black height (-1 means invalid)
+ */
+static int check_subtree(const struct rb_pnode *node, key_t *prev, int *first)
+{
+        int left, right;
+
+        if (!node) {
+                return 1;
+        }
+        if (node->color == RB_NODE_COLOR_RED &&
+            ((node->left && node->left->color == RB_NODE_COLOR_RED) ||
+             (node->right && node->right->color == RB_NODE_COLOR_RED))) {
+                return -1;
+        }
+        left = check_subtree(node->left, prev, first);
+        if (!*first && *prev >= node->key) {
+                return -1;
+        }
+        *first = 0;
+        *prev = node->key;
+        right = check_subtree(node->right, prev, first);
+        if (left < 0 || left != right) {
+                return -1;
+        }
+        return left + (node->color == RB_NODE_COLOR_BLACK);
+}
+
+static int check_tree(struct rb_ptree *version)
+{
+        key_t prev = 0;
+        int first = 1;
+
+        if (version->root && version->root->color != RB_NODE_COLOR_BLACK) {
+                return -1;
+        }
+        return check_subtree(version->root, &prev, &first);
+}
+
+static int count_node(const struct rb_pnode *node, void *arg)
+{
+        (void)node;
+        (*(size_t *)arg)++;
+        return 0;
+}
+
+void test_rb_ptree_snapshot(void)
+{
+        struct rb_ptree *snapshot = NULL;
+        size_t count = 0;
+
+        for (key_t key = 1; key <= INSERT_SIZE; key++) {
+                TEST_ASSERT_EQUAL(0, rb_ptree_insert(ptree, key, NULL));
+        }
+        snapshot = rb_ptree_snapshot(ptree);
+        TEST_ASSERT_NOT_NULL(snapshot);
+        TEST_ASSERT_EQUAL_PTR(ptree->root, snapshot->root);
+
+        for (key_t key = 2; key <= INSERT_SIZE; key += 2) {
+                TEST_ASSERT_EQUAL(0, rb_ptree_delete(ptree, key));
+        }
+        TEST_ASSERT_EQUAL(0, rb_ptree_insert(ptree, 1, &count)); /**< update */
+        TEST_ASSERT_EQUAL(-ENODATA, rb_ptree_delete(ptree, 2));
+
+        TEST_ASSERT_EQUAL(INSERT_SIZE / 2, ptree->nr_nodes);
+        TEST_ASSERT_EQUAL(INSERT_SIZE, snapshot->nr_nodes);
+        TEST_ASSERT_NULL(rb_ptree_search(ptree, 2));
+        TEST_ASSERT_NOT_NULL(rb_ptree_search(snapshot, 2));
+        TEST_ASSERT_EQUAL_PTR(&count, rb_ptree_search(ptree, 1)->data);
+        TEST_ASSERT_NULL(rb_ptree_search(snapshot, 1)->data);
+        TEST_ASSERT_GREATER_THAN(0, check_tree(ptree));
+        TEST_ASSERT_GREATER_THAN(0, check_tree(snapshot));
+
+        TEST_ASSERT_EQUAL(0, rb_ptree_for_each(snapshot, 100, 199, count_node,
+                                               &count));
+        TEST_ASSERT_EQUAL(100, count);
+        rb_ptree_dealloc(snapshot);
+}
+
+void test_rb_ptree_versions(void)
+{
+        struct rb_ptree *versions[NR_VERSIONS];
+        static unsigned char present[NR_VERSIONS + 1][INSERT_SIZE];
+        key_t key;
+
+        srand(7);
+        for (int v = 0; v <= NR_VERSIONS; v++) {
+                for (int i = 0; i < INSERT_SIZE; i++) {
+                        key = (key_t)rand() % INSERT_SIZE;
+                        if (rand() % 3) {
+                                TEST_ASSERT_EQUAL(0, rb_ptree_insert(ptree, key,
+                                                                     NULL));
+                                present[NR_VERSIONS][key] = 1;
+                        } else {
+                                TEST_ASSERT_EQUAL(
+                                        present[NR_VERSIONS][key] ? 0 : -ENODATA,
+                                        rb_ptree_delete(ptree, key));
+                                present[NR_VERSIONS][key] = 0;
+                        }
+                }
+                if (v == NR_VERSIONS) {
+                        break;
+                }
+                versions[v] = rb_ptree_snapshot(ptree);
+                TEST_ASSERT_NOT_NULL(versions[v]);
+                memcpy(present[v], present[NR_VERSIONS], INSERT_SIZE);
+        }
+
+        for (int v = 0; v <= NR_VERSIONS; v++) {
+                struct rb_ptree *version = v < NR_VERSIONS ? versions[v] : ptree;
+                size_t nr_nodes = 0;
+
+                TEST_ASSERT_GREATER_THAN(0, check_tree(version));
+                for (key = 0; key < INSERT_SIZE; key++) {
+                        TEST_ASSERT_EQUAL(present[v][key],
+                                          !!rb_ptree_search(version, key));
+                        nr_nodes += present[v][key];
+                }
+                TEST_ASSERT_EQUAL(nr_nodes, version->nr_nodes);
+        }
+        for (int v = 0; v < NR_VERSIONS; v += 2) { /**< release out of order */
+                rb_ptree_dealloc(versions[v]);
+        }
+        for (int v = 1; v < NR_VERSIONS; v += 2) {
+                rb_ptree_dealloc(versions[v]);
+        }
+}
+
+static atomic_int stop;
+
+static void *scanner(void *arg)
+{
+        struct rb_ptree *snapshot = NULL;
+        size_t count;
+        int *nr_invalid = (int *)arg;
+
+        while (!atomic_load(&stop)) {
+                snapshot = rb_ptree_snapshot(ptree);
+                count = 0;
+                rb_ptree_for_each(snapshot, 0, RB_MAX_KEY, count_node, &count);
+                if (count != snapshot->nr_nodes || check_tree(snapshot) < 0) {
+                        (*nr_invalid)++;
+                }
+                rb_ptree_dealloc(snapshot);
+        }
+        return NULL;
+}
+
+void test_rb_ptree_concurrent_snapshot(void)
+{
+        pthread_t thread;
+        int nr_invalid = 0;
+
+        for (key_t key = 0; key < INSERT_SIZE; key += 2) {
+                TEST_ASSERT_EQUAL(0, rb_ptree_insert(ptree, key, NULL));
+        }
+
+        atomic_store(&stop, 0);
+        TEST_ASSERT_EQUAL(0, pthread_create(&thread, NULL, scanner,
+                                            &nr_invalid));
+        for (int round = 0; round < NR_ROUNDS; round++) { /**< odd keys only */
+                for (key_t key = 1; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(0, rb_ptree_insert(ptree, key, NULL));
+                }
+                for (key_t key = 1; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(0, rb_ptree_delete(ptree, key));
+                }
+        }
+        atomic_store(&stop, 1);
+        pthread_join(thread, NULL);
+
+        TEST_ASSERT_EQUAL(0, nr_invalid);
+        TEST_ASSERT_EQUAL(INSERT_SIZE / 2, ptree->nr_nodes);
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_ptree_snapshot);
+        RUN_TEST(test_rb_ptree_versions);
+        RUN_TEST(test_rb_ptree_concurrent_snapshot);
+
+        return UNITY_END();
+}
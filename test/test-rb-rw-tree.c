@@ -0,0 +1,159 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "rb-rw-tree.h"
+#include "unity.h"
+
+#define INSERT_SIZE (1000)
+#define NR_READERS (4)
+#define NR_ROUNDS (50)
+
+struct rb_rw_tree *rwtree;
+
+struct reader_arg {
+        pthread_t thread;
+        int nr_missed;
+};
+
+void setUp(void)
+{
+        rwtree = rb_rw_tree_alloc(0);
+        TEST_ASSERT_NOT_NULL(rwtree);
+}
+
+void tearDown(void)
+{
+        if (rwtree) {
+                rb_rw_tree_dealloc(rwtree);
+        }
+}
+
+static int sum_keys(struct rb_node *node, void *arg)
+{
+        *(key_t *)arg += node->key;
+        return 0;
+}
+
+static int stop_at_ten(struct rb_node *node, void *arg)
+{
+        (void)arg;
+        return node->key == 10 ? -ECANCELED : 0;
+}
+
+static void *reader(void *arg)
+{
+        struct reader_arg *rarg = (struct reader_arg *)arg;
+
+        for (int round = 0; round < NR_ROUNDS; round++) {
+                for (key_t key = 0; key < INSERT_SIZE; key += 2) {
+                        if (rb_rw_tree_search(rwtree, key, NULL, NULL)) {
+                                rarg->nr_missed++;
+                        }
+                }
+        }
+        return NULL;
+}
+
+void test_rb_rw_parallel_search(void)
+{
+        struct reader_arg readers[NR_READERS];
+
+        for (key_t key = 0; key < INSERT_SIZE; key += 2) {
+                TEST_ASSERT_EQUAL(0, rb_rw_tree_insert(rwtree, key, NULL));
+        }
+
+        for (int i = 0; i < NR_READERS; i++) {
+                readers[i].nr_missed = 0;
+                TEST_ASSERT_EQUAL(0, pthread_create(&readers[i].thread, NULL,
+                                                    reader, &readers[i]));
+        }
+        for (int round = 0; round < NR_ROUNDS; round++) { /**< odd keys only */
+                for (key_t key = 1; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(0,
+                                          rb_rw_tree_insert(rwtree, key, NULL));
+                }
+                for (key_t key = 1; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(0, rb_rw_tree_delete(rwtree, key));
+                }
+        }
+        for (int i = 0; i < NR_READERS; i++) {
+                pthread_join(readers[i].thread, NULL);
+                TEST_ASSERT_EQUAL(0, readers[i].nr_missed);
+        }
+
+        TEST_ASSERT_EQUAL(-ENODATA, rb_rw_tree_search(rwtree, 1, NULL, NULL));
+        TEST_ASSERT_EQUAL(1, rb_rw_tree_count_key(rwtree, 2));
+}
+
+void test_rb_rw_for_each(void)
+{
+        key_t sum = 0;
+
+        for (key_t key = 1; key <= 20; key++) {
+                TEST_ASSERT_EQUAL(0, rb_rw_tree_insert(rwtree, key, NULL));
+        }
+
+        TEST_ASSERT_EQUAL(0, rb_rw_tree_for_each(rwtree, 5, 7, sum_keys, &sum));
+        TEST_ASSERT_EQUAL(5 + 6 + 7, sum);
+        TEST_ASSERT_EQUAL(-ECANCELED, rb_rw_tree_for_each(rwtree, 0, UINT64_MAX,
+                                                          stop_at_ten, NULL));
+
+        sum = 0;
+        TEST_ASSERT_EQUAL(-ENODATA,
+                          rb_rw_tree_lower_bound(rwtree, 21, NULL, NULL));
+        TEST_ASSERT_EQUAL(0, rb_rw_tree_upper_bound(rwtree, 19, sum_keys, &sum));
+        TEST_ASSERT_EQUAL(20, sum);
+}
+
+void test_rb_rw_split_and_concat(void)
+{
+        struct rb_rw_tree *upper = NULL;
+        struct rb_snapshot *snapshot = NULL;
+        struct rb_tree *tree = NULL;
+        struct rb_node *node = NULL;
+        key_t sum = 0;
+
+        for (key_t key = 1; key <= 20; key++) {
+                TEST_ASSERT_EQUAL(0, rb_rw_tree_insert(rwtree, key, NULL));
+        }
+
+        TEST_ASSERT_EQUAL(0, rb_rw_tree_split(rwtree, 10, &upper));
+        TEST_ASSERT_NOT_NULL(upper);
+        TEST_ASSERT_EQUAL(0, rb_rw_tree_search(rwtree, 10, NULL, NULL));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_rw_tree_search(rwtree, 11, NULL, NULL));
+        TEST_ASSERT_EQUAL(0, rb_rw_tree_search(upper, 11, NULL, NULL));
+
+        tree = rb_rw_tree_read_lock(upper); /**< use the core API directly */
+        TEST_ASSERT_EQUAL(11, rb_tree_minimum(tree, tree->root)->key);
+        rb_rw_tree_read_unlock(upper);
+
+        TEST_ASSERT_EQUAL(0, rb_rw_tree_delete(upper, 11));
+        node = rb_node_alloc(5); /**< not consumed by the failures */
+        TEST_ASSERT_EQUAL(-EINVAL, rb_rw_tree_concat(rwtree, upper, node));
+        node->key = 11;
+        snapshot = rb_tree_snapshot(tree);
+        TEST_ASSERT_NOT_NULL(snapshot);
+        TEST_ASSERT_EQUAL(-EBUSY, rb_rw_tree_concat(rwtree, upper, node));
+        rb_snapshot_release(snapshot);
+        TEST_ASSERT_EQUAL(0, rb_rw_tree_concat(rwtree, upper, node));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_rw_tree_search(upper, 12, NULL, NULL));
+        TEST_ASSERT_EQUAL(0, rb_rw_tree_for_each(rwtree, 0, UINT64_MAX,
+                                                 sum_keys, &sum));
+        TEST_ASSERT_EQUAL(20 * 21 / 2, sum);
+
+        TEST_ASSERT_EQUAL(0, rb_rw_tree_insert(upper, 100, NULL)); /**< reuse */
+        rb_rw_tree_dealloc(upper);
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_rw_parallel_search);
+        RUN_TEST(test_rb_rw_for_each);
+        RUN_TEST(test_rb_rw_split_and_concat);
+
+        return UNITY_END();
+}
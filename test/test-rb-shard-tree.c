@@ -0,0 +1,183 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "rb-shard-tree.h"
+#include "unity.h"
+
+#define INSERT_SIZE (4096)
+#define NR_SHARDS (8)
+#define NR_WRITERS (4)
+#define KEY_STEP (RB_MAX_KEY / INSERT_SIZE) /**< spread over the shards */
+
+struct rb_shard_tree *stree;
+
+struct writer_arg {
+        pthread_t thread;
+        key_t base;
+        int nr_failed;
+};
+
+void setUp(void)
+{
+        stree = rb_shard_tree_alloc(NR_SHARDS);
+        TEST_ASSERT_NOT_NULL(stree);
+}
+
+void tearDown(void)
+{
+        if (stree) {
+                rb_shard_tree_dealloc(stree);
+        }
+}
+
+/**
+ * @brief Iterate every key and check the order
+ *
+ * @return size_t number of the keys
+ */
+static size_t count_ordered(void)
+{
+        struct rb_shard_iter iter;
+        size_t count = 0;
+        key_t key, prev = 0;
+
+        rb_shard_iter_init(stree, &iter, 0);
+        while (rb_shard_iter_next(&iter, &key, NULL) == 0) {
+                if (count > 0) {
+                        TEST_ASSERT_TRUE(prev < key);
+                }
+                prev = key;
+                count++;
+        }
+        return count;
+}
+
+void test_rb_shard_routing(void)
+{
+        struct rb_shard_iter iter;
+        key_t key;
+
+        for (key_t i = 0; i < INSERT_SIZE; i++) {
+                TEST_ASSERT_EQUAL(0, rb_shard_tree_insert(stree, i * KEY_STEP,
+                                                          NULL));
+        }
+        TEST_ASSERT_EQUAL(0, rb_shard_tree_insert(stree, RB_MAX_KEY, NULL));
+        for (size_t i = 0; i < stree->nr_shards; i++) { /**< every range */
+                TEST_ASSERT_NOT_EQUAL(stree->shards[i]->tree->nil,
+                                      stree->shards[i]->tree->root);
+        }
+
+        TEST_ASSERT_EQUAL(0, rb_shard_tree_search(stree, 7 * KEY_STEP, NULL,
+                                                  NULL));
+        TEST_ASSERT_EQUAL(0, rb_shard_tree_delete(stree, 7 * KEY_STEP));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_shard_tree_search(stree, 7 * KEY_STEP,
+                                                         NULL, NULL));
+        TEST_ASSERT_EQUAL(INSERT_SIZE, count_ordered());
+
+        rb_shard_iter_init(stree, &iter, 6 * KEY_STEP + 1); /**< skips 7 */
+        TEST_ASSERT_EQUAL(0, rb_shard_iter_next(&iter, &key, NULL));
+        TEST_ASSERT_EQUAL(8 * KEY_STEP, key);
+        rb_shard_iter_init(stree, &iter, RB_MAX_KEY);
+        TEST_ASSERT_EQUAL(0, rb_shard_iter_next(&iter, &key, NULL));
+        TEST_ASSERT_EQUAL(RB_MAX_KEY, key);
+        TEST_ASSERT_EQUAL(-ENODATA, rb_shard_iter_next(&iter, &key, NULL));
+}
+
+void test_rb_shard_rebalance(void)
+{
+        size_t nr_used = 0;
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) { /**< all in shard 0 */
+                TEST_ASSERT_EQUAL(0, rb_shard_tree_insert(stree, key, NULL));
+        }
+        TEST_ASSERT_EQUAL(NR_SHARDS, stree->nr_shards);
+        for (size_t i = 0; i < stree->nr_shards; i++) {
+                if (stree->shards[i]->tree->root !=
+                    stree->shards[i]->tree->nil) {
+                        nr_used++;
+                }
+                if (i > 0) {
+                        TEST_ASSERT_TRUE(stree->bounds[i - 1] <
+                                         stree->bounds[i]);
+                }
+        }
+        TEST_ASSERT_GREATER_THAN(1, nr_used); /**< the hot range is split */
+        TEST_ASSERT_EQUAL(INSERT_SIZE, count_ordered());
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                TEST_ASSERT_EQUAL(0, rb_shard_tree_search(stree, key, NULL,
+                                                          NULL));
+                TEST_ASSERT_EQUAL(0, rb_shard_tree_delete(stree, key));
+        }
+        TEST_ASSERT_EQUAL(0, count_ordered());
+}
+
+void test_rb_shard_hot_middle(void)
+{
+        const key_t base = RB_MAX_KEY / 3;
+
+        rb_shard_tree_dealloc(stree);
+        stree = rb_shard_tree_alloc(3);
+        TEST_ASSERT_NOT_NULL(stree);
+        /**< both adjacent pairs have the hot shard, so nothing is merged */
+        for (key_t key = 0; key < 5000; key++) {
+                TEST_ASSERT_EQUAL(0, rb_shard_tree_insert(stree, base + key,
+                                                          NULL));
+        }
+        TEST_ASSERT_EQUAL(3, stree->nr_shards);
+        TEST_ASSERT_EQUAL(5000, count_ordered());
+        for (key_t key = 0; key < 5000; key++) {
+                TEST_ASSERT_EQUAL(0, rb_shard_tree_search(stree, base + key,
+                                                          NULL, NULL));
+        }
+}
+
+static void *writer(void *arg)
+{
+        struct writer_arg *warg = (struct writer_arg *)arg;
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                if (rb_shard_tree_insert(stree, warg->base + key, NULL)) {
+                        warg->nr_failed++;
+                }
+        }
+        for (key_t key = 0; key < INSERT_SIZE; key += 2) {
+                if (rb_shard_tree_delete(stree, warg->base + key)) {
+                        warg->nr_failed++;
+                }
+        }
+        return NULL;
+}
+
+void test_rb_shard_parallel_write(void)
+{
+        struct writer_arg writers[NR_WRITERS];
+
+        for (int i = 0; i < NR_WRITERS; i++) {
+                writers[i].base = (key_t)i * INSERT_SIZE;
+                writers[i].nr_failed = 0;
+                TEST_ASSERT_EQUAL(0, pthread_create(&writers[i].thread, NULL,
+                                                    writer, &writers[i]));
+        }
+        for (int i = 0; i < NR_WRITERS; i++) {
+                pthread_join(writers[i].thread, NULL);
+                TEST_ASSERT_EQUAL(0, writers[i].nr_failed);
+        }
+
+        TEST_ASSERT_EQUAL(NR_WRITERS * INSERT_SIZE / 2, count_ordered());
+        TEST_ASSERT_EQUAL(-ENODATA, rb_shard_tree_search(stree, 0, NULL, NULL));
+        TEST_ASSERT_EQUAL(0, rb_shard_tree_search(stree, 1, NULL, NULL));
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_shard_routing);
+        RUN_TEST(test_rb_shard_rebalance);
+        RUN_TEST(test_rb_shard_hot_middle);
+        RUN_TEST(test_rb_shard_parallel_write);
+
+        return UNITY_END();
+}
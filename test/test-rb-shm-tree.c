@@ -0,0 +1,196 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "rb-shm-tree.h"
+#include "unity.h"
+
+#define INSERT_SIZE (1000)
+#define NAME_SIZE (64)
+
+struct rb_shm_tree *stree;
+char name[NAME_SIZE];
+
+void setUp(void)
+{
+        snprintf(name, NAME_SIZE, "/rb-shm-test-%d", (int)getpid());
+        rb_shm_tree_unlink(name); /**< left by the previous crash */
+        stree = rb_shm_tree_create(name, INSERT_SIZE);
+        TEST_ASSERT_NOT_NULL(stree);
+}
+
+void tearDown(void)
+{
+        if (stree) {
+                rb_shm_tree_detach(stree);
+        }
+        rb_shm_tree_unlink(name);
+}
+
+/**
+ * @brief Check the order and the red-black properties of the subtree
+ *
+ * @return int black height (-1 means invalid)
+ */
+static int check_subtree(struct rb_shm_tree *t, rb_shm_off_t off,
+                         rb_shm_off_t parent, size_t *count)
+{
+        struct rb_shm_node *node = NULL;
+        int left, right;
+
+        if (!off) {
+                return 1;
+        }
+        node = rb_shm_node(t, off);
+        if (node->parent != parent || !node->in_use) {
+                return -1;
+        }
+        if (node->color == RB_NODE_COLOR_RED &&
+            ((node->left && rb_shm_node(t, node->left)->color ==
+                                    RB_NODE_COLOR_RED) ||
+             (node->right && rb_shm_node(t, node->right)->color ==
+                                     RB_NODE_COLOR_RED))) {
+                return -1;
+        }
+        if ((node->left && rb_shm_node(t, node->left)->key >= node->key) ||
+            (node->right && rb_shm_node(t, node->right)->key <= node->key)) {
+                return -1;
+        }
+        (*count)++;
+        left = check_subtree(t, node->left, off, count);
+        right = check_subtree(t, node->right, off, count);
+        if (left < 0 || left != right) {
+                return -1;
+        }
+        return left + (node->color == RB_NODE_COLOR_BLACK);
+}
+
+static void check_tree(struct rb_shm_tree *t)
+{
+        size_t count = 0;
+
+        TEST_ASSERT_GREATER_THAN(0, check_subtree(t, t->header->root, 0,
+                                                  &count));
+        TEST_ASSERT_EQUAL(t->header->nr_nodes, count);
+}
+
+void test_rb_shm_basic(void)
+{
+        struct rb_shm_tree *other = NULL;
+        uint64_t value = 0;
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                TEST_ASSERT_EQUAL(0, rb_shm_tree_insert(stree, key, key * 2));
+        }
+        TEST_ASSERT_EQUAL(-ENOSPC, rb_shm_tree_insert(stree, INSERT_SIZE, 0));
+        TEST_ASSERT_EQUAL(0, rb_shm_tree_insert(stree, 7, 77)); /**< update */
+        check_tree(stree);
+
+        for (key_t key = 0; key < INSERT_SIZE; key += 2) {
+                TEST_ASSERT_EQUAL(0, rb_shm_tree_delete(stree, key));
+        }
+        TEST_ASSERT_EQUAL(-ENODATA, rb_shm_tree_delete(stree, 0));
+        TEST_ASSERT_EQUAL(0, rb_shm_tree_insert(stree, INSERT_SIZE, 1));
+        check_tree(stree);
+
+        other = rb_shm_tree_attach(name); /**< mapped at another address */
+        TEST_ASSERT_NOT_NULL(other);
+        TEST_ASSERT_NOT_EQUAL(stree->header, other->header);
+        TEST_ASSERT_EQUAL(0, rb_shm_tree_search(other, 7, &value));
+        TEST_ASSERT_EQUAL(77, value);
+        TEST_ASSERT_EQUAL(0, rb_shm_tree_search(other, 9, &value));
+        TEST_ASSERT_EQUAL(18, value);
+        TEST_ASSERT_EQUAL(-ENODATA, rb_shm_tree_search(other, 8, NULL));
+        TEST_ASSERT_EQUAL(0, rb_shm_tree_search(other, INSERT_SIZE, NULL));
+        rb_shm_tree_detach(other);
+}
+
+void test_rb_shm_multi_process(void)
+{
+        int status = 0, nr_missed = 0;
+        pid_t pid;
+
+        for (key_t key = 0; key < INSERT_SIZE / 2; key++) {
+                TEST_ASSERT_EQUAL(0, rb_shm_tree_insert(stree, key, key));
+        }
+
+        pid = fork();
+        TEST_ASSERT_TRUE(pid >= 0);
+        if (pid == 0) { /**< writer process */
+                struct rb_shm_tree *child = rb_shm_tree_attach(name);
+                int nr_failed = !child;
+
+                for (key_t key = INSERT_SIZE / 2; child && key < INSERT_SIZE;
+                     key++) {
+                        nr_failed += !!rb_shm_tree_insert(child, key, key);
+                }
+                for (key_t key = 1; child && key < INSERT_SIZE / 2; key += 2) {
+                        nr_failed += !!rb_shm_tree_delete(child, key);
+                }
+                _exit(nr_failed ? 1 : 0);
+        }
+
+        while (waitpid(pid, &status, WNOHANG) == 0) { /**< lock-free reads */
+                for (key_t key = 0; key < INSERT_SIZE / 2; key += 2) {
+                        nr_missed += !!rb_shm_tree_search(stree, key, NULL);
+                }
+        }
+        TEST_ASSERT_TRUE(WIFEXITED(status));
+        TEST_ASSERT_EQUAL(0, WEXITSTATUS(status));
+        TEST_ASSERT_EQUAL(0, nr_missed);
+
+        TEST_ASSERT_EQUAL(INSERT_SIZE * 3 / 4, stree->header->nr_nodes);
+        TEST_ASSERT_EQUAL(0, rb_shm_tree_search(stree, INSERT_SIZE - 1, NULL));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_shm_tree_search(stree, 1, NULL));
+        check_tree(stree);
+}
+
+void test_rb_shm_owner_dead(void)
+{
+        int status = 0;
+        pid_t pid;
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                TEST_ASSERT_EQUAL(0, rb_shm_tree_insert(stree, key, key));
+        }
+        TEST_ASSERT_EQUAL(0, rb_shm_tree_delete(stree, 3));
+
+        pid = fork();
+        TEST_ASSERT_TRUE(pid >= 0);
+        if (pid == 0) { /**< dies in the middle of an update */
+                struct rb_shm_tree *child = rb_shm_tree_attach(name);
+
+                if (!child || rb_shm_tree_lock(child)) {
+                        _exit(1);
+                }
+                atomic_fetch_add(&child->header->seq, 1);
+                rb_shm_node(child, child->header->root)->left = 0;
+                _exit(0);
+        }
+        waitpid(pid, &status, 0);
+        TEST_ASSERT_EQUAL(0, WEXITSTATUS(status));
+        TEST_ASSERT_EQUAL(1, atomic_load(&stree->header->seq) & 1);
+
+        TEST_ASSERT_EQUAL(0, rb_shm_tree_search(stree, 0, NULL)); /**< recover */
+        TEST_ASSERT_EQUAL(0, atomic_load(&stree->header->seq) & 1);
+        TEST_ASSERT_EQUAL(INSERT_SIZE - 1, stree->header->nr_nodes);
+        check_tree(stree);
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                TEST_ASSERT_EQUAL(key == 3 ? -ENODATA : 0,
+                                  rb_shm_tree_search(stree, key, NULL));
+        }
+        TEST_ASSERT_EQUAL(0, rb_shm_tree_insert(stree, 3, 3)); /**< free slot */
+        TEST_ASSERT_EQUAL(-ENOSPC, rb_shm_tree_insert(stree, INSERT_SIZE, 0));
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_shm_basic);
+        RUN_TEST(test_rb_shm_multi_process);
+        RUN_TEST(test_rb_shm_owner_dead);
+
+        return UNITY_END();
+}
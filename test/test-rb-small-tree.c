@@ -0,0 +1,191 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+
+#include "rb-small-tree.h"
+#include "unity.h"
+
+#define KEY_RANGE (3 * RB_SMALL_KEYS)
+
+struct rb_small_tree *stree;
+
+void setUp(void)
+{
+        stree = rb_small_tree_alloc();
+        TEST_ASSERT_NOT_NULL(stree);
+}
+
+void tearDown(void)
+{
+        if (stree) {
+                rb_small_tree_dealloc(stree);
+        }
+}
+
+static key_t *key_data(key_t key)
+{
+        key_t *data = (key_t *)malloc(sizeof(key_t));
+
+        TEST_ASSERT_NOT_NULL(data);
+        *data = key;
+        return data;
+}
+
+/**
+ * @brief Check the form of the small tree and the order of its array
+ */
+static void check_small_tree(struct rb_small_tree *target)
+{
+        struct rb_node *node = NULL;
+        size_t nr_keys = 0;
+
+        TEST_ASSERT_TRUE(target->nr_keys <= KEY_RANGE);
+        if (!rb_small_tree_is_inline(target)) {
+                for (node = rb_tree_minimum(target->tree, target->tree->root);
+                     node != target->tree->nil;
+                     node = rb_tree_successor(target->tree, node)) {
+                        nr_keys++;
+                }
+                TEST_ASSERT_EQUAL(target->nr_keys, nr_keys);
+                return;
+        }
+        TEST_ASSERT_TRUE(target->nr_keys <= RB_SMALL_KEYS);
+        for (size_t i = 0; i < target->nr_keys; i++) {
+                TEST_ASSERT_TRUE(i == 0 ||
+                                 target->keys[i - 1] < target->keys[i]);
+                TEST_ASSERT_EQUAL(target->keys[i], *(key_t *)target->data[i]);
+        }
+}
+
+void test_rb_small_tree_random(void)
+{
+        int nr_grows = 0, nr_shrinks = 0;
+        int was_inline = 1;
+
+        srand(41);
+        for (int i = 0; i < 4000; i++) {
+                key_t key = (key_t)(rand() % KEY_RANGE);
+                /**< drifts the size over both thresholds */
+                int insert = (i / 500) % 2 ? (rand() % 4 == 0) :
+                                             (rand() % 4 != 0);
+
+                if (insert) {
+                        TEST_ASSERT_EQUAL(0, rb_small_tree_insert(
+                                                     stree, key, key_data(key)));
+                } else {
+                        rb_small_tree_delete(stree, key);
+                }
+                if (was_inline != rb_small_tree_is_inline(stree)) {
+                        was_inline ? nr_grows++ : nr_shrinks++;
+                        was_inline = rb_small_tree_is_inline(stree);
+                }
+                if (i % 50 == 0) {
+                        check_small_tree(stree);
+                }
+        }
+        check_small_tree(stree);
+        TEST_ASSERT_TRUE(nr_grows > 1);
+        TEST_ASSERT_TRUE(nr_shrinks > 1);
+}
+
+void test_rb_small_tree_split_form(void)
+{
+        struct rb_small_tree *t1 = NULL, *t2 = NULL;
+
+        for (key_t key = 0; key < RB_SMALL_KEYS + 4; key++) {
+                TEST_ASSERT_EQUAL(0, rb_small_tree_insert(stree, key * 2,
+                                                          key_data(key * 2)));
+        }
+        TEST_ASSERT_FALSE(rb_small_tree_is_inline(stree));
+        for (key_t x = 0; x < 2 * (RB_SMALL_KEYS + 4); x += 3) {
+                TEST_ASSERT_EQUAL(0, rb_small_tree_split(stree, x, &t1, &t2));
+                TEST_ASSERT_EQUAL(x / 2 + 1, t1->nr_keys);
+                TEST_ASSERT_EQUAL(t1->nr_keys <= RB_SMALL_SHRINK_KEYS,
+                                  rb_small_tree_is_inline(t1));
+                check_small_tree(t1);
+                check_small_tree(t2);
+                stree = rb_small_tree_concat(t1, t2);
+                TEST_ASSERT_NOT_NULL(stree);
+                check_small_tree(stree);
+                TEST_ASSERT_EQUAL(RB_SMALL_KEYS + 4, stree->nr_keys);
+        }
+
+        rb_small_tree_dealloc(stree);
+
+        /**< two arrays which do not fit in one array */
+        t1 = rb_small_tree_alloc();
+        t2 = rb_small_tree_alloc();
+        TEST_ASSERT_NOT_NULL(t1);
+        TEST_ASSERT_NOT_NULL(t2);
+        for (key_t key = 100; key < 110; key++) {
+                TEST_ASSERT_EQUAL(0, rb_small_tree_insert(t1, key,
+                                                          key_data(key)));
+                TEST_ASSERT_EQUAL(0, rb_small_tree_insert(t2, key + 10,
+                                                          key_data(key + 10)));
+        }
+        stree = rb_small_tree_concat(t1, t2);
+        TEST_ASSERT_NOT_NULL(stree);
+        TEST_ASSERT_FALSE(rb_small_tree_is_inline(stree));
+        TEST_ASSERT_EQUAL(20, stree->nr_keys);
+
+        /**< a tree side which fits in one array with the other side */
+        TEST_ASSERT_EQUAL(0, rb_small_tree_split(stree, 104, &t1, &t2));
+        TEST_ASSERT_TRUE(rb_small_tree_is_inline(t1));
+        TEST_ASSERT_FALSE(rb_small_tree_is_inline(t2));
+        for (key_t key = 116; key < 120; key++) {
+                TEST_ASSERT_EQUAL(0, rb_small_tree_delete(t2, key));
+        }
+        TEST_ASSERT_FALSE(rb_small_tree_is_inline(t2));
+        stree = rb_small_tree_concat(t1, t2);
+        TEST_ASSERT_NOT_NULL(stree);
+        TEST_ASSERT_TRUE(rb_small_tree_is_inline(stree));
+        TEST_ASSERT_EQUAL(RB_SMALL_KEYS, stree->nr_keys);
+        for (key_t key = 100; key < 116; key++) {
+                TEST_ASSERT_EQUAL(0, rb_small_tree_search(stree, key, NULL));
+        }
+}
+
+void test_rb_small_tree_threshold(void)
+{
+        size_t bytes;
+
+        TEST_ASSERT_EQUAL(sizeof(struct rb_small_tree),
+                          rb_small_tree_bytes(stree));
+        for (key_t key = 0; key < RB_SMALL_KEYS; key++) {
+                TEST_ASSERT_EQUAL(0, rb_small_tree_insert(stree, key,
+                                                          key_data(key)));
+        }
+        TEST_ASSERT_TRUE(rb_small_tree_is_inline(stree));
+        /**< one allocation instead of the tree and a node per key */
+        TEST_ASSERT_TRUE(rb_small_tree_bytes(stree) <
+                         sizeof(struct rb_tree) +
+                                 RB_SMALL_KEYS * sizeof(struct rb_node));
+        TEST_ASSERT_EQUAL(0, rb_small_tree_insert(stree, 3, key_data(3)));
+        TEST_ASSERT_TRUE(rb_small_tree_is_inline(stree));
+
+        TEST_ASSERT_EQUAL(0, rb_small_tree_insert(stree, RB_SMALL_KEYS,
+                                                  key_data(RB_SMALL_KEYS)));
+        TEST_ASSERT_FALSE(rb_small_tree_is_inline(stree));
+        bytes = rb_small_tree_bytes(stree);
+        TEST_ASSERT_TRUE(bytes > sizeof(struct rb_small_tree));
+        check_small_tree(stree);
+
+        for (key_t key = RB_SMALL_KEYS; key >= RB_SMALL_SHRINK_KEYS; key--) {
+                TEST_ASSERT_FALSE(rb_small_tree_is_inline(stree));
+                TEST_ASSERT_EQUAL(0, rb_small_tree_delete(stree, key));
+        }
+        TEST_ASSERT_TRUE(rb_small_tree_is_inline(stree));
+        TEST_ASSERT_EQUAL(RB_SMALL_SHRINK_KEYS, stree->nr_keys);
+        TEST_ASSERT_EQUAL(-ENODATA, rb_small_tree_delete(stree, RB_SMALL_KEYS));
+        check_small_tree(stree);
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_small_tree_random);
+        RUN_TEST(test_rb_small_tree_split_form);
+        RUN_TEST(test_rb_small_tree_threshold);
+
+        return UNITY_END();
+}
@@ -0,0 +1,165 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+
+#include "rb-td-tree.h"
+#include "unity.h"
+
+#define INSERT_SIZE (5000)
+
+struct rb_td_tree *tdtree;
+
+void setUp(void)
+{
+        tdtree = rb_td_tree_alloc();
+        TEST_ASSERT_NOT_NULL(tdtree);
+}
+
+void tearDown(void)
+{
+        if (tdtree) {
+                rb_td_tree_dealloc(tdtree);
+        }
+}
+
+static key_t *key_data(key_t key)
+{
+        key_t *data = (key_t *)malloc(sizeof(key_t));
+
+        TEST_ASSERT_NOT_NULL(data);
+        *data = key;
+        return data;
+}
+
+/**
+ * @brief Check the red-black properties of the subtree
+ *
+ * @return int black height of the subtree
+ */
+static int check_node(struct rb_td_node *node, key_t *prev, size_t *nr_keys)
+{
+        int left, right;
+
+        if (!node) {
+                return 1;
+        }
+        if (node->color == RB_NODE_COLOR_RED) {
+                TEST_ASSERT_TRUE(!node->link[RB_TD_LEFT] ||
+                                 node->link[RB_TD_LEFT]->color ==
+                                         RB_NODE_COLOR_BLACK);
+                TEST_ASSERT_TRUE(!node->link[RB_TD_RIGHT] ||
+                                 node->link[RB_TD_RIGHT]->color ==
+                                         RB_NODE_COLOR_BLACK);
+        } else {
+                TEST_ASSERT_EQUAL(RB_NODE_COLOR_BLACK, node->color);
+        }
+        left = check_node(node->link[RB_TD_LEFT], prev, nr_keys);
+        TEST_ASSERT_TRUE(*nr_keys == 0 || *prev < node->key);
+        TEST_ASSERT_EQUAL(node->key, *(key_t *)node->data);
+        *prev = node->key;
+        (*nr_keys)++;
+        right = check_node(node->link[RB_TD_RIGHT], prev, nr_keys);
+        TEST_ASSERT_EQUAL(left, right);
+        return left + (node->color == RB_NODE_COLOR_BLACK);
+}
+
+static void check_td_tree(struct rb_td_tree *target)
+{
+        size_t nr_keys = 0;
+        key_t prev = 0;
+
+        TEST_ASSERT_TRUE(!target->root ||
+                         target->root->color == RB_NODE_COLOR_BLACK);
+        check_node(target->root, &prev, &nr_keys);
+        TEST_ASSERT_EQUAL(target->nr_keys, nr_keys);
+}
+
+void test_rb_td_tree_random(void)
+{
+        /**< 8 bytes less than the same node with a parent pointer */
+        TEST_ASSERT_EQUAL(40, sizeof(struct rb_td_node));
+        srand(47);
+        for (int i = 0; i < 4 * INSERT_SIZE; i++) {
+                key_t key = (key_t)(rand() % INSERT_SIZE);
+
+                if (rand() % 3) {
+                        TEST_ASSERT_EQUAL(0, rb_td_tree_insert(
+                                                     tdtree, key, key_data(key)));
+                } else {
+                        rb_td_tree_delete(tdtree, key);
+                }
+                if (i % 997 == 0) {
+                        check_td_tree(tdtree);
+                }
+        }
+        check_td_tree(tdtree);
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                rb_td_tree_delete(tdtree, key);
+                if (key % 499 == 0) {
+                        check_td_tree(tdtree);
+                }
+        }
+        TEST_ASSERT_NULL(tdtree->root);
+        TEST_ASSERT_EQUAL(0, tdtree->nr_keys);
+        TEST_ASSERT_EQUAL(-ENODATA, rb_td_tree_delete(tdtree, 0));
+}
+
+void test_rb_td_tree_relink(void)
+{
+        struct rb_td_tree *t1 = NULL, *t2 = NULL;
+
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                TEST_ASSERT_EQUAL(0, rb_td_tree_insert(tdtree, key * 2,
+                                                       key_data(key * 2)));
+        }
+        for (key_t x = 0; x < 2 * INSERT_SIZE; x += 331) {
+                TEST_ASSERT_EQUAL(0, rb_td_tree_split(tdtree, x, &t1, &t2));
+                check_td_tree(t1);
+                check_td_tree(t2);
+                TEST_ASSERT_EQUAL(x / 2 + 1, t1->nr_keys);
+                tdtree = rb_td_tree_concat(t1, t2);
+                TEST_ASSERT_NOT_NULL(tdtree);
+                check_td_tree(tdtree);
+                TEST_ASSERT_EQUAL(INSERT_SIZE, tdtree->nr_keys);
+        }
+        /**< the linked tree is still updatable */
+        TEST_ASSERT_EQUAL(0, rb_td_tree_delete(tdtree, 0));
+        TEST_ASSERT_EQUAL(0, rb_td_tree_insert(tdtree, 1, key_data(1)));
+        check_td_tree(tdtree);
+}
+
+void test_rb_td_tree_iter(void)
+{
+        struct rb_td_iter iter;
+        void *data = NULL;
+        key_t key, expected = 15;
+
+        rb_td_iter_init(tdtree, &iter, 0);
+        TEST_ASSERT_EQUAL(-ENODATA, rb_td_iter_next(&iter, &key, NULL));
+        for (key = 0; key < INSERT_SIZE; key++) {
+                TEST_ASSERT_EQUAL(0, rb_td_tree_insert(tdtree, key * 3,
+                                                       key_data(key * 3)));
+        }
+        TEST_ASSERT_EQUAL(0, rb_td_tree_insert(tdtree, 3, key_data(3)));
+        TEST_ASSERT_EQUAL(INSERT_SIZE, tdtree->nr_keys);
+        check_td_tree(tdtree);
+
+        rb_td_iter_init(tdtree, &iter, 13);
+        while (rb_td_iter_next(&iter, &key, &data) == 0) {
+                TEST_ASSERT_EQUAL(expected, key);
+                TEST_ASSERT_EQUAL(key, *(key_t *)data);
+                expected += 3;
+        }
+        TEST_ASSERT_EQUAL(3 * INSERT_SIZE, expected);
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb_td_tree_random);
+        RUN_TEST(test_rb_td_tree_relink);
+        RUN_TEST(test_rb_td_tree_iter);
+
+        return UNITY_END();
+}
@@ -1,13 +1,22 @@
+#define _GNU_SOURCE /**< pthread_setaffinity_np */
+#define key_t sys_key_t /**< System V key_t is not the tree's key_t */
 #include <stdlib.h>
+#include <sched.h>
+#include <unistd.h>
 #include <time.h>
 #include <errno.h>
+#include <pthread.h>
+#undef key_t
 
 #include "rb-tree.h"
+#include "rb-arena.h"
 #include "unity.h"
 
 #define INSERT_SIZE (1000)
 #define STR_BUF_SIZE (256)
 #define NR_TREE (2)
+#define NR_READERS (4)
+#define NR_ROUNDS (20)
 
 struct rb_tree *tree_arr[NR_TREE];
 struct rb_tree *tree;
@@ -101,8 +110,7 @@ void test_rb_successor_and_predecessor(void)
         struct rb_node *succ, *pred, *cur;
         int i = 0;
         key_t values[] = { 10, 35, 5, 22 };
-        key_t expects[] = { RB_NODE_NIL_KEY_VALUE, 5, 10, 22, 35,
-                            RB_NODE_NIL_KEY_VALUE };
+        key_t expects[] = { 0, 5, 10, 22, 35, 0 }; /**< 0 means tree->nil */
         const int nr_expects = (int)(sizeof(expects) / sizeof(key_t));
         const int nr_values = (int)(sizeof(values) / sizeof(key_t));
         for (int i = 0; i < nr_values; i++) {
@@ -120,13 +128,250 @@ void test_rb_successor_and_predecessor(void)
 
                 cur = succ;
 
-                TEST_ASSERT_EQUAL(expects[i], pred->key);
-                TEST_ASSERT_EQUAL(expects[i + 2], succ->key);
+                if (expects[i] == 0) {
+                        TEST_ASSERT_EQUAL_PTR(tree->nil, pred);
+                } else {
+                        TEST_ASSERT_EQUAL(expects[i], pred->key);
+                }
+                if (expects[i + 2] == 0) {
+                        TEST_ASSERT_EQUAL_PTR(tree->nil, succ);
+                } else {
+                        TEST_ASSERT_EQUAL(expects[i + 2], succ->key);
+                }
         }
         TEST_ASSERT_EQUAL(tree->nil, cur);
         TEST_ASSERT_EQUAL(i, nr_expects - 2);
 }
 
+void test_rb_full_key_space(void)
+{
+        key_t values[] = { UINT64_MAX, 0, (key_t)LONG_MAX,
+                           (key_t)LONG_MAX + 1, UINT64_MAX - 1 };
+        key_t expects[] = { 0, (key_t)LONG_MAX, (key_t)LONG_MAX + 1,
+                            UINT64_MAX - 1, UINT64_MAX };
+        const int nr_values = (int)(sizeof(values) / sizeof(key_t));
+        struct rb_node *cur;
+        int i;
+
+        TEST_ASSERT_NULL(rb_tree_search(tree, (key_t)LONG_MAX));
+        for (i = 0; i < nr_values; i++) {
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, values[i], NULL));
+        }
+        for (i = 0; i < nr_values; i++) {
+                cur = rb_tree_search(tree, values[i]);
+                TEST_ASSERT_NOT_NULL(cur);
+                TEST_ASSERT_EQUAL_UINT64(values[i], cur->key);
+        }
+        TEST_ASSERT_NULL(rb_tree_search(tree, UINT64_MAX - 2));
+
+        for (i = 0, cur = rb_tree_minimum(tree, tree->root); cur != tree->nil;
+             i++, cur = rb_tree_successor(tree, cur)) {
+                TEST_ASSERT_EQUAL_UINT64(expects[i], cur->key);
+        }
+        TEST_ASSERT_EQUAL(nr_values, i);
+
+        TEST_ASSERT_EQUAL(0, rb_tree_delete(tree, UINT64_MAX));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_tree_delete(tree, UINT64_MAX));
+        TEST_ASSERT_EQUAL_UINT64(UINT64_MAX - 1,
+                                 rb_tree_maximum(tree, tree->root)->key);
+}
+
+static void *optimistic_reader(void *arg)
+{
+        long nr_missed = 0;
+
+        (void)arg;
+        for (int round = 0; round < NR_ROUNDS; round++) {
+                for (key_t key = 0; key < INSERT_SIZE; key += 2) {
+                        struct rb_node *node = rb_tree_search(tree, key);
+                        if (!node || node->key != key) {
+                                nr_missed++;
+                        }
+                }
+        }
+        return (void *)nr_missed;
+}
+
+/**
+ * @brief Pin the thread to the CPU (best effort)
+ */
+static void pin_cpu(pthread_t thread, long cpu)
+{
+        long nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET((int)(cpu % (nr_cpus > 0 ? nr_cpus : 1)), &set);
+        pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+
+static atomic_int nr_published; /**< keys which the writer inserted */
+
+static void *publish_reader(void *arg)
+{
+        long nr_missed = 0;
+        int last;
+
+        (void)arg;
+        pin_cpu(pthread_self(), 1);
+        while ((last = atomic_load(&nr_published)) < 16 * INSERT_SIZE) {
+                /**< the next key is just being linked by the writer */
+                rb_tree_search(tree, (key_t)last + 1);
+                if (last > 0 && !rb_tree_search(tree, (key_t)last - 1)) {
+                        nr_missed++;
+                }
+        }
+        return (void *)nr_missed;
+}
+
+void test_rb_optimistic_publish(void)
+{
+        pthread_t reader;
+        cpu_set_t saved;
+        void *nr_missed = NULL;
+
+        rb_tree_dealloc(tree_arr[0]);
+        tree = tree_arr[0] = rb_tree_alloc_flags(RB_TREE_FLAG_OPTIMISTIC);
+        TEST_ASSERT_NOT_NULL(tree);
+        atomic_store(&nr_published, 0);
+        pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved);
+        TEST_ASSERT_EQUAL(0, pthread_create(&reader, NULL, publish_reader,
+                                            NULL));
+        pin_cpu(pthread_self(), 0);
+        for (int key = 0; key < 16 * INSERT_SIZE; key++) {
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, (key_t)key, NULL));
+                atomic_store(&nr_published, key + 1);
+        }
+        pthread_join(reader, &nr_missed);
+        TEST_ASSERT_NULL(nr_missed);
+        pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+}
+
+void test_rb_optimistic_search(void)
+{
+        pthread_t readers[NR_READERS];
+        void *nr_missed = NULL;
+
+        rb_tree_dealloc(tree_arr[0]);
+        tree = tree_arr[0] = rb_tree_alloc_flags(RB_TREE_FLAG_OPTIMISTIC);
+        TEST_ASSERT_NOT_NULL(tree);
+        for (key_t key = 0; key < INSERT_SIZE; key += 2) {
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, key, NULL));
+        }
+
+        for (int i = 0; i < NR_READERS; i++) {
+                TEST_ASSERT_EQUAL(0, pthread_create(&readers[i], NULL,
+                                                    optimistic_reader, NULL));
+        }
+        for (int round = 0; round < NR_ROUNDS; round++) { /**< single writer */
+                for (key_t key = 1; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, key, NULL));
+                }
+                for (key_t key = 0; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, key,
+                                                            malloc(1)));
+                }
+                for (key_t key = 1; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(0, rb_tree_delete(tree, key));
+                }
+        }
+        for (int i = 0; i < NR_READERS; i++) {
+                pthread_join(readers[i], &nr_missed);
+                TEST_ASSERT_NULL(nr_missed);
+        }
+
+        TEST_ASSERT_NOT_NULL(tree->retired); /**< freed after the readers */
+        TEST_ASSERT_EQUAL(0, atomic_load(&tree->seq) & 1);
+        rb_tree_reclaim(tree);
+        TEST_ASSERT_NULL(tree->retired);
+        TEST_ASSERT_NULL(rb_tree_search(tree, 1));
+}
+
+static key_t *key_data(key_t key)
+{
+        key_t *data = (key_t *)malloc(sizeof(key_t));
+        *data = key;
+        return data;
+}
+
+static void *snapshot_reader(void *arg)
+{
+        struct rb_snapshot *snapshot = (struct rb_snapshot *)arg;
+        struct rb_snapshot_iter iter;
+        key_t expected, key;
+        void *data;
+
+        for (int round = 0; round < NR_ROUNDS; round++) {
+                expected = 0;
+                rb_snapshot_iter_init(snapshot, &iter, 0);
+                while (rb_snapshot_iter_next(&iter, &key, &data) == 0) {
+                        if (key != expected || *(key_t *)data != key) {
+                                return (void *)1;
+                        }
+                        expected += 2;
+                }
+                if (expected != INSERT_SIZE) {
+                        return (void *)1;
+                }
+        }
+        return NULL;
+}
+
+void test_rb_snapshot(void)
+{
+        struct rb_snapshot *snapshot = NULL;
+        struct rb_snapshot_iter iter;
+        struct rb_tree *t1 = NULL;
+        struct rb_tree *t2 = NULL;
+        pthread_t reader;
+        void *nr_missed = NULL;
+        key_t key;
+        void *data;
+
+        for (key = 0; key < INSERT_SIZE; key += 2) {
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, key, key_data(key)));
+        }
+        snapshot = rb_tree_snapshot(tree);
+        TEST_ASSERT_NOT_NULL(snapshot);
+        TEST_ASSERT_NULL(rb_tree_snapshot(tree)); /**< only one is live */
+
+        TEST_ASSERT_EQUAL(0, pthread_create(&reader, NULL, snapshot_reader,
+                                            snapshot));
+        for (int round = 0; round < NR_ROUNDS; round++) { /**< export runs */
+                for (key = 1; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, key, NULL));
+                }
+                for (key = 0; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, key,
+                                                            key_data(key)));
+                }
+                for (key = 0; key < INSERT_SIZE; key += 4) {
+                        TEST_ASSERT_EQUAL(0, rb_tree_delete(tree, key));
+                        TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, key,
+                                                            key_data(key)));
+                }
+                for (key = 1; key < INSERT_SIZE; key += 2) {
+                        TEST_ASSERT_EQUAL(0, rb_tree_delete(tree, key));
+                }
+        }
+        pthread_join(reader, &nr_missed);
+        TEST_ASSERT_NULL(nr_missed);
+        TEST_ASSERT_EQUAL(-EBUSY, rb_tree_split(tree, 10, &t1, &t2));
+        TEST_ASSERT_NULL(t1);
+
+        rb_snapshot_release(snapshot);
+        TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, INSERT_SIZE, NULL));
+        TEST_ASSERT_NULL(tree->snapshot); /**< freed by the writer */
+
+        snapshot = rb_tree_snapshot(tree);
+        TEST_ASSERT_NOT_NULL(snapshot);
+        rb_snapshot_iter_init(snapshot, &iter, INSERT_SIZE - 1);
+        TEST_ASSERT_EQUAL(0, rb_snapshot_iter_next(&iter, &key, &data));
+        TEST_ASSERT_EQUAL(INSERT_SIZE, key);
+        TEST_ASSERT_EQUAL(-ENODATA, rb_snapshot_iter_next(&iter, &key, &data));
+        rb_snapshot_release(snapshot); /**< freed by `rb_tree_dealloc` */
+}
+
 void test_rb_delete(void)
 {
         struct rb_node *node;
@@ -231,6 +476,23 @@ void test_rb_concat(void)
         }
 }
 
+void test_rb_concat_empty(void)
+{
+        struct rb_tree *t1 = tree_arr[0];
+        struct rb_tree *t2 = tree_arr[1];
+        struct rb_node *x = rb_node_alloc(0);
+
+        TEST_ASSERT_EQUAL(0, rb_tree_insert(t2, UINT64_MAX, NULL));
+        tree = rb_tree_concat(t1, t2, x); /**< t1 is empty */
+        TEST_ASSERT_NOT_NULL(tree);
+        tree_arr[0] = tree;
+        tree_arr[1] = NULL;
+
+        TEST_ASSERT_EQUAL_PTR(x, rb_tree_minimum(tree, tree->root));
+        TEST_ASSERT_EQUAL_UINT64(UINT64_MAX,
+                                 rb_tree_maximum(tree, tree->root)->key);
+}
+
 void test_rb_split(void)
 {
         struct rb_tree *tree = tree_arr[0];
@@ -256,6 +518,339 @@ void test_rb_split(void)
         rb_tree_dealloc(t2);
 }
 
+/**
+ * @brief Check the red-black properties of the subtree
+ * 
+ * @return int black height of the subtree (-1 means invalid)
+ */
+static int check_subtree(struct rb_tree *tree, struct rb_node *node)
+{
+        int left, right;
+
+        if (node == tree->nil) {
+                return 0;
+        }
+        if (node->color == RB_NODE_COLOR_RED &&
+            (node->left->color == RB_NODE_COLOR_RED ||
+             node->right->color == RB_NODE_COLOR_RED)) {
+                return -1;
+        }
+        if ((node->left != tree->nil && (node->left->parent != node ||
+                                         node->left->key > node->key)) ||
+            (node->right != tree->nil && (node->right->parent != node ||
+                                          node->right->key < node->key))) {
+                return -1;
+        }
+        left = check_subtree(tree, node->left);
+        right = check_subtree(tree, node->right);
+        if (left < 0 || left != right) {
+                return -1;
+        }
+        return left + (node->color == RB_NODE_COLOR_BLACK);
+}
+
+static void check_tree(struct rb_tree *tree)
+{
+        TEST_ASSERT_EQUAL(RB_NODE_COLOR_BLACK, tree->root->color);
+        TEST_ASSERT_EQUAL(tree->bh, check_subtree(tree, tree->root));
+}
+
+void test_rb_split_and_concat_balance(void)
+{
+        struct rb_tree *t1 = NULL;
+        struct rb_tree *t2 = NULL;
+        key_t split_points[] = { 0, 1, 250, 500, 999, RB_MAX_KEY };
+        const int nr_points = (int)(sizeof(split_points) / sizeof(key_t));
+        key_t key;
+
+        srand(3);
+        for (int i = 0; i < INSERT_SIZE; i++) {
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, (key_t)i, NULL));
+        }
+        for (int i = 0; i < INSERT_SIZE / 2; i++) { /**< irregular shape */
+                rb_tree_delete(tree, (key_t)(rand() % INSERT_SIZE));
+        }
+
+        for (int i = 0; i < nr_points; i++) {
+                TEST_ASSERT_EQUAL(0, rb_tree_split(tree, split_points[i], &t1,
+                                                   &t2));
+                check_tree(t1);
+                check_tree(t2);
+                if (t1->root != t1->nil) {
+                        TEST_ASSERT_TRUE(rb_tree_maximum(t1, t1->root)->key <=
+                                         split_points[i]);
+                }
+                if (t2->root != t2->nil) {
+                        TEST_ASSERT_TRUE(rb_tree_minimum(t2, t2->root)->key >
+                                         split_points[i]);
+                }
+
+                key = (t2->root != t2->nil) ?
+                              rb_tree_minimum(t2, t2->root)->key :
+                              INSERT_SIZE;
+                if (key == INSERT_SIZE) { /**< fresh joint node */
+                        tree = rb_tree_concat(t1, t2, rb_node_alloc(key));
+                        TEST_ASSERT_NOT_NULL(tree);
+                        TEST_ASSERT_EQUAL(0, rb_tree_delete(tree, key));
+                } else {
+                        tree = rb_tree_concat(t1, t2,
+                                              rb_tree_minimum(t2, t2->root));
+                        TEST_ASSERT_NOT_NULL(tree);
+                }
+                check_tree(tree);
+        }
+
+        t1 = rb_tree_alloc(); /**< fresh node which has the existing key */
+        tree = rb_tree_concat(tree, t1, rb_node_alloc(
+                                                rb_tree_maximum(tree, tree->root)
+                                                        ->key));
+        TEST_ASSERT_NOT_NULL(tree);
+        check_tree(tree);
+        tree_arr[0] = tree;
+}
+
+void test_rb_multi_insert_order(void)
+{
+        struct rb_tree *multi = rb_tree_alloc_flags(RB_TREE_FLAG_MULTI);
+        struct rb_node *first, *last, *cur;
+        key_t values[] = { 7, 3, 7, 9, 7, 3 };
+        const char *expects[] = { "0", "2", "4" };
+        const int nr_values = (int)(sizeof(values) / sizeof(key_t));
+        int i = 0;
+
+        TEST_ASSERT_NOT_NULL(multi);
+        for (i = 0; i < nr_values; i++) {
+                char *data = (char *)malloc(sizeof(char) * STR_BUF_SIZE);
+                sprintf(data, "%d", i);
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(multi, values[i], data));
+        }
+
+        TEST_ASSERT_EQUAL(0, rb_tree_equal_range(multi, 7, &first, &last));
+        for (i = 0, cur = first; cur != last; i++) {
+                TEST_ASSERT_EQUAL(7, cur->key);
+                TEST_ASSERT_EQUAL_STRING(expects[i], cur->data);
+                cur = rb_tree_successor(multi, cur);
+        }
+        TEST_ASSERT_EQUAL(3, i);
+        TEST_ASSERT_EQUAL(9, last->key);
+        TEST_ASSERT_EQUAL_PTR(first, rb_tree_search(multi, 7));
+
+        TEST_ASSERT_EQUAL(3, rb_tree_count_key(multi, 7));
+        TEST_ASSERT_EQUAL(2, rb_tree_count_key(multi, 3));
+        TEST_ASSERT_EQUAL(1, rb_tree_count_key(multi, 9));
+        TEST_ASSERT_EQUAL(0, rb_tree_count_key(multi, 5));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_tree_equal_range(multi, 5, &first, &last));
+
+        rb_tree_dealloc(multi);
+}
+
+void test_rb_multi_delete(void)
+{
+        struct rb_tree *multi = rb_tree_alloc_flags(RB_TREE_FLAG_MULTI);
+        struct rb_node *first, *last;
+
+        TEST_ASSERT_NOT_NULL(multi);
+        for (int i = 0; i < INSERT_SIZE; i++) {
+                char *data = (char *)malloc(sizeof(char) * STR_BUF_SIZE);
+                sprintf(data, "%d", i);
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(multi, i % 10, data));
+        }
+        TEST_ASSERT_EQUAL(INSERT_SIZE / 10, rb_tree_count_key(multi, 4));
+
+        /**< the oldest duplicate must be deleted first */
+        TEST_ASSERT_EQUAL(0, rb_tree_delete(multi, 4));
+        TEST_ASSERT_EQUAL_STRING("14", rb_tree_search(multi, 4)->data);
+
+        /**< delete the newest duplicate */
+        TEST_ASSERT_EQUAL(0, rb_tree_equal_range(multi, 4, &first, &last));
+        TEST_ASSERT_EQUAL(0, rb_tree_delete_node(
+                                     multi, rb_tree_predecessor(multi, last)));
+        TEST_ASSERT_EQUAL(INSERT_SIZE / 10 - 2, rb_tree_count_key(multi, 4));
+
+        for (int i = 0; i < INSERT_SIZE; i++) {
+                rb_tree_delete(multi, i % 10);
+        }
+        TEST_ASSERT_EQUAL(0, rb_tree_count_key(multi, 4));
+        TEST_ASSERT_EQUAL_PTR(multi->nil, multi->root);
+
+        rb_tree_dealloc(multi);
+}
+
+void test_rb_multi_concat(void)
+{
+        struct rb_tree *t1 = rb_tree_alloc_flags(RB_TREE_FLAG_MULTI);
+        struct rb_tree *t2 = rb_tree_alloc_flags(RB_TREE_FLAG_MULTI);
+        struct rb_tree *multi = NULL;
+        key_t t1_data[] = { 1, 2, 3, 5, 5 };
+        key_t t2_data[] = { 5, 5, 8, 9, 10 };
+        const int nr_t1_data = (int)(sizeof(t1_data) / sizeof(key_t));
+        const int nr_t2_data = (int)(sizeof(t2_data) / sizeof(key_t));
+
+        for (int i = 0; i < nr_t1_data; i++) {
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(t1, t1_data[i], NULL));
+        }
+        for (int i = 0; i < nr_t2_data; i++) {
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(t2, t2_data[i], NULL));
+        }
+
+        multi = rb_tree_concat(t1, t2, rb_tree_search(t2, 5));
+        TEST_ASSERT_NOT_NULL(multi);
+        TEST_ASSERT_EQUAL(4, rb_tree_count_key(multi, 5));
+        TEST_ASSERT_EQUAL(1, rb_tree_count_key(multi, 10));
+
+        rb_tree_dealloc(multi);
+}
+
+void test_rb_apply_batch(void)
+{
+        const size_t nr_ops = 8 * RB_BATCH_MIN_OPS;
+        struct rb_batch_op *ops = calloc(nr_ops, sizeof(*ops));
+        struct rb_batch_op *expects = calloc(nr_ops, sizeof(*expects));
+        struct rb_tree *serial = tree_arr[1];
+        struct rb_node *x, *y;
+
+        TEST_ASSERT_NOT_NULL(ops);
+        TEST_ASSERT_NOT_NULL(expects);
+        srand(5);
+        for (key_t key = 0; key < INSERT_SIZE; key += 2) {
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, key, NULL));
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(serial, key, NULL));
+        }
+        for (size_t i = 0; i < nr_ops; i++) { /**< many ops hit the same key */
+                ops[i].type = (rand() % 3) ? RB_BATCH_INSERT : RB_BATCH_DELETE;
+                ops[i].key = (key_t)(rand() % (2 * INSERT_SIZE));
+        }
+        memcpy(expects, ops, sizeof(*ops) * nr_ops);
+
+        TEST_ASSERT_EQUAL(0, rb_tree_apply_batch(tree, ops, nr_ops, 4));
+        TEST_ASSERT_EQUAL(0, rb_tree_apply_batch(serial, expects, nr_ops, 1));
+        check_tree(tree);
+        for (size_t i = 0; i < nr_ops; i++) {
+                TEST_ASSERT_EQUAL(expects[i].ret, ops[i].ret);
+        }
+        x = rb_tree_minimum(tree, tree->root);
+        y = rb_tree_minimum(serial, serial->root);
+        while (x != tree->nil && y != serial->nil) {
+                TEST_ASSERT_EQUAL(y->key, x->key);
+                x = rb_tree_successor(tree, x);
+                y = rb_tree_successor(serial, y);
+        }
+        TEST_ASSERT_EQUAL_PTR(tree->nil, x);
+        TEST_ASSERT_EQUAL_PTR(serial->nil, y);
+
+        free(ops);
+        free(expects);
+}
+
+void test_rb_relayout(void)
+{
+        struct rb_relayout_stats stats;
+        struct rb_tree *t1 = NULL, *t2 = NULL;
+        struct rb_node *node = NULL;
+
+        srand(7);
+        for (int i = 0; i < INSERT_SIZE; i++) {
+                key_t key = (key_t)(rand() % (8 * INSERT_SIZE));
+                key_t *data = (key_t *)malloc(sizeof(key_t));
+                *data = key;
+                if (rb_tree_insert(tree, key, data)) {
+                        free(data);
+                }
+        }
+        TEST_ASSERT_EQUAL(0, rb_tree_relayout(tree, &stats));
+        check_tree(tree);
+        TEST_ASSERT_TRUE(stats.lines_after <= stats.lines_before);
+        TEST_ASSERT_TRUE(stats.lines_after == rb_tree_search_lines(tree));
+
+        for (key_t key = 0; key < 8 * INSERT_SIZE; key += 3) { /**< churn */
+                rb_tree_delete(tree, key);
+                key_t *data = (key_t *)malloc(sizeof(key_t));
+                *data = key + 1;
+                if (rb_tree_insert(tree, key + 1, data)) {
+                        free(data);
+                }
+        }
+        TEST_ASSERT_EQUAL(0, rb_tree_relayout(tree, &stats));
+        check_tree(tree);
+        TEST_ASSERT_TRUE(stats.nr_nodes > 0);
+        for (node = rb_tree_minimum(tree, tree->root); node != tree->nil;
+             node = rb_tree_successor(tree, node)) {
+                TEST_ASSERT_EQUAL(node->key, *(key_t *)node->data);
+                TEST_ASSERT_EQUAL_PTR(node, rb_tree_search(tree, node->key));
+        }
+
+        TEST_ASSERT_EQUAL(0, rb_tree_split(tree, 4 * INSERT_SIZE, &t1, &t2));
+        tree_arr[0] = NULL;
+        TEST_ASSERT_EQUAL(0, rb_tree_relayout(t2, NULL));
+        rb_tree_dealloc(t1); /**< the arena lives for t2's nodes */
+        check_tree(t2);
+        rb_tree_dealloc(t2);
+}
+
+void test_rb_compact(void)
+{
+        struct rb_tree *multi = rb_tree_alloc_flags(RB_TREE_FLAG_MULTI);
+        struct rb_cursor cursor;
+        struct rb_node *node = NULL, *next = NULL;
+        int ret, nr_calls = 0, nr_gaps = 0;
+
+        srand(9);
+        for (key_t key = 0; key < INSERT_SIZE; key++) {
+                key_t *data = (key_t *)malloc(sizeof(key_t));
+                *data = key;
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(tree, key, data));
+        }
+        rb_tree_cursor_attach(tree, &cursor, rb_tree_search(tree, 500));
+        do { /**< the tree changes between the calls */
+                ret = rb_tree_compact(tree, 64);
+                nr_calls++;
+                rb_tree_delete(tree, (key_t)(rand() % INSERT_SIZE) * 2 + 1);
+                TEST_ASSERT_EQUAL(500, cursor.node->key);
+                check_tree(tree);
+        } while (ret == -EAGAIN);
+        TEST_ASSERT_EQUAL(0, ret);
+        TEST_ASSERT_TRUE(nr_calls >= INSERT_SIZE / 64);
+        TEST_ASSERT_EQUAL_PTR(rb_tree_search(tree, 500), cursor.node);
+
+        TEST_ASSERT_EQUAL(0, rb_tree_compact(tree, SIZE_MAX));
+        for (node = rb_tree_minimum(tree, tree->root); node != tree->nil;
+             node = next) {
+                TEST_ASSERT_EQUAL(node->key, *(key_t *)node->data);
+                next = rb_tree_successor(tree, node);
+                nr_gaps += (next != tree->nil &&
+                            (char *)next - (char *)node !=
+                                    sizeof(struct rb_arena_slot));
+        }
+        TEST_ASSERT_TRUE(nr_gaps < 4); /**< only between the blocks */
+        rb_tree_cursor_detach(tree, &cursor);
+        TEST_ASSERT_NULL(tree->cursors);
+
+        TEST_ASSERT_NOT_NULL(multi); /**< the same keys over the calls */
+        for (int i = 0; i < INSERT_SIZE; i++) {
+                TEST_ASSERT_EQUAL(0, rb_tree_insert(multi, (key_t)(i % 4), NULL));
+        }
+        nr_calls = 0;
+        while ((ret = rb_tree_compact(multi, 10)) == -EAGAIN) {
+                nr_calls++;
+        }
+        TEST_ASSERT_EQUAL(0, ret);
+        TEST_ASSERT_EQUAL(INSERT_SIZE / 10 - 1, nr_calls);
+        TEST_ASSERT_EQUAL(INSERT_SIZE / 4, rb_tree_count_key(multi, 3));
+
+        TEST_ASSERT_EQUAL(-EAGAIN, rb_tree_compact(multi, 1));
+        node = rb_tree_successor(multi, rb_tree_minimum(multi, multi->root));
+        TEST_ASSERT_EQUAL(0, rb_tree_delete_node(multi, node)); /**< resume */
+        nr_calls = 0;
+        while ((ret = rb_tree_compact(multi, 10)) == -EAGAIN) {
+                nr_calls++;
+        }
+        TEST_ASSERT_EQUAL((INSERT_SIZE - 2) / 10, nr_calls);
+        TEST_ASSERT_EQUAL(0, ret);
+        TEST_ASSERT_EQUAL(INSERT_SIZE / 4 - 1, rb_tree_count_key(multi, 0));
+        check_tree(multi);
+        rb_tree_dealloc(multi);
+}
+
 int main(void)
 {
         UNITY_BEGIN();
@@ -266,10 +861,22 @@ int main(void)
         RUN_TEST(test_rb_minimum);
         RUN_TEST(test_rb_maximum);
         RUN_TEST(test_rb_successor_and_predecessor);
+        RUN_TEST(test_rb_full_key_space);
+        RUN_TEST(test_rb_optimistic_search);
+        RUN_TEST(test_rb_optimistic_publish);
+        RUN_TEST(test_rb_snapshot);
         RUN_TEST(test_rb_delete);
         RUN_TEST(test_rb_bh);
         RUN_TEST(test_rb_concat);
+        RUN_TEST(test_rb_concat_empty);
         RUN_TEST(test_rb_split);
+        RUN_TEST(test_rb_split_and_concat_balance);
+        RUN_TEST(test_rb_apply_batch);
+        RUN_TEST(test_rb_relayout);
+        RUN_TEST(test_rb_compact);
+        RUN_TEST(test_rb_multi_insert_order);
+        RUN_TEST(test_rb_multi_delete);
+        RUN_TEST(test_rb_multi_concat);
 
         return UNITY_END();
 }
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include <stdlib.h>
+#include <errno.h>
+
+#include "rb-tree128.h"
+#include "unity.h"
+
+#define NR_SHARD (8)
+#define NR_ID (128)
+
+struct rb_tree128 *tree;
+
+void setUp(void)
+{
+        tree = rb_tree128_alloc();
+        TEST_ASSERT_NOT_NULL(tree);
+}
+
+void tearDown(void)
+{
+        rb_tree128_dealloc(tree);
+}
+
+void test_rb128_composite_order(void)
+{
+        struct rb_node128 *node;
+        uint64_t shard, id;
+        int count = 0;
+
+        for (id = 0; id < NR_ID; id++) { /**< insert id major order */
+                for (shard = 0; shard < NR_SHARD; shard++) {
+                        TEST_ASSERT_EQUAL(0, rb_tree128_insert(
+                                                     tree,
+                                                     rb_key128_make(shard, UINT64_MAX - id),
+                                                     NULL));
+                }
+        }
+        TEST_ASSERT_EQUAL(NR_SHARD * NR_ID, tree->nr_nodes);
+
+        for (node = rb_tree128_first(tree); node;
+             node = rb_tree128_next(node), count++) {
+                shard = (uint64_t)count / NR_ID;
+                id = UINT64_MAX - (NR_ID - 1) + (uint64_t)count % NR_ID;
+                TEST_ASSERT_EQUAL_UINT64(shard, node->key.hi);
+                TEST_ASSERT_EQUAL_UINT64(id, node->key.lo);
+        }
+        TEST_ASSERT_EQUAL(NR_SHARD * NR_ID, count);
+
+        node = rb_tree128_lower_bound(tree, rb_key128_make(3, 0));
+        TEST_ASSERT_EQUAL_UINT64(3, node->key.hi);
+        TEST_ASSERT_EQUAL_UINT64(UINT64_MAX - (NR_ID - 1), node->key.lo);
+        TEST_ASSERT_EQUAL_UINT64(2, rb_tree128_prev(node)->key.hi);
+        TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, rb_tree128_prev(node)->key.lo);
+        TEST_ASSERT_NULL(rb_tree128_lower_bound(tree,
+                                                rb_key128_make(NR_SHARD, 0)));
+}
+
+void test_rb128_update_and_delete(void)
+{
+        struct rb_key128 key = rb_key128_make(UINT64_MAX, UINT64_MAX);
+        struct rb_node128 *node;
+        int *data = (int *)malloc(sizeof(int));
+
+        *data = 1;
+        TEST_ASSERT_EQUAL(0, rb_tree128_insert(tree, key, NULL));
+        TEST_ASSERT_EQUAL(0, rb_tree128_insert(tree, key, data));
+        TEST_ASSERT_EQUAL(1, tree->nr_nodes);
+
+        node = rb_tree128_search(tree, key);
+        TEST_ASSERT_NOT_NULL(node);
+        TEST_ASSERT_EQUAL_PTR(data, node->data);
+        TEST_ASSERT_EQUAL_PTR(node, rb_tree128_last(tree));
+        TEST_ASSERT_NULL(rb_tree128_search(tree,
+                                           rb_key128_make(UINT64_MAX, 0)));
+
+        TEST_ASSERT_EQUAL(0, rb_tree128_delete(tree, key));
+        TEST_ASSERT_EQUAL(-ENODATA, rb_tree128_delete(tree, key));
+        TEST_ASSERT_NULL(rb_tree128_first(tree));
+        TEST_ASSERT_EQUAL(0, tree->nr_nodes);
+}
+
+int main(void)
+{
+        UNITY_BEGIN();
+
+        RUN_TEST(test_rb128_composite_order);
+        RUN_TEST(test_rb128_update_and_delete);
+
+        return UNITY_END();
+}